@@ -36,6 +36,7 @@ typedef struct {
 	gboolean       view_destination;
 	GFile         *catalog_file;
 	GthCatalog    *catalog;
+	gboolean       appending;
 } AddData;
 
 
@@ -93,6 +94,10 @@ get_selected_catalog (DialogData *data)
 }
 
 
+static void add_data_save_catalog (AddData  *add_data,
+				   gboolean  append);
+
+
 static void
 catalog_save_done_cb (void     **buffer,
 		      gsize      count,
@@ -101,11 +106,19 @@ catalog_save_done_cb (void     **buffer,
 {
 	AddData *add_data = user_data;
 
+	if ((error != NULL) && add_data->appending) {
+		/* the file changed since it was loaded, rewrite it */
+		add_data_save_catalog (add_data, FALSE);
+		return;
+	}
+
 	if (error != NULL) {
 		_gtk_error_dialog_from_gerror_show (GTK_WINDOW (add_data->parent_window), _("Could not add the files to the catalog"), error);
 		return;
 	}
 
+	gth_catalog_data_saved (add_data->catalog);
+
 	gth_monitor_folder_changed (gth_main_get_default_monitor (),
 				    add_data->catalog_file,
 				    add_data->files,
@@ -121,6 +134,44 @@ catalog_save_done_cb (void     **buffer,
 }
 
 
+static void
+add_data_save_catalog (AddData  *add_data,
+		       gboolean  append)
+{
+	char    *buffer;
+	gsize    length;
+	goffset  file_size;
+	GFile   *gio_file;
+
+	gio_file = gth_catalog_file_to_gio_file (add_data->catalog_file);
+	buffer = append ? gth_catalog_to_log_data (add_data->catalog, &length, &file_size) : NULL;
+	add_data->appending = (buffer != NULL);
+	if (add_data->appending) {
+		_g_file_append_async (gio_file,
+				      file_size,
+				      buffer,
+				      length,
+				      G_PRIORITY_DEFAULT,
+				      NULL,
+				      catalog_save_done_cb,
+				      add_data);
+	}
+	else {
+		buffer = gth_catalog_to_data (add_data->catalog, &length);
+		_g_file_write_async (gio_file,
+				     buffer,
+				     length,
+				     TRUE,
+				     G_PRIORITY_DEFAULT,
+				     NULL,
+				     catalog_save_done_cb,
+				     add_data);
+	}
+
+	g_object_unref (gio_file);
+}
+
+
 static void
 catalog_ready_cb (GObject  *catalog,
 		  GError   *error,
@@ -128,9 +179,6 @@ catalog_ready_cb (GObject  *catalog,
 {
 	AddData *add_data = user_data;
 	GList   *scan;
-	char    *buffer;
-	gsize    length;
-	GFile   *gio_file;
 
 	if (error != NULL) {
 		_gtk_error_dialog_from_gerror_show (GTK_WINDOW (add_data->parent_window), _("Could not add the files to the catalog"), error);
@@ -142,18 +190,7 @@ catalog_ready_cb (GObject  *catalog,
 	for (scan = add_data->files; scan; scan = scan->next)
 		gth_catalog_insert_file (add_data->catalog, (GFile *) scan->data, -1);
 
-	buffer = gth_catalog_to_data (add_data->catalog, &length);
-	gio_file = gth_catalog_file_to_gio_file (add_data->catalog_file);
-	_g_file_write_async (gio_file,
-			     buffer,
-			     length,
-			     TRUE,
-			     G_PRIORITY_DEFAULT,
-			     NULL,
-			     catalog_save_done_cb,
-			     add_data);
-
-	g_object_unref (gio_file);
+	add_data_save_catalog (add_data, TRUE);
 }
 
 
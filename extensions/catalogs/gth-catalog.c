@@ -28,6 +28,20 @@
 
 
 #define CATALOG_FORMAT "1.0"
+#define LOG_FORMAT_HEADER "#gthumb-catalog-log 1.0 "
+#define LOG_FORMAT_MIN_FILES 1000
+#define LOG_FORMAT_MAX_GARBAGE 1000
+
+
+/* Catalogs with many files are saved in the log format: a header line with
+ * the size of the catalog document, the catalog document without the file
+ * list, and a line for each change of the file list, '+' followed by the
+ * uri for an added file, '-' followed by the uri for a removed file.
+ * Adding or removing files appends the changes to the file instead of
+ * rewriting it, the file is rewritten when the removed files take too
+ * much space.  The changes are appended only if the file still has the
+ * size it had when loaded or last saved, and if it ends with a complete
+ * line, otherwise the file is rewritten. */
 
 
 struct _GthCatalogPrivate {
@@ -41,6 +55,14 @@ struct _GthCatalogPrivate {
 	char           *order;
 	gboolean        order_inverse;
 	GCancellable   *cancellable;
+	gboolean        log_format;       /* writing the document of the log format */
+	GString        *log;              /* changes not saved yet, NULL if the file must be rewritten */
+	goffset         log_file_size;    /* size of the saved file, -1 if not known */
+	int             log_records;      /* records saved in the file */
+	int             log_new_records;  /* records in log */
+	gboolean        saving_log;       /* the data being saved is the log */
+	goffset         saving_size;      /* size of the data being saved, -1 if none */
+	int             saving_records;   /* records in the log being saved */
 };
 
 
@@ -62,6 +84,8 @@ gth_catalog_finalize (GObject *object)
 		g_hash_table_destroy (catalog->priv->file_hash);
 		gth_datetime_free (catalog->priv->date_time);
 		g_free (catalog->priv->order);
+		if (catalog->priv->log != NULL)
+			g_string_free (catalog->priv->log, TRUE);
 		g_free (catalog->priv);
 		catalog->priv = NULL;
 	}
@@ -70,6 +94,85 @@ gth_catalog_finalize (GObject *object)
 }
 
 
+static void
+_gth_catalog_log_reset (GthCatalog *catalog,
+			gboolean    log_format,
+			int         n_records,
+			goffset     file_size)
+{
+	if (catalog->priv->log != NULL) {
+		g_string_free (catalog->priv->log, TRUE);
+		catalog->priv->log = NULL;
+	}
+	if (log_format)
+		catalog->priv->log = g_string_new ("");
+	catalog->priv->log_file_size = file_size;
+	catalog->priv->log_records = n_records;
+	catalog->priv->log_new_records = 0;
+}
+
+
+static void
+_gth_catalog_log_invalidate (GthCatalog *catalog)
+{
+	_gth_catalog_log_reset (catalog, FALSE, 0, -1);
+}
+
+
+static void
+_gth_catalog_log_add_record (GthCatalog *catalog,
+			     char        op,
+			     GFile      *file)
+{
+	char *uri;
+
+	if (catalog->priv->log == NULL)
+		return;
+
+	uri = g_file_get_uri (file);
+	g_string_append_c (catalog->priv->log, op);
+	g_string_append (catalog->priv->log, uri);
+	g_string_append_c (catalog->priv->log, '\n');
+	catalog->priv->log_new_records++;
+
+	g_free (uri);
+}
+
+
+/* Returns the catalog document of a file saved in the log format, or NULL
+ * if @buffer is not in the log format. */
+static const char *
+_gth_catalog_log_get_document (const char *buffer,
+			       gsize       count,
+			       gsize      *document_size)
+{
+	gsize       header_size;
+	const char *line_end;
+	char       *size_end;
+	guint64     size;
+
+	header_size = strlen (LOG_FORMAT_HEADER);
+	if ((count <= header_size) || (strncmp (buffer, LOG_FORMAT_HEADER, header_size) != 0))
+		return NULL;
+
+	line_end = memchr (buffer, '\n', count);
+	if (line_end == NULL)
+		return NULL;
+
+	size = g_ascii_strtoull (buffer + header_size, &size_end, 10);
+	if (size_end != line_end)
+		return NULL;
+
+	line_end++;
+	if (size > count - (line_end - buffer))
+		return NULL;
+
+	*document_size = size;
+
+	return line_end;
+}
+
+
 static DomElement *
 base_create_root (GthCatalog  *catalog,
 		  DomDocument *doc)
@@ -118,19 +221,194 @@ base_read_from_doc (GthCatalog *catalog,
 }
 
 
+/* Replaces the file list with the files in @uris. */
+static void
+_gth_catalog_set_uri_list (GthCatalog *catalog,
+			   GList      *uris)
+{
+	GList *file_list;
+	GList *scan;
+
+	_g_object_list_unref (catalog->priv->file_list);
+	g_hash_table_remove_all (catalog->priv->file_hash);
+
+	file_list = NULL;
+	for (scan = uris; scan; scan = scan->next) {
+		GFile *file;
+
+		file = g_file_new_for_uri ((char *) scan->data);
+		if (g_hash_table_lookup (catalog->priv->file_hash, file) != NULL) {
+			g_object_unref (file);
+			continue;
+		}
+		file_list = g_list_prepend (file_list, file);
+		g_hash_table_insert (catalog->priv->file_hash, file, GINT_TO_POINTER (1));
+	}
+	catalog->priv->file_list = g_list_reverse (file_list);
+}
+
+
+/* The file list is read without creating the DOM nodes, the other elements
+ * are loaded in a DomDocument for the read_from_doc functions. */
+
+
+typedef struct {
+	DomDocument *doc;
+	GQueue       open_nodes;
+	gboolean     file_list;
+	GList       *uris;
+} ReadData;
+
+
+static void
+read_start_element (int          depth,
+		    const char  *element_name,
+		    const char **attribute_names,
+		    const char **attribute_values,
+		    gpointer     user_data)
+{
+	ReadData   *read_data = user_data;
+	DomElement *node;
+	int         i;
+
+	if (read_data->file_list && (depth == 2)) {
+		if (strcmp (element_name, "file") == 0) {
+			const char *uri;
+
+			uri = dom_reader_get_attribute (attribute_names, attribute_values, "uri");
+			if (uri != NULL)
+				read_data->uris = g_list_prepend (read_data->uris, g_strdup (uri));
+		}
+		return;
+	}
+
+	if ((depth == 1) && (strcmp (element_name, "files") == 0))
+		read_data->file_list = TRUE;
+
+	node = dom_document_create_element (read_data->doc, element_name, NULL);
+	for (i = 0; attribute_names[i] != NULL; i++)
+		dom_element_set_attribute (node, attribute_names[i], attribute_values[i]);
+	dom_element_append_child (DOM_ELEMENT (g_queue_peek_head (&read_data->open_nodes)), node);
+	g_queue_push_head (&read_data->open_nodes, node);
+}
+
+
 static void
+read_end_element (int          depth,
+		  const char  *element_name,
+		  const char  *text,
+		  gpointer     user_data)
+{
+	ReadData   *read_data = user_data;
+	DomElement *node;
+
+	if (read_data->file_list && (depth == 2))
+		return;
+
+	if (depth == 1)
+		read_data->file_list = FALSE;
+
+	node = g_queue_pop_head (&read_data->open_nodes);
+	if (text != NULL)
+		dom_element_append_child (node, dom_document_create_text_node (read_data->doc, text));
+}
+
+
+static const DomReader catalog_reader = {
+	read_start_element,
+	read_end_element
+};
+
+
+static gboolean
 read_catalog_data_from_xml (GthCatalog  *catalog,
 		   	    const char  *buffer,
 		   	    gsize        count,
 		   	    GError     **error)
 {
-	DomDocument *doc;
+	ReadData read_data;
+	gboolean success;
+
+	read_data.doc = dom_document_new ();
+	g_queue_init (&read_data.open_nodes);
+	g_queue_push_head (&read_data.open_nodes, read_data.doc);
+	read_data.file_list = FALSE;
+	read_data.uris = NULL;
+
+	success = dom_reader_parse (&catalog_reader, buffer, count, &read_data, error);
+	if (success) {
+		GTH_CATALOG_GET_CLASS (catalog)->read_from_doc (catalog, DOM_ELEMENT (read_data.doc)->first_child);
+		read_data.uris = g_list_reverse (read_data.uris);
+		_gth_catalog_set_uri_list (catalog, read_data.uris);
+	}
 
-	doc = dom_document_new ();
-	if (dom_document_load (doc, buffer, count, error))
-		GTH_CATALOG_GET_CLASS (catalog)->read_from_doc (catalog, DOM_ELEMENT (doc)->first_child);
+	_g_string_list_free (read_data.uris);
+	g_queue_clear (&read_data.open_nodes);
+	g_object_unref (read_data.doc);
 
-	g_object_unref (doc);
+	return success;
+}
+
+
+static void
+read_catalog_data_from_log (GthCatalog  *catalog,
+			    const char  *buffer,
+			    gsize        count,
+			    const char  *document,
+			    gsize        document_size,
+			    GError     **error)
+{
+	const char *buffer_end = buffer + count;
+	GQueue      uris = G_QUEUE_INIT;
+	GHashTable *links;
+	const char *line;
+	const char *line_end;
+	int         n_records;
+
+	if (! read_catalog_data_from_xml (catalog, document, document_size, error))
+		return;
+
+	/* replay the changes, an incomplete last line is ignored */
+
+	links = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	n_records = 0;
+	for (line = document + document_size;
+	     (line_end = memchr (line, '\n', buffer_end - line)) != NULL;
+	     line = line_end + 1)
+	{
+		char  *uri;
+		GList *link;
+
+		if (line_end - line < 2)
+			continue;
+
+		n_records++;
+		uri = g_strndup (line + 1, line_end - line - 1);
+		link = g_hash_table_lookup (links, uri);
+		if ((line[0] == '+') && (link == NULL)) {
+			g_queue_push_tail (&uris, uri);
+			g_hash_table_insert (links, uri, uris.tail);
+			uri = NULL;
+		}
+		else if ((line[0] == '-') && (link != NULL)) {
+			g_queue_delete_link (&uris, link);
+			g_hash_table_remove (links, uri);
+		}
+
+		g_free (uri);
+	}
+
+	_gth_catalog_set_uri_list (catalog, uris.head);
+
+	/* the changes cannot be appended after an incomplete line */
+
+	if (line == buffer_end)
+		_gth_catalog_log_reset (catalog, TRUE, n_records, count);
+	else
+		_gth_catalog_log_invalidate (catalog);
+
+	g_queue_clear (&uris);
+	g_hash_table_destroy (links);
 }
 
 
@@ -205,7 +483,7 @@ base_write_to_doc (GthCatalog  *catalog,
 									     "inverse", (catalog->priv->order_inverse ? "1" : "0"),
 									     NULL));
 
-	if (catalog->priv->file_list != NULL) {
+	if ((catalog->priv->file_list != NULL) && ! catalog->priv->log_format) {
 		DomElement *node;
 		GList      *scan;
 
@@ -248,6 +526,8 @@ gth_catalog_init (GthCatalog *catalog)
 	catalog->priv = g_new0 (GthCatalogPrivate, 1);
 	catalog->priv->date_time = gth_datetime_new ();
 	catalog->priv->file_hash = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, NULL, NULL);
+	catalog->priv->log_file_size = -1;
+	catalog->priv->saving_size = -1;
 }
 
 
@@ -285,10 +565,15 @@ void
 gth_catalog_set_name (GthCatalog *catalog,
 		      const char *name)
 {
+	if ((name != NULL) && (strcmp (name, "") == 0))
+		name = NULL;
+	if (g_strcmp0 (name, catalog->priv->name) == 0)
+		return;
+
+	_gth_catalog_log_invalidate (catalog);
+
 	g_free (catalog->priv->name);
-	catalog->priv->name = NULL;
-	if ((name != NULL) && (strcmp (name, "") != 0))
-		catalog->priv->name = g_strdup (name);;
+	catalog->priv->name = g_strdup (name);
 }
 
 
@@ -303,6 +588,12 @@ void
 gth_catalog_set_date (GthCatalog  *catalog,
 		      GthDateTime *date_time)
 {
+	if ((g_date_valid (date_time->date) != g_date_valid (catalog->priv->date_time->date))
+	    || (g_date_valid (date_time->date) && (g_date_compare (date_time->date, catalog->priv->date_time->date) != 0)))
+	{
+		_gth_catalog_log_invalidate (catalog);
+	}
+
 	if (g_date_valid (date_time->date))
 		g_date_set_dmy (catalog->priv->date_time->date,
 				g_date_get_day (date_time->date),
@@ -326,6 +617,9 @@ gth_catalog_set_order (GthCatalog *catalog,
 		       const char *order,
 		       gboolean    inverse)
 {
+	if ((g_strcmp0 (order, catalog->priv->order) != 0) || (inverse != catalog->priv->order_inverse))
+		_gth_catalog_log_invalidate (catalog);
+
 	g_free (catalog->priv->order);
 	catalog->priv->order = NULL;
 
@@ -350,19 +644,30 @@ gth_catalog_load_from_data (GthCatalog  *catalog,
 			    gsize        count,
 			    GError     **error)
 {
-	char *text_buffer;
+	char       *text_buffer;
+	const char *document;
+	gsize       document_size;
+
+	_gth_catalog_log_invalidate (catalog);
 
 	if (buffer == NULL)
 		return;
 
 	text_buffer = (char *) buffer;
-	if (strncmp (text_buffer, "<?xml ", 6) == 0)
+	document = _gth_catalog_log_get_document (text_buffer, count, &document_size);
+	if (document != NULL)
+		read_catalog_data_from_log (catalog, text_buffer, count, document, document_size, error);
+	else if (strncmp (text_buffer, "<?xml ", 6) == 0)
 		read_catalog_data_from_xml (catalog, text_buffer, count, error);
 	else
 		read_catalog_data_old_format (catalog, text_buffer, count);
 }
 
 
+/* Returns the whole catalog, the log format is used for the catalogs with
+ * many files, the other ones are saved as a xml document.  Call
+ * gth_catalog_data_saved() when the data has been saved, the following
+ * changes are then returned by gth_catalog_to_log_data(). */
 char *
 gth_catalog_to_data (GthCatalog *catalog,
 		     gsize      *length)
@@ -370,6 +675,10 @@ gth_catalog_to_data (GthCatalog *catalog,
 	DomDocument *doc;
 	DomElement  *root;
 	char        *data;
+	int          n_files;
+
+	n_files = g_list_length (catalog->priv->file_list);
+	catalog->priv->log_format = (n_files >= LOG_FORMAT_MIN_FILES);
 
 	doc = dom_document_new ();
 	root = GTH_CATALOG_GET_CLASS (catalog)->create_root (catalog, doc);
@@ -377,16 +686,110 @@ gth_catalog_to_data (GthCatalog *catalog,
 	GTH_CATALOG_GET_CLASS (catalog)->write_to_doc (catalog, doc, root);
 	data = dom_document_dump (doc, length);
 
+	if (catalog->priv->log_format) {
+		GString *buffer;
+		GList   *scan;
+
+		buffer = g_string_sized_new (*length + n_files * 128);
+		g_string_append_printf (buffer, "%s%" G_GSIZE_FORMAT "\n", LOG_FORMAT_HEADER, *length);
+		g_string_append_len (buffer, data, *length);
+		for (scan = catalog->priv->file_list; scan; scan = scan->next) {
+			char *uri;
+
+			uri = g_file_get_uri ((GFile *) scan->data);
+			g_string_append_c (buffer, '+');
+			g_string_append (buffer, uri);
+			g_string_append_c (buffer, '\n');
+
+			g_free (uri);
+		}
+
+		g_free (data);
+		*length = buffer->len;
+		data = g_string_free (buffer, FALSE);
+	}
+
+	/* the changes from now on are relative to the returned data, they
+	 * can be appended only after the data has been saved. */
+
+	_gth_catalog_log_reset (catalog, catalog->priv->log_format, n_files, -1);
+	catalog->priv->log_format = FALSE;
+	catalog->priv->saving_log = FALSE;
+	catalog->priv->saving_size = *length;
+
 	g_object_unref (doc);
 
 	return data;
 }
 
 
+/* Returns the changes of the file list to append to the saved catalog, or
+ * NULL if the catalog must be saved with gth_catalog_to_data(): when the
+ * catalog is not in the log format, when the order of the files or the
+ * other properties changed, when the saved file is not known, or when the
+ * file must be compacted.  The properties defined by the subclasses are not
+ * tracked, use gth_catalog_to_data() after changing them.  The data must be
+ * appended with _g_file_append() or _g_file_append_async() passing
+ * @file_size, the expected size of the saved file; if that fails save the
+ * catalog with gth_catalog_to_data(), otherwise call
+ * gth_catalog_data_saved(). */
+char *
+gth_catalog_to_log_data (GthCatalog *catalog,
+			 gsize      *length,
+			 goffset    *file_size)
+{
+	int n_files;
+	int n_records;
+
+	if ((catalog->priv->log == NULL) || (catalog->priv->log_file_size < 0))
+		return NULL;
+
+	n_files = g_hash_table_size (catalog->priv->file_hash);
+	n_records = catalog->priv->log_records + catalog->priv->log_new_records;
+	if (n_records - n_files > MAX (n_files, LOG_FORMAT_MAX_GARBAGE))
+		return NULL;
+
+	catalog->priv->saving_log = TRUE;
+	catalog->priv->saving_size = catalog->priv->log->len;
+	catalog->priv->saving_records = catalog->priv->log_new_records;
+
+	*length = catalog->priv->log->len;
+	*file_size = catalog->priv->log_file_size;
+
+	return g_strndup (catalog->priv->log->str, catalog->priv->log->len);
+}
+
+
+/* Tells that the data returned by the last call to gth_catalog_to_data() or
+ * gth_catalog_to_log_data() has been saved.  If the data was not saved the
+ * catalog will be rewritten the next time. */
+void
+gth_catalog_data_saved (GthCatalog *catalog)
+{
+	if (catalog->priv->saving_size < 0)
+		return;
+
+	if (! catalog->priv->saving_log) {
+		catalog->priv->log_file_size = catalog->priv->saving_size;
+	}
+	else if ((catalog->priv->log != NULL) && (catalog->priv->log_file_size >= 0)) {
+		g_string_erase (catalog->priv->log, 0, catalog->priv->saving_size);
+		catalog->priv->log_file_size += catalog->priv->saving_size;
+		catalog->priv->log_records += catalog->priv->saving_records;
+		catalog->priv->log_new_records -= catalog->priv->saving_records;
+	}
+
+	catalog->priv->saving_log = FALSE;
+	catalog->priv->saving_size = -1;
+}
+
+
 void
 gth_catalog_set_file_list (GthCatalog *catalog,
 			   GList      *file_list)
 {
+	_gth_catalog_log_invalidate (catalog);
+
 	_g_object_list_unref (catalog->priv->file_list);
 	catalog->priv->file_list = NULL;
 	g_hash_table_remove_all (catalog->priv->file_hash);
@@ -429,10 +832,40 @@ gth_catalog_insert_file (GthCatalog *catalog,
 	catalog->priv->file_list = g_list_insert (catalog->priv->file_list, file, pos);
 	g_hash_table_insert (catalog->priv->file_hash, file, GINT_TO_POINTER (1));
 
+	if (pos < 0)
+		_gth_catalog_log_add_record (catalog, '+', file);
+	else
+		_gth_catalog_log_invalidate (catalog);
+
 	return TRUE;
 }
 
 
+/* Adds @files at the end of the list, the files already in the catalog are
+ * ignored.  Faster than gth_catalog_insert_file() for many files because
+ * the list is traversed only once. */
+void
+gth_catalog_append_files (GthCatalog *catalog,
+			  GList      *files)
+{
+	GList *new_files;
+	GList *scan;
+
+	new_files = NULL;
+	for (scan = files; scan; scan = scan->next) {
+		GFile *file = scan->data;
+
+		if (g_hash_table_lookup (catalog->priv->file_hash, file) != NULL)
+			continue;
+		file = g_file_dup (file);
+		new_files = g_list_prepend (new_files, file);
+		g_hash_table_insert (catalog->priv->file_hash, file, GINT_TO_POINTER (1));
+		_gth_catalog_log_add_record (catalog, '+', file);
+	}
+	catalog->priv->file_list = g_list_concat (catalog->priv->file_list, g_list_reverse (new_files));
+}
+
+
 int
 gth_catalog_remove_file (GthCatalog *catalog,
 			 GFile      *file)
@@ -452,6 +885,7 @@ gth_catalog_remove_file (GthCatalog *catalog,
 
 	catalog->priv->file_list = g_list_remove_link (catalog->priv->file_list, scan);
 	g_hash_table_remove (catalog->priv->file_hash, file);
+	_gth_catalog_log_add_record (catalog, '-', (GFile *) scan->data);
 
 	_g_object_list_unref (scan);
 
@@ -935,35 +1369,36 @@ gth_catalog_get_icon (GFile *file)
 }
 
 
-static char *
-get_tag_value (const char *buffer,
-	       const char *tag_start,
-	       const char *tag_end)
+typedef struct {
+	char *name;
+	char *exif_date;
+} HeaderData;
+
+
+static void
+header_end_element (int          depth,
+		    const char  *element_name,
+		    const char  *text,
+		    gpointer     user_data)
 {
-	char *value;
-	char *begin_tag;
-
-	value = NULL;
-	begin_tag = strstr (buffer, tag_start);
-	if (begin_tag != NULL) {
-		char        *end_tag;
-		char        *xml;
-		DomDocument *doc;
-
-		end_tag = strstr (begin_tag, tag_end);
-		xml = g_strndup (begin_tag, (end_tag - begin_tag) + strlen (tag_end));
-		doc = dom_document_new ();
-		if (dom_document_load (doc, xml, strlen (xml), NULL))
-			value = g_strdup (dom_element_get_inner_text (DOM_ELEMENT (doc)->first_child));
-
-		g_object_unref (doc);
-		g_free (xml);
-	}
+	HeaderData *header_data = user_data;
+
+	if ((depth != 1) || (text == NULL))
+		return;
 
-	return value;
+	if ((header_data->name == NULL) && (strcmp (element_name, "name") == 0))
+		header_data->name = g_strdup (text);
+	else if ((header_data->exif_date == NULL) && (strcmp (element_name, "date") == 0))
+		header_data->exif_date = g_strdup (text);
 }
 
 
+static const DomReader header_reader = {
+	NULL,
+	header_end_element
+};
+
+
 void
 gth_catalog_update_standard_attributes (GFile     *file,
 				        GFileInfo *info)
@@ -992,15 +1427,28 @@ gth_catalog_update_standard_attributes (GFile     *file,
 
 				n = g_input_stream_read (G_INPUT_STREAM (istream), buffer, buffer_size - 1, NULL, NULL);
 				if (n > 0) {
-					char *exif_date;
+					const char *xml;
+					HeaderData  header_data;
 
-					buffer[n] = '\0';
-					name = get_tag_value (buffer, "<name>", "</name>");
-					exif_date = get_tag_value (buffer, "<date>", "</date>");
-					if (exif_date != NULL)
-						gth_datetime_from_exif_date (date_time, exif_date);
+					/* the buffer is truncated, the elements
+					 * read before the parsing error are
+					 * enough. */
 
-					g_free (exif_date);
+					buffer[n] = '\0';
+					xml = buffer;
+					if (g_str_has_prefix (xml, LOG_FORMAT_HEADER)) {
+						xml = strchr (xml, '\n');
+						xml = (xml != NULL) ? xml + 1 : "";
+					}
+
+					header_data.name = NULL;
+					header_data.exif_date = NULL;
+					dom_reader_parse (&header_reader, xml, -1, &header_data, NULL);
+					name = header_data.name;
+					if (header_data.exif_date != NULL)
+						gth_datetime_from_exif_date (date_time, header_data.exif_date);
+
+					g_free (header_data.exif_date);
 				}
 				g_object_unref (istream);
 			}
@@ -1028,6 +1476,34 @@ gth_catalog_update_standard_attributes (GFile     *file,
 }
 
 
+/* Creates a catalog of the type saved in @buffer and loads the data, returns
+ * NULL if the type is not recognized. */
+GthCatalog *
+gth_catalog_new_from_data (const void  *buffer,
+			   gsize        count,
+			   GError     **error)
+{
+	const char *document;
+	gsize       document_size;
+	GthCatalog *catalog;
+
+	document = buffer;
+	if (buffer != NULL) {
+		const char *log_document;
+
+		log_document = _gth_catalog_log_get_document (buffer, count, &document_size);
+		if (log_document != NULL)
+			document = log_document;
+	}
+
+	catalog = gth_hook_invoke_get ("gth-catalog-load-from-data", (gpointer) document);
+	if (catalog != NULL)
+		gth_catalog_load_from_data (catalog, buffer, count, error);
+
+	return catalog;
+}
+
+
 /* -- gth_catalog_load_from_file --*/
 
 
@@ -1046,11 +1522,8 @@ load__catalog_buffer_ready_cb (void     **buffer,
 	LoadData   *load_data = user_data;
 	GthCatalog *catalog = NULL;
 
-	if (error == NULL) {
-		catalog = gth_hook_invoke_get ("gth-catalog-load-from-data", *buffer);
-		if (catalog != NULL)
-			gth_catalog_load_from_data (catalog, *buffer, count, &error);
-	}
+	if (error == NULL)
+		catalog = gth_catalog_new_from_data (*buffer, count, &error);
 
 	load_data->ready_func (G_OBJECT (catalog), error, load_data->user_data);
 
@@ -1123,20 +1596,32 @@ gth_catalog_get_file_for_tag (const char *tag,
 GthCatalog *
 gth_catalog_load_from_file (GFile *file)
 {
-	GthCatalog *catalog;
-	GFile      *gio_file;
-	void       *buffer;
-	gsize       buffer_size;
+	GthCatalog  *catalog;
+	GFile       *gio_file;
+	char        *path;
+	GMappedFile *mapped_file;
 
+	catalog = NULL;
 	gio_file = gth_catalog_file_to_gio_file (file);
-	if (! _g_file_load_in_buffer (gio_file, &buffer, &buffer_size, NULL, NULL))
-		return NULL;
+	path = g_file_get_path (gio_file);
+	mapped_file = (path != NULL) ? g_mapped_file_new (path, FALSE, NULL) : NULL;
+	if (mapped_file != NULL) {
+		catalog = gth_catalog_new_from_data (g_mapped_file_get_contents (mapped_file),
+						     g_mapped_file_get_length (mapped_file),
+						     NULL);
+		g_mapped_file_unref (mapped_file);
+	}
+	else if (path == NULL) {
+		void  *buffer;
+		gsize  buffer_size;
 
-	catalog = gth_hook_invoke_get ("gth-catalog-load-from-data", buffer);
-	if (catalog != NULL)
-		gth_catalog_load_from_data (catalog, buffer, buffer_size, NULL);
+		if (_g_file_load_in_buffer (gio_file, &buffer, &buffer_size, NULL, NULL)) {
+			catalog = gth_catalog_new_from_data (buffer, buffer_size, NULL);
+			g_free (buffer);
+		}
+	}
 
-	g_free (buffer);
+	g_free (path);
 	g_object_unref (gio_file);
 
 	return catalog;
@@ -1146,12 +1631,14 @@ gth_catalog_load_from_file (GFile *file)
 void
 gth_catalog_save (GthCatalog *catalog)
 {
-	GFile  *file;
-	GFile  *gio_file;
-	GFile  *gio_parent;
-	char   *data;
-	gsize   size;
-	GError *error = NULL;
+	GFile    *file;
+	GFile    *gio_file;
+	GFile    *gio_parent;
+	char     *data;
+	gsize     size;
+	goffset   file_size;
+	gboolean  success;
+	GError   *error = NULL;
 
 	file = gth_catalog_get_file (catalog);
 	gio_file = gth_catalog_file_to_gio_file (file);
@@ -1159,15 +1646,29 @@ gth_catalog_save (GthCatalog *catalog)
 	gio_parent = g_file_get_parent (gio_file);
 	if (gio_parent != NULL)
 		g_file_make_directory_with_parents (gio_parent, NULL, NULL);
-	data = gth_catalog_to_data (catalog, &size);
-	if (! _g_file_write (gio_file,
-			     FALSE,
-			     G_FILE_CREATE_NONE,
-			     data,
-			     size,
-			     NULL,
-			     &error))
-	{
+
+	/* rewrite the whole file if the changes cannot be appended */
+
+	success = FALSE;
+	data = gth_catalog_to_log_data (catalog, &size, &file_size);
+	if (data != NULL) {
+		success = _g_file_append (gio_file, file_size, data, size, NULL, NULL);
+		if (! success) {
+			g_free (data);
+			data = NULL;
+		}
+	}
+	if (! success) {
+		data = gth_catalog_to_data (catalog, &size);
+		success = _g_file_write (gio_file,
+					 FALSE,
+					 G_FILE_CREATE_NONE,
+					 data,
+					 size,
+					 NULL,
+					 &error);
+	}
+	if (! success) {
 		g_warning ("%s", error->message);
 		g_clear_error (&error);
 	}
@@ -1176,6 +1677,8 @@ gth_catalog_save (GthCatalog *catalog)
 		GFile *parent;
 		GList *list;
 
+		gth_catalog_data_saved (catalog);
+
 		parent = g_file_get_parent (file);
 		parent_parent = g_file_get_parent (parent);
 		if (parent_parent != NULL) {
@@ -93,12 +93,18 @@ void          gth_catalog_load_from_data  (GthCatalog           *catalog,
 					   GError              **error);
 char *        gth_catalog_to_data         (GthCatalog           *catalog,
 		     			   gsize                *length);
+char *        gth_catalog_to_log_data     (GthCatalog           *catalog,
+					   gsize                *length,
+					   goffset              *file_size);
+void          gth_catalog_data_saved      (GthCatalog           *catalog);
 void          gth_catalog_set_file_list   (GthCatalog           *catalog,
 					   GList                *file_list);
 GList *       gth_catalog_get_file_list   (GthCatalog           *catalog);
 gboolean      gth_catalog_insert_file     (GthCatalog           *catalog,
 					   GFile                *file,
 					   int                   pos);
+void          gth_catalog_append_files    (GthCatalog           *catalog,
+					   GList                *files);
 int           gth_catalog_remove_file     (GthCatalog           *catalog,
 					   GFile                *file);
 void          gth_catalog_list_async      (GthCatalog           *catalog,
@@ -130,6 +136,9 @@ GFile *        gth_catalog_get_file_for_date          (GthDateTime   *date_time,
 	      	      	       	       	       	       const char    *extension);
 GFile *        gth_catalog_get_file_for_tag           (const char    *tag,
 		      	      	      	      	       const char    *extension);
+GthCatalog *   gth_catalog_new_from_data              (const void    *buffer,
+						       gsize          count,
+						       GError       **error);
 GthCatalog *   gth_catalog_load_from_file             (GFile         *file);
 void           gth_catalog_save                       (GthCatalog    *catalog);
 
@@ -1311,6 +1311,7 @@ typedef struct {
 	GList      *file_data_list;
 	GFile      *gio_file;
 	GthCatalog *catalog;
+	gboolean    appending;
 } RemoveFromCatalogData;
 
 
@@ -1328,6 +1329,10 @@ remove_from_catalog_end (GError                *error,
 }
 
 
+static void remove_files__save_catalog (RemoveFromCatalogData *data,
+					gboolean               append);
+
+
 static void
 remove_files__catalog_save_done_cb (void     **buffer,
 				    gsize      count,
@@ -1336,8 +1341,16 @@ remove_files__catalog_save_done_cb (void     **buffer,
 {
 	RemoveFromCatalogData *data = user_data;
 
+	if ((error != NULL) && data->appending) {
+		/* the file changed since it was loaded, rewrite it */
+		remove_files__save_catalog (data, FALSE);
+		return;
+	}
+
 	if (error == NULL) {
 		GFile *catalog_file;
+
+		gth_catalog_data_saved (data->catalog);
 		GList *files = NULL;
 		GList *scan;
 
@@ -1359,6 +1372,40 @@ remove_files__catalog_save_done_cb (void     **buffer,
 }
 
 
+static void
+remove_files__save_catalog (RemoveFromCatalogData *data,
+			    gboolean               append)
+{
+	void    *catalog_buffer;
+	gsize    catalog_size;
+	goffset  file_size;
+
+	catalog_buffer = append ? gth_catalog_to_log_data (data->catalog, &catalog_size, &file_size) : NULL;
+	data->appending = (catalog_buffer != NULL);
+	if (data->appending) {
+		_g_file_append_async (data->gio_file,
+				      file_size,
+				      catalog_buffer,
+				      catalog_size,
+				      G_PRIORITY_DEFAULT,
+				      NULL,
+				      remove_files__catalog_save_done_cb,
+				      data);
+		return;
+	}
+
+	catalog_buffer = gth_catalog_to_data (data->catalog, &catalog_size);
+	_g_file_write_async (data->gio_file,
+			     catalog_buffer,
+			     catalog_size,
+			     TRUE,
+			     G_PRIORITY_DEFAULT,
+			     NULL,
+			     remove_files__catalog_save_done_cb,
+			     data);
+}
+
+
 static void
 catalog_buffer_ready_cb (void     **buffer,
 			 gsize      count,
@@ -1367,22 +1414,15 @@ catalog_buffer_ready_cb (void     **buffer,
 {
 	RemoveFromCatalogData *data = user_data;
 	GList                 *scan;
-	void                  *catalog_buffer;
-	gsize                  catalog_size;
 
 	if (error != NULL) {
 		remove_from_catalog_end (error, data);
 		return;
 	}
 
-	data->catalog = gth_hook_invoke_get ("gth-catalog-load-from-data", *buffer);
-	if (data->catalog == NULL) {
+	data->catalog = gth_catalog_new_from_data (*buffer, count, &error);
+	if ((data->catalog == NULL) && (error == NULL))
 		error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_FAILED, _("Invalid file format"));
-		remove_from_catalog_end (error, data);
-		return;
-	}
-
-	gth_catalog_load_from_data (data->catalog, *buffer, count, &error);
 	if (error != NULL) {
 		remove_from_catalog_end (error, data);
 		return;
@@ -1393,20 +1433,7 @@ catalog_buffer_ready_cb (void     **buffer,
 		gth_catalog_remove_file (data->catalog, file_data->file);
 	}
 
-	catalog_buffer = gth_catalog_to_data (data->catalog, &catalog_size);
-	if (error != NULL) {
-		remove_from_catalog_end (error, data);
-		return;
-	}
-
-	_g_file_write_async (data->gio_file,
-			     catalog_buffer,
-			     catalog_size,
-			     TRUE,
-			     G_PRIORITY_DEFAULT,
-			     NULL,
-			     remove_files__catalog_save_done_cb,
-			     data);
+	remove_files__save_catalog (data, TRUE);
 }
 
 
@@ -566,15 +566,14 @@ gth_organize_task_exec (GthTask *base)
 		break;
 	}
 
-	g_directory_foreach_child (self->priv->folder,
-				   self->priv->recursive,
-				   TRUE,
-				   attributes,
-				   gth_task_get_cancellable (GTH_TASK (self)),
-				   start_dir_func,
-				   for_each_file_func,
-				   done_func,
-				   self);
+	g_directory_foreach_child_full (self->priv->folder,
+					(self->priv->recursive ? GTH_LIST_RECURSIVE : GTH_LIST_DEFAULT) | GTH_LIST_PARALLEL,
+					attributes,
+					gth_task_get_cancellable (GTH_TASK (self)),
+					start_dir_func,
+					for_each_file_func,
+					done_func,
+					self);
 
 	gtk_widget_show (GET_WIDGET ("cancel_button"));
 	gtk_widget_hide (GET_WIDGET ("close_button"));
@@ -0,0 +1,636 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+/*
+ *  GThumb
+ *
+ *  Copyright (C) 2013 Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <config.h>
+#include <string.h>
+#include <gthumb.h>
+#include "gth-comment.h"
+#include "gth-comment-index.h"
+
+
+/* The comments of a folder, saved one per file in the .comments folder,
+ * are also collected in an index saved in the cache folder, to read them
+ * with a single file access.  The index is a GVariant with the following
+ * format:
+ *
+ *   version, folder uri,
+ *   dictionary of file name → (size, modification time, comment)
+ *
+ * where the size and the modification time, in microseconds, are the ones
+ * of the comment file, and the comment is a
+ * (caption, note, place, rating, time, categories) tuple.
+ * An entry is valid as long as the comment file has the same size and
+ * modification time, this way the comments rewritten in place by other
+ * programs are read again, and only the comment files changed since the
+ * last check are read when updating the index.  When a folder doesn't have
+ * a saved index yet the index is created in a thread, and the comment files
+ * are read one at a time until it's ready.  The index files are managed by
+ * gth-user-cache.c. */
+
+
+#define CACHE_NAME "comments"
+#define INDEX_VERSION 2
+#define COMMENT_FORMAT "(msmsmsimsas)"
+#define ENTRY_FORMAT "(tx" COMMENT_FORMAT ")"
+#define INDEX_FORMAT "(usa{s" ENTRY_FORMAT "})"
+#define COMMENT_FILE_EXTENSION ".xml"
+#define COMMENT_FILE_ATTRIBUTES G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_TIME_MODIFIED "," G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC
+#define MAX_INDEXES_IN_MEMORY 4
+#define CHECK_INTERVAL (2 * G_USEC_PER_SEC)
+
+
+typedef struct {
+	GFile      *folder;
+	gint64      last_check;
+	GHashTable *entries; /* file name → GVariant */
+} FolderIndex;
+
+
+static GMutex        index_mutex;
+static GthUserCache *indexes = NULL; /* folder uri → FolderIndex */
+static GHashTable   *building = NULL; /* uri set of the folders indexed in a thread */
+
+
+static GHashTable *
+_gth_comment_index_entries_new (void)
+{
+	return g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_variant_unref);
+}
+
+
+static FolderIndex *
+folder_index_new (GFile *folder)
+{
+	FolderIndex *index;
+
+	index = g_new0 (FolderIndex, 1);
+	index->folder = g_object_ref (folder);
+	index->last_check = 0;
+	index->entries = _gth_comment_index_entries_new ();
+
+	return index;
+}
+
+
+static void
+folder_index_free (FolderIndex *index)
+{
+	g_hash_table_unref (index->entries);
+	g_object_unref (index->folder);
+	g_free (index);
+}
+
+
+static void
+_gth_comment_file_get_times (GFileInfo *info,
+			     guint64   *size,
+			     gint64    *mtime)
+{
+	*size = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
+	*mtime = (gint64) g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC
+		 + g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+}
+
+
+static GVariant *
+_gth_comment_index_entry_new (GthComment *comment,
+			      GFileInfo  *comment_info)
+{
+	guint64          size;
+	gint64           mtime;
+	GVariantBuilder  categories;
+	GPtrArray       *categories_v;
+	char            *time;
+	GVariant        *entry;
+	int              i;
+
+	_gth_comment_file_get_times (comment_info, &size, &mtime);
+
+	g_variant_builder_init (&categories, G_VARIANT_TYPE_STRING_ARRAY);
+	categories_v = gth_comment_get_categories (comment);
+	for (i = 0; i < categories_v->len; i++)
+		g_variant_builder_add (&categories, "s", g_ptr_array_index (categories_v, i));
+
+	time = gth_comment_get_time_as_exif_format (comment);
+	entry = g_variant_new (ENTRY_FORMAT,
+			       size,
+			       mtime,
+			       gth_comment_get_caption (comment),
+			       gth_comment_get_note (comment),
+			       gth_comment_get_place (comment),
+			       gth_comment_get_rating (comment),
+			       time,
+			       &categories);
+	g_variant_ref_sink (entry);
+
+	g_free (time);
+
+	return entry;
+}
+
+
+static gboolean
+_gth_comment_index_entry_is_valid (GVariant  *entry,
+				   GFileInfo *comment_info)
+{
+	guint64 size;
+	gint64  mtime;
+	guint64 entry_size;
+	gint64  entry_mtime;
+
+	_gth_comment_file_get_times (comment_info, &size, &mtime);
+	g_variant_get (entry, "(tx@" COMMENT_FORMAT ")", &entry_size, &entry_mtime, NULL);
+
+	return (entry_size == size) && (entry_mtime == mtime);
+}
+
+
+static GthComment *
+_gth_comment_index_entry_to_comment (GVariant *entry)
+{
+	const char   *caption;
+	const char   *note;
+	const char   *place;
+	int           rating;
+	const char   *time;
+	GVariantIter *categories;
+	const char   *category;
+	GthComment   *comment;
+
+	g_variant_get (entry, "(tx(m&sm&sm&sim&sas))", NULL, NULL, &caption, &note, &place, &rating, &time, &categories);
+
+	comment = gth_comment_new ();
+	gth_comment_set_caption (comment, caption);
+	gth_comment_set_note (comment, note);
+	gth_comment_set_place (comment, place);
+	gth_comment_set_rating (comment, rating);
+	gth_comment_set_time_from_exif_format (comment, time);
+	while (g_variant_iter_loop (categories, "&s", &category))
+		gth_comment_add_category (comment, category);
+
+	g_variant_iter_free (categories);
+
+	return comment;
+}
+
+
+/* Reads the entries of the saved index of @folder, returns NULL if the index
+ * doesn't exist or if it was saved for another folder. */
+static GHashTable *
+_gth_comment_index_load (GFile *folder)
+{
+	char         *uri;
+	GMappedFile  *mapped_file;
+	GVariant     *data;
+	guint32       version;
+	const char   *index_uri;
+	GVariantIter *entries_iter;
+	GHashTable   *entries;
+
+	uri = g_file_get_uri (folder);
+	mapped_file = gth_user_cache_map_file (CACHE_NAME, uri);
+	if (mapped_file == NULL) {
+		g_free (uri);
+		return NULL;
+	}
+
+	/* the data is not trusted, an index saved with another version
+	 * is read as an invalid value of the current format */
+
+	data = g_variant_new_from_data (G_VARIANT_TYPE (INDEX_FORMAT),
+					g_mapped_file_get_contents (mapped_file),
+					g_mapped_file_get_length (mapped_file),
+					FALSE,
+					(GDestroyNotify) g_mapped_file_unref,
+					mapped_file);
+	g_variant_ref_sink (data);
+
+	g_variant_get (data, "(u&sa{s" ENTRY_FORMAT "})", &version, &index_uri, &entries_iter);
+
+	entries = NULL;
+	if ((version == INDEX_VERSION) && (g_strcmp0 (index_uri, uri) == 0)) {
+		const char *name;
+		GVariant   *entry;
+
+		entries = _gth_comment_index_entries_new ();
+		while (g_variant_iter_loop (entries_iter, "{&s@" ENTRY_FORMAT "}", &name, &entry))
+			g_hash_table_insert (entries, g_strdup (name), g_variant_ref (entry));
+	}
+
+	g_variant_iter_free (entries_iter);
+	g_free (uri);
+	g_variant_unref (data);
+
+	return entries;
+}
+
+
+/* Returns the entries for the comment files of @folder, reusing the entries
+ * in @old_entries still valid, and reading only the comment files added or
+ * changed.  Sets @changed to TRUE if the entries differ from @old_entries.
+ * Returns NULL if the .comments folder cannot be read. */
+static GHashTable *
+_gth_comment_index_update_entries (GFile         *folder,
+				   GHashTable    *old_entries,
+				   gboolean      *changed,
+				   GCancellable  *cancellable)
+{
+	GHashTable      *entries;
+	GFile           *comments_folder;
+	GFileEnumerator *enumerator;
+	GError          *error = NULL;
+	GFileInfo       *info;
+	guint            n_reused;
+
+	entries = _gth_comment_index_entries_new ();
+	n_reused = 0;
+
+	comments_folder = g_file_get_child (folder, ".comments");
+	enumerator = g_file_enumerate_children (comments_folder,
+						COMMENT_FILE_ATTRIBUTES,
+						G_FILE_QUERY_INFO_NONE,
+						cancellable,
+						&error);
+	g_object_unref (comments_folder);
+
+	if (enumerator == NULL) {
+		gboolean not_found;
+
+		not_found = g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+		g_error_free (error);
+		if (! not_found) {
+			g_hash_table_unref (entries);
+			return NULL;
+		}
+
+		/* no .comments folder, no comments */
+
+		*changed = (old_entries == NULL) || (g_hash_table_size (old_entries) > 0);
+		return entries;
+	}
+
+	while ((info = g_file_enumerator_next_file (enumerator, cancellable, NULL)) != NULL) {
+		const char *comment_name;
+
+		comment_name = g_file_info_get_name (info);
+		if ((g_file_info_get_file_type (info) == G_FILE_TYPE_REGULAR)
+		    && g_str_has_suffix (comment_name, COMMENT_FILE_EXTENSION))
+		{
+			char     *name;
+			GVariant *entry;
+
+			name = g_strndup (comment_name, strlen (comment_name) - strlen (COMMENT_FILE_EXTENSION));
+			entry = (old_entries != NULL) ? g_hash_table_lookup (old_entries, name) : NULL;
+			if ((entry != NULL) && _gth_comment_index_entry_is_valid (entry, info)) {
+				g_hash_table_insert (entries, g_strdup (name), g_variant_ref (entry));
+				n_reused++;
+			}
+			else {
+				GFile      *file;
+				GthComment *comment;
+
+				file = g_file_get_child (folder, name);
+				comment = gth_comment_new_for_file (file, cancellable, NULL);
+				if (comment != NULL) {
+					g_hash_table_insert (entries, g_strdup (name), _gth_comment_index_entry_new (comment, info));
+					g_object_unref (comment);
+				}
+
+				g_object_unref (file);
+			}
+
+			g_free (name);
+		}
+
+		g_object_unref (info);
+	}
+
+	g_object_unref (enumerator);
+
+	if ((cancellable != NULL) && g_cancellable_is_cancelled (cancellable)) {
+		g_hash_table_unref (entries);
+		return NULL;
+	}
+
+	*changed = (old_entries == NULL)
+		   || (n_reused != g_hash_table_size (old_entries))
+		   || (n_reused != g_hash_table_size (entries));
+
+	return entries;
+}
+
+
+static void
+_gth_comment_index_serialize (FolderIndex  *index,
+			      void        **buffer,
+			      gsize        *size)
+{
+	GVariantBuilder  entries;
+	GHashTableIter   iter;
+	const char      *name;
+	GVariant        *entry;
+	char            *uri;
+	GVariant        *data;
+
+	g_variant_builder_init (&entries, G_VARIANT_TYPE ("a{s" ENTRY_FORMAT "}"));
+	g_hash_table_iter_init (&iter, index->entries);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &name, (gpointer *) &entry))
+		g_variant_builder_add (&entries, "{s@" ENTRY_FORMAT "}", name, entry);
+
+	uri = g_file_get_uri (index->folder);
+	data = g_variant_new (INDEX_FORMAT, INDEX_VERSION, uri, &entries);
+	g_variant_ref_sink (data);
+
+	*size = g_variant_get_size (data);
+	*buffer = g_malloc (*size);
+	g_variant_store (data, *buffer);
+
+	g_variant_unref (data);
+	g_free (uri);
+}
+
+
+/* called with the mutex locked */
+static void
+_gth_comment_index_set_entries (GFile      *folder,
+				const char *uri,
+				GHashTable *entries,
+				gboolean    changed,
+				gint64      now)
+{
+	FolderIndex *index;
+
+	index = gth_user_cache_lookup (indexes, uri);
+	if (index == NULL) {
+		index = folder_index_new (folder);
+		gth_user_cache_add (indexes, uri, index);
+	}
+	g_hash_table_unref (index->entries);
+	index->entries = entries;
+	index->last_check = now;
+	if (changed)
+		gth_user_cache_queue_save (indexes, uri);
+}
+
+
+static gpointer
+build_index_thread_func (gpointer user_data)
+{
+	GFile      *folder = user_data;
+	char       *uri;
+	gint64      now;
+	GHashTable *entries;
+	gboolean    changed;
+
+	uri = g_file_get_uri (folder);
+	now = g_get_monotonic_time ();
+	entries = _gth_comment_index_update_entries (folder, NULL, &changed, NULL);
+
+	g_mutex_lock (&index_mutex);
+	if (entries != NULL)
+		_gth_comment_index_set_entries (folder, uri, entries, changed, now);
+	g_hash_table_remove (building, uri);
+	g_mutex_unlock (&index_mutex);
+
+	g_free (uri);
+	g_object_unref (folder);
+
+	return NULL;
+}
+
+
+/* Reads all the comment files of @folder in a thread, if not already
+ * doing it.  Called with the mutex locked. */
+static void
+_gth_comment_index_build (GFile      *folder,
+			  const char *uri)
+{
+	if (g_hash_table_contains (building, uri))
+		return;
+
+	g_hash_table_add (building, g_strdup (uri));
+	g_thread_unref (g_thread_new ("gth-comment-index", build_index_thread_func, g_object_ref (folder)));
+}
+
+
+/* Updates the index of @folder if not checked recently.  The comment files
+ * are read without holding the mutex, the new entries replace the old ones
+ * when done.  Returns FALSE if the index cannot be used, this is the case
+ * while the index of a folder without a saved index is created. */
+static gboolean
+_gth_comment_index_update (GFile        *folder,
+			   GCancellable *cancellable)
+{
+	char        *uri;
+	FolderIndex *index;
+	gint64       now;
+	GHashTable  *old_entries;
+	GHashTable  *entries;
+	gboolean     changed;
+
+	uri = g_file_get_uri (folder);
+	now = g_get_monotonic_time ();
+
+	g_mutex_lock (&index_mutex);
+
+	if (indexes == NULL) {
+		indexes = gth_user_cache_new (CACHE_NAME,
+					      MAX_INDEXES_IN_MEMORY,
+					      (GthUserCacheSerializeFunc) _gth_comment_index_serialize,
+					      (GDestroyNotify) folder_index_free,
+					      &index_mutex);
+		building = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	}
+
+	if (g_hash_table_contains (building, uri)) {
+		g_mutex_unlock (&index_mutex);
+		g_free (uri);
+		return FALSE;
+	}
+
+	/* do not check the comment files for every file */
+
+	index = gth_user_cache_lookup (indexes, uri);
+	if ((index != NULL) && (now - index->last_check < CHECK_INTERVAL)) {
+		g_mutex_unlock (&index_mutex);
+		g_free (uri);
+		return TRUE;
+	}
+
+	/* the entries can be changed by gth_comment_index_set while reading
+	 * the comment files, use a copy */
+
+	old_entries = NULL;
+	if (index != NULL) {
+		GHashTableIter  iter;
+		const char     *name;
+		GVariant       *entry;
+
+		old_entries = _gth_comment_index_entries_new ();
+		g_hash_table_iter_init (&iter, index->entries);
+		while (g_hash_table_iter_next (&iter, (gpointer *) &name, (gpointer *) &entry))
+			g_hash_table_insert (old_entries, g_strdup (name), g_variant_ref (entry));
+	}
+
+	g_mutex_unlock (&index_mutex);
+
+	if (old_entries == NULL) {
+		old_entries = _gth_comment_index_load (folder);
+
+		/* reading every comment file here would block the first
+		 * lookup, read them in a thread */
+
+		if (old_entries == NULL) {
+			g_mutex_lock (&index_mutex);
+			_gth_comment_index_build (folder, uri);
+			g_mutex_unlock (&index_mutex);
+			g_free (uri);
+			return FALSE;
+		}
+	}
+
+	entries = _gth_comment_index_update_entries (folder, old_entries, &changed, cancellable);
+
+	if (old_entries != NULL)
+		g_hash_table_unref (old_entries);
+
+	if (entries == NULL) {
+		g_free (uri);
+		return FALSE;
+	}
+
+	/* a comment set while reading the files is read again at the next
+	 * check, because the entry has the old file times */
+
+	g_mutex_lock (&index_mutex);
+	_gth_comment_index_set_entries (folder, uri, entries, changed, now);
+	g_mutex_unlock (&index_mutex);
+
+	g_free (uri);
+
+	return TRUE;
+}
+
+
+/* Sets @comment to the comment of @file read from the folder index, NULL if
+ * the file has no comment.  Returns FALSE if the index cannot be used, in
+ * this case the comment file must be read with gth_comment_new_for_file. */
+gboolean
+gth_comment_index_lookup (GFile         *file,
+			  GthComment   **comment,
+			  GCancellable  *cancellable)
+{
+	GFile       *folder;
+	char        *uri;
+	char        *name;
+	FolderIndex *index;
+	GVariant    *entry;
+
+	folder = g_file_get_parent (file);
+	if (folder == NULL)
+		return FALSE;
+
+	if (! _gth_comment_index_update (folder, cancellable)) {
+		g_object_unref (folder);
+		return FALSE;
+	}
+
+	uri = g_file_get_uri (folder);
+	name = g_file_get_basename (file);
+
+	g_mutex_lock (&index_mutex);
+
+	index = gth_user_cache_lookup (indexes, uri);
+	if (index != NULL) {
+		entry = g_hash_table_lookup (index->entries, name);
+		*comment = (entry != NULL) ? _gth_comment_index_entry_to_comment (entry) : NULL;
+	}
+
+	g_mutex_unlock (&index_mutex);
+
+	g_free (name);
+	g_free (uri);
+	g_object_unref (folder);
+
+	return (index != NULL);
+}
+
+
+/* Updates the index after the comment file of @file has been written or
+ * deleted, @comment is NULL in the latter case. */
+void
+gth_comment_index_set (GFile      *file,
+		       GthComment *comment)
+{
+	GFile       *folder;
+	char        *uri;
+	char        *name;
+	GFileInfo   *comment_info;
+	FolderIndex *index;
+
+	folder = g_file_get_parent (file);
+	if (folder == NULL)
+		return;
+
+	uri = g_file_get_uri (folder);
+	name = g_file_get_basename (file);
+
+	/* the entry is valid for the comment file just written, a later
+	 * change made by another program is detected by the next check */
+
+	comment_info = NULL;
+	if (comment != NULL) {
+		GFile *comment_file;
+
+		comment_file = gth_comment_get_comment_file (file);
+		comment_info = g_file_query_info (comment_file,
+						  COMMENT_FILE_ATTRIBUTES,
+						  G_FILE_QUERY_INFO_NONE,
+						  NULL,
+						  NULL);
+		g_object_unref (comment_file);
+	}
+
+	g_mutex_lock (&index_mutex);
+
+	/* an index not in memory is updated when loaded */
+
+	index = (indexes != NULL) ? gth_user_cache_lookup (indexes, uri) : NULL;
+	if (index != NULL) {
+		if (comment_info != NULL)
+			g_hash_table_insert (index->entries, g_strdup (name), _gth_comment_index_entry_new (comment, comment_info));
+		else
+			g_hash_table_remove (index->entries, name);
+
+		if ((comment != NULL) && (comment_info == NULL))
+			gth_user_cache_remove (indexes, uri);
+		else
+			gth_user_cache_queue_save (indexes, uri);
+	}
+
+	g_mutex_unlock (&index_mutex);
+
+	_g_object_unref (comment_info);
+	g_free (name);
+	g_free (uri);
+	g_object_unref (folder);
+}
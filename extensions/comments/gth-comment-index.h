@@ -0,0 +1,40 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+/*
+ *  GThumb
+ *
+ *  Copyright (C) 2013 Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef GTH_COMMENT_INDEX_H
+#define GTH_COMMENT_INDEX_H
+
+#include <glib.h>
+#include <gio/gio.h>
+#include "gth-comment.h"
+
+G_BEGIN_DECLS
+
+gboolean	gth_comment_index_lookup	(GFile         *file,
+						 GthComment   **comment,
+						 GCancellable  *cancellable);
+void		gth_comment_index_set		(GFile         *file,
+						 GthComment    *comment);
+
+G_END_DECLS
+
+#endif /* GTH_COMMENT_INDEX_H */
@@ -23,6 +23,7 @@
 #include <string.h>
 #include <gthumb.h>
 #include "gth-comment.h"
+#include "gth-comment-index.h"
 
 
 #define COMMENT_VERSION "3.0"
@@ -272,6 +273,102 @@ gth_comment_get_comment_file (GFile *file)
 }
 
 
+/* -- gth_comment_new_for_file -- */
+
+
+typedef struct {
+	GthComment *comment;
+	const char *version;
+	gboolean    categories;
+} ReadData;
+
+
+static void
+read_start_element (int          depth,
+		    const char  *element_name,
+		    const char **attribute_names,
+		    const char **attribute_values,
+		    gpointer     user_data)
+{
+	ReadData   *read_data = user_data;
+	const char *value;
+
+	if (depth == 0) {
+		if (g_strcmp0 (dom_reader_get_attribute (attribute_names, attribute_values, "format"), "2.0") == 0)
+			read_data->version = "2.0";
+		else if (g_strcmp0 (dom_reader_get_attribute (attribute_names, attribute_values, "version"), "3.0") == 0)
+			read_data->version = "3.0";
+		return;
+	}
+
+	if (g_strcmp0 (read_data->version, "3.0") != 0)
+		return;
+
+	value = dom_reader_get_attribute (attribute_names, attribute_values, "value");
+	if (depth == 1) {
+		if (strcmp (element_name, "time") == 0)
+			gth_comment_set_time_from_exif_format (read_data->comment, value);
+		else if ((strcmp (element_name, "rating") == 0) && (value != NULL)) {
+			int v;
+
+			sscanf (value, "%d", &v);
+			gth_comment_set_rating (read_data->comment, v);
+		}
+		else if (strcmp (element_name, "categories") == 0)
+			read_data->categories = TRUE;
+	}
+	else if ((depth == 2) && read_data->categories && (strcmp (element_name, "category") == 0))
+		gth_comment_add_category (read_data->comment, value);
+}
+
+
+static void
+read_end_element (int          depth,
+		  const char  *element_name,
+		  const char  *text,
+		  gpointer     user_data)
+{
+	ReadData *read_data = user_data;
+
+	if (depth != 1)
+		return;
+
+	read_data->categories = FALSE;
+
+	if (g_strcmp0 (read_data->version, "2.0") == 0) {
+		if (strcmp (element_name, "Note") == 0)
+			gth_comment_set_note (read_data->comment, text);
+		else if (strcmp (element_name, "Place") == 0)
+			gth_comment_set_place (read_data->comment, text);
+		else if ((strcmp (element_name, "Time") == 0) && (text != NULL))
+			gth_comment_set_time_from_time_t (read_data->comment, atol (text));
+		else if ((strcmp (element_name, "Keywords") == 0) && (text != NULL)) {
+			char **categories;
+			int    i;
+
+			categories = g_strsplit (text, ",", -1);
+			for (i = 0; categories[i] != NULL; i++)
+				gth_comment_add_category (read_data->comment, categories[i]);
+			g_strfreev (categories);
+		}
+	}
+	else if (g_strcmp0 (read_data->version, "3.0") == 0) {
+		if (strcmp (element_name, "caption") == 0)
+			gth_comment_set_caption (read_data->comment, text);
+		else if (strcmp (element_name, "note") == 0)
+			gth_comment_set_note (read_data->comment, text);
+		else if (strcmp (element_name, "place") == 0)
+			gth_comment_set_place (read_data->comment, text);
+	}
+}
+
+
+static const DomReader comment_reader = {
+	read_start_element,
+	read_end_element
+};
+
+
 GthComment *
 gth_comment_new_for_file (GFile         *file,
 			  GCancellable  *cancellable,
@@ -283,7 +380,7 @@ gth_comment_new_for_file (GFile         *file,
 	gsize        zipped_size;
 	void        *buffer;
 	gsize        size;
-	DomDocument *doc;
+	ReadData     read_data;
 
 	comment_file = gth_comment_get_comment_file (file);
 	if (comment_file == NULL)
@@ -307,17 +404,14 @@ gth_comment_new_for_file (GFile         *file,
 	}
 
 	comment = gth_comment_new ();
-	doc = dom_document_new ();
-	if (dom_document_load (doc, buffer, size, error)) {
-		dom_domizable_load_from_element (DOM_DOMIZABLE (comment), DOM_ELEMENT (doc)->first_child);
-	}
-	else {
-		buffer = NULL;
+	read_data.comment = comment;
+	read_data.version = NULL;
+	read_data.categories = FALSE;
+	if (! dom_reader_parse (&comment_reader, buffer, size, &read_data, error)) {
 		g_object_unref (comment);
 		comment = NULL;
 	}
 
-	g_object_unref (doc);
 	g_free (buffer);
 	g_free (zipped_buffer);
 
@@ -700,13 +794,16 @@ gth_comment_update_from_general_attributes (GthFileData *file_data)
 			g_file_make_directory (comment_directory, NULL, NULL);
 
 		buffer = gth_comment_to_data (comment, &size);
-		_g_file_write (comment_file,
-			       FALSE,
-			       G_FILE_CREATE_NONE,
-			       buffer,
-			       size,
-			       NULL,
-			       NULL);
+		if (_g_file_write (comment_file,
+				   FALSE,
+				   G_FILE_CREATE_NONE,
+				   buffer,
+				   size,
+				   NULL,
+				   NULL))
+		{
+			gth_comment_index_set (file_data->file, comment);
+		}
 
 		{
 			GFile *parent;
@@ -23,6 +23,7 @@
 #include <glib.h>
 #include <gthumb.h>
 #include "gth-comment.h"
+#include "gth-comment-index.h"
 #include "gth-metadata-provider-comment.h"
 
 
@@ -72,7 +73,11 @@ gth_metadata_provider_comment_read (GthMetadataProvider *self,
 	GPtrArray  *categories;
 	char       *comment_time;
 
-	comment = gth_comment_new_for_file (file_data->file, cancellable, NULL);
+	/* the comments of the folder are read once, the comment file is
+	 * read directly only if the index is not available. */
+
+	if (! gth_comment_index_lookup (file_data->file, &comment, cancellable))
+		comment = gth_comment_new_for_file (file_data->file, cancellable, NULL);
 	g_file_info_set_attribute_boolean (file_data->info, "comment::no-comment-file", (comment == NULL));
 
 	if (comment == NULL)
@@ -211,7 +216,8 @@ gth_metadata_provider_comment_write (GthMetadataProvider   *self,
 	comment_folder = g_file_get_parent (comment_file);
 
 	g_file_make_directory (comment_folder, NULL, NULL);
-	_g_file_write (comment_file, FALSE, 0, data, length, cancellable, NULL);
+	if (_g_file_write (comment_file, FALSE, 0, data, length, cancellable, NULL))
+		gth_comment_index_set (file_data->file, comment);
 
 	g_object_unref (comment_folder);
 	g_object_unref (comment_file);
@@ -27,6 +27,7 @@
 #include "callbacks.h"
 #include "dlg-comments-preferences.h"
 #include "gth-comment.h"
+#include "gth-comment-index.h"
 #include "gth-metadata-provider-comment.h"
 #include "preferences.h"
 
@@ -147,7 +148,8 @@ comments__delete_metadata_cb (GFile  *file,
 
 	comment_file = gth_comment_get_comment_file (file);
 	if (comment_file != NULL) {
-		g_file_delete (comment_file, NULL, NULL);
+		if (g_file_delete (comment_file, NULL, NULL))
+			gth_comment_index_set (file, NULL);
 		g_object_unref (comment_file);
 	}
 }
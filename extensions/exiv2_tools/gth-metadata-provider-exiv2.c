@@ -28,6 +28,12 @@
 #include "gth-metadata-provider-exiv2.h"
 
 
+#define JPEG_HEADER_INITIAL_SIZE (64 * 1024)
+#define JPEG_HEADER_MAX_SIZE (1024 * 1024)
+#define JPEG_MARKER_SOS 0xda
+#define JPEG_MARKER_EOI 0xd9
+
+
 struct _GthMetadataProviderExiv2Private {
 	GSettings *general_settings;
 };
@@ -93,6 +99,116 @@ gth_metadata_provider_exiv2_can_write (GthMetadataProvider  *self,
 }
 
 
+static gboolean
+gth_metadata_provider_exiv2_can_cache (GthMetadataProvider *base,
+				       GthFileData         *file_data)
+{
+	GthMetadataProviderExiv2 *self = GTH_METADATA_PROVIDER_EXIV2 (base);
+	GFile                    *sidecar;
+	gboolean                  sidecar_exists;
+
+	/* the general attributes are read from the file only if the
+	 * metadata is stored in the files. */
+
+	if (self->priv->general_settings == NULL)
+		self->priv->general_settings = g_settings_new (GTHUMB_GENERAL_SCHEMA);
+	if (! g_settings_get_boolean (self->priv->general_settings, PREF_GENERAL_STORE_METADATA_IN_FILES))
+		return FALSE;
+
+	/* the sidecar can change without changing the file */
+
+	sidecar = exiv2_get_sidecar (file_data->file);
+	sidecar_exists = g_file_query_exists (sidecar, NULL);
+	g_object_unref (sidecar);
+
+	return ! sidecar_exists;
+}
+
+
+static gsize
+gth_metadata_provider_exiv2_get_read_size (GthMetadataProvider *base,
+					   GthFileData         *file_data)
+{
+	/* only the JPEG images are read from the shared buffer */
+
+	if (g_content_type_is_a (gth_file_data_get_mime_type (file_data), "image/jpeg"))
+		return JPEG_HEADER_INITIAL_SIZE;
+
+	return 0;
+}
+
+
+/* Returns TRUE if the buffer contains all the JPEG segments that precede the
+ * image data, that is all the segments exiv2 reads. */
+static gboolean
+_jpeg_header_is_complete (const guchar *buffer,
+			  gsize         buffer_size)
+{
+	gsize offset;
+
+	offset = 2; /* skip the SOI marker */
+	while (offset + 4 <= buffer_size) {
+		guchar marker;
+
+		if (buffer[offset] != 0xff)
+			return TRUE; /* invalid data, reading more will not help */
+
+		marker = buffer[offset + 1];
+		if (marker == 0xff) { /* fill byte */
+			offset += 1;
+			continue;
+		}
+
+		if ((marker == JPEG_MARKER_SOS) || (marker == JPEG_MARKER_EOI))
+			return TRUE;
+
+		if ((marker == 0x01) || ((marker >= 0xd0) && (marker <= 0xd7))) { /* no parameters */
+			offset += 2;
+			continue;
+		}
+
+		offset += 2 + ((buffer[offset + 2] << 8) | buffer[offset + 3]);
+	}
+
+	return FALSE;
+}
+
+
+static gboolean
+_exiv2_read_metadata_from_shared_buffer (GthFileData  *file_data,
+					 GFileInfo    *info,
+					 gboolean      update_general_attributes,
+					 GCancellable *cancellable)
+{
+	gsize requested_size;
+
+	/* exiv2 stops reading a JPEG image at the start of the image data,
+	 * so only the header is needed. */
+
+	requested_size = JPEG_HEADER_INITIAL_SIZE;
+	while (TRUE) {
+		const guchar *buffer;
+		gsize         buffer_size;
+
+		buffer = gth_metadata_provider_get_file_buffer (file_data, requested_size, &buffer_size, cancellable);
+		if (buffer == NULL)
+			return FALSE;
+
+		if (_jpeg_header_is_complete (buffer, buffer_size))
+			return exiv2_read_metadata_from_buffer ((void *) buffer,
+								buffer_size,
+								info,
+								update_general_attributes,
+								NULL);
+
+		if ((buffer_size < requested_size) || (requested_size >= JPEG_HEADER_MAX_SIZE))
+			return FALSE;
+
+		requested_size *= 2;
+	}
+}
+
+
 static void
 gth_metadata_provider_exiv2_read (GthMetadataProvider *base,
 				  GthFileData         *file_data,
@@ -115,13 +231,22 @@ gth_metadata_provider_exiv2_read (GthMetadataProvider *base,
 	update_general_attributes = g_settings_get_boolean (self->priv->general_settings, PREF_GENERAL_STORE_METADATA_IN_FILES);
 
 	/* this function is executed in a secondary thread, so calling
-	 * slow sync functions is not a problem. */
-
-	exiv2_read_metadata_from_file (file_data->file,
-				       file_data->info,
-				       update_general_attributes,
-				       cancellable,
-				       NULL);
+	 * slow sync functions is not a problem.
+	 * Use the file content read once for all the providers when the
+	 * header is entirely there, let exiv2 read the file otherwise. */
+
+	if (! g_content_type_is_a (gth_file_data_get_mime_type (file_data), "image/jpeg")
+	    || ! _exiv2_read_metadata_from_shared_buffer (file_data,
+							  file_data->info,
+							  update_general_attributes,
+							  cancellable))
+	{
+		exiv2_read_metadata_from_file (file_data->file,
+					       file_data->info,
+					       update_general_attributes,
+					       cancellable,
+					       NULL);
+	}
 
 	/* sidecar data */
 
@@ -344,6 +469,8 @@ gth_metadata_provider_exiv2_class_init (GthMetadataProviderExiv2Class *klass)
 	mp_class = GTH_METADATA_PROVIDER_CLASS (klass);
 	mp_class->can_read = gth_metadata_provider_exiv2_can_read;
 	mp_class->can_write = gth_metadata_provider_exiv2_can_write;
+	mp_class->can_cache = gth_metadata_provider_exiv2_can_cache;
+	mp_class->get_read_size = gth_metadata_provider_exiv2_get_read_size;
 	mp_class->read = gth_metadata_provider_exiv2_read;
 	mp_class->write = gth_metadata_provider_exiv2_write;
 }
@@ -268,10 +268,31 @@ gth_file_data_cmp_date_time_original (GthFileData *a,
 }
 
 
+static void
+gth_file_data_date_time_original_key (GthFileData        *file_data,
+				      GthFileDataSortKey *key)
+{
+	GTimeVal *pt;
+	GTimeVal  t;
+
+	pt = NULL;
+	if (gth_file_data_get_digitalization_time (file_data, &t))
+		pt = &t;
+	if (pt == NULL)
+		pt = gth_file_data_get_modification_time (file_data);
+
+	key->value = (gint64) pt->tv_sec * G_USEC_PER_SEC + pt->tv_usec;
+	key->text = NULL;
+	key->folder_len = 0;
+	key->name = gth_file_data_get_filename_sort_key (file_data);
+}
+
+
 GthFileDataSort exiv2_sort_types[] = {
 	{ "exif::photo::datetimeoriginal", N_("date photo was taken"),
 	  "Exif::Photo::DateTimeOriginal,Exif::Photo::DateTimeDigitized",
-	  gth_file_data_cmp_date_time_original }
+	  gth_file_data_cmp_date_time_original,
+	  gth_file_data_date_time_original_key }
 };
 
 
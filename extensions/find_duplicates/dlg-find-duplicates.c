@@ -70,7 +70,8 @@ ok_clicked_cb (GtkWidget  *widget,
 	gth_find_duplicates_exec (data->browser,
 				  folder,
 				  gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (GET_WIDGET ("include_subfolder_checkbutton"))),
-				  g_list_nth_data (data->general_tests, gtk_combo_box_get_active (GTK_COMBO_BOX (GET_WIDGET ("file_type_combobox")))));
+				  g_list_nth_data (data->general_tests, gtk_combo_box_get_active (GTK_COMBO_BOX (GET_WIDGET ("file_type_combobox")))),
+				  gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (GET_WIDGET ("similar_images_checkbutton"))));
 
 	g_object_unref (folder);
 	gtk_widget_destroy (data->dialog);
@@ -27,10 +27,20 @@
 #include <extensions/file_manager/actions.h>
 #include "gth-find-duplicates.h"
 #include "gth-folder-chooser-dialog.h"
+#include "gth-image-hash.h"
 
 
 #define GET_WIDGET(x) (_gtk_builder_get_widget (self->priv->builder, (x)))
-#define BUFFER_SIZE 4096
+#define BUFFER_SIZE (1024 * 1024)
+#define PARTIAL_CHECKSUM_SIZE (64 * 1024) /* bytes read at the start and at the end of the file */
+#define N_CHECKSUM_THREADS 4
+#define CHECKSUM_ATTRIBUTE "find-duplicates::checksum"
+#define PARTIAL_CHECKSUM_ATTRIBUTE "find-duplicates::partial-checksum"
+#define INODE_ATTRIBUTE "unix::inode"
+#define IMAGE_HASH_ATTRIBUTE "find-duplicates::image-hash"
+#define IMAGE_HASH_THUMB_SIZE 128
+#define MAX_IMAGE_HASH_DISTANCE 6
+#define IMAGE_HASH_BATCH_SIZE 100 /* cached hashes added before returning to the main loop */
 #define SELECT_COMMAND_ID_DATA "delete-command-id"
 #define PULSE_DELAY 50
 
@@ -72,33 +82,39 @@ SelectCommand select_commands[] = {
 
 struct _GthFindDuplicatesPrivate
 {
-	GthBrowser    *browser;
-	GFile         *location;
-	gboolean       recursive;
-	GthTest       *test;
-	GtkBuilder    *builder;
-	GtkWidget     *duplicates_list;
-	GtkWidget     *select_button;
-	GtkWidget     *select_menu;
-	GString       *attributes;
-	GCancellable  *cancellable;
-	gboolean       io_operation;
-	gboolean       closing;
-	GthFileSource *file_source;
-	int            n_duplicates;
-	goffset        duplicates_size;
-	int            n_files;
-	int            n_file;
-	GList         *files;
-	GList         *directories;
-	GFile         *current_directory;
-	GthFileData   *current_file;
-	guchar         buffer[BUFFER_SIZE];
-	GChecksum     *checksum;
-	GInputStream  *file_stream;
-	GHashTable    *duplicated;
-	gulong         folder_changed_id;
-	guint          pulse_event_id;
+	GthBrowser       *browser;
+	GFile            *location;
+	gboolean          recursive;
+	gboolean          similar_images;
+	GthTest          *test;
+	GtkBuilder       *builder;
+	GtkWidget        *duplicates_list;
+	GtkWidget        *select_button;
+	GtkWidget        *select_menu;
+	GString          *attributes;
+	GCancellable     *cancellable;
+	gboolean          io_operation;
+	gboolean          closing;
+	GthFileSource    *file_source;
+	int               n_duplicates;
+	goffset           duplicates_size;
+	int               n_files;
+	int               n_file;
+	GList            *files;
+	GList            *directories;
+	GFile            *current_directory;
+	gboolean          partial_checksum;
+	int               n_running;
+	guint64           bytes_read;
+	gint64            checksum_start_time;
+	GHashTable       *partial_checksums;
+	GHashTable       *duplicated;
+	GthThumbLoader   *thumb_loader;
+	GthImageHashTree *image_hashes;
+	GthFileData      *current_file;
+	gulong            folder_changed_id;
+	guint             pulse_event_id;
+	guint             image_hash_id;
 };
 
 
@@ -146,6 +162,8 @@ gth_find_duplicates_finalize (GObject *object)
 
 	if (self->priv->pulse_event_id != 0)
 		g_source_remove (self->priv->pulse_event_id);
+	if (self->priv->image_hash_id != 0)
+		g_source_remove (self->priv->image_hash_id);
 	if (self->priv->folder_changed_id != 0)
 		g_signal_handler_disconnect (gth_main_get_default_monitor (),
 					     self->priv->folder_changed_id);
@@ -158,12 +176,12 @@ gth_find_duplicates_finalize (GObject *object)
 	_g_object_unref (self->priv->file_source);
 	_g_object_list_unref (self->priv->files);
 	_g_object_list_unref (self->priv->directories);
-	_g_object_unref (self->priv->current_file);
 	_g_object_unref (self->priv->current_directory);
-	if (self->priv->checksum != NULL)
-		g_checksum_free (self->priv->checksum);
-	_g_object_unref (self->priv->file_stream);
+	g_hash_table_unref (self->priv->partial_checksums);
 	g_hash_table_unref (self->priv->duplicated);
+	_g_object_unref (self->priv->thumb_loader);
+	gth_image_hash_tree_free (self->priv->image_hashes);
+	_g_object_unref (self->priv->current_file);
 
 	G_OBJECT_CLASS (gth_find_duplicates_parent_class)->finalize (object);
 }
@@ -195,15 +213,24 @@ gth_find_duplicates_init (GthFindDuplicates *self)
 	self->priv->files = NULL;
 	self->priv->directories = NULL;
 	self->priv->current_directory = NULL;
-	self->priv->current_file = NULL;
-	self->priv->checksum = NULL;
-	self->priv->file_stream = NULL;
+	self->priv->partial_checksum = FALSE;
+	self->priv->n_running = 0;
+	self->priv->bytes_read = 0;
+	self->priv->checksum_start_time = 0;
+	self->priv->partial_checksums = g_hash_table_new_full (g_str_hash,
+							       g_str_equal,
+							       g_free,
+							       (GDestroyNotify) g_ptr_array_unref);
 	self->priv->duplicated = g_hash_table_new_full (g_str_hash,
 							g_str_equal,
 							g_free,
 							(GDestroyNotify) duplicated_data_free);
+	self->priv->thumb_loader = NULL;
+	self->priv->image_hashes = NULL;
+	self->priv->current_file = NULL;
 	self->priv->cancellable = g_cancellable_new ();
 	self->priv->folder_changed_id = 0;
+	self->priv->image_hash_id = 0;
 }
 
 
@@ -509,125 +536,474 @@ _file_list_add_file (GthFindDuplicates *self,
 
 
 static void
-file_input_stream_read_ready_cb (GObject      *source,
-		    	    	 GAsyncResult *result,
-		    	    	 gpointer      user_data)
+add_checksum (GthFindDuplicates *self,
+	      GthFileData       *file_data,
+	      const char        *checksum)
 {
-	GthFindDuplicates *self = user_data;
-	GError            *error = NULL;
-	gssize             buffer_size;
+	DuplicatedData *d_data;
 
-	self->priv->io_operation = FALSE;
-	if (self->priv->closing) {
-		gtk_widget_destroy (GET_WIDGET ("find_duplicates_dialog"));
-		return;
+	g_file_info_set_attribute_string (file_data->info,
+					  "find-duplicates::checksum",
+					  checksum);
+
+	d_data = g_hash_table_lookup (self->priv->duplicated, checksum);
+	if (d_data == NULL) {
+		d_data = duplicated_data_new ();
+		g_hash_table_insert (self->priv->duplicated, g_strdup (checksum), d_data);
 	}
+	if (d_data->file_data == NULL)
+		d_data->file_data = g_object_ref (file_data);
+	d_data->files = g_list_prepend (d_data->files, g_object_ref (file_data));
+	d_data->n_files += 1;
+	d_data->total_size += g_file_info_get_size (file_data->info);
+	if (d_data->n_files > 1) {
+		char  *text;
+		GList *singleton;
+
+		text = g_strdup_printf (g_dngettext (NULL, "%d duplicate", "%d duplicates", d_data->n_files - 1), d_data->n_files - 1);
+		g_file_info_set_attribute_string (d_data->file_data->info,
+						  "find-duplicates::n-duplicates",
+						  text);
+		g_free (text);
+
+		singleton = g_list_append (NULL, d_data->file_data);
+		if (d_data->n_files == 2) {
+			gth_file_list_add_files (GTH_FILE_LIST (self->priv->duplicates_list), singleton, -1);
+			_file_list_add_file (self, d_data->file_data); /* add the first one as well */
+		}
+		else
+			gth_file_list_update_files (GTH_FILE_LIST (self->priv->duplicates_list), singleton);
+		_file_list_add_file (self, file_data);
+		g_list_free (singleton);
+
+		self->priv->n_duplicates += 1;
+		self->priv->duplicates_size += g_file_info_get_size (d_data->file_data->info);
+		update_total_duplicates_label (self);
+	}
+
+	duplicates_list_view_selection_changed_cb (NULL, self);
+}
 
-	buffer_size = g_input_stream_read_finish (G_INPUT_STREAM (source), result, &error);
 
-	if (buffer_size < 0) {
-		start_next_checksum (self);
-		return;
+/* The partial checksum is a fast hash of the first and last
+ * PARTIAL_CHECKSUM_SIZE bytes. */
+static void
+add_partial_checksum (GthFindDuplicates *self,
+		      GthFileData       *file_data,
+		      const char        *checksum)
+{
+	char      *key;
+	GPtrArray *files;
+
+	g_file_info_set_attribute_string (file_data->info,
+					  "find-duplicates::partial-checksum",
+					  checksum);
+
+	key = g_strdup_printf ("%" G_GOFFSET_FORMAT ":%s", g_file_info_get_size (file_data->info), checksum);
+	files = g_hash_table_lookup (self->priv->partial_checksums, key);
+	if (files == NULL) {
+		files = g_ptr_array_new_with_free_func (g_object_unref);
+		g_hash_table_insert (self->priv->partial_checksums, key, files);
 	}
-	else if (buffer_size == 0) {
-		const char     *checksum;
-		DuplicatedData *d_data;
+	else
+		g_free (key);
+	g_ptr_array_add (files, g_object_ref (file_data));
+}
 
-		self->priv->n_file += 1;
 
-		g_object_unref (self->priv->file_stream);
-		self->priv->file_stream = NULL;
+typedef struct {
+	char        *folder_uri;
+	int          pos;
+	GthFileData *file_data;
+} FolderSortItem;
 
-		checksum = g_checksum_get_string (self->priv->checksum);
-		g_file_info_set_attribute_string (self->priv->current_file->info,
-						  "find-duplicates::checksum",
-						  checksum);
 
-		d_data = g_hash_table_lookup (self->priv->duplicated, checksum);
-		if (d_data == NULL) {
-			d_data = duplicated_data_new ();
-			g_hash_table_insert (self->priv->duplicated, g_strdup (checksum), d_data);
-		}
-		if (d_data->file_data == NULL)
-			d_data->file_data = g_object_ref (self->priv->current_file);
-		d_data->files = g_list_prepend (d_data->files, g_object_ref (self->priv->current_file));
-		d_data->n_files += 1;
-		d_data->total_size += g_file_info_get_size (self->priv->current_file->info);
-		if (d_data->n_files > 1) {
-			char  *text;
-			GList *singleton;
+static int
+folder_sort_item_cmp (gconstpointer a,
+		      gconstpointer b,
+		      gpointer      user_data)
+{
+	const FolderSortItem *item_a = a;
+	const FolderSortItem *item_b = b;
+	int                   result;
 
-			text = g_strdup_printf (g_dngettext (NULL, "%d duplicate", "%d duplicates", d_data->n_files - 1), d_data->n_files - 1);
-			g_file_info_set_attribute_string (d_data->file_data->info,
-							  "find-duplicates::n-duplicates",
-							  text);
-			g_free (text);
+	result = strcmp (item_a->folder_uri, item_b->folder_uri);
+	if (result == 0)
+		result = item_a->pos - item_b->pos;
 
-			singleton = g_list_append (NULL, d_data->file_data);
-			if (d_data->n_files == 2) {
-				gth_file_list_add_files (GTH_FILE_LIST (self->priv->duplicates_list), singleton, -1);
-				_file_list_add_file (self, d_data->file_data); /* add the first one as well */
-			}
-			else
-				gth_file_list_update_files (GTH_FILE_LIST (self->priv->duplicates_list), singleton);
-			_file_list_add_file (self, self->priv->current_file);
-			g_list_free (singleton);
+	return result;
+}
 
-			self->priv->n_duplicates += 1;
-			self->priv->duplicates_size += g_file_info_get_size (d_data->file_data->info);
-			update_total_duplicates_label (self);
+
+/* Returns @files sorted by folder, keeping the order of the files in the same
+ * folder, so that the metadata cache of a folder is loaded once for all its
+ * files.  @files is freed. */
+static GList *
+sort_files_by_folder (GList *files)
+{
+	int             n_files;
+	FolderSortItem *items;
+	GList          *scan;
+	GList          *result;
+	int             i;
+
+	n_files = g_list_length (files);
+	items = g_new (FolderSortItem, n_files);
+	for (scan = files, i = 0; scan; scan = scan->next, i++) {
+		GthFileData *file_data = scan->data;
+		GFile       *parent;
+
+		parent = g_file_get_parent (file_data->file);
+		items[i].folder_uri = (parent != NULL) ? g_file_get_uri (parent) : g_strdup ("");
+		items[i].pos = i;
+		items[i].file_data = file_data;
+
+		_g_object_unref (parent);
+	}
+	g_qsort_with_data (items, n_files, sizeof (FolderSortItem), folder_sort_item_cmp, NULL);
+
+	result = NULL;
+	for (i = n_files - 1; i >= 0; i--) {
+		result = g_list_prepend (result, items[i].file_data);
+		g_free (items[i].folder_uri);
+	}
+
+	g_free (items);
+	g_list_free (files);
+
+	return result;
+}
+
+
+/* Returns the files that need the full checksum: the files with the same
+ * size and partial checksum of another file, sorted by folder. */
+static GList *
+get_files_with_same_partial_checksum (GthFindDuplicates *self)
+{
+	GList          *files;
+	GHashTableIter  iter;
+	GPtrArray      *same_checksum;
+
+	files = NULL;
+	g_hash_table_iter_init (&iter, self->priv->partial_checksums);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &same_checksum)) {
+		int i;
+
+		if (same_checksum->len < 2)
+			continue;
+
+		for (i = 0; i < same_checksum->len; i++)
+			files = g_list_prepend (files, g_object_ref (g_ptr_array_index (same_checksum, i)));
+	}
+	g_hash_table_remove_all (self->priv->partial_checksums);
+
+	return sort_files_by_folder (files);
+}
+
+
+/* Returns the files of @files with the same size of another file, the files
+ * with a unique size cannot have duplicates.  @files is freed. */
+static GList *
+get_files_with_same_size (GList *files)
+{
+	GHashTable *sizes;
+	GList      *result;
+	GList      *scan;
+
+	sizes = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, NULL);
+	for (scan = files; scan; scan = scan->next) {
+		GthFileData *file_data = scan->data;
+		gint64       size;
+		int          n;
+
+		size = g_file_info_get_size (file_data->info);
+		n = GPOINTER_TO_INT (g_hash_table_lookup (sizes, &size));
+		g_hash_table_insert (sizes, g_memdup (&size, sizeof (gint64)), GINT_TO_POINTER (n + 1));
+	}
+
+	result = NULL;
+	for (scan = files; scan; scan = scan->next) {
+		GthFileData *file_data = scan->data;
+		gint64       size;
+
+		size = g_file_info_get_size (file_data->info);
+		if (GPOINTER_TO_INT (g_hash_table_lookup (sizes, &size)) > 1)
+			result = g_list_prepend (result, g_object_ref (file_data));
+	}
+
+	g_hash_table_destroy (sizes);
+	_g_object_list_unref (files);
+
+	return g_list_reverse (result);
+}
+
+
+/* -- checksum_thread -- */
+
+
+#define FNV_OFFSET_BASIS G_GUINT64_CONSTANT (14695981039346656037)
+#define FNV_PRIME G_GUINT64_CONSTANT (1099511628211)
+
+
+typedef struct {
+	GthFileData *file_data;
+	goffset      size;
+	gboolean     partial;
+	char        *checksum;
+	gsize        bytes_read;
+} ChecksumData;
+
+
+static ChecksumData *
+checksum_data_new (GthFileData *file_data,
+		   gboolean     partial)
+{
+	ChecksumData *checksum_data;
+
+	checksum_data = g_new0 (ChecksumData, 1);
+	checksum_data->file_data = g_object_ref (file_data);
+	checksum_data->size = g_file_info_get_size (file_data->info);
+	checksum_data->partial = partial;
+	checksum_data->checksum = NULL;
+	checksum_data->bytes_read = 0;
+
+	return checksum_data;
+}
+
+
+static void
+checksum_data_free (ChecksumData *checksum_data)
+{
+	g_object_unref (checksum_data->file_data);
+	g_free (checksum_data->checksum);
+	g_free (checksum_data);
+}
+
+
+/* FNV-1a, a fast non-cryptographic hash used to find the candidates. */
+static guint64
+fnv_hash_update (guint64       hash,
+		 const guchar *buffer,
+		 gsize         size)
+{
+	gsize i;
+
+	for (i = 0; i < size; i++) {
+		hash ^= buffer[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+
+static gboolean
+read_partial_checksum (GInputStream  *stream,
+		       ChecksumData  *checksum_data,
+		       guchar        *buffer,
+		       GCancellable  *cancellable,
+		       GError       **error)
+{
+	guint64 hash;
+	gsize   n;
+
+	hash = FNV_OFFSET_BASIS;
+
+	if (! g_input_stream_read_all (stream, buffer, PARTIAL_CHECKSUM_SIZE, &n, cancellable, error))
+		return FALSE;
+	hash = fnv_hash_update (hash, buffer, n);
+	checksum_data->bytes_read += n;
+
+	if (n == PARTIAL_CHECKSUM_SIZE) {
+		if (checksum_data->size > 2 * PARTIAL_CHECKSUM_SIZE) {
+			if (! G_IS_SEEKABLE (stream)) {
+				g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "");
+				return FALSE;
+			}
+			if (! g_seekable_seek (G_SEEKABLE (stream),
+					       checksum_data->size - PARTIAL_CHECKSUM_SIZE,
+					       G_SEEK_SET,
+					       cancellable,
+					       error))
+			{
+				return FALSE;
+			}
 		}
 
-		duplicates_list_view_selection_changed_cb (NULL, self);
+		if (! g_input_stream_read_all (stream, buffer, PARTIAL_CHECKSUM_SIZE, &n, cancellable, error))
+			return FALSE;
+		hash = fnv_hash_update (hash, buffer, n);
+		checksum_data->bytes_read += n;
+	}
 
-		start_next_checksum (self);
+	checksum_data->checksum = g_strdup_printf ("%016" G_GINT64_MODIFIER "x", hash);
 
-		return;
+	return TRUE;
+}
+
+
+static gboolean
+read_checksum (GInputStream  *stream,
+	       ChecksumData  *checksum_data,
+	       guchar        *buffer,
+	       GCancellable  *cancellable,
+	       GError       **error)
+{
+	GChecksum *checksum;
+	gssize     n;
+
+	checksum = g_checksum_new (G_CHECKSUM_MD5);
+	while ((n = g_input_stream_read (stream, buffer, BUFFER_SIZE, cancellable, error)) > 0) {
+		g_checksum_update (checksum, buffer, n);
+		checksum_data->bytes_read += n;
 	}
+	if (n == 0)
+		checksum_data->checksum = g_strdup (g_checksum_get_string (checksum));
 
-	self->priv->io_operation = TRUE;
+	g_checksum_free (checksum);
+
+	return (n == 0);
+}
+
+
+/* The checksums are saved in the metadata cache, which is valid as long as
+ * the size and the modification time of the file are the same, the inode is
+ * saved as well to detect a file replaced with another one. */
+static gboolean
+load_cached_checksum (ChecksumData *checksum_data,
+		      const char   *attribute)
+{
+	GFileInfo  *info = checksum_data->file_data->info;
+	gboolean    has_inode;
+	guint64     inode;
+	const char *value;
+
+	has_inode = g_file_info_has_attribute (info, INODE_ATTRIBUTE);
+	inode = g_file_info_get_attribute_uint64 (info, INODE_ATTRIBUTE);
+
+	if (! gth_metadata_cache_load (checksum_data->file_data, attribute, attribute, NULL))
+		return FALSE;
+
+	if (has_inode && (g_file_info_get_attribute_uint64 (info, INODE_ATTRIBUTE) != inode)) {
+		g_file_info_set_attribute_uint64 (info, INODE_ATTRIBUTE, inode);
+		return FALSE;
+	}
+
+	value = g_file_info_get_attribute_string (info, attribute);
+	if (value == NULL)
+		return FALSE;
+
+	checksum_data->checksum = g_strdup (value);
+
+	return TRUE;
+}
 
-	g_checksum_update (self->priv->checksum, self->priv->buffer, buffer_size);
-	g_input_stream_read_async (self->priv->file_stream,
-				   self->priv->buffer,
-				   BUFFER_SIZE,
-				   G_PRIORITY_DEFAULT,
-				   self->priv->cancellable,
-				   file_input_stream_read_ready_cb,
-				   self);
+
+static void
+save_cached_checksum (ChecksumData *checksum_data,
+		      const char   *attribute)
+{
+	char *attribute_v[] = { (char *) attribute, INODE_ATTRIBUTE, NULL };
+
+	g_file_info_set_attribute_string (checksum_data->file_data->info, attribute, checksum_data->checksum);
+	gth_metadata_cache_save (checksum_data->file_data, attribute, attribute, attribute_v);
 }
 
 
 static void
-read_current_file_ready_cb (GObject      *source,
-			    GAsyncResult *result,
-			    gpointer      user_data)
+checksum_thread (GSimpleAsyncResult *result,
+		 GObject            *object,
+		 GCancellable       *cancellable)
+{
+	ChecksumData *checksum_data;
+	const char   *attribute;
+	GInputStream *stream;
+	guchar       *buffer;
+	gboolean      success;
+	GError       *error = NULL;
+
+	checksum_data = g_simple_async_result_get_op_res_gpointer (result);
+
+	attribute = checksum_data->partial ? PARTIAL_CHECKSUM_ATTRIBUTE : CHECKSUM_ATTRIBUTE;
+	if (load_cached_checksum (checksum_data, attribute))
+		return;
+
+	stream = (GInputStream *) g_file_read (checksum_data->file_data->file, cancellable, &error);
+	if (stream != NULL) {
+		buffer = g_malloc (BUFFER_SIZE);
+		if (checksum_data->partial)
+			success = read_partial_checksum (stream, checksum_data, buffer, cancellable, &error);
+		else
+			success = read_checksum (stream, checksum_data, buffer, cancellable, &error);
+
+		g_free (buffer);
+		g_object_unref (stream);
+	}
+	else
+		success = FALSE;
+
+	if (success)
+		save_cached_checksum (checksum_data, attribute);
+	else {
+		g_simple_async_result_set_from_error (result, error);
+		g_error_free (error);
+	}
+}
+
+
+static void
+checksum_ready_cb (GObject      *source_object,
+		   GAsyncResult *result,
+		   gpointer      user_data)
 {
 	GthFindDuplicates *self = user_data;
-	GError            *error = NULL;
+	ChecksumData      *checksum_data;
 
-	self->priv->io_operation = FALSE;
+	self->priv->n_running -= 1;
+	self->priv->io_operation = (self->priv->n_running > 0);
 	if (self->priv->closing) {
-		gtk_widget_destroy (GET_WIDGET ("find_duplicates_dialog"));
+		if (! self->priv->io_operation)
+			gtk_widget_destroy (GET_WIDGET ("find_duplicates_dialog"));
 		return;
 	}
 
-	if (self->priv->file_stream != NULL)
-		g_object_unref (self->priv->file_stream);
-	self->priv->file_stream = (GInputStream *) g_file_read_finish (G_FILE (source), result, &error);
-	if (self->priv->file_stream == NULL) {
-		start_next_checksum (self);
-		return;
+	checksum_data = g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (result));
+	self->priv->n_file += 1;
+	self->priv->bytes_read += checksum_data->bytes_read;
+
+	if (! g_simple_async_result_propagate_error (G_SIMPLE_ASYNC_RESULT (result), NULL)) {
+		if (checksum_data->partial)
+			add_partial_checksum (self, checksum_data->file_data, checksum_data->checksum);
+		else
+			add_checksum (self, checksum_data->file_data, checksum_data->checksum);
 	}
 
+	start_next_checksum (self);
+}
+
+
+static void
+start_checksum (GthFindDuplicates *self,
+		GthFileData       *file_data)
+{
+	GSimpleAsyncResult *result;
+
+	result = g_simple_async_result_new (G_OBJECT (self),
+					    checksum_ready_cb,
+					    self,
+					    start_checksum);
+	g_simple_async_result_set_op_res_gpointer (result,
+						   checksum_data_new (file_data, self->priv->partial_checksum),
+						   (GDestroyNotify) checksum_data_free);
+	g_simple_async_result_run_in_thread (result,
+					     checksum_thread,
+					     G_PRIORITY_DEFAULT,
+					     self->priv->cancellable);
+
+	self->priv->n_running += 1;
 	self->priv->io_operation = TRUE;
-	g_input_stream_read_async (self->priv->file_stream,
-				   self->priv->buffer,
-				   BUFFER_SIZE,
-				   G_PRIORITY_DEFAULT,
-				   self->priv->cancellable,
-				   file_input_stream_read_ready_cb,
-				   self);
+
+	g_object_unref (result);
 }
 
 
@@ -695,54 +1071,351 @@ folder_changed_cb (GthMonitor      *monitor,
 
 
 static void
-start_next_checksum (GthFindDuplicates *self)
+update_checksum_progress (GthFindDuplicates *self)
 {
-	GList *link;
-	char  *text;
-	int    n_remaining;
-
-	link = self->priv->files;
-	if (link == NULL) {
-		self->priv->folder_changed_id = g_signal_connect (gth_main_get_default_monitor (),
-								  "folder-changed",
-								  G_CALLBACK (folder_changed_cb),
-								  self);
-
-		gtk_notebook_set_current_page (GTK_NOTEBOOK (GET_WIDGET ("pages_notebook")), (self->priv->n_duplicates > 0) ? 0 : 1);
-		gtk_label_set_text (GTK_LABEL (GET_WIDGET ("progress_label")), _("Search completed"));
-		gtk_label_set_text (GTK_LABEL (GET_WIDGET ("search_details_label")), "");
-		gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (GET_WIDGET ("search_progressbar")), 1.0);
-		gtk_widget_set_sensitive (GET_WIDGET ("stop_button"), FALSE);
-		duplicates_list_view_selection_changed_cb (NULL, self);
-		return;
-	}
-
-	self->priv->files = g_list_remove_link (self->priv->files, link);
-	_g_object_unref (self->priv->current_file);
-	self->priv->current_file = (GthFileData *) link->data;
-	g_list_free (link);
+	int     n_remaining;
+	char   *remaining_text;
+	gint64  elapsed;
+	char   *text;
 
-	gtk_label_set_text (GTK_LABEL (GET_WIDGET ("progress_label")), _("Searching for duplicates"));
+	gtk_label_set_text (GTK_LABEL (GET_WIDGET ("progress_label")), self->priv->similar_images ? _("Searching for similar images") : _("Searching for duplicates"));
 
 	n_remaining = self->priv->n_files - self->priv->n_file;
-	text = g_strdup_printf (g_dngettext (NULL, "%d file remaining", "%d files remaining", n_remaining), n_remaining);
+	remaining_text = g_strdup_printf (g_dngettext (NULL, "%d file remaining", "%d files remaining", n_remaining), n_remaining);
+	elapsed = g_get_monotonic_time () - self->priv->checksum_start_time;
+	if ((elapsed > 0) && (self->priv->bytes_read > 0)) {
+		char *speed;
+
+		speed = g_format_size ((guint64) ((double) self->priv->bytes_read * G_USEC_PER_SEC / elapsed));
+		/* Translators: the first %s is the number of remaining files, the second %s is a size, for example: "10 files remaining, 20 MB/s" */
+		text = g_strdup_printf (_("%s, %s/s"), remaining_text, speed);
+
+		g_free (speed);
+	}
+	else
+		text = g_strdup (remaining_text);
 	gtk_label_set_text (GTK_LABEL (GET_WIDGET ("search_details_label")), text);
-	g_free (text);
 
 	gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (GET_WIDGET ("search_progressbar")),
 				       (double) (self->priv->n_file + 1) / (self->priv->n_files + 1));
 
-	if (self->priv->checksum == NULL)
-		self->priv->checksum = g_checksum_new (G_CHECKSUM_MD5);
-	else
-		g_checksum_reset (self->priv->checksum);
+	g_free (text);
+	g_free (remaining_text);
+}
+
+
+static void
+search_completed (GthFindDuplicates *self)
+{
+	self->priv->folder_changed_id = g_signal_connect (gth_main_get_default_monitor (),
+							  "folder-changed",
+							  G_CALLBACK (folder_changed_cb),
+							  self);
+
+	gtk_notebook_set_current_page (GTK_NOTEBOOK (GET_WIDGET ("pages_notebook")), (self->priv->n_duplicates > 0) ? 0 : 1);
+	gtk_label_set_text (GTK_LABEL (GET_WIDGET ("progress_label")), _("Search completed"));
+	gtk_label_set_text (GTK_LABEL (GET_WIDGET ("search_details_label")), "");
+	gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (GET_WIDGET ("search_progressbar")), 1.0);
+	gtk_widget_set_sensitive (GET_WIDGET ("stop_button"), FALSE);
+	duplicates_list_view_selection_changed_cb (NULL, self);
+}
+
+
+static void
+start_checksums (GthFindDuplicates *self,
+		 GList             *files,
+		 gboolean           partial)
+{
+	self->priv->files = files;
+	self->priv->n_files = g_list_length (files);
+	self->priv->n_file = 0;
+	self->priv->partial_checksum = partial;
+	self->priv->bytes_read = 0;
+	self->priv->checksum_start_time = g_get_monotonic_time ();
+	start_next_checksum (self);
+}
+
+
+static void
+start_next_checksum (GthFindDuplicates *self)
+{
+	if (g_cancellable_is_cancelled (self->priv->cancellable)) {
+		_g_object_list_unref (self->priv->files);
+		self->priv->files = NULL;
+		self->priv->partial_checksum = FALSE;
+	}
+
+	if ((self->priv->files == NULL) && (self->priv->n_running == 0) && self->priv->partial_checksum) {
+		start_checksums (self, get_files_with_same_partial_checksum (self), FALSE);
+		return;
+	}
+
+	if ((self->priv->files == NULL) && (self->priv->n_running == 0)) {
+		search_completed (self);
+		return;
+	}
+
+	/* keep N_CHECKSUM_THREADS files in progress */
+
+	while ((self->priv->files != NULL) && (self->priv->n_running < N_CHECKSUM_THREADS)) {
+		GList *link;
+
+		link = self->priv->files;
+		self->priv->files = g_list_remove_link (self->priv->files, link);
+		start_checksum (self, (GthFileData *) link->data);
+
+		_g_object_list_unref (link);
+	}
+
+	update_checksum_progress (self);
+}
+
+
+/* -- similar images -- */
+
+
+/* Adds @file_data to the group of the first image with a hash within
+ * MAX_IMAGE_HASH_DISTANCE, or starts a new group. */
+static void
+add_image_hash (GthFindDuplicates *self,
+		GthFileData       *file_data,
+		guint64            hash)
+{
+	char *key;
+
+	key = gth_image_hash_tree_find (self->priv->image_hashes, hash, MAX_IMAGE_HASH_DISTANCE);
+	if (key == NULL) {
+		key = g_strdup_printf ("%016" G_GINT64_MODIFIER "x", hash);
+		gth_image_hash_tree_add (self->priv->image_hashes, hash, key);
+	}
+	add_checksum (self, file_data, key);
+}
+
+
+static void start_next_image_hash (GthFindDuplicates *self);
+
+
+static void
+save_image_hash_thread (GSimpleAsyncResult *result,
+			GObject            *object,
+			GCancellable       *cancellable)
+{
+	GthFileData *file_data;
+	char        *attribute_v[] = { IMAGE_HASH_ATTRIBUTE, NULL };
+
+	file_data = g_simple_async_result_get_op_res_gpointer (result);
+	gth_metadata_cache_save (file_data, IMAGE_HASH_ATTRIBUTE, IMAGE_HASH_ATTRIBUTE, attribute_v);
+}
+
+
+/* the metadata cache can read the cache file of the folder, so it's not
+ * used in the main thread. */
+static void
+save_image_hash (GthFileData *file_data)
+{
+	GSimpleAsyncResult *result;
+
+	result = g_simple_async_result_new (NULL,
+					    NULL,
+					    NULL,
+					    save_image_hash);
+	g_simple_async_result_set_op_res_gpointer (result,
+						   gth_file_data_dup (file_data),
+						   g_object_unref);
+	g_simple_async_result_run_in_thread (result,
+					     save_image_hash_thread,
+					     G_PRIORITY_LOW,
+					     NULL);
+
+	g_object_unref (result);
+}
+
+
+static void
+image_hash_thumbnail_ready_cb (GObject      *source_object,
+			       GAsyncResult *result,
+			       gpointer      user_data)
+{
+	GthFindDuplicates *self = user_data;
+	cairo_surface_t   *image = NULL;
+	guint64            hash;
+
+	self->priv->io_operation = FALSE;
+	if (self->priv->closing) {
+		gtk_widget_destroy (GET_WIDGET ("find_duplicates_dialog"));
+		return;
+	}
+
+	if (gth_thumb_loader_load_finish (GTH_THUMB_LOADER (source_object), result, &image, NULL)
+	    && gth_image_hash_from_surface (image, &hash))
+	{
+		char *value;
+
+		value = g_strdup_printf ("%016" G_GINT64_MODIFIER "x", hash);
+		g_file_info_set_attribute_string (self->priv->current_file->info, IMAGE_HASH_ATTRIBUTE, value);
+		save_image_hash (self->priv->current_file);
+		add_image_hash (self, self->priv->current_file, hash);
+
+		g_free (value);
+	}
+
+	if (image != NULL)
+		cairo_surface_destroy (image);
+
+	self->priv->n_file += 1;
+	start_next_image_hash (self);
+}
+
+
+static gboolean
+image_hash_idle_cb (gpointer user_data)
+{
+	GthFindDuplicates *self = user_data;
+
+	self->priv->image_hash_id = 0;
+	start_next_image_hash (self);
+
+	return FALSE;
+}
+
+
+/* The hash of an image is computed from its thumbnail and saved in the
+ * metadata cache, so the thumbnails are only loaded for new or modified
+ * images.  The cached hashes, loaded before by load_cached_image_hashes,
+ * are added IMAGE_HASH_BATCH_SIZE at a time to keep the dialog
+ * responsive. */
+static void
+start_next_image_hash (GthFindDuplicates *self)
+{
+	int n_cached = 0;
+
+	while (self->priv->files != NULL) {
+		GList       *link;
+		GthFileData *file_data;
+		const char  *value;
+
+		if (g_cancellable_is_cancelled (self->priv->cancellable)) {
+			_g_object_list_unref (self->priv->files);
+			self->priv->files = NULL;
+			break;
+		}
+
+		if (n_cached >= IMAGE_HASH_BATCH_SIZE) {
+			update_checksum_progress (self);
+			self->priv->image_hash_id = g_idle_add (image_hash_idle_cb, self);
+			return;
+		}
+
+		link = self->priv->files;
+		self->priv->files = g_list_remove_link (self->priv->files, link);
+		file_data = link->data;
+		g_list_free (link);
+
+		_g_object_unref (self->priv->current_file);
+		self->priv->current_file = file_data;
+
+		if (! _g_mime_type_is_image (gth_file_data_get_mime_type (file_data))) {
+			self->priv->n_file += 1;
+			continue;
+		}
+
+		value = g_file_info_get_attribute_string (file_data->info, IMAGE_HASH_ATTRIBUTE);
+		if (value != NULL) {
+			add_image_hash (self, file_data, g_ascii_strtoull (value, NULL, 16));
+			self->priv->n_file += 1;
+			n_cached += 1;
+			continue;
+		}
+
+		update_checksum_progress (self);
+
+		self->priv->io_operation = TRUE;
+		gth_thumb_loader_load (self->priv->thumb_loader,
+				       file_data,
+				       self->priv->cancellable,
+				       image_hash_thumbnail_ready_cb,
+				       self);
+		return;
+	}
+
+	search_completed (self);
+}
+
+
+static void
+load_cached_image_hashes_thread (GSimpleAsyncResult *result,
+				 GObject            *object,
+				 GCancellable       *cancellable)
+{
+	GList *files;
+	GList *scan;
+
+	files = g_simple_async_result_get_op_res_gpointer (result);
+	for (scan = files; scan; scan = scan->next) {
+		GthFileData *file_data = scan->data;
+
+		if (g_cancellable_is_cancelled (cancellable))
+			break;
+
+		if (_g_mime_type_is_image (gth_file_data_get_mime_type (file_data)))
+			gth_metadata_cache_load (file_data, IMAGE_HASH_ATTRIBUTE, IMAGE_HASH_ATTRIBUTE, NULL);
+	}
+}
+
+
+static void
+load_cached_image_hashes_ready_cb (GObject      *source_object,
+				   GAsyncResult *result,
+				   gpointer      user_data)
+{
+	GthFindDuplicates *self = user_data;
+
+	self->priv->io_operation = FALSE;
+	if (self->priv->closing) {
+		gtk_widget_destroy (GET_WIDGET ("find_duplicates_dialog"));
+		return;
+	}
+
+	start_next_image_hash (self);
+}
+
+
+/* the files are walked in another thread, start_next_image_hash only reads
+ * the attribute set by the metadata cache. */
+static void
+load_cached_image_hashes (GthFindDuplicates *self)
+{
+	GSimpleAsyncResult *result;
+
+	result = g_simple_async_result_new (G_OBJECT (self),
+					    load_cached_image_hashes_ready_cb,
+					    self,
+					    load_cached_image_hashes);
+	g_simple_async_result_set_op_res_gpointer (result, self->priv->files, NULL);
+	g_simple_async_result_run_in_thread (result,
+					     load_cached_image_hashes_thread,
+					     G_PRIORITY_DEFAULT,
+					     self->priv->cancellable);
 
 	self->priv->io_operation = TRUE;
-	g_file_read_async (self->priv->current_file->file,
-			   G_PRIORITY_DEFAULT,
-			   self->priv->cancellable,
-			   read_current_file_ready_cb,
-			   self);
+
+	g_object_unref (result);
+}
+
+
+static void
+start_image_hashes (GthFindDuplicates *self,
+		    GList             *files)
+{
+	self->priv->thumb_loader = gth_thumb_loader_new (IMAGE_HASH_THUMB_SIZE);
+	self->priv->image_hashes = gth_image_hash_tree_new (g_free);
+	self->priv->files = files;
+	self->priv->n_files = g_list_length (files);
+	self->priv->n_file = 0;
+	self->priv->bytes_read = 0;
+	self->priv->checksum_start_time = g_get_monotonic_time ();
+	update_checksum_progress (self);
+	load_cached_image_hashes (self);
 }
 
 
@@ -768,10 +1441,15 @@ done_func (GObject  *object,
 		return;
 	}
 
-	self->priv->files = g_list_reverse (self->priv->files);
-	self->priv->n_files = g_list_length (self->priv->files);
-	self->priv->n_file = 0;
-	start_next_checksum (self);
+	if (self->priv->similar_images) {
+		start_image_hashes (self, g_list_reverse (self->priv->files));
+		return;
+	}
+
+	/* compute the full checksum only for the files with the same size
+	 * and the same partial checksum */
+
+	start_checksums (self, get_files_with_same_size (g_list_reverse (self->priv->files)), TRUE);
 }
 
 
@@ -1263,7 +1941,8 @@ void
 gth_find_duplicates_exec (GthBrowser *browser,
 		     	  GFile      *location,
 		     	  gboolean    recursive,
-		     	  const char *filter)
+		     	  const char *filter,
+		     	  gboolean    similar_images)
 {
 	GthFindDuplicates *self;
 	GSettings         *settings;
@@ -1279,6 +1958,7 @@ gth_find_duplicates_exec (GthBrowser *browser,
 	self->priv->browser = browser;
 	self->priv->location = g_object_ref (location);
 	self->priv->recursive = recursive;
+	self->priv->similar_images = similar_images;
 	if (filter != NULL)
 		self->priv->test = gth_main_get_registered_object (GTH_TYPE_TEST, filter);
 
@@ -1286,7 +1966,7 @@ gth_find_duplicates_exec (GthBrowser *browser,
 	gth_file_source_set_cancellable (self->priv->file_source, self->priv->cancellable);
 
 	self->priv->attributes = g_string_new (g_settings_get_boolean (settings, PREF_BROWSER_FAST_FILE_TYPE) ? GFILE_STANDARD_ATTRIBUTES_WITH_FAST_CONTENT_TYPE : GFILE_STANDARD_ATTRIBUTES_WITH_CONTENT_TYPE);
-	g_string_append (self->priv->attributes, ",gth::file::display-size");
+	g_string_append (self->priv->attributes, ",gth::file::display-size," INODE_ATTRIBUTE);
 	test_attributes = gth_test_get_attributes (self->priv->test);
 	if (test_attributes[0] != '\0') {
 		g_string_append (self->priv->attributes, ",");
@@ -51,6 +51,7 @@ GType   gth_find_duplicates_get_type (void) G_GNUC_CONST;
 void    gth_find_duplicates_exec            (GthBrowser *browser,
 					     GFile      *location,
 					     gboolean    recursive,
-					     const char *filter);
+					     const char *filter,
+					     gboolean    similar_images);
 
 #endif /* GTH_FIND_DUPLICATES_H */
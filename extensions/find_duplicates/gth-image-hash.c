@@ -0,0 +1,295 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+/*
+ *  GThumb
+ *
+ *  Copyright (C) 2013 Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <config.h>
+#include <gthumb.h>
+#include "gth-image-hash.h"
+
+
+/* The hash is a difference hash: the image is reduced to a grid of
+ * (HASH_COLUMNS + 1) x HASH_ROWS gray values and every bit tells whether a
+ * cell is darker than the cell on its right.  The hash doesn't change when
+ * the image is scaled or recompressed, so similar images have hashes with a
+ * small hamming distance. */
+
+
+#define HASH_COLUMNS 8
+#define HASH_ROWS 8
+
+
+gboolean
+gth_image_hash_from_surface (cairo_surface_t *image,
+			     guint64         *hash)
+{
+	int     width;
+	int     height;
+	int     stride;
+	guchar *pixels;
+	double  gray[HASH_ROWS][HASH_COLUMNS + 1];
+	int     row;
+	int     column;
+
+	if (image == NULL)
+		return FALSE;
+
+	if ((cairo_image_surface_get_format (image) != CAIRO_FORMAT_ARGB32)
+	    && (cairo_image_surface_get_format (image) != CAIRO_FORMAT_RGB24))
+	{
+		return FALSE;
+	}
+
+	width = cairo_image_surface_get_width (image);
+	height = cairo_image_surface_get_height (image);
+	if ((width < HASH_COLUMNS + 1) || (height < HASH_ROWS))
+		return FALSE;
+
+	cairo_surface_flush (image);
+	stride = cairo_image_surface_get_stride (image);
+	pixels = cairo_image_surface_get_data (image);
+
+	/* the gray value of a cell is the average luminance of its pixels */
+
+	for (row = 0; row < HASH_ROWS; row++) {
+		int y1 = row * height / HASH_ROWS;
+		int y2 = (row + 1) * height / HASH_ROWS;
+
+		for (column = 0; column < HASH_COLUMNS + 1; column++) {
+			int    x1 = column * width / (HASH_COLUMNS + 1);
+			int    x2 = (column + 1) * width / (HASH_COLUMNS + 1);
+			double sum;
+			int    x, y;
+
+			sum = 0.0;
+			for (y = y1; y < y2; y++) {
+				guchar *p = pixels + (y * stride) + (x1 * 4);
+
+				for (x = x1; x < x2; x++) {
+					sum += (0.299 * p[CAIRO_RED]) + (0.587 * p[CAIRO_GREEN]) + (0.114 * p[CAIRO_BLUE]);
+					p += 4;
+				}
+			}
+			gray[row][column] = sum / ((x2 - x1) * (y2 - y1));
+		}
+	}
+
+	*hash = 0;
+	for (row = 0; row < HASH_ROWS; row++)
+		for (column = 0; column < HASH_COLUMNS; column++)
+			if (gray[row][column] < gray[row][column + 1])
+				*hash |= G_GUINT64_CONSTANT (1) << (row * HASH_COLUMNS + column);
+
+	return TRUE;
+}
+
+
+/* Returns the number of different bits. */
+int
+gth_image_hash_distance (guint64 hash1,
+			 guint64 hash2)
+{
+	guint64 bits;
+	int     distance;
+
+	bits = hash1 ^ hash2;
+	for (distance = 0; bits != 0; distance++)
+		bits &= bits - 1;
+
+	return distance;
+}
+
+
+/* -- GthImageHashTree -- */
+
+
+/* A BK-tree: the children of a node are indexed by their distance from the
+ * node, because of the triangle inequality only the children with a
+ * distance in [d - max_distance, d + max_distance] can contain a hash within
+ * max_distance, where d is the distance between the node and the hash to
+ * find. */
+
+
+typedef struct _Node Node;
+
+
+struct _Node {
+	guint64    hash;
+	gpointer   data;
+	int        distance; /* from the parent */
+	GPtrArray *children;
+};
+
+
+struct _GthImageHashTree {
+	Node           *root;
+	GDestroyNotify  data_destroy_func;
+};
+
+
+static Node *
+node_new (guint64  hash,
+	  gpointer data,
+	  int      distance)
+{
+	Node *node;
+
+	node = g_new0 (Node, 1);
+	node->hash = hash;
+	node->data = data;
+	node->distance = distance;
+	node->children = NULL;
+
+	return node;
+}
+
+
+static void
+node_free (Node           *node,
+	   GDestroyNotify  data_destroy_func)
+{
+	if (node->children != NULL) {
+		int i;
+
+		for (i = 0; i < node->children->len; i++)
+			node_free (g_ptr_array_index (node->children, i), data_destroy_func);
+		g_ptr_array_free (node->children, TRUE);
+	}
+	if (data_destroy_func != NULL)
+		data_destroy_func (node->data);
+	g_free (node);
+}
+
+
+GthImageHashTree *
+gth_image_hash_tree_new (GDestroyNotify data_destroy_func)
+{
+	GthImageHashTree *tree;
+
+	tree = g_new0 (GthImageHashTree, 1);
+	tree->root = NULL;
+	tree->data_destroy_func = data_destroy_func;
+
+	return tree;
+}
+
+
+void
+gth_image_hash_tree_free (GthImageHashTree *tree)
+{
+	if (tree == NULL)
+		return;
+
+	if (tree->root != NULL)
+		node_free (tree->root, tree->data_destroy_func);
+	g_free (tree);
+}
+
+
+void
+gth_image_hash_tree_add (GthImageHashTree *tree,
+			 guint64           hash,
+			 gpointer          data)
+{
+	Node *node;
+
+	if (tree->root == NULL) {
+		tree->root = node_new (hash, data, 0);
+		return;
+	}
+
+	node = tree->root;
+	while (TRUE) {
+		int   distance;
+		Node *next;
+		int   i;
+
+		distance = gth_image_hash_distance (node->hash, hash);
+
+		next = NULL;
+		if (node->children != NULL) {
+			for (i = 0; i < node->children->len; i++) {
+				Node *child = g_ptr_array_index (node->children, i);
+
+				if (child->distance == distance) {
+					next = child;
+					break;
+				}
+			}
+		}
+
+		if (next == NULL) {
+			if (node->children == NULL)
+				node->children = g_ptr_array_new ();
+			g_ptr_array_add (node->children, node_new (hash, data, distance));
+			return;
+		}
+
+		node = next;
+	}
+}
+
+
+static void
+node_find (Node     *node,
+	   guint64   hash,
+	   Node    **nearest,
+	   int      *nearest_distance)
+{
+	int distance;
+	int i;
+
+	distance = gth_image_hash_distance (node->hash, hash);
+	if (distance < *nearest_distance) {
+		*nearest = node;
+		*nearest_distance = distance;
+	}
+
+	if (node->children == NULL)
+		return;
+
+	for (i = 0; i < node->children->len; i++) {
+		Node *child = g_ptr_array_index (node->children, i);
+
+		if (ABS (child->distance - distance) <= *nearest_distance)
+			node_find (child, hash, nearest, nearest_distance);
+	}
+}
+
+
+/* Returns the data of the nearest hash within @max_distance, or NULL if
+ * there is no such hash. */
+gpointer
+gth_image_hash_tree_find (GthImageHashTree *tree,
+			  guint64           hash,
+			  int               max_distance)
+{
+	Node *nearest;
+	int   nearest_distance;
+
+	if (tree->root == NULL)
+		return NULL;
+
+	nearest = NULL;
+	nearest_distance = max_distance + 1;
+	node_find (tree->root, hash, &nearest, &nearest_distance);
+
+	return (nearest != NULL) ? nearest->data : NULL;
+}
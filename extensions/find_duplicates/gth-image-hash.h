@@ -0,0 +1,48 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+/*
+ *  GThumb
+ *
+ *  Copyright (C) 2013 Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef GTH_IMAGE_HASH_H
+#define GTH_IMAGE_HASH_H
+
+#include <glib.h>
+#include <cairo.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GthImageHashTree GthImageHashTree;
+
+gboolean		gth_image_hash_from_surface	(cairo_surface_t   *image,
+							 guint64           *hash);
+int			gth_image_hash_distance		(guint64            hash1,
+							 guint64            hash2);
+GthImageHashTree *	gth_image_hash_tree_new		(GDestroyNotify     data_destroy_func);
+void			gth_image_hash_tree_free	(GthImageHashTree  *tree);
+void			gth_image_hash_tree_add		(GthImageHashTree  *tree,
+							 guint64            hash,
+							 gpointer           data);
+gpointer		gth_image_hash_tree_find	(GthImageHashTree  *tree,
+							 guint64            hash,
+							 int                max_distance);
+
+G_END_DECLS
+
+#endif /* GTH_IMAGE_HASH_H */
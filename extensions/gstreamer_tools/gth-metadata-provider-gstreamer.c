@@ -51,6 +51,16 @@ gth_metadata_provider_gstreamer_can_read (GthMetadataProvider  *self,
 }
 
 
+static gboolean
+gth_metadata_provider_gstreamer_can_cache (GthMetadataProvider *self,
+					    GthFileData         *file_data)
+{
+	/* the stream information only depends on the file content */
+
+	return TRUE;
+}
+
+
 static void
 gth_metadata_provider_gstreamer_read (GthMetadataProvider *self,
 				      GthFileData         *file_data,
@@ -77,6 +87,7 @@ gth_metadata_provider_gstreamer_class_init (GthMetadataProviderGstreamerClass *k
 
 	metadata_provider_class = GTH_METADATA_PROVIDER_CLASS (klass);
 	metadata_provider_class->can_read = gth_metadata_provider_gstreamer_can_read;
+	metadata_provider_class->can_cache = gth_metadata_provider_gstreamer_can_cache;
 	metadata_provider_class->read = gth_metadata_provider_gstreamer_read;
 }
 
@@ -34,6 +34,8 @@
 
 
 #define BUFFER_SIZE 1024
+#define JPEG_HEADER_INITIAL_SIZE (64 * 1024)
+#define JPEG_HEADER_MAX_SIZE (1024 * 1024)
 
 
 G_DEFINE_TYPE (GthMetadataProviderImage, gth_metadata_provider_image, GTH_TYPE_METADATA_PROVIDER)
@@ -54,6 +56,77 @@ gth_metadata_provider_image_can_read (GthMetadataProvider  *self,
 }
 
 
+#if HAVE_LIBJPEG
+
+
+static gboolean
+_jpeg_get_image_info_from_shared_buffer (GthFileData  *file_data,
+					 int          *width,
+					 int          *height,
+					 GthTransform *orientation,
+					 GCancellable *cancellable)
+{
+	gsize requested_size;
+
+	/* the image size is in the SOF segment, which usually follows the
+	 * metadata segments: expand the buffer until it contains it. */
+
+	requested_size = JPEG_HEADER_INITIAL_SIZE;
+	while (TRUE) {
+		const guchar *buffer;
+		gsize         buffer_size;
+		GInputStream *stream;
+		gboolean      result;
+
+		buffer = gth_metadata_provider_get_file_buffer (file_data, requested_size, &buffer_size, cancellable);
+		if (buffer == NULL)
+			return FALSE;
+
+		stream = g_memory_input_stream_new_from_data (buffer, buffer_size, NULL);
+		result = _jpeg_get_image_info (stream,
+					       width,
+					       height,
+					       orientation,
+					       cancellable,
+					       NULL);
+		g_object_unref (stream);
+
+		if (result || (buffer_size < requested_size) || (requested_size >= JPEG_HEADER_MAX_SIZE))
+			return result;
+
+		requested_size *= 2;
+	}
+}
+
+
+#endif /* HAVE_LIBJPEG */
+
+
+static gboolean
+gth_metadata_provider_image_can_cache (GthMetadataProvider *self,
+				        GthFileData         *file_data)
+{
+	/* the format and the size only depend on the file content */
+
+	return TRUE;
+}
+
+
+static gsize
+gth_metadata_provider_image_get_read_size (GthMetadataProvider *self,
+					   GthFileData         *file_data)
+{
+#if HAVE_LIBJPEG
+	/* the size of a JPEG image is after the metadata segments */
+
+	if (g_content_type_is_a (gth_file_data_get_mime_type (file_data), "image/jpeg"))
+		return JPEG_HEADER_INITIAL_SIZE;
+#endif /* HAVE_LIBJPEG */
+
+	return BUFFER_SIZE;
+}
+
+
 static void
 gth_metadata_provider_image_read (GthMetadataProvider *self,
 				  GthFileData         *file_data,
@@ -62,6 +135,10 @@ gth_metadata_provider_image_read (GthMetadataProvider *self,
 {
 	gboolean          format_recognized;
 	GFileInputStream *stream;
+	const guchar     *buffer;
+	guchar           *own_buffer;
+	gsize             buffer_size;
+	gssize            size;
 	char             *description;
 	int               width;
 	int               height;
@@ -69,19 +146,30 @@ gth_metadata_provider_image_read (GthMetadataProvider *self,
 
 	format_recognized = FALSE;
 
-	stream = g_file_read (file_data->file, cancellable, NULL);
-	if (stream != NULL) {
-		int     buffer_size;
-		guchar *buffer;
-		gssize  size;
-
-		buffer_size = BUFFER_SIZE;
-		buffer = g_new (guchar, buffer_size);
-		size = g_input_stream_read (G_INPUT_STREAM (stream),
-					    buffer,
-					    buffer_size,
-					    cancellable,
-					    NULL);
+	/* use the file content shared with the other metadata providers when
+	 * available, read the header directly otherwise. */
+
+	stream = NULL;
+	own_buffer = NULL;
+	size = -1;
+	buffer = gth_metadata_provider_get_file_buffer (file_data, BUFFER_SIZE, &buffer_size, cancellable);
+	if (buffer != NULL) {
+		size = buffer_size;
+	}
+	else {
+		stream = g_file_read (file_data->file, cancellable, NULL);
+		if (stream != NULL) {
+			own_buffer = g_new (guchar, BUFFER_SIZE);
+			size = g_input_stream_read (G_INPUT_STREAM (stream),
+						    own_buffer,
+						    BUFFER_SIZE,
+						    cancellable,
+						    NULL);
+			buffer = own_buffer;
+		}
+	}
+
+	if (buffer != NULL) {
 		if (size >= 0) {
 			if ((size >= 24)
 
@@ -121,22 +209,36 @@ gth_metadata_provider_image_read (GthMetadataProvider *self,
 				/* JPEG */
 
 				GthTransform orientation;
+				gboolean     info_read;
+
+				/* buffer is not valid after this point, the
+				 * shared buffer can be reallocated. */
 
-				if (g_seekable_can_seek (G_SEEKABLE (stream))) {
-					g_seekable_seek (G_SEEKABLE (stream), 0, G_SEEK_SET, cancellable, NULL);
+				if (stream == NULL) {
+					info_read = _jpeg_get_image_info_from_shared_buffer (file_data,
+											     &width,
+											     &height,
+											     &orientation,
+											     cancellable);
 				}
 				else {
-					g_object_unref (stream);
-					stream = g_file_read (file_data->file, cancellable, NULL);
+					if (g_seekable_can_seek (G_SEEKABLE (stream))) {
+						g_seekable_seek (G_SEEKABLE (stream), 0, G_SEEK_SET, cancellable, NULL);
+					}
+					else {
+						g_object_unref (stream);
+						stream = g_file_read (file_data->file, cancellable, NULL);
+					}
+
+					info_read = (stream != NULL) && _jpeg_get_image_info (G_INPUT_STREAM (stream),
+											      &width,
+											      &height,
+											      &orientation,
+											      cancellable,
+											      NULL);
 				}
 
-				if (_jpeg_get_image_info (G_INPUT_STREAM (stream),
-							  &width,
-							  &height,
-							  &orientation,
-							  cancellable,
-							  NULL))
-				{
+				if (info_read) {
 					description = _("JPEG");
 					mime_type = "image/jpeg";
 					format_recognized = TRUE;
@@ -159,7 +261,7 @@ gth_metadata_provider_image_read (GthMetadataProvider *self,
 				WebPDecoderConfig config;
 
 				if (WebPInitDecoderConfig (&config)) {
-					if (WebPGetFeatures (buffer, buffer_size, &config.input) == VP8_STATUS_OK) {
+					if (WebPGetFeatures (buffer, size, &config.input) == VP8_STATUS_OK) {
 						width = config.input.width;
 						height = config.input.height;
 						description = _("WebP");
@@ -179,7 +281,7 @@ gth_metadata_provider_image_read (GthMetadataProvider *self,
 				GInputStream      *mem_stream;
 				GDataInputStream  *data_stream;
 
-				mem_stream = g_memory_input_stream_new_from_data (buffer, BUFFER_SIZE, NULL);
+				mem_stream = g_memory_input_stream_new_from_data (buffer, size, NULL);
 				data_stream = g_data_input_stream_new (mem_stream);
 				g_data_input_stream_set_byte_order (data_stream, G_DATA_STREAM_BYTE_ORDER_BIG_ENDIAN);
 
@@ -206,8 +308,8 @@ gth_metadata_provider_image_read (GthMetadataProvider *self,
 			}
 		}
 
-		g_free (buffer);
-		g_object_unref (stream);
+		g_free (own_buffer);
+		_g_object_unref (stream);
 	}
 
 	if (! format_recognized) { /* use gdk_pixbuf_get_file_info */
@@ -255,6 +357,8 @@ gth_metadata_provider_image_class_init (GthMetadataProviderImageClass *klass)
 
 	metadata_provider_class = GTH_METADATA_PROVIDER_CLASS (klass);
 	metadata_provider_class->can_read = gth_metadata_provider_image_can_read;
+	metadata_provider_class->can_cache = gth_metadata_provider_image_can_cache;
+	metadata_provider_class->get_read_size = gth_metadata_provider_image_get_read_size;
 	metadata_provider_class->read = gth_metadata_provider_image_read;
 }
 
@@ -60,6 +60,16 @@ supported_mime_type (GthFileData *file_data)
 }
 
 
+static gboolean
+gth_metadata_provider_raw_can_cache (GthMetadataProvider *self,
+				      GthFileData         *file_data)
+{
+	/* decoding a raw file is slow, cache the result */
+
+	return TRUE;
+}
+
+
 static void
 gth_metadata_provider_raw_read (GthMetadataProvider *self,
 				GthFileData         *file_data,
@@ -129,6 +139,7 @@ gth_metadata_provider_raw_class_init (GthMetadataProviderRawClass *klass)
 
 	metadata_provider_class = GTH_METADATA_PROVIDER_CLASS (klass);
 	metadata_provider_class->can_read = gth_metadata_provider_raw_can_read;
+	metadata_provider_class->can_cache = gth_metadata_provider_raw_can_cache;
 	metadata_provider_class->read = gth_metadata_provider_raw_read;
 }
 
@@ -29,6 +29,7 @@
 #include "callbacks.h"
 #include "gth-search.h"
 #include "gth-search-editor.h"
+#include "gth-search-index.h"
 #include "gth-search-task.h"
 
 
@@ -347,3 +348,10 @@ search__gth_organize_task_create_catalog (GthGroupPolicyData *data)
 		break;
 	}
 }
+
+
+void
+search__gth_browser_close_last_window_cb (GthBrowser *browser)
+{
+	gth_search_index_release ();
+}
@@ -40,5 +40,6 @@ void         search__dlg_catalog_properties_saved        (GthBrowser         *br
 							  GthFileData        *file_data,
 							  GthCatalog         *catalog);
 void         search__gth_organize_task_create_catalog    (GthGroupPolicyData *data);
+void         search__gth_browser_close_last_window_cb    (GthBrowser         *browser);
 
 #endif /* CALLBACKS_H */
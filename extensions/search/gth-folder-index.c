@@ -0,0 +1,526 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+/*
+ *  GThumb
+ *
+ *  Copyright (C) 2013 Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <config.h>
+#include <string.h>
+#include "glib-utils.h"
+#include "gth-folder-index.h"
+
+
+/* The index of the folders below a root folder, saved as a GVariant with
+ * the following format:
+ *
+ *   version, root uri, file attributes,
+ *   dictionary of folder → (modification time, folder id, sub-folders,
+ *                           dictionary of file name → file attributes)
+ *
+ * the folders are uris relative to the root uri, the root folder itself is
+ * the empty string; the sub-folders and the file names are escaped as in
+ * the uris.  The modification time is in microseconds, 0 if the folder
+ * must be read again.  The folder id is the id::file attribute, used to
+ * index a folder only once when it can be reached following a link. */
+
+
+#define INDEX_VERSION 2
+#define INDEX_FORMAT "(ussa{s(xsasa{sa{sv}})})"
+#define FOLDER_FORMAT "(xsasa{sa{sv}})"
+
+
+static GthFolderIndexEntry *
+folder_index_entry_new (gint64      mtime,
+			const char *id,
+			char      **subfolders,
+			GVariant   *files)
+{
+	GthFolderIndexEntry *entry;
+
+	entry = g_new0 (GthFolderIndexEntry, 1);
+	entry->mtime = mtime;
+	entry->id = ((id != NULL) && (id[0] != '\0')) ? g_strdup (id) : NULL;
+	entry->subfolders = (subfolders != NULL) ? subfolders : g_new0 (char *, 1);
+	entry->files = (files != NULL) ? files : g_variant_ref_sink (g_variant_new_array (G_VARIANT_TYPE ("{sa{sv}}"), NULL, 0));
+
+	return entry;
+}
+
+
+static void
+folder_index_entry_free (GthFolderIndexEntry *entry)
+{
+	g_variant_unref (entry->files);
+	g_strfreev (entry->subfolders);
+	g_free (entry->id);
+	g_free (entry);
+}
+
+
+GthFolderIndex *
+gth_folder_index_new (GFile      *root,
+		      const char *attributes)
+{
+	GthFolderIndex *index;
+
+	index = g_new0 (GthFolderIndex, 1);
+	index->ref = 1;
+	index->root = g_object_ref (root);
+	index->uri = g_file_get_uri (root);
+	if (g_str_has_suffix (index->uri, "/"))
+		index->uri_prefix = g_strdup (index->uri);
+	else
+		index->uri_prefix = g_strconcat (index->uri, "/", NULL);
+	index->attributes = g_strdup (attributes);
+	index->folders = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) folder_index_entry_free);
+	index->ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+	return index;
+}
+
+
+/* Returns the index saved in @data, or NULL if it was saved with another
+ * version, for another root or with different attributes. */
+GthFolderIndex *
+gth_folder_index_new_from_variant (GFile      *root,
+				   const char *attributes,
+				   GVariant   *data)
+{
+	guint32         version;
+	const char     *index_uri;
+	const char     *index_attributes;
+	GVariantIter   *folders;
+	char           *uri;
+	GthFolderIndex *index;
+
+	if (! g_variant_is_of_type (data, G_VARIANT_TYPE (INDEX_FORMAT)))
+		return NULL;
+
+	g_variant_get (data, "(u&s&sa{s" FOLDER_FORMAT "})", &version, &index_uri, &index_attributes, &folders);
+
+	index = NULL;
+	uri = g_file_get_uri (root);
+	if ((version == INDEX_VERSION)
+	    && (g_strcmp0 (index_uri, uri) == 0)
+	    && (g_strcmp0 (index_attributes, attributes) == 0))
+	{
+		const char *folder_path;
+		GVariant   *folder;
+
+		index = gth_folder_index_new (root, attributes);
+		while (g_variant_iter_loop (folders, "{&s@" FOLDER_FORMAT "}", &folder_path, &folder)) {
+			gint64                mtime;
+			const char           *id;
+			char                **subfolders;
+			GVariant             *files;
+			GthFolderIndexEntry  *entry;
+
+			g_variant_get (folder, "(x&s^as@" GTH_FOLDER_INDEX_FILES_FORMAT ")", &mtime, &id, &subfolders, &files);
+			entry = folder_index_entry_new (mtime, id, subfolders, files);
+			g_hash_table_insert (index->folders, g_strdup (folder_path), entry);
+			if (entry->id != NULL)
+				g_hash_table_insert (index->ids, g_strdup (entry->id), g_strdup (folder_path));
+		}
+	}
+
+	g_free (uri);
+	g_variant_iter_free (folders);
+
+	return index;
+}
+
+
+/* Returns a new reference to the serialized index. */
+GVariant *
+gth_folder_index_to_variant (GthFolderIndex *index)
+{
+	GVariantBuilder      folders;
+	GHashTableIter       iter;
+	const char          *path;
+	GthFolderIndexEntry *entry;
+
+	g_variant_builder_init (&folders, G_VARIANT_TYPE ("a{s" FOLDER_FORMAT "}"));
+	g_hash_table_iter_init (&iter, index->folders);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &path, (gpointer *) &entry))
+		g_variant_builder_add (&folders,
+				       "{s(xs^as@" GTH_FOLDER_INDEX_FILES_FORMAT ")}",
+				       path,
+				       entry->mtime,
+				       (entry->id != NULL) ? entry->id : "",
+				       entry->subfolders,
+				       entry->files);
+
+	return g_variant_ref_sink (g_variant_new (INDEX_FORMAT, INDEX_VERSION, index->uri, index->attributes, &folders));
+}
+
+
+GthFolderIndex *
+gth_folder_index_ref (GthFolderIndex *index)
+{
+	index->ref++;
+	return index;
+}
+
+
+void
+gth_folder_index_unref (GthFolderIndex *index)
+{
+	if (--index->ref > 0)
+		return;
+
+	g_hash_table_unref (index->ids);
+	g_hash_table_unref (index->folders);
+	g_free (index->attributes);
+	g_free (index->uri_prefix);
+	g_free (index->uri);
+	g_object_unref (index->root);
+	g_free (index);
+}
+
+
+/* Returns the uri of @file relative to the root of @index, or NULL if
+ * @file is not inside the root. */
+char *
+gth_folder_index_get_relative_uri (GthFolderIndex *index,
+				   GFile          *file)
+{
+	char *uri;
+	char *relative_uri;
+
+	uri = g_file_get_uri (file);
+	if (strcmp (uri, index->uri) == 0)
+		relative_uri = g_strdup ("");
+	else if (g_str_has_prefix (uri, index->uri_prefix))
+		relative_uri = g_strdup (uri + strlen (index->uri_prefix));
+	else
+		relative_uri = NULL;
+
+	g_free (uri);
+
+	return relative_uri;
+}
+
+
+char *
+gth_folder_index_get_folder_uri (GthFolderIndex *index,
+				 const char     *path)
+{
+	if (path[0] == '\0')
+		return g_strdup (index->uri);
+	else
+		return g_strconcat (index->uri_prefix, path, NULL);
+}
+
+
+/* Returns the uri of the folder @path with a trailing slash. */
+char *
+gth_folder_index_get_folder_uri_prefix (GthFolderIndex *index,
+					const char     *path)
+{
+	if (path[0] == '\0')
+		return g_strdup (index->uri_prefix);
+	else
+		return g_strconcat (index->uri_prefix, path, "/", NULL);
+}
+
+
+GthFolderIndexEntry *
+gth_folder_index_lookup (GthFolderIndex *index,
+			 const char     *path)
+{
+	return g_hash_table_lookup (index->folders, path);
+}
+
+
+static char *
+_gth_folder_index_get_child_path (const char *path,
+				  const char *name)
+{
+	if (path[0] == '\0')
+		return g_strdup (name);
+	else
+		return g_strconcat (path, "/", name, NULL);
+}
+
+
+static gboolean
+_gth_folder_index_path_in_scope (const char *path,
+				 const char *scope,
+				 gboolean    recursive)
+{
+	gsize len;
+
+	if (strcmp (path, scope) == 0)
+		return TRUE;
+	if (! recursive)
+		return FALSE;
+	if (scope[0] == '\0')
+		return TRUE;
+
+	len = strlen (scope);
+	return (strncmp (path, scope, len) == 0) && (path[len] == '/');
+}
+
+
+/* Returns the sorted list of the indexed folders inside @scope, as relative
+ * uris. */
+GList *
+gth_folder_index_get_folders (GthFolderIndex *index,
+			      const char     *scope,
+			      gboolean        recursive)
+{
+	GList          *list;
+	GHashTableIter  iter;
+	const char     *path;
+
+	list = NULL;
+	g_hash_table_iter_init (&iter, index->folders);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &path, NULL))
+		if (_gth_folder_index_path_in_scope (path, scope, recursive))
+			list = g_list_prepend (list, g_strdup (path));
+
+	return g_list_sort (list, (GCompareFunc) strcmp);
+}
+
+
+/* Adds the folder @path to the folders to read, if not already present. */
+void
+gth_folder_index_add_folder (GthFolderIndex *index,
+			     const char     *path,
+			     const char     *id)
+{
+	GthFolderIndexEntry *entry;
+
+	if (g_hash_table_lookup (index->folders, path) != NULL)
+		return;
+
+	entry = folder_index_entry_new (0, id, NULL, NULL);
+	g_hash_table_insert (index->folders, g_strdup (path), entry);
+	if (entry->id != NULL)
+		g_hash_table_insert (index->ids, g_strdup (entry->id), g_strdup (path));
+}
+
+
+/* Removes @path and its sub-folders. */
+void
+gth_folder_index_remove_folder (GthFolderIndex *index,
+				const char     *path)
+{
+	GthFolderIndexEntry *entry;
+	int                  i;
+
+	entry = g_hash_table_lookup (index->folders, path);
+	if (entry == NULL)
+		return;
+
+	for (i = 0; entry->subfolders[i] != NULL; i++) {
+		char *child_path;
+
+		child_path = _gth_folder_index_get_child_path (path, entry->subfolders[i]);
+		gth_folder_index_remove_folder (index, child_path);
+
+		g_free (child_path);
+	}
+
+	if ((entry->id != NULL) && (g_strcmp0 (g_hash_table_lookup (index->ids, entry->id), path) == 0))
+		g_hash_table_remove (index->ids, entry->id);
+	g_hash_table_remove (index->folders, path);
+}
+
+
+/* Marks @folder as to be read again, returns whether the index changed. */
+gboolean
+gth_folder_index_invalidate_folder (GthFolderIndex *index,
+				    GFile          *folder)
+{
+	char                *path;
+	GthFolderIndexEntry *entry;
+	gboolean             changed;
+
+	path = gth_folder_index_get_relative_uri (index, folder);
+	entry = (path != NULL) ? g_hash_table_lookup (index->folders, path) : NULL;
+	changed = (entry != NULL) && (entry->mtime != 0);
+	if (changed)
+		entry->mtime = 0;
+
+	g_free (path);
+
+	return changed;
+}
+
+
+/* Returns whether the folder with id @id can be indexed as @path: a folder
+ * is indexed only once, this avoids loops when following the links. */
+gboolean
+gth_folder_index_can_add_folder (GthFolderIndex *index,
+				 const char     *path,
+				 const char     *id)
+{
+	const char *indexed_path;
+
+	if ((id == NULL) || (id[0] == '\0'))
+		return TRUE;
+
+	indexed_path = g_hash_table_lookup (index->ids, id);
+	return (indexed_path == NULL) || (strcmp (indexed_path, path) == 0);
+}
+
+
+/* Sets the content of the folder @path, the sub-folders that don't exist
+ * anymore are removed, the new ones are added and returned as a list of
+ * relative uris.  @subfolder_ids contains the id of each sub-folder, an
+ * empty string if not known. */
+GList *
+gth_folder_index_set_folder (GthFolderIndex  *index,
+			     const char      *path,
+			     gint64           mtime,
+			     const char      *id,
+			     char           **subfolders,
+			     char           **subfolder_ids,
+			     GVariant        *files)
+{
+	GthFolderIndexEntry *entry;
+	GList               *new_folders;
+	int                  i;
+
+	entry = g_hash_table_lookup (index->folders, path);
+	if (entry == NULL)
+		return NULL;
+
+	for (i = 0; entry->subfolders[i] != NULL; i++) {
+		if (_g_strv_find (subfolders, entry->subfolders[i]) < 0) {
+			char *child_path;
+
+			child_path = _gth_folder_index_get_child_path (path, entry->subfolders[i]);
+			gth_folder_index_remove_folder (index, child_path);
+
+			g_free (child_path);
+		}
+	}
+
+	new_folders = NULL;
+	for (i = 0; subfolders[i] != NULL; i++) {
+		char *child_path;
+
+		child_path = _gth_folder_index_get_child_path (path, subfolders[i]);
+		if (g_hash_table_lookup (index->folders, child_path) == NULL) {
+			gth_folder_index_add_folder (index, child_path, (subfolder_ids != NULL) ? subfolder_ids[i] : NULL);
+			new_folders = g_list_prepend (new_folders, g_strdup (child_path));
+		}
+
+		g_free (child_path);
+	}
+
+	g_strfreev (entry->subfolders);
+	entry->subfolders = g_strdupv (subfolders);
+	g_variant_unref (entry->files);
+	entry->files = g_variant_ref_sink (files);
+	entry->mtime = mtime;
+	if ((id != NULL) && (id[0] != '\0') && (g_strcmp0 (entry->id, id) != 0)) {
+		if ((entry->id != NULL) && (g_strcmp0 (g_hash_table_lookup (index->ids, entry->id), path) == 0))
+			g_hash_table_remove (index->ids, entry->id);
+		g_free (entry->id);
+		entry->id = g_strdup (id);
+		g_hash_table_insert (index->ids, g_strdup (entry->id), g_strdup (path));
+	}
+
+	return g_list_reverse (new_folders);
+}
+
+
+static gboolean
+_gth_folder_index_file_changed (GVariant  *attributes,
+				GFileInfo *info)
+{
+	guint64 size;
+	guint64 mtime;
+	guint32 mtime_usec;
+
+	if (! g_variant_lookup (attributes, G_FILE_ATTRIBUTE_STANDARD_SIZE, "t", &size)
+	    || ! g_variant_lookup (attributes, G_FILE_ATTRIBUTE_TIME_MODIFIED, "t", &mtime))
+	{
+		return TRUE;
+	}
+	if (! g_variant_lookup (attributes, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC, "u", &mtime_usec))
+		mtime_usec = 0;
+
+	return (size != g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE))
+		|| (mtime != g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED))
+		|| (mtime_usec != g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC));
+}
+
+
+/* Returns whether the indexed @files of @folder are different from the
+ * current ones: @file_info_list is the listing of @folder with the size and
+ * the modification time of the files.  A file edited in place doesn't
+ * change the modification time of the folder, so it must be checked
+ * here. */
+gboolean
+gth_folder_index_files_changed (GVariant *files,
+				GFile    *folder,
+				GList    *file_info_list)
+{
+	GHashTable   *indexed_files;
+	GVariantIter  iter;
+	const char   *name;
+	GVariant     *attributes;
+	GList        *scan;
+	guint         n_files;
+	gboolean      changed;
+
+	indexed_files = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) g_variant_unref);
+	g_variant_iter_init (&iter, files);
+	while (g_variant_iter_next (&iter, "{&s@a{sv}}", &name, &attributes))
+		g_hash_table_insert (indexed_files, (gpointer) name, attributes);
+
+	changed = FALSE;
+	n_files = 0;
+	for (scan = file_info_list; ! changed && scan; scan = scan->next) {
+		GFileInfo *info = scan->data;
+		GFile     *file;
+		char      *uri;
+		char      *file_name;
+
+		if ((g_file_info_get_file_type (info) != G_FILE_TYPE_REGULAR) || g_file_info_get_is_hidden (info))
+			continue;
+
+		n_files++;
+
+		/* the file names are escaped as in the uris */
+
+		file = g_file_get_child (folder, g_file_info_get_name (info));
+		uri = g_file_get_uri (file);
+		file_name = strrchr (uri, '/');
+		if (file_name != NULL) {
+			attributes = g_hash_table_lookup (indexed_files, file_name + 1);
+			changed = (attributes == NULL) || _gth_folder_index_file_changed (attributes, info);
+		}
+
+		g_free (uri);
+		g_object_unref (file);
+	}
+
+	if (! changed)
+		changed = (n_files != g_hash_table_size (indexed_files));
+
+	g_hash_table_destroy (indexed_files);
+
+	return changed;
+}
@@ -0,0 +1,95 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+/*
+ *  GThumb
+ *
+ *  Copyright (C) 2013 Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef GTH_FOLDER_INDEX_H
+#define GTH_FOLDER_INDEX_H
+
+#include <glib.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define GTH_FOLDER_INDEX_FILES_FORMAT "a{sa{sv}}"
+
+typedef struct {
+	gint64     mtime;       /* 0 if the folder must be read again */
+	char      *id;          /* the id::file attribute of the folder */
+	char     **subfolders;
+	GVariant  *files;       /* GTH_FOLDER_INDEX_FILES_FORMAT */
+} GthFolderIndexEntry;
+
+typedef struct {
+	GFile      *root;
+	char       *uri;
+	char       *uri_prefix;
+	char       *attributes;
+	GHashTable *folders;    /* relative uri → GthFolderIndexEntry */
+	GHashTable *ids;        /* folder id → relative uri */
+
+	/*< private >*/
+
+	int         ref;
+} GthFolderIndex;
+
+GthFolderIndex *	gth_folder_index_new			(GFile           *root,
+								 const char      *attributes);
+GthFolderIndex *	gth_folder_index_new_from_variant	(GFile           *root,
+								 const char      *attributes,
+								 GVariant        *data);
+GVariant *		gth_folder_index_to_variant		(GthFolderIndex  *index);
+GthFolderIndex *	gth_folder_index_ref			(GthFolderIndex  *index);
+void			gth_folder_index_unref			(GthFolderIndex  *index);
+char *			gth_folder_index_get_relative_uri	(GthFolderIndex  *index,
+								 GFile           *file);
+char *			gth_folder_index_get_folder_uri		(GthFolderIndex  *index,
+								 const char      *path);
+char *			gth_folder_index_get_folder_uri_prefix	(GthFolderIndex  *index,
+								 const char      *path);
+GthFolderIndexEntry *	gth_folder_index_lookup			(GthFolderIndex  *index,
+								 const char      *path);
+GList *			gth_folder_index_get_folders		(GthFolderIndex  *index,
+								 const char      *scope,
+								 gboolean         recursive);
+void			gth_folder_index_add_folder		(GthFolderIndex  *index,
+								 const char      *path,
+								 const char      *id);
+void			gth_folder_index_remove_folder		(GthFolderIndex  *index,
+								 const char      *path);
+gboolean		gth_folder_index_invalidate_folder	(GthFolderIndex  *index,
+								 GFile           *folder);
+gboolean		gth_folder_index_can_add_folder		(GthFolderIndex  *index,
+								 const char      *path,
+								 const char      *id);
+GList *			gth_folder_index_set_folder		(GthFolderIndex  *index,
+								 const char      *path,
+								 gint64           mtime,
+								 const char      *id,
+								 char           **subfolders,
+								 char           **subfolder_ids,
+								 GVariant        *files);
+gboolean		gth_folder_index_files_changed		(GVariant        *files,
+								 GFile           *folder,
+								 GList           *file_info_list);
+
+G_END_DECLS
+
+#endif /* GTH_FOLDER_INDEX_H */
@@ -0,0 +1,1097 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+/*
+ *  GThumb
+ *
+ *  Copyright (C) 2013 Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <config.h>
+#include <string.h>
+#include <gthumb.h>
+#include "gth-folder-index.h"
+#include "gth-search-index.h"
+
+
+/* The files found below a folder are collected in an index saved in the
+ * cache folder, so that the searches that only test the indexed attributes
+ * can be done without reading the folders again, see gth-folder-index.c for
+ * the format.  A folder is read again when its modification time changes,
+ * when the size or the modification time of one of its files changes, or
+ * when the monitor reports a change of one of its files.  The hidden files
+ * and the hidden folders are not indexed, the links to folders are followed
+ * indexing each folder only once.  The index files are managed by
+ * gth-user-cache.c. */
+
+
+#define INDEXED_FILE_ATTRIBUTES "standard::type,standard::is-hidden,standard::is-symlink,standard::name,standard::display-name,standard::size,time::created,time::created-usec,time::modified,time::modified-usec"
+#define INDEXED_METADATA_ATTRIBUTES "general::*,comment::*,Embedded::Photo::DateTimeOriginal,Exif::Image::Model,frame::width,frame::height,gth::file::size"
+#define CHECK_FILE_ATTRIBUTES "standard::type,standard::is-hidden,standard::name,standard::size,time::modified,time::modified-usec"
+#define CACHE_NAME "search"
+#define MAX_INDEXES_IN_MEMORY 2
+#define REFRESH_INTERVAL (5 * 60 * G_USEC_PER_SEC)
+
+
+static GthUserCache *indexes = NULL; /* root uri → GthFolderIndex */
+static GHashTable   *changed_folders = NULL; /* folder uri set */
+static GHashTable   *checked_folders = NULL; /* folder uri → last check time */
+static gulong        folder_changed_id = 0;
+static gulong        file_renamed_id = 0;
+static gulong        metadata_changed_id = 0;
+static GCancellable *refresh_cancellable = NULL; /* set while refreshing */
+
+
+static char *
+_gth_search_index_get_attributes (void)
+{
+	GSettings *settings;
+	char      *attributes;
+
+	settings = g_settings_new (GTHUMB_BROWSER_SCHEMA);
+	attributes = g_strconcat (INDEXED_FILE_ATTRIBUTES,
+				  g_settings_get_boolean (settings, PREF_BROWSER_FAST_FILE_TYPE) ? ",standard::fast-content-type" : ",standard::fast-content-type,standard::content-type",
+				  ",",
+				  INDEXED_METADATA_ATTRIBUTES,
+				  NULL);
+
+	g_object_unref (settings);
+
+	return attributes;
+}
+
+
+/* Reads the saved index of @root, returns NULL if it doesn't exist or if it
+ * was created with different attributes.  The folders changed while the
+ * index was not in memory are marked as to be read again, in this case
+ * @changed is set to TRUE. */
+static GthFolderIndex *
+_gth_search_index_load (GFile      *root,
+			const char *uri,
+			const char *attributes,
+			gboolean   *changed)
+{
+	GMappedFile    *mapped_file;
+	GVariant       *data;
+	GthFolderIndex *index;
+
+	*changed = FALSE;
+
+	mapped_file = gth_user_cache_map_file (CACHE_NAME, uri);
+	if (mapped_file == NULL)
+		return NULL;
+
+	data = g_variant_new_from_data (G_VARIANT_TYPE_VARIANT,
+					g_mapped_file_get_contents (mapped_file),
+					g_mapped_file_get_length (mapped_file),
+					FALSE,
+					(GDestroyNotify) g_mapped_file_unref,
+					mapped_file);
+	g_variant_ref_sink (data);
+	index = gth_folder_index_new_from_variant (root, attributes, data);
+	g_variant_unref (data);
+
+	if (index != NULL) {
+		GHashTableIter  iter;
+		const char     *folder_uri;
+
+		g_hash_table_iter_init (&iter, changed_folders);
+		while (g_hash_table_iter_next (&iter, (gpointer *) &folder_uri, NULL)) {
+			GFile *folder;
+
+			folder = g_file_new_for_uri (folder_uri);
+			if (gth_folder_index_invalidate_folder (index, folder))
+				*changed = TRUE;
+
+			g_object_unref (folder);
+		}
+	}
+
+	return index;
+}
+
+
+static void
+_gth_search_index_serialize (GthFolderIndex  *index,
+			     void           **buffer,
+			     gsize           *size)
+{
+	GVariant *data;
+	GVariant *variant;
+
+	/* saved as a variant so that the type is checked when loading */
+
+	data = gth_folder_index_to_variant (index);
+	variant = g_variant_ref_sink (g_variant_new_variant (data));
+
+	*size = g_variant_get_size (variant);
+	*buffer = g_malloc (*size);
+	g_variant_store (variant, *buffer);
+
+	g_variant_unref (variant);
+	g_variant_unref (data);
+}
+
+
+static void
+_gth_search_index_queue_save (GthFolderIndex *index)
+{
+	/* the index can be unloaded while searching */
+
+	if ((indexes != NULL) && (gth_user_cache_lookup (indexes, index->uri) == index))
+		gth_user_cache_queue_save (indexes, index->uri);
+}
+
+
+/* Returns the index whose root is @root, loading it from the disk if
+ * needed, or NULL if it doesn't exist. */
+static GthFolderIndex *
+_gth_search_index_get (GFile      *root,
+		       const char *attributes)
+{
+	char           *uri;
+	GthFolderIndex *index;
+
+	uri = g_file_get_uri (root);
+	index = gth_user_cache_lookup (indexes, uri);
+	if ((index != NULL) && (strcmp (index->attributes, attributes) != 0)) {
+		gth_user_cache_remove (indexes, uri);
+		index = NULL;
+	}
+
+	if (index == NULL) {
+		gboolean changed;
+
+		index = _gth_search_index_load (root, uri, attributes, &changed);
+		if (index != NULL) {
+			gth_user_cache_add (indexes, uri, index);
+			if (changed)
+				gth_user_cache_queue_save (indexes, uri);
+		}
+	}
+
+	g_free (uri);
+
+	return index;
+}
+
+
+/* -- monitor -- */
+
+
+static void
+invalidate_folder_cb (const char *uri,
+		      gpointer    data,
+		      gpointer    user_data)
+{
+	GthFolderIndex *index = data;
+	GFile          *folder = user_data;
+
+	if (gth_folder_index_invalidate_folder (index, folder))
+		gth_user_cache_queue_save (indexes, uri);
+}
+
+
+/* Marks @folder as to be read again in every index that contains it.  Only
+ * the indexes in memory are updated, the other ones are updated when loaded,
+ * see _gth_search_index_load. */
+static void
+_gth_search_index_folder_changed (GFile *folder)
+{
+	if (folder == NULL)
+		return;
+
+	g_hash_table_add (changed_folders, g_file_get_uri (folder));
+	gth_user_cache_foreach (indexes, invalidate_folder_cb, folder);
+}
+
+
+static void
+_gth_search_index_file_changed (GFile *file)
+{
+	GFile *folder;
+
+	folder = g_file_get_parent (file);
+	_gth_search_index_folder_changed (folder);
+
+	_g_object_unref (folder);
+}
+
+
+static void
+monitor_folder_changed_cb (GthMonitor      *monitor,
+			   GFile           *parent,
+			   GList           *list,
+			   int              position,
+			   GthMonitorEvent  event,
+			   gpointer         user_data)
+{
+	_gth_search_index_folder_changed (parent);
+}
+
+
+static void
+monitor_file_renamed_cb (GthMonitor *monitor,
+			 GFile      *file,
+			 GFile      *new_file,
+			 gpointer    user_data)
+{
+	_gth_search_index_file_changed (file);
+	_gth_search_index_file_changed (new_file);
+}
+
+
+static void
+monitor_metadata_changed_cb (GthMonitor  *monitor,
+			     GthFileData *file_data,
+			     gpointer     user_data)
+{
+	_gth_search_index_file_changed (file_data->file);
+}
+
+
+/**/
+
+
+void
+gth_search_index_initialize (void)
+{
+	GthMonitor *monitor;
+
+	if (indexes != NULL)
+		return;
+
+	indexes = gth_user_cache_new (CACHE_NAME,
+				      MAX_INDEXES_IN_MEMORY,
+				      (GthUserCacheSerializeFunc) _gth_search_index_serialize,
+				      (GDestroyNotify) gth_folder_index_unref,
+				      NULL);
+	changed_folders = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	checked_folders = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+	monitor = gth_main_get_default_monitor ();
+	folder_changed_id = g_signal_connect (monitor, "folder-changed", G_CALLBACK (monitor_folder_changed_cb), NULL);
+	file_renamed_id = g_signal_connect (monitor, "file-renamed", G_CALLBACK (monitor_file_renamed_cb), NULL);
+	metadata_changed_id = g_signal_connect (monitor, "metadata-changed", G_CALLBACK (monitor_metadata_changed_cb), NULL);
+}
+
+
+void
+gth_search_index_release (void)
+{
+	GthMonitor *monitor;
+
+	if (indexes == NULL)
+		return;
+
+	monitor = gth_main_get_default_monitor ();
+	g_signal_handler_disconnect (monitor, folder_changed_id);
+	g_signal_handler_disconnect (monitor, file_renamed_id);
+	g_signal_handler_disconnect (monitor, metadata_changed_id);
+
+	if (refresh_cancellable != NULL) {
+		g_cancellable_cancel (refresh_cancellable);
+		refresh_cancellable = NULL;
+	}
+
+	gth_user_cache_free (indexes);
+	indexes = NULL;
+	g_hash_table_unref (changed_folders);
+	changed_folders = NULL;
+	g_hash_table_unref (checked_folders);
+	checked_folders = NULL;
+}
+
+
+/* Returns whether the attributes used by @test are all indexed. */
+gboolean
+gth_search_index_can_search (GthTest *test)
+{
+	char     *attributes;
+	gboolean  can_search;
+
+	if (indexes == NULL)
+		return FALSE;
+
+	attributes = _gth_search_index_get_attributes ();
+	can_search = _g_file_attributes_matches_all (gth_test_get_attributes (test), attributes);
+
+	g_free (attributes);
+
+	return can_search;
+}
+
+
+/* -- gth_search_index_search -- */
+
+
+typedef struct {
+	char     *path;
+	char     *uri;
+	gint64    mtime;
+	GVariant *files;
+	gboolean  changed;
+} CheckFolder;
+
+
+typedef struct {
+	GthFolderIndex *index;
+	GList          *check_folders;  /* CheckFolder list */
+	GCancellable   *cancellable;
+} RefreshData;
+
+
+typedef struct {
+	char     *path;
+	char     *uri_prefix;
+	GVariant *files;
+} MatchFolder;
+
+
+typedef struct {
+	GthFolderIndex             *index;
+	char                       *scope;
+	gboolean                    recursive;
+	GthTest                    *test;
+	GCancellable               *cancellable;
+	GthSearchIndexProgressFunc  progress_func;
+	InfoReadyCallback           ready_func;
+	gpointer                    user_data;
+	GthFileSource              *file_source;
+	GFileAttributeMatcher      *matcher;
+	GList                      *match_folders;  /* MatchFolder list */
+	GQueue                     *to_read;        /* relative uri queue */
+	char                       *current;
+	gint64                      current_mtime;
+	char                       *current_id;
+	GVariantBuilder            *current_files;
+	GPtrArray                  *current_subfolders;
+	GPtrArray                  *current_subfolder_ids;
+	GList                      *files;          /* GthFileData list */
+} SearchData;
+
+
+static void
+check_folder_free (CheckFolder *check_folder)
+{
+	g_variant_unref (check_folder->files);
+	g_free (check_folder->path);
+	g_free (check_folder->uri);
+	g_free (check_folder);
+}
+
+
+static void
+refresh_data_free (RefreshData *refresh_data)
+{
+	g_list_free_full (refresh_data->check_folders, (GDestroyNotify) check_folder_free);
+	g_object_unref (refresh_data->cancellable);
+	gth_folder_index_unref (refresh_data->index);
+	g_free (refresh_data);
+}
+
+
+static void
+match_folder_free (MatchFolder *match_folder)
+{
+	g_free (match_folder->path);
+	g_free (match_folder->uri_prefix);
+	g_variant_unref (match_folder->files);
+	g_free (match_folder);
+}
+
+
+static void
+search_data_free_current (SearchData *search_data)
+{
+	if (search_data->current_files != NULL) {
+		g_variant_builder_unref (search_data->current_files);
+		search_data->current_files = NULL;
+	}
+	if (search_data->current_subfolders != NULL) {
+		g_ptr_array_free (search_data->current_subfolders, TRUE);
+		search_data->current_subfolders = NULL;
+	}
+	if (search_data->current_subfolder_ids != NULL) {
+		g_ptr_array_free (search_data->current_subfolder_ids, TRUE);
+		search_data->current_subfolder_ids = NULL;
+	}
+	g_free (search_data->current_id);
+	search_data->current_id = NULL;
+}
+
+
+static void
+search_data_free (SearchData *search_data)
+{
+	search_data_free_current (search_data);
+	g_free (search_data->current);
+	g_queue_free_full (search_data->to_read, g_free);
+	g_list_free_full (search_data->match_folders, (GDestroyNotify) match_folder_free);
+	_g_object_list_unref (search_data->files);
+	g_file_attribute_matcher_unref (search_data->matcher);
+	g_object_unref (search_data->file_source);
+	_g_object_unref (search_data->cancellable);
+	g_object_unref (search_data->test);
+	g_free (search_data->scope);
+	gth_folder_index_unref (search_data->index);
+	g_free (search_data);
+}
+
+
+static void _gth_search_index_refresh (GthFolderIndex *index, const char *scope, gboolean recursive);
+
+
+static void
+search_data_done (SearchData *search_data,
+		  GError     *error)
+{
+	if (error == NULL)
+		_gth_search_index_refresh (search_data->index, search_data->scope, search_data->recursive);
+
+	search_data->ready_func (search_data->files, error, search_data->user_data);
+	search_data_free (search_data);
+}
+
+
+static gint64
+_gth_search_index_get_mtime (GFileInfo *info)
+{
+	return (gint64) g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC
+		+ g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+}
+
+
+static void
+match_files_thread (GSimpleAsyncResult *result,
+		    GObject            *object,
+		    GCancellable       *cancellable)
+{
+	SearchData *search_data;
+	GList      *scan;
+
+	search_data = g_simple_async_result_get_op_res_gpointer (result);
+
+	performance (DEBUG_INFO, "gth_search_index match start");
+
+	for (scan = search_data->match_folders; scan; scan = scan->next) {
+		MatchFolder  *match_folder = scan->data;
+		GVariantIter  files;
+		const char   *name;
+		GVariant     *attributes;
+
+		if ((cancellable != NULL) && g_cancellable_is_cancelled (cancellable)) {
+			GError *error;
+
+			error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_CANCELLED, "");
+			g_simple_async_result_set_from_error (result, error);
+			g_error_free (error);
+			break;
+		}
+
+		g_variant_iter_init (&files, match_folder->files);
+		while (g_variant_iter_loop (&files, "{&s@a{sv}}", &name, &attributes)) {
+			GFileInfo    *info;
+			GVariantIter  attribute_iter;
+			const char   *attribute;
+			GVariant     *value;
+			char         *uri;
+			GFile        *file;
+			GthFileData  *file_data;
+
+			info = g_file_info_new ();
+			g_variant_iter_init (&attribute_iter, attributes);
+			while (g_variant_iter_loop (&attribute_iter, "{&sv}", &attribute, &value))
+				_g_file_info_set_attribute_variant (info, attribute, value);
+
+			uri = g_strconcat (match_folder->uri_prefix, name, NULL);
+			file = g_file_new_for_uri (uri);
+			file_data = gth_file_data_new (file, info);
+			if (gth_test_match (search_data->test, file_data))
+				search_data->files = g_list_prepend (search_data->files, g_object_ref (file_data));
+
+			g_object_unref (file_data);
+			g_object_unref (file);
+			g_free (uri);
+			g_object_unref (info);
+		}
+	}
+	search_data->files = g_list_reverse (search_data->files);
+
+	performance (DEBUG_INFO, "gth_search_index match end");
+}
+
+
+static void
+match_files_ready_cb (GObject      *source_object,
+		      GAsyncResult *result,
+		      gpointer      user_data)
+{
+	SearchData *search_data = user_data;
+	GError     *error = NULL;
+
+	if (g_simple_async_result_propagate_error (G_SIMPLE_ASYNC_RESULT (result), &error)) {
+		_g_object_list_unref (search_data->files);
+		search_data->files = NULL;
+	}
+	search_data_done (search_data, error);
+}
+
+
+static void
+search_data_match_files (SearchData *search_data)
+{
+	GList              *folders;
+	GList              *scan;
+	GSimpleAsyncResult *result;
+
+	/* the test is evaluated in another thread on a copy of the folder
+	 * list, the folder entries can change in the meanwhile. */
+
+	folders = gth_folder_index_get_folders (search_data->index, search_data->scope, search_data->recursive);
+	for (scan = folders; scan; scan = scan->next) {
+		const char          *path = scan->data;
+		GthFolderIndexEntry *entry;
+		MatchFolder         *match_folder;
+
+		entry = gth_folder_index_lookup (search_data->index, path);
+		match_folder = g_new0 (MatchFolder, 1);
+		match_folder->path = g_strdup (path);
+		match_folder->uri_prefix = gth_folder_index_get_folder_uri_prefix (search_data->index, path);
+		match_folder->files = g_variant_ref (entry->files);
+		search_data->match_folders = g_list_prepend (search_data->match_folders, match_folder);
+	}
+	search_data->match_folders = g_list_reverse (search_data->match_folders);
+
+	_g_string_list_free (folders);
+
+	result = g_simple_async_result_new (NULL,
+					    match_files_ready_cb,
+					    search_data,
+					    search_data_match_files);
+	g_simple_async_result_set_op_res_gpointer (result, search_data, NULL);
+	g_simple_async_result_run_in_thread (result,
+					     match_files_thread,
+					     G_PRIORITY_DEFAULT,
+					     search_data->cancellable);
+
+	g_object_unref (result);
+}
+
+
+static void search_data_read_next_folder (SearchData *search_data);
+
+
+static DirOp
+read_folder_start_dir_func (GFile      *directory,
+			    GFileInfo  *info,
+			    GError    **error,
+			    gpointer    user_data)
+{
+	SearchData *search_data = user_data;
+
+	search_data->current_mtime = MAX (_gth_search_index_get_mtime (info), 1);
+	search_data->current_id = g_strdup (g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILE));
+	if (search_data->progress_func != NULL)
+		search_data->progress_func (directory, search_data->user_data);
+
+	return DIR_OP_CONTINUE;
+}
+
+
+static gboolean
+_gth_search_index_can_add_subfolder (SearchData *search_data,
+				const char *name,
+				const char *id,
+				gboolean    is_symlink)
+{
+	char     *child_path;
+	gboolean  can_add;
+	int       i;
+
+	if ((id == NULL) || (id[0] == '\0'))
+		return ! is_symlink;
+
+	/* a link to the folder itself, or to a folder already indexed with
+	 * another path */
+
+	if (g_strcmp0 (id, search_data->current_id) == 0)
+		return FALSE;
+
+	for (i = 0; i < search_data->current_subfolder_ids->len; i++)
+		if (g_strcmp0 (id, g_ptr_array_index (search_data->current_subfolder_ids, i)) == 0)
+			return FALSE;
+
+	if (search_data->current[0] == '\0')
+		child_path = g_strdup (name);
+	else
+		child_path = g_strconcat (search_data->current, "/", name, NULL);
+	can_add = gth_folder_index_can_add_folder (search_data->index, child_path, id);
+
+	g_free (child_path);
+
+	return can_add;
+}
+
+
+static void
+read_folder_for_each_file_func (GFile     *file,
+				GFileInfo *info,
+				gpointer   user_data)
+{
+	SearchData      *search_data = user_data;
+	char            *uri;
+	const char      *name;
+	const char      *id;
+	GVariantBuilder  attribute_builder;
+	char           **attribute_v;
+	int              i;
+
+	if (g_file_info_get_is_hidden (info))
+		return;
+
+	uri = g_file_get_uri (file);
+	name = strrchr (uri, '/');
+	if ((name == NULL) || (name[1] == '\0')) {
+		g_free (uri);
+		return;
+	}
+	name++;
+
+	switch (g_file_info_get_file_type (info)) {
+	case G_FILE_TYPE_DIRECTORY:
+		/* the links are followed indexing each folder only once, they
+		 * are ignored when the folder id is not known. */
+
+		id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILE);
+		if (_gth_search_index_can_add_subfolder (search_data, name, id, g_file_info_get_is_symlink (info))) {
+			g_ptr_array_add (search_data->current_subfolders, g_strdup (name));
+			g_ptr_array_add (search_data->current_subfolder_ids, g_strdup ((id != NULL) ? id : ""));
+		}
+		break;
+
+	case G_FILE_TYPE_REGULAR:
+		g_variant_builder_init (&attribute_builder, G_VARIANT_TYPE ("a{sv}"));
+		attribute_v = g_file_info_list_attributes (info, NULL);
+		for (i = 0; attribute_v[i] != NULL; i++) {
+			GVariant *value;
+
+			if (! g_file_attribute_matcher_matches (search_data->matcher, attribute_v[i]))
+				continue;
+
+			value = _g_file_info_get_attribute_variant (info, attribute_v[i]);
+			if (value != NULL)
+				g_variant_builder_add (&attribute_builder, "{sv}", attribute_v[i], value);
+		}
+		g_variant_builder_add (search_data->current_files, "{sa{sv}}", name, &attribute_builder);
+
+		g_strfreev (attribute_v);
+		break;
+
+	default:
+		break;
+	}
+
+	g_free (uri);
+}
+
+
+static void
+read_folder_done_func (GObject  *object,
+		       GError   *error,
+		       gpointer  user_data)
+{
+	SearchData     *search_data = user_data;
+	GthFolderIndex *index = search_data->index;
+
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		search_data_done (search_data, error);
+		return;
+	}
+
+	if (gth_folder_index_lookup (index, search_data->current) == NULL) {
+		/* removed in the meanwhile */
+		if (error != NULL)
+			g_error_free (error);
+	}
+	else if (error != NULL) {
+		/* the folder doesn't exist anymore or cannot be read */
+		gth_folder_index_remove_folder (index, search_data->current);
+		_gth_search_index_queue_save (index);
+		g_error_free (error);
+	}
+	else {
+		GList *new_folders;
+		GList *scan;
+
+		g_ptr_array_add (search_data->current_subfolders, NULL);
+		g_ptr_array_add (search_data->current_subfolder_ids, NULL);
+		new_folders = gth_folder_index_set_folder (index,
+							   search_data->current,
+							   search_data->current_mtime,
+							   search_data->current_id,
+							   (char **) search_data->current_subfolders->pdata,
+							   (char **) search_data->current_subfolder_ids->pdata,
+							   g_variant_builder_end (search_data->current_files));
+		if (search_data->recursive) {
+			for (scan = new_folders; scan; scan = scan->next)
+				g_queue_push_tail (search_data->to_read, g_strdup (scan->data));
+		}
+
+		_g_string_list_free (new_folders);
+		_gth_search_index_queue_save (index);
+	}
+
+	search_data_free_current (search_data);
+	search_data_read_next_folder (search_data);
+}
+
+
+static void
+search_data_read_next_folder (SearchData *search_data)
+{
+	char  *path;
+	char  *uri;
+	GFile *folder;
+
+	g_free (search_data->current);
+	search_data->current = NULL;
+
+	while ((path = g_queue_pop_head (search_data->to_read)) != NULL) {
+		if (gth_folder_index_lookup (search_data->index, path) != NULL)
+			break;
+		g_free (path);
+	}
+
+	if (path == NULL) {
+		search_data_match_files (search_data);
+		return;
+	}
+
+	/* the file source resets the cancellable when a new operation
+	 * starts. */
+
+	if ((search_data->cancellable != NULL) && g_cancellable_is_cancelled (search_data->cancellable)) {
+		g_free (path);
+		search_data_done (search_data, g_error_new_literal (G_IO_ERROR, G_IO_ERROR_CANCELLED, ""));
+		return;
+	}
+
+	search_data->current = path;
+	search_data->current_mtime = 0;
+	search_data->current_files = g_variant_builder_new (G_VARIANT_TYPE (GTH_FOLDER_INDEX_FILES_FORMAT));
+	search_data->current_subfolders = g_ptr_array_new_with_free_func (g_free);
+	search_data->current_subfolder_ids = g_ptr_array_new_with_free_func (g_free);
+
+	uri = gth_folder_index_get_folder_uri (search_data->index, path);
+	folder = g_file_new_for_uri (uri);
+	gth_file_source_for_each_child (search_data->file_source,
+					folder,
+					FALSE,
+					search_data->index->attributes,
+					read_folder_start_dir_func,
+					read_folder_for_each_file_func,
+					read_folder_done_func,
+					search_data);
+
+	g_object_unref (folder);
+	g_free (uri);
+}
+
+
+/* Returns whether the files of @check_folder changed since the folder was
+ * indexed. */
+static gboolean
+_gth_search_index_folder_files_changed (CheckFolder  *check_folder,
+					GFile        *folder,
+					GCancellable *cancellable)
+{
+	GFileEnumerator *enumerator;
+	GList           *file_info_list;
+	GFileInfo       *info;
+	gboolean         changed;
+
+	enumerator = g_file_enumerate_children (folder,
+						CHECK_FILE_ATTRIBUTES,
+						G_FILE_QUERY_INFO_NONE,
+						cancellable,
+						NULL);
+	if (enumerator == NULL)
+		return TRUE;
+
+	file_info_list = NULL;
+	while ((info = g_file_enumerator_next_file (enumerator, cancellable, NULL)) != NULL)
+		file_info_list = g_list_prepend (file_info_list, info);
+	changed = gth_folder_index_files_changed (check_folder->files, folder, file_info_list);
+
+	_g_object_list_unref (file_info_list);
+	g_object_unref (enumerator);
+
+	return changed;
+}
+
+
+static void
+check_folders_thread (GSimpleAsyncResult *result,
+		      GObject            *object,
+		      GCancellable       *cancellable)
+{
+	RefreshData *refresh_data;
+	GList       *scan;
+
+	refresh_data = g_simple_async_result_get_op_res_gpointer (result);
+
+	for (scan = refresh_data->check_folders; scan; scan = scan->next) {
+		CheckFolder *check_folder = scan->data;
+		GFile       *folder;
+		GFileInfo   *info;
+
+		if (g_cancellable_is_cancelled (cancellable))
+			break;
+
+		folder = g_file_new_for_uri (check_folder->uri);
+		info = g_file_query_info (folder,
+					  G_FILE_ATTRIBUTE_TIME_MODIFIED "," G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+					  G_FILE_QUERY_INFO_NONE,
+					  cancellable,
+					  NULL);
+
+		/* the size and the modification time of the files are
+		 * checked as well because editing a file doesn't change the
+		 * folder. */
+
+		check_folder->changed = ((info == NULL)
+					 || (_gth_search_index_get_mtime (info) != check_folder->mtime)
+					 || _gth_search_index_folder_files_changed (check_folder, folder, cancellable));
+
+		_g_object_unref (info);
+		g_object_unref (folder);
+	}
+}
+
+
+static void
+check_folders_ready_cb (GObject      *source_object,
+			GAsyncResult *result,
+			gpointer      user_data)
+{
+	RefreshData    *refresh_data = user_data;
+	GthFolderIndex *index = refresh_data->index;
+	GList          *scan;
+
+	if (refresh_cancellable == refresh_data->cancellable)
+		refresh_cancellable = NULL;
+
+	/* the index can be released or unloaded in the meanwhile */
+
+	if (g_cancellable_is_cancelled (refresh_data->cancellable)
+	    || (indexes == NULL)
+	    || (gth_user_cache_lookup (indexes, index->uri) != index))
+	{
+		refresh_data_free (refresh_data);
+		return;
+	}
+
+	/* mark the changed folders as to be read again by the next search,
+	 * unless they have been read in the meanwhile */
+
+	for (scan = refresh_data->check_folders; scan; scan = scan->next) {
+		CheckFolder         *check_folder = scan->data;
+		GthFolderIndexEntry *entry;
+		gint64              *check_time;
+
+		check_time = g_new (gint64, 1);
+		*check_time = g_get_monotonic_time ();
+		g_hash_table_insert (checked_folders, g_strdup (check_folder->uri), check_time);
+
+		if (! check_folder->changed)
+			continue;
+
+		entry = gth_folder_index_lookup (index, check_folder->path);
+		if ((entry != NULL) && (entry->mtime == check_folder->mtime)) {
+			entry->mtime = 0;
+			_gth_search_index_queue_save (index);
+		}
+	}
+
+	refresh_data_free (refresh_data);
+}
+
+
+/* Checks in background whether the indexed folders inside @scope changed
+ * without the monitor noticing it, for example while gthumb was not
+ * running, or because a file was edited by another application.  The
+ * changed folders are read again by the next search.  A folder is checked
+ * at most once every REFRESH_INTERVAL. */
+static void
+_gth_search_index_refresh (GthFolderIndex *index,
+			   const char     *scope,
+			   gboolean        recursive)
+{
+	RefreshData        *refresh_data;
+	gint64              now;
+	GList              *folders;
+	GList              *scan;
+	GSimpleAsyncResult *result;
+
+	if ((indexes == NULL) || (refresh_cancellable != NULL))
+		return;
+
+	now = g_get_monotonic_time ();
+
+	refresh_data = g_new0 (RefreshData, 1);
+	refresh_data->index = gth_folder_index_ref (index);
+	refresh_data->cancellable = g_cancellable_new ();
+
+	folders = gth_folder_index_get_folders (index, scope, recursive);
+	for (scan = folders; scan; scan = scan->next) {
+		const char          *path = scan->data;
+		GthFolderIndexEntry *entry;
+		char                *uri;
+		gint64              *check_time;
+		CheckFolder         *check_folder;
+
+		entry = gth_folder_index_lookup (index, path);
+		if (entry->mtime == 0)
+			continue;
+
+		uri = gth_folder_index_get_folder_uri (index, path);
+		check_time = g_hash_table_lookup (checked_folders, uri);
+		if ((check_time != NULL) && (now - *check_time < REFRESH_INTERVAL)) {
+			g_free (uri);
+			continue;
+		}
+
+		check_folder = g_new0 (CheckFolder, 1);
+		check_folder->path = g_strdup (path);
+		check_folder->uri = uri;
+		check_folder->mtime = entry->mtime;
+		check_folder->files = g_variant_ref (entry->files);
+		refresh_data->check_folders = g_list_prepend (refresh_data->check_folders, check_folder);
+	}
+	refresh_data->check_folders = g_list_reverse (refresh_data->check_folders);
+
+	_g_string_list_free (folders);
+
+	if (refresh_data->check_folders == NULL) {
+		refresh_data_free (refresh_data);
+		return;
+	}
+
+	refresh_cancellable = refresh_data->cancellable;
+
+	result = g_simple_async_result_new (NULL,
+					    check_folders_ready_cb,
+					    refresh_data,
+					    _gth_search_index_refresh);
+	g_simple_async_result_set_op_res_gpointer (result, refresh_data, NULL);
+	g_simple_async_result_run_in_thread (result,
+					     check_folders_thread,
+					     G_PRIORITY_LOW,
+					     refresh_data->cancellable);
+
+	g_object_unref (result);
+}
+
+
+/* Calls @ready_func with the files inside @folder that match @test.  The
+ * index is updated before, reading the folders the monitor reported as
+ * changed, the other folders are checked in background after the search,
+ * see _gth_search_index_refresh.  The hidden files are never returned. */
+void
+gth_search_index_search (GFile                      *folder,
+			 gboolean                    recursive,
+			 GthTest                    *test,
+			 GCancellable               *cancellable,
+			 GthSearchIndexProgressFunc  progress_func,
+			 InfoReadyCallback           ready_func,
+			 gpointer                    user_data)
+{
+	SearchData         *search_data;
+	char               *attributes;
+	GthFolderIndex     *index;
+	char               *scope;
+	GFile              *root;
+	GList              *folders;
+	GList              *scan;
+
+	g_return_if_fail (indexes != NULL);
+
+	/* use the index of the folder or of one of its parents */
+
+	attributes = _gth_search_index_get_attributes ();
+	index = NULL;
+	scope = NULL;
+	root = g_object_ref (folder);
+	while (root != NULL) {
+		GFile *parent;
+
+		index = _gth_search_index_get (root, attributes);
+		if (index != NULL) {
+			scope = gth_folder_index_get_relative_uri (index, folder);
+			if ((scope != NULL) && (gth_folder_index_lookup (index, scope) != NULL))
+				break;
+
+			g_free (scope);
+			scope = NULL;
+			index = NULL;
+		}
+
+		parent = g_file_get_parent (root);
+		g_object_unref (root);
+		root = parent;
+	}
+	_g_object_unref (root);
+
+	if (index == NULL) {
+		index = gth_folder_index_new (folder, attributes);
+		gth_folder_index_add_folder (index, "", NULL);
+		gth_user_cache_add (indexes, index->uri, index);
+		scope = g_strdup ("");
+	}
+
+	search_data = g_new0 (SearchData, 1);
+	search_data->index = gth_folder_index_ref (index);
+	search_data->scope = scope;
+	search_data->recursive = recursive;
+	search_data->test = g_object_ref (test);
+	search_data->cancellable = _g_object_ref (cancellable);
+	search_data->progress_func = progress_func;
+	search_data->ready_func = ready_func;
+	search_data->user_data = user_data;
+	search_data->file_source = gth_main_get_file_source (folder);
+	gth_file_source_set_cancellable (search_data->file_source, cancellable);
+	search_data->matcher = g_file_attribute_matcher_new (attributes);
+	search_data->to_read = g_queue_new ();
+
+	/* the stored folders are trusted, only the folders never read or
+	 * marked as changed are read again. */
+
+	folders = gth_folder_index_get_folders (index, scope, recursive);
+	for (scan = folders; scan; scan = scan->next) {
+		const char          *path = scan->data;
+		GthFolderIndexEntry *entry;
+
+		entry = gth_folder_index_lookup (index, path);
+		if (entry->mtime == 0)
+			g_queue_push_tail (search_data->to_read, g_strdup (path));
+	}
+
+	_g_string_list_free (folders);
+	g_free (attributes);
+
+	search_data_read_next_folder (search_data);
+}
@@ -0,0 +1,48 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+/*
+ *  GThumb
+ *
+ *  Copyright (C) 2013 Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef GTH_SEARCH_INDEX_H
+#define GTH_SEARCH_INDEX_H
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <gthumb.h>
+
+G_BEGIN_DECLS
+
+typedef void (*GthSearchIndexProgressFunc) (GFile    *folder,
+					    gpointer  user_data);
+
+void		gth_search_index_initialize	(void);
+void		gth_search_index_release	(void);
+gboolean	gth_search_index_can_search	(GthTest                     *test);
+void		gth_search_index_search		(GFile                       *folder,
+						 gboolean                     recursive,
+						 GthTest                     *test,
+						 GCancellable                *cancellable,
+						 GthSearchIndexProgressFunc   progress_func,
+						 InfoReadyCallback            ready_func,
+						 gpointer                     user_data);
+
+G_END_DECLS
+
+#endif /* GTH_SEARCH_INDEX_H */
@@ -24,9 +24,14 @@
 #include <glib/gi18n.h>
 #include <gthumb.h>
 #include <extensions/catalogs/gth-catalog.h>
+#include "gth-search-index.h"
 #include "gth-search-task.h"
 
 
+#define FLUSH_DELAY 500
+#define UPDATE_TEXT_DELAY (200 * 1000)
+
+
 G_DEFINE_TYPE (GthSearchTask, gth_search_task, GTH_TYPE_TASK)
 
 
@@ -43,6 +48,9 @@ struct _GthSearchTaskPrivate
 	GtkWidget     *dialog;
 	GthFileSource *file_source;
 	gsize          n_files;
+	GPtrArray     *new_files;
+	guint          flush_id;
+	gint64         last_text_update;
 };
 
 
@@ -62,6 +70,9 @@ gth_search_task_finalize (GObject *object)
 	task = GTH_SEARCH_TASK (object);
 
 	if (task->priv != NULL) {
+		if (task->priv->flush_id != 0)
+			g_source_remove (task->priv->flush_id);
+		g_ptr_array_free (task->priv->new_files, TRUE);
 		g_object_unref (task->priv->file_source);
 		g_object_unref (task->priv->search);
 		g_object_unref (task->priv->test);
@@ -115,11 +126,81 @@ save_search_result_copy_done_cb (void     **buffer,
 	task->priv->io_operation = FALSE;
 
 	gth_browser_update_extra_widget (task->priv->browser);
+	gth_task_completed (GTH_TASK (task), task->priv->error);
+}
+
+
+static void
+update_secondary_text (GthSearchTask *task)
+{
+	char *format_str;
+	char *msg;
+
+	format_str = g_strdup_printf ("%"G_GSIZE_FORMAT, task->priv->n_files);
+	msg = g_strdup_printf (_("Files found until now: %s"), format_str);
+	gth_embedded_dialog_set_secondary_text (GTH_EMBEDDED_DIALOG (task->priv->dialog), msg);
+	task->priv->last_text_update = g_get_monotonic_time ();
+
+	g_free (format_str);
+	g_free (msg);
+}
+
+
+/* the found files are added to the catalog and shown in the browser a batch
+ * at a time. */
+static void
+flush_new_files (GthSearchTask *task)
+{
+	GList *files;
+	int    i;
+
+	if (task->priv->flush_id != 0) {
+		g_source_remove (task->priv->flush_id);
+		task->priv->flush_id = 0;
+	}
+
+	if (task->priv->new_files->len == 0)
+		return;
+
+	files = NULL;
+	for (i = task->priv->new_files->len - 1; i >= 0; i--)
+		files = g_list_prepend (files, g_ptr_array_index (task->priv->new_files, i));
+	gth_catalog_append_files (GTH_CATALOG (task->priv->search), files);
 	gth_monitor_folder_changed (gth_main_get_default_monitor (),
 				    task->priv->search_catalog,
-				    gth_catalog_get_file_list (GTH_CATALOG (task->priv->search)),
+				    files,
 				    GTH_MONITOR_EVENT_CREATED);
-	gth_task_completed (GTH_TASK (task), task->priv->error);
+
+	g_list_free (files);
+	g_ptr_array_set_size (task->priv->new_files, 0);
+}
+
+
+static gboolean
+flush_new_files_cb (gpointer user_data)
+{
+	GthSearchTask *task = user_data;
+
+	task->priv->flush_id = 0;
+	flush_new_files (task);
+	update_secondary_text (task);
+
+	return FALSE;
+}
+
+
+static void
+add_new_file (GthSearchTask *task,
+	      GFile         *file)
+{
+	g_ptr_array_add (task->priv->new_files, g_object_ref (file));
+	task->priv->n_files++;
+
+	if (task->priv->flush_id == 0)
+		task->priv->flush_id = g_timeout_add (FLUSH_DELAY, flush_new_files_cb, task);
+
+	if (g_get_monotonic_time () - task->priv->last_text_update >= UPDATE_TEXT_DELAY)
+		update_secondary_text (task);
 }
 
 
@@ -129,11 +210,11 @@ done_func (GObject  *object,
 	   gpointer  user_data)
 {
 	GthSearchTask *task = user_data;
-	DomDocument   *doc;
 	char          *data;
 	gsize          size;
 	GFile         *search_result_real_file;
 
+	flush_new_files (task);
 	gth_embedded_dialog_set_secondary_text (GTH_EMBEDDED_DIALOG (task->priv->dialog), NULL);
 
 	task->priv->error = NULL;
@@ -152,9 +233,7 @@ done_func (GObject  *object,
 
 	/* save the search result */
 
-	doc = dom_document_new ();
-	dom_element_append_child (DOM_ELEMENT (doc), dom_domizable_create_element (DOM_DOMIZABLE (task->priv->search), doc));
-	data = dom_document_dump (doc, &size);
+	data = gth_catalog_to_data (GTH_CATALOG (task->priv->search), &size);
 
 	search_result_real_file = gth_catalog_file_to_gio_file (task->priv->search_catalog);
 	_g_file_write_async (search_result_real_file,
@@ -167,22 +246,6 @@ done_func (GObject  *object,
 			     task);
 
 	g_object_unref (search_result_real_file);
-	g_object_unref (doc);
-}
-
-
-static void
-update_secondary_text (GthSearchTask *task)
-{
-	char *format_str;
-	char *msg;
-
-	format_str = g_strdup_printf ("%"G_GSIZE_FORMAT, task->priv->n_files);
-	msg = g_strdup_printf (_("Files found until now: %s"), format_str);
-	gth_embedded_dialog_set_secondary_text (GTH_EMBEDDED_DIALOG (task->priv->dialog), msg);
-
-	g_free (format_str);
-	g_free (msg);
 }
 
 
@@ -199,11 +262,8 @@ for_each_file_func (GFile     *file,
 
 	file_data = gth_file_data_new (file, info);
 
-	if (gth_test_match (GTH_TEST (task->priv->test), file_data)) {
-		gth_catalog_insert_file (GTH_CATALOG (task->priv->search), file_data->file, -1);
-		task->priv->n_files++;
-		update_secondary_text (task);
-	}
+	if (gth_test_match (GTH_TEST (task->priv->test), file_data))
+		add_new_file (task, file_data->file);
 
 	g_object_unref (file_data);
 }
@@ -221,6 +281,22 @@ file_is_visible (GthSearchTask *task,
 }
 
 
+static void
+update_primary_text (GthSearchTask *task,
+		     GFile         *directory)
+{
+	char *uri;
+	char *text;
+
+	uri = g_file_get_parse_name (directory);
+	text = g_strdup_printf ("Searching in %s", uri);
+	gth_embedded_dialog_set_primary_text (GTH_EMBEDDED_DIALOG (task->priv->dialog), text);
+
+	g_free (text);
+	g_free (uri);
+}
+
+
 static DirOp
 start_dir_func (GFile      *directory,
 		GFileInfo  *info,
@@ -228,23 +304,42 @@ start_dir_func (GFile      *directory,
 		gpointer    user_data)
 {
 	GthSearchTask *task = user_data;
-	char          *uri;
-	char          *text;
 
 	if (! file_is_visible (task, info))
 		return DIR_OP_SKIP;
 
-	uri = g_file_get_parse_name (directory);
-	text = g_strdup_printf ("Searching in %s", uri);
-	gth_embedded_dialog_set_primary_text (GTH_EMBEDDED_DIALOG (task->priv->dialog), text);
-
-	g_free (text);
-	g_free (uri);
+	update_primary_text (task, directory);
 
 	return DIR_OP_CONTINUE;
 }
 
 
+static void
+index_progress_func (GFile    *folder,
+		     gpointer  user_data)
+{
+	update_primary_text ((GthSearchTask *) user_data, folder);
+}
+
+
+static void
+index_search_ready_cb (GList    *files,
+		       GError   *error,
+		       gpointer  user_data)
+{
+	GthSearchTask *task = user_data;
+	GList         *scan;
+
+	for (scan = files; scan; scan = scan->next) {
+		GthFileData *file_data = scan->data;
+
+		add_new_file (task, file_data->file);
+	}
+
+	done_func (NULL, error, task);
+}
+
+
 static void
 browser_location_ready_cb (GthBrowser    *browser,
 			   GFile         *folder,
@@ -326,14 +421,25 @@ browser_location_ready_cb (GthBrowser    *browser,
 		g_string_append (attributes, test_attributes);
 	}
 
-	gth_file_source_for_each_child (task->priv->file_source,
-					gth_search_get_folder (task->priv->search),
-					gth_search_is_recursive (task->priv->search),
-					attributes->str,
-					start_dir_func,
-					for_each_file_func,
-					done_func,
-					task);
+	/* the index doesn't contain the hidden files */
+
+	if (! task->priv->show_hidden_files && gth_search_index_can_search (GTH_TEST (task->priv->test)))
+		gth_search_index_search (gth_search_get_folder (task->priv->search),
+					 gth_search_is_recursive (task->priv->search),
+					 GTH_TEST (task->priv->test),
+					 gth_task_get_cancellable (GTH_TASK (task)),
+					 index_progress_func,
+					 index_search_ready_cb,
+					 task);
+	else
+		gth_file_source_for_each_child (task->priv->file_source,
+						gth_search_get_folder (task->priv->search),
+						gth_search_is_recursive (task->priv->search),
+						attributes->str,
+						start_dir_func,
+						for_each_file_func,
+						done_func,
+						task);
 
 	g_object_unref (settings);
 	g_string_free (attributes, TRUE);
@@ -436,6 +542,7 @@ static void
 gth_search_task_init (GthSearchTask *task)
 {
 	task->priv = g_new0 (GthSearchTaskPrivate, 1);
+	task->priv->new_files = g_ptr_array_new_with_free_func (g_object_unref);
 }
 
 
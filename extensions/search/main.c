@@ -24,6 +24,7 @@
 #include <gtk/gtk.h>
 #include <gthumb.h>
 #include "callbacks.h"
+#include "gth-search-index.h"
 
 
 G_MODULE_EXPORT void
@@ -36,12 +37,15 @@ gthumb_extension_activate (void)
 	gth_hook_add_callback ("dlg-catalog-properties-save", 10, G_CALLBACK (search__dlg_catalog_properties_save), NULL);
 	gth_hook_add_callback ("dlg-catalog-properties-saved", 10, G_CALLBACK (search__dlg_catalog_properties_saved), NULL);
 	gth_hook_add_callback ("gth-organize-task-create-catalog", 10, G_CALLBACK (search__gth_organize_task_create_catalog), NULL);
+	gth_hook_add_callback ("gth-browser-close-last-window", 10, G_CALLBACK (search__gth_browser_close_last_window_cb), NULL);
+	gth_search_index_initialize ();
 }
 
 
 G_MODULE_EXPORT void
 gthumb_extension_deactivate (void)
 {
+	gth_search_index_release ();
 }
 
 
@@ -671,6 +671,138 @@ dom_document_load (DomDocument  *self,
 }
 
 
+/* -- DomReader -- */
+
+
+typedef struct {
+	const DomReader *reader;
+	gpointer         user_data;
+	int              depth;
+	GString         *text;
+	gboolean         leaf;
+} ReaderData;
+
+
+static void
+reader_start_element_cb (GMarkupParseContext  *context,
+			 const char           *element_name,
+			 const char          **attribute_names,
+			 const char          **attribute_values,
+			 gpointer              user_data,
+			 GError              **error)
+{
+	ReaderData *data = user_data;
+
+	if (data->reader->start_element != NULL)
+		data->reader->start_element (data->depth,
+					     element_name,
+					     attribute_names,
+					     attribute_values,
+					     data->user_data);
+
+	g_string_truncate (data->text, 0);
+	data->leaf = TRUE;
+	data->depth++;
+}
+
+
+static void
+reader_end_element_cb (GMarkupParseContext  *context,
+		       const char           *element_name,
+		       gpointer              user_data,
+		       GError              **error)
+{
+	ReaderData *data = user_data;
+	const char *text;
+
+	data->depth--;
+
+	text = (data->leaf && (data->text->len > 0)) ? data->text->str : NULL;
+	if (data->reader->end_element != NULL)
+		data->reader->end_element (data->depth,
+					   element_name,
+					   text,
+					   data->user_data);
+
+	g_string_truncate (data->text, 0);
+	data->leaf = FALSE;
+}
+
+
+static void
+reader_text_cb (GMarkupParseContext  *context,
+		const char           *text,
+		gsize                 text_len,
+		gpointer              user_data,
+		GError              **error)
+{
+	ReaderData *data = user_data;
+
+	if (data->leaf)
+		g_string_append_len (data->text, text, text_len);
+}
+
+
+static const GMarkupParser reader_markup_parser = {
+	reader_start_element_cb,  /* start_element */
+	reader_end_element_cb,    /* end_element */
+	reader_text_cb,           /* text */
+	NULL,                     /* passthrough */
+	NULL                      /* error */
+};
+
+
+/* Parses @xml calling the @reader functions for each element, without
+ * creating a DomDocument.  The depth of the root element is 0, the text
+ * passed to end_element is the text of the element if it doesn't have
+ * child elements, NULL otherwise or if the element is empty.  The elements
+ * read before an error are reported as well. */
+gboolean
+dom_reader_parse (const DomReader  *reader,
+		  const char       *xml,
+		  gssize            len,
+		  gpointer          user_data,
+		  GError          **error)
+{
+	ReaderData           data;
+	GMarkupParseContext *context;
+	gboolean             success;
+
+	g_return_val_if_fail (reader != NULL, FALSE);
+	g_return_val_if_fail (xml != NULL, FALSE);
+
+	data.reader = reader;
+	data.user_data = user_data;
+	data.depth = 0;
+	data.text = g_string_new ("");
+	data.leaf = FALSE;
+
+	context = g_markup_parse_context_new (&reader_markup_parser, 0, &data, NULL);
+	success = g_markup_parse_context_parse (context, xml, (len < 0) ? strlen (xml) : len, error)
+		  && g_markup_parse_context_end_parse (context, error);
+
+	g_markup_parse_context_free (context);
+	g_string_free (data.text, TRUE);
+
+	return success;
+}
+
+
+const char *
+dom_reader_get_attribute (const char **attribute_names,
+			  const char **attribute_values,
+			  const char  *name)
+{
+	int i;
+
+	for (i = 0; attribute_names[i] != NULL; i++)
+		if (strcmp (attribute_names[i], name) == 0)
+			return attribute_values[i];
+
+	return NULL;
+}
+
+
 /* -- DomDomizable -- */
 
 
@@ -74,6 +74,21 @@ typedef struct _DomDocumentPrivate DomDocumentPrivate;
 typedef struct _DomDomizable DomDomizable;
 typedef struct _DomDomizableInterface DomDomizableInterface;
 
+typedef void (*DomReaderStartElementFunc) (int          depth,
+					   const char  *element_name,
+					   const char **attribute_names,
+					   const char **attribute_values,
+					   gpointer     user_data);
+typedef void (*DomReaderEndElementFunc)   (int          depth,
+					   const char  *element_name,
+					   const char  *text,
+					   gpointer     user_data);
+
+typedef struct {
+	DomReaderStartElementFunc start_element;
+	DomReaderEndElementFunc   end_element;
+} DomReader;
+
 struct _DomElement {
 	GInitiallyUnowned parent_instance;
 	DomElementPrivate *priv;
@@ -177,6 +192,17 @@ gboolean      dom_document_load                     (DomDocument  *self,
 					             gssize        len,
 					             GError      **error);
 
+/* DomReader */
+
+gboolean      dom_reader_parse                      (const DomReader  *reader,
+						     const char       *xml,
+						     gssize            len,
+						     gpointer          user_data,
+						     GError          **error);
+const char *  dom_reader_get_attribute              (const char      **attribute_names,
+						     const char      **attribute_values,
+						     const char       *name);
+
 /* DomDomizable */
 
 GType         dom_domizable_get_type                (void);
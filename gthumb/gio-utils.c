@@ -160,19 +160,37 @@ child_data_free (ChildData *data)
 }
 
 
-static void
-clear_child_data (ChildData **data)
-{
-	if (*data != NULL)
-		child_data_free (*data);
-	*data = NULL;
-}
+/* with GTH_LIST_PARALLEL, number of directories enumerated at the same time,
+ * and number of entries a directory can read ahead while waiting to be
+ * delivered to the caller. */
+#define FOR_EACH_CHILD_MAX_ACTIVE_DIRS 4
+#define FOR_EACH_CHILD_MAX_BUFFERED_CHILDREN (N_FILES_PER_REQUEST * 4)
+
+
+typedef struct _ForEachChildData ForEachChildData;
 
 
 typedef struct {
+	ForEachChildData     *fec;
+	ChildData            *dir;
+	GFileEnumerator      *enumerator;
+	GQueue               *children;
+	GError               *error;
+	gboolean              started;
+	gboolean              completed;
+	gboolean              paused;
+	gboolean              pending_op;
+	gboolean              discarded;
+} VisitData;
+
+
+struct _ForEachChildData {
 	GFile                *base_directory;
 	gboolean              recursive;
 	gboolean              follow_links;
+	gboolean              no_backup_files;
+	gboolean              no_hidden_files;
+	gboolean              parallel;
 	StartDirCallback      start_dir_func;
 	ForEachChildCallback  for_each_file_func;
 	ReadyFunc             done_func;
@@ -180,18 +198,58 @@ typedef struct {
 
 	/* private */
 
-	ChildData            *current;
 	GHashTable           *already_visited;
 	GList                *to_visit;
+	VisitData            *current;
+	int                   n_active;
+	int                   n_pending_ops;
+	gboolean              waiting;
+	gboolean              finished;
 	char                 *attributes;
 	GCancellable         *cancellable;
-	GFileEnumerator      *enumerator;
 	GError               *error;
 	guint                 source_id;
 	gboolean              metadata_attributes;
-	GList                *children;
-	GList                *current_child;
-} ForEachChildData;
+};
+
+
+static VisitData *
+visit_data_new (ForEachChildData *fec,
+		ChildData        *dir)
+{
+	VisitData *visit;
+
+	visit = g_new0 (VisitData, 1);
+	visit->fec = fec;
+	visit->dir = dir;
+	visit->children = g_queue_new ();
+
+	return visit;
+}
+
+
+static void
+visit_data_free (VisitData *visit)
+{
+	if (visit == NULL)
+		return;
+
+	if (visit->enumerator != NULL) {
+		if (! g_file_enumerator_is_closed (visit->enumerator))
+			g_file_enumerator_close_async (visit->enumerator,
+						       G_PRIORITY_DEFAULT,
+						       NULL,
+						       NULL,
+						       NULL);
+		g_object_unref (visit->enumerator);
+	}
+	g_queue_foreach (visit->children, (GFunc) g_object_unref, NULL);
+	g_queue_free (visit->children);
+	child_data_free (visit->dir);
+	if (visit->error != NULL)
+		g_error_free (visit->error);
+	g_free (visit);
+}
 
 
 static void
@@ -203,12 +261,7 @@ for_each_child_data_free (ForEachChildData *fec)
 	g_object_unref (fec->base_directory);
 	if (fec->already_visited != NULL)
 		g_hash_table_destroy (fec->already_visited);
-	clear_child_data (&(fec->current));
 	g_free (fec->attributes);
-	if (fec->to_visit != NULL) {
-		g_list_foreach (fec->to_visit, (GFunc) child_data_free, NULL);
-		g_list_free (fec->to_visit);
-	}
 	_g_object_unref (fec->cancellable);
 	g_free (fec);
 }
@@ -220,7 +273,6 @@ for_each_child_done_cb (gpointer user_data)
 	ForEachChildData *fec = user_data;
 
 	g_source_remove (fec->source_id);
-	clear_child_data (&(fec->current));
 	if (fec->done_func)
 		fec->done_func (fec->error, fec->user_data);
 	for_each_child_data_free (fec);
@@ -236,103 +288,230 @@ for_each_child_done (ForEachChildData *fec)
 }
 
 
-static void for_each_child_start_current (ForEachChildData *fec);
+static void
+for_each_child_check_done (ForEachChildData *fec)
+{
+	/* wait for the operations still running on the discarded directories,
+	 * they reference fec. */
 
+	if (fec->finished && (fec->n_pending_ops == 0) && (fec->source_id == 0))
+		for_each_child_done (fec);
+}
 
+
+/* release a directory that will not be delivered to the caller, if an
+ * operation is still running the directory is freed in its callback. */
 static void
-for_each_child_start (ForEachChildData *fec)
+for_each_child_discard_visit (ForEachChildData *fec,
+			      VisitData        *visit)
 {
-	for_each_child_start_current (fec);
+	if (visit->started)
+		fec->n_active--;
+
+	if (visit->pending_op)
+		visit->discarded = TRUE;
+	else
+		visit_data_free (visit);
 }
 
 
 static void
-for_each_child_set_current (ForEachChildData *fec,
-			    ChildData        *data)
+for_each_child_stop (ForEachChildData *fec)
 {
-	clear_child_data (&(fec->current));
-	fec->current = data;
+	GList *scan;
+
+	if (fec->current != NULL) {
+		for_each_child_discard_visit (fec, fec->current);
+		fec->current = NULL;
+	}
+
+	for (scan = fec->to_visit; scan; scan = scan->next)
+		for_each_child_discard_visit (fec, (VisitData *) scan->data);
+	g_list_free (fec->to_visit);
+	fec->to_visit = NULL;
+
+	fec->finished = TRUE;
+	for_each_child_check_done (fec);
 }
 
 
-static void
-for_each_child_start_next_sub_directory (ForEachChildData *fec)
+static void for_each_child_visit_ready (ForEachChildData *fec, VisitData *visit);
+static void for_each_child_enumerate_ready (GObject *source_object, GAsyncResult *result, gpointer user_data);
+static void for_each_child_next_files_ready (GObject *source_object, GAsyncResult *result, gpointer user_data);
+
+
+/* returns TRUE if the operation callback must go on, otherwise visit has
+ * been discarded meanwhile and it's now freed. */
+static gboolean
+for_each_child_visit_op_finished (VisitData *visit)
 {
-	ChildData *child = NULL;
+	ForEachChildData *fec = visit->fec;
 
-	if (fec->to_visit != NULL) {
-		GList *tmp;
+	visit->pending_op = FALSE;
+	fec->n_pending_ops--;
 
-		child = (ChildData *) fec->to_visit->data;
-		tmp = fec->to_visit;
-		fec->to_visit = g_list_remove_link (fec->to_visit, tmp);
-		g_list_free (tmp);
+	if (visit->discarded) {
+		visit_data_free (visit);
+		for_each_child_check_done (fec);
+		return FALSE;
 	}
 
-	if (child != NULL) {
-		for_each_child_set_current (fec, child);
-		for_each_child_start (fec);
-	}
-	else
-		for_each_child_done (fec);
+	return TRUE;
 }
 
 
 static void
-for_each_child_close_enumerator (GObject      *source_object,
-				 GAsyncResult *result,
-		      		 gpointer      user_data)
+for_each_child_read_next_files (VisitData *visit)
 {
-	ForEachChildData *fec = user_data;
-	GError           *error = NULL;
+	visit->pending_op = TRUE;
+	visit->fec->n_pending_ops++;
+	g_file_enumerator_next_files_async (visit->enumerator,
+					    N_FILES_PER_REQUEST,
+					    G_PRIORITY_DEFAULT,
+					    visit->fec->cancellable,
+					    for_each_child_next_files_ready,
+					    visit);
+}
+
+
+static void
+for_each_child_start_visit (ForEachChildData *fec,
+			    VisitData        *visit)
+{
+	visit->started = TRUE;
+	visit->pending_op = TRUE;
+	fec->n_active++;
+	fec->n_pending_ops++;
+	g_file_enumerate_children_async (visit->dir->file,
+					 fec->attributes,
+					 fec->follow_links ? G_FILE_QUERY_INFO_NONE : G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+					 G_PRIORITY_DEFAULT,
+					 fec->cancellable,
+					 for_each_child_enumerate_ready,
+					 visit);
+}
 
-	if (! g_file_enumerator_close_finish (fec->enumerator,
-					      result,
-					      &error))
+
+/* keep up to FOR_EACH_CHILD_MAX_ACTIVE_DIRS directories enumerating, in
+ * visiting order.  Without GTH_LIST_PARALLEL a directory is enumerated only
+ * when it's its turn. */
+static void
+for_each_child_fill_active_dirs (ForEachChildData *fec)
+{
+	GList *scan;
+
+	if (! fec->parallel)
+		return;
+
+	for (scan = fec->to_visit;
+	     (scan != NULL) && (fec->n_active < FOR_EACH_CHILD_MAX_ACTIVE_DIRS);
+	     scan = scan->next)
 	{
-		if (fec->error == NULL)
-			fec->error = g_error_copy (error);
+		VisitData *visit = scan->data;
+
+		if (! visit->started)
+			for_each_child_start_visit (fec, visit);
+	}
+}
+
+
+static void
+for_each_child_close_ready (GObject      *source_object,
+			    GAsyncResult *result,
+			    gpointer      user_data)
+{
+	VisitData *visit = user_data;
+	GError    *error = NULL;
+
+	if (! g_file_enumerator_close_finish (G_FILE_ENUMERATOR (source_object), result, &error)) {
+		if (visit->error == NULL)
+			visit->error = error;
 		else
 			g_clear_error (&error);
 	}
 
-	if ((fec->error == NULL) && fec->recursive)
-		for_each_child_start_next_sub_directory (fec);
-	else
-		for_each_child_done (fec);
+	if (! for_each_child_visit_op_finished (visit))
+		return;
+
+	visit->completed = TRUE;
+	for_each_child_visit_ready (visit->fec, visit);
 }
 
 
-static void for_each_child_next_files_ready (GObject      *source_object,
-					     GAsyncResult *result,
-					     gpointer      user_data);
+static void
+for_each_child_next_files_ready (GObject      *source_object,
+				 GAsyncResult *result,
+				 gpointer      user_data)
+{
+	VisitData *visit = user_data;
+	GList     *children;
+	GList     *scan;
+
+	children = g_file_enumerator_next_files_finish (visit->enumerator,
+							result,
+							&(visit->error));
+
+	if (! for_each_child_visit_op_finished (visit)) {
+		_g_object_list_unref (children);
+		return;
+	}
+
+	if (children == NULL) {
+		visit->pending_op = TRUE;
+		visit->fec->n_pending_ops++;
+		g_file_enumerator_close_async (visit->enumerator,
+					       G_PRIORITY_DEFAULT,
+					       visit->fec->cancellable,
+					       for_each_child_close_ready,
+					       visit);
+		return;
+	}
+
+	for (scan = children; scan; scan = scan->next)
+		g_queue_push_tail (visit->children, scan->data);
+	g_list_free (children);
+
+	/* read ahead until the buffer is full, the delivery resumes the
+	 * enumeration when the buffer is consumed. */
+
+	if (g_queue_get_length (visit->children) < FOR_EACH_CHILD_MAX_BUFFERED_CHILDREN)
+		for_each_child_read_next_files (visit);
+	else
+		visit->paused = TRUE;
+
+	for_each_child_visit_ready (visit->fec, visit);
+}
 
 
 static void
-for_each_child_read_next_files (ForEachChildData *fec)
+for_each_child_enumerate_ready (GObject      *source_object,
+				GAsyncResult *result,
+				gpointer      user_data)
 {
-	_g_object_list_unref (fec->children);
-	fec->children = NULL;
-	g_file_enumerator_next_files_async (fec->enumerator,
-					    N_FILES_PER_REQUEST,
-					    G_PRIORITY_DEFAULT,
-					    fec->cancellable,
-					    for_each_child_next_files_ready,
-					    fec);
-}
+	VisitData *visit = user_data;
+
+	visit->enumerator = g_file_enumerate_children_finish (G_FILE (source_object), result, &(visit->error));
 
+	if (! for_each_child_visit_op_finished (visit))
+		return;
+
+	if (visit->enumerator == NULL) {
+		visit->completed = TRUE;
+		for_each_child_visit_ready (visit->fec, visit);
+		return;
+	}
 
-static void for_each_child_read_current_child_metadata (ForEachChildData *fec);
+	for_each_child_read_next_files (visit);
+}
 
 
 static void
-for_each_child_read_next_child_metadata (ForEachChildData *fec)
+for_each_child_add_dir (ForEachChildData *fec,
+			GFile            *file,
+			GFileInfo        *info)
 {
-	fec->current_child = fec->current_child->next;
-	if (fec->current_child != NULL)
-		for_each_child_read_current_child_metadata (fec);
-	else
-		for_each_child_read_next_files (fec);
+	fec->to_visit = g_list_append (fec->to_visit, visit_data_new (fec, child_data_new (file, info)));
+	for_each_child_fill_active_dirs (fec);
 }
 
 
@@ -341,7 +520,12 @@ for_each_child_compute_child (ForEachChildData *fec,
 			      GFile            *file,
 			      GFileInfo        *info)
 {
-	if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+	if (fec->no_backup_files && g_file_info_get_is_backup (info))
+		return;
+	if (fec->no_hidden_files && g_file_info_get_is_hidden (info))
+		return;
+
+	if (fec->recursive && (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)) {
 		char *id;
 
 		/* avoid to visit a directory more than ones */
@@ -352,7 +536,7 @@ for_each_child_compute_child (ForEachChildData *fec,
 
 		if (g_hash_table_lookup (fec->already_visited, id) == NULL) {
 			g_hash_table_insert (fec->already_visited, g_strdup (id), GINT_TO_POINTER (1));
-			fec->to_visit = g_list_append (fec->to_visit, child_data_new (file, info));
+			for_each_child_add_dir (fec, file, info);
 		}
 
 		g_free (id);
@@ -362,6 +546,9 @@ for_each_child_compute_child (ForEachChildData *fec,
 }
 
 
+static void for_each_child_deliver_children (ForEachChildData *fec);
+
+
 static void
 for_each_child_metadata_ready_func (GObject      *source_object,
                 		    GAsyncResult *result,
@@ -377,19 +564,19 @@ for_each_child_metadata_ready_func (GObject      *source_object,
 		for_each_child_compute_child (fec, child_data->file, child_data->info);
 	}
 
-	for_each_child_read_next_child_metadata (fec);
+	for_each_child_deliver_children (fec);
 }
 
 
 static void
-for_each_child_read_current_child_metadata (ForEachChildData *fec)
+for_each_child_read_child_metadata (ForEachChildData *fec,
+				    GFileInfo        *child_info)
 {
-	GFileInfo   *child_info = fec->current_child->data;
 	GFile       *child_file;
 	GList       *file_list;
 	GthFileData *child_data;
 
-	child_file = g_file_get_child (fec->current->file, g_file_info_get_name (child_info));
+	child_file = g_file_get_child (fec->current->dir->file, g_file_info_get_name (child_info));
 	child_data = gth_file_data_new (child_file, child_info);
 	file_list = g_list_append (NULL, child_data);
 	_g_query_metadata_async  (file_list,
@@ -403,96 +590,123 @@ for_each_child_read_current_child_metadata (ForEachChildData *fec)
 }
 
 
+static void for_each_child_deliver_next_dir (ForEachChildData *fec);
+
+
 static void
-for_each_child_next_files_ready (GObject      *source_object,
-				 GAsyncResult *result,
-				 gpointer      user_data)
+for_each_child_current_dir_delivered (ForEachChildData *fec)
 {
-	ForEachChildData *fec = user_data;
+	VisitData *visit = fec->current;
 
-	fec->children = g_file_enumerator_next_files_finish (fec->enumerator,
-							     result,
-							     &(fec->error));
+	fec->current = NULL;
+	fec->n_active--;
 
-	if (fec->children == NULL) {
-		g_file_enumerator_close_async (fec->enumerator,
-					       G_PRIORITY_DEFAULT,
-					       fec->cancellable,
-					       for_each_child_close_enumerator,
-					       fec);
+	if (visit->error != NULL) {
+		fec->error = visit->error;
+		visit->error = NULL;
+		visit_data_free (visit);
+		for_each_child_stop (fec);
 		return;
 	}
 
-	if (fec->metadata_attributes) {
-		fec->current_child = fec->children;
-		for_each_child_read_current_child_metadata (fec);
-	}
-	else {
-		GList *scan;
+	visit_data_free (visit);
+	for_each_child_fill_active_dirs (fec);
+	for_each_child_deliver_next_dir (fec);
+}
 
-		for (scan = fec->children; scan; scan = scan->next) {
-			GFileInfo *child_info = scan->data;
-			GFile     *child_file;
 
-			child_file = g_file_get_child (fec->current->file, g_file_info_get_name (child_info));
+static void
+for_each_child_deliver_children (ForEachChildData *fec)
+{
+	VisitData *visit = fec->current;
+	GFileInfo *child_info;
+
+	while ((child_info = g_queue_pop_head (visit->children)) != NULL) {
+		if (visit->paused && (g_queue_get_length (visit->children) < N_FILES_PER_REQUEST)) {
+			visit->paused = FALSE;
+			for_each_child_read_next_files (visit);
+		}
+
+		if (fec->metadata_attributes) {
+			for_each_child_read_child_metadata (fec, child_info);
+			g_object_unref (child_info);
+			return;
+		}
+		else {
+			GFile *child_file;
+
+			child_file = g_file_get_child (visit->dir->file, g_file_info_get_name (child_info));
 			for_each_child_compute_child (fec, child_file, child_info);
 
 			g_object_unref (child_file);
+			g_object_unref (child_info);
 		}
-
-		for_each_child_read_next_files (fec);
 	}
+
+	if (visit->completed)
+		for_each_child_current_dir_delivered (fec);
+	else
+		fec->waiting = TRUE;
 }
 
 
+/* the directories are delivered in visiting order, start_dir_func is called
+ * for a directory just before its files, as for the sequential visit. */
 static void
-for_each_child_ready (GObject      *source_object,
-		      GAsyncResult *result,
-		      gpointer      user_data)
-{
-	ForEachChildData *fec = user_data;
+for_each_child_deliver_next_dir (ForEachChildData *fec)
+{
+	while (fec->to_visit != NULL) {
+		VisitData *visit;
+
+		visit = fec->to_visit->data;
+		fec->to_visit = g_list_remove (fec->to_visit, visit);
+
+		if (fec->start_dir_func != NULL) {
+			DirOp op;
+
+			op = fec->start_dir_func (visit->dir->file, visit->dir->info, &(fec->error), fec->user_data);
+			switch (op) {
+			case DIR_OP_SKIP:
+				for_each_child_discard_visit (fec, visit);
+				for_each_child_fill_active_dirs (fec);
+				continue;
+			case DIR_OP_STOP:
+				for_each_child_discard_visit (fec, visit);
+				for_each_child_stop (fec);
+				return;
+			case DIR_OP_CONTINUE:
+				break;
+			}
+		}
 
-	fec->enumerator = g_file_enumerate_children_finish (G_FILE (source_object), result, &(fec->error));
-	if (fec->enumerator == NULL) {
-		for_each_child_done (fec);
+		fec->current = visit;
+		if (! visit->started) {
+			for_each_child_start_visit (fec, visit);
+			fec->waiting = TRUE;
+			return;
+		}
+
+		for_each_child_deliver_children (fec);
 		return;
 	}
 
-	g_file_enumerator_next_files_async (fec->enumerator,
-					    N_FILES_PER_REQUEST,
-					    G_PRIORITY_DEFAULT,
-					    fec->cancellable,
-					    for_each_child_next_files_ready,
-					    fec);
+	fec->finished = TRUE;
+	for_each_child_check_done (fec);
 }
 
 
 static void
-for_each_child_start_current (ForEachChildData *fec)
+for_each_child_visit_ready (ForEachChildData *fec,
+			    VisitData        *visit)
 {
-	if (fec->start_dir_func != NULL) {
-		DirOp  op;
+	/* the other directories are read ahead, they are delivered when it's
+	 * their turn */
 
-		op = fec->start_dir_func (fec->current->file, fec->current->info, &(fec->error), fec->user_data);
-		switch (op) {
-		case DIR_OP_SKIP:
-			for_each_child_start_next_sub_directory (fec);
-			return;
-		case DIR_OP_STOP:
-			for_each_child_done (fec);
-			return;
-		case DIR_OP_CONTINUE:
-			break;
-		}
-	}
+	if (! fec->waiting || (fec->current != visit))
+		return;
 
-	g_file_enumerate_children_async (fec->current->file,
-					 fec->attributes,
-					 fec->follow_links ? G_FILE_QUERY_INFO_NONE : G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-					 G_PRIORITY_DEFAULT,
-					 fec->cancellable,
-					 for_each_child_ready,
-					 fec);
+	fec->waiting = FALSE;
+	for_each_child_deliver_children (fec);
 }
 
 
@@ -503,7 +717,6 @@ directory_info_ready_cb (GObject      *source_object,
 {
 	ForEachChildData *fec = user_data;
 	GFileInfo        *info;
-	ChildData        *child;
 
 	info = g_file_query_info_finish (G_FILE (source_object), result, &(fec->error));
 	if (info == NULL) {
@@ -511,19 +724,17 @@ directory_info_ready_cb (GObject      *source_object,
 		return;
 	}
 
-	child = child_data_new (fec->base_directory, info);
+	for_each_child_add_dir (fec, fec->base_directory, info);
 	g_object_unref (info);
 
-	for_each_child_set_current (fec, child);
-	for_each_child_start_current (fec);
+	for_each_child_deliver_next_dir (fec);
 }
 
 
 /**
- * g_directory_foreach_child:
+ * g_directory_foreach_child_full:
  * @directory: The directory to visit.
- * @recursive: Whether to traverse the @directory recursively.
- * @follow_links: Whether to dereference the symbolic links.
+ * @flags: The traversing options.
  * @attributes: The GFileInfo attributes to read.
  * @cancellable: An optional @GCancellable object, used to cancel the process.
  * @start_dir_func: the function called for each sub-directory, or %NULL if
@@ -533,26 +744,29 @@ directory_info_ready_cb (GObject      *source_object,
  *   Can't be %NULL.
  * @user_data: data to pass to @done_func
  *
- * Traverse the @directory's filesystem structure calling the
- * @for_each_file_func function for each file in the directory; the
- * @start_dir_func function on each directory before it's going to be
- * traversed, this includes @directory too; the @done_func function is
- * called at the end of the process.
- * Some traversing options are available: if @recursive is TRUE the
- * directory is traversed recursively; if @follow_links is TRUE, symbolic
- * links are dereferenced, otherwise they are returned as links.
- * Each callback uses the same @user_data additional parameter.
+ * Like g_directory_foreach_child() but the traversing options are specified
+ * with @flags: %GTH_LIST_RECURSIVE to traverse the @directory recursively;
+ * %GTH_LIST_NO_FOLLOW_LINKS to return the symbolic links as links;
+ * %GTH_LIST_NO_HIDDEN_FILES and %GTH_LIST_NO_BACKUP_FILES to ignore the
+ * hidden and the backup files, the ignored directories are not traversed;
+ * %GTH_LIST_PARALLEL to enumerate some directories at the same time.
+ * The directories are visited breadth-first, in enumeration order, and
+ * @start_dir_func is called for a directory just before its files are
+ * passed to @for_each_file_func, with or without %GTH_LIST_PARALLEL.
+ * Without %GTH_LIST_PARALLEL a directory is enumerated only if
+ * @start_dir_func doesn't skip it, with %GTH_LIST_PARALLEL the next
+ * directories are read ahead meanwhile, and the work done for the skipped
+ * ones is discarded.
  */
 void
-g_directory_foreach_child (GFile                *directory,
-			   gboolean              recursive,
-			   gboolean              follow_links,
-			   const char           *attributes,
-			   GCancellable         *cancellable,
-			   StartDirCallback      start_dir_func,
-			   ForEachChildCallback  for_each_file_func,
-			   ReadyFunc             done_func,
-			   gpointer              user_data)
+g_directory_foreach_child_full (GFile                *directory,
+				GthListFlags          flags,
+				const char           *attributes,
+				GCancellable         *cancellable,
+				StartDirCallback      start_dir_func,
+				ForEachChildCallback  for_each_file_func,
+				ReadyFunc             done_func,
+				gpointer              user_data)
 {
 	ForEachChildData *fec;
 
@@ -561,9 +775,16 @@ g_directory_foreach_child (GFile                *directory,
 	fec = g_new0 (ForEachChildData, 1);
 
 	fec->base_directory = g_file_dup (directory);
-	fec->recursive = recursive;
-	fec->follow_links = follow_links;
-	fec->attributes = g_strconcat (attributes, ",standard::name,standard::type,id::file", NULL);
+	fec->recursive = (flags & GTH_LIST_RECURSIVE) != 0;
+	fec->follow_links = (flags & GTH_LIST_NO_FOLLOW_LINKS) == 0;
+	fec->no_backup_files = (flags & GTH_LIST_NO_BACKUP_FILES) != 0;
+	fec->no_hidden_files = (flags & GTH_LIST_NO_HIDDEN_FILES) != 0;
+	fec->parallel = (flags & GTH_LIST_PARALLEL) != 0;
+	fec->attributes = g_strconcat (attributes,
+				       ",standard::name,standard::type,id::file",
+				       fec->no_backup_files ? ",standard::is-backup" : "",
+				       fec->no_hidden_files ? ",standard::is-hidden" : "",
+				       NULL);
 	fec->cancellable = _g_object_ref (cancellable);
 	fec->start_dir_func = start_dir_func;
 	fec->for_each_file_func = for_each_file_func;
@@ -585,6 +806,60 @@ g_directory_foreach_child (GFile                *directory,
 }
 
 
+/**
+ * g_directory_foreach_child:
+ * @directory: The directory to visit.
+ * @recursive: Whether to traverse the @directory recursively.
+ * @follow_links: Whether to dereference the symbolic links.
+ * @attributes: The GFileInfo attributes to read.
+ * @cancellable: An optional @GCancellable object, used to cancel the process.
+ * @start_dir_func: the function called for each sub-directory, or %NULL if
+ *   not needed.
+ * @for_each_file_func: the function called for each file.  Can't be %NULL.
+ * @done_func: the function called at the end of the traversing process.
+ *   Can't be %NULL.
+ * @user_data: data to pass to @done_func
+ *
+ * Traverse the @directory's filesystem structure calling the
+ * @for_each_file_func function for each file in the directory; the
+ * @start_dir_func function on each directory before it's going to be
+ * traversed, this includes @directory too; the @done_func function is
+ * called at the end of the process.
+ * Some traversing options are available: if @recursive is TRUE the
+ * directory is traversed recursively; if @follow_links is TRUE, symbolic
+ * links are dereferenced, otherwise they are returned as links.
+ * Each callback uses the same @user_data additional parameter.
+ * The sub-directories are visited breadth-first, in enumeration order.
+ */
+void
+g_directory_foreach_child (GFile                *directory,
+			   gboolean              recursive,
+			   gboolean              follow_links,
+			   const char           *attributes,
+			   GCancellable         *cancellable,
+			   StartDirCallback      start_dir_func,
+			   ForEachChildCallback  for_each_file_func,
+			   ReadyFunc             done_func,
+			   gpointer              user_data)
+{
+	GthListFlags flags = GTH_LIST_DEFAULT;
+
+	if (recursive)
+		flags |= GTH_LIST_RECURSIVE;
+	if (! follow_links)
+		flags |= GTH_LIST_NO_FOLLOW_LINKS;
+
+	g_directory_foreach_child_full (directory,
+					flags,
+					attributes,
+					cancellable,
+					start_dir_func,
+					for_each_file_func,
+					done_func,
+					user_data);
+}
+
+
 /* -- get_file_list_data -- */
 
 
@@ -975,15 +1250,14 @@ query_data_info_ready_cb (GObject      *source_object,
 	}
 
 	if ((query_data->flags & GTH_LIST_RECURSIVE) && (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)) {
-		g_directory_foreach_child ((GFile *) query_data->current->data,
-					   TRUE,
-					   (query_data->flags & GTH_LIST_NO_FOLLOW_LINKS) == 0,
-					   query_data->attributes,
-					   query_data->cancellable,
-					   query_data__start_dir_cb,
-					   query_data__for_each_file_cb,
-					   query_data__done_cb,
-					   query_data);
+		g_directory_foreach_child_full ((GFile *) query_data->current->data,
+						query_data->flags | GTH_LIST_PARALLEL,
+						query_data->attributes,
+						query_data->cancellable,
+						query_data__start_dir_cb,
+						query_data__for_each_file_cb,
+						query_data__done_cb,
+						query_data);
 	}
 	else {
 		query_data->files = g_list_prepend (query_data->files, gth_file_data_new ((GFile *) query_data->current->data, info));
@@ -1108,6 +1382,9 @@ typedef struct {
 	gpointer              dialog_callback_data;
 	CopyReadyCallback     ready_callback;
 	gpointer              user_data;
+	GFileProgressCallback file_progress_callback;
+	gpointer              file_progress_data;
+	gboolean              defer_overwrite;
 
 	GFile                *current_destination;
 	char                 *message;
@@ -1284,7 +1561,9 @@ copy_file_ready_cb (GObject      *source_object,
 
 	if (! g_file_copy_finish ((GFile *) source_object, result, &error)) {
 		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_EXISTS)) {
-			if (copy_file_data->default_response != GTH_OVERWRITE_RESPONSE_ALWAYS_NO) {
+			if ((copy_file_data->default_response != GTH_OVERWRITE_RESPONSE_ALWAYS_NO)
+			    && ! copy_file_data->defer_overwrite)
+			{
 				GtkWidget *dialog;
 
 				dialog = gth_overwrite_dialog_new (copy_file_data->source->file,
@@ -1342,6 +1621,11 @@ copy_file_progress_cb (goffset  current_num_bytes,
 	char         *s2;
 	char         *details;
 
+	if (copy_file_data->file_progress_callback != NULL) {
+		copy_file_data->file_progress_callback (current_num_bytes, total_num_bytes, copy_file_data->file_progress_data);
+		return;
+	}
+
 	if (copy_file_data->progress_callback == NULL)
 		return;
 
@@ -1432,6 +1716,9 @@ _g_copy_file_async_private (GthFileData           *source,
 			    gpointer               progress_callback_data,
 			    DialogCallback         dialog_callback,
 			    gpointer               dialog_callback_data,
+			    GFileProgressCallback  file_progress_callback,
+			    gpointer               file_progress_data,
+			    gboolean               defer_overwrite,
 			    CopyReadyCallback      ready_callback,
 			    gpointer               user_data)
 {
@@ -1451,6 +1738,9 @@ _g_copy_file_async_private (GthFileData           *source,
 	copy_file_data->progress_callback_data = progress_callback_data;
 	copy_file_data->dialog_callback = dialog_callback;
 	copy_file_data->dialog_callback_data = dialog_callback_data;
+	copy_file_data->file_progress_callback = file_progress_callback;
+	copy_file_data->file_progress_data = file_progress_data;
+	copy_file_data->defer_overwrite = defer_overwrite;
 	copy_file_data->ready_callback = ready_callback;
 	copy_file_data->user_data = user_data;
 	copy_file_data->default_response = default_response;
@@ -1488,6 +1778,9 @@ _g_copy_file_async (GthFileData           *source,
 				    progress_callback_data,
 				    dialog_callback,
 				    dialog_callback_data,
+				    NULL,
+				    NULL,
+				    FALSE,
 				    ready_callback,
 				    user_data);
 }
@@ -1496,24 +1789,45 @@ _g_copy_file_async (GthFileData           *source,
 /* -- _g_copy_files_async -- */
 
 
+/* maximum number of files copied at the same time, depending on the
+ * destination device */
+#define COPY_FILES_MAX_LOCAL_COPIES 4
+#define COPY_FILES_MAX_REMOTE_COPIES 2
+
+
+typedef struct _CopyData CopyData;
+
+
 typedef struct {
+	CopyData             *copy_data;
+	GthFileData          *source;
+	GFile                *destination;
+	gboolean              explicitly_requested;
+	gboolean              defer_overwrite;
+	goffset               copied_size;
+} CopyTask;
+
+
+struct _CopyData {
 	GHashTable           *source_hash;
 	GFile                *destination;
 
 	GList                *files;  /* GthFileData list */
 	GList                *current;
+	GList                *conflicts;  /* CopyTask list */
 	GList                *copied_directories; /* GFile list */
 	GFile                *source_base;
-	GFile                *current_destination;
 
-	GList                *source_sidecars;  /* GFile list */
-	GList                *destination_sidecars;  /* GFile list */
-	GList                *current_source_sidecar;
-	GList                *current_destination_sidecar;
+	int                   n_running;
+	int                   max_running;
+	gboolean              starting;
+	GError               *error;
 
 	goffset               tot_size;
 	goffset               copied_size;
+	goffset               running_size;
 	gsize                 tot_files;
+	gint64                start_time;
 
 	char                 *message;
 	GthOverwriteResponse  default_response;
@@ -1528,16 +1842,23 @@ typedef struct {
 	gpointer              dialog_callback_data;
 	ReadyFunc             done_callback;
 	gpointer              user_data;
-} CopyData;
+};
+
+
+static void
+copy_task_free (CopyTask *task)
+{
+	g_object_unref (task->source);
+	g_object_unref (task->destination);
+	g_free (task);
+}
 
 
 static void
 copy_data_free (CopyData *copy_data)
 {
 	g_free (copy_data->message);
-	_g_object_list_unref (copy_data->destination_sidecars);
-	_g_object_list_unref (copy_data->source_sidecars);
-	_g_object_unref (copy_data->current_destination);
+	g_list_free_full (copy_data->conflicts, (GDestroyNotify) copy_task_free);
 	_g_object_list_unref (copy_data->copied_directories);
 	_g_object_list_unref (copy_data->files);
 	_g_object_unref (copy_data->source_base);
@@ -1557,45 +1878,204 @@ copy_data__done (CopyData *copy_data,
 }
 
 
-static void copy_data__copy_current_file (CopyData *copy_data);
+static void
+copy_data__update_progress (CopyData *copy_data)
+{
+	goffset  copied_size;
+	gint64   elapsed;
+	char    *s1;
+	char    *s2;
+	char    *s3;
+	char    *details;
+
+	if (copy_data->progress_callback == NULL)
+		return;
+
+	copied_size = copy_data->copied_size + copy_data->running_size;
+	s1 = g_format_size (copied_size);
+	s2 = g_format_size (copy_data->tot_size);
+	elapsed = g_get_monotonic_time () - copy_data->start_time;
+	if (elapsed >= G_USEC_PER_SEC) {
+		s3 = g_format_size ((guint64) ((double) copied_size * G_USEC_PER_SEC / elapsed));
+		/* For translators: This is a progress size indicator followed by the transfer speed, for example: 230.4 MB of 512.8 MB (12.5 MB/s) */
+		details = g_strdup_printf (_("%s of %s (%s/s)"), s1, s2, s3);
+		g_free (s3);
+	}
+	else
+		/* For translators: This is a progress size indicator, for example: 230.4 MB of 512.8 MB */
+		details = g_strdup_printf (_("%s of %s"), s1, s2);
+
+	copy_data->progress_callback (NULL,
+				      copy_data->message,
+				      details,
+				      FALSE,
+				      (copy_data->tot_size > 0) ? (double) copied_size / copy_data->tot_size : 0.0,
+				      copy_data->progress_callback_data);
+
+	g_free (details);
+	g_free (s2);
+	g_free (s1);
+}
 
 
 static void
-copy_data__copy_next_file (CopyData *copy_data)
+copy_task_progress_cb (goffset  current_num_bytes,
+		       goffset  total_num_bytes,
+		       gpointer user_data)
 {
-	GthFileData *source = (GthFileData *) copy_data->current->data;
+	CopyTask *task = user_data;
+	CopyData *copy_data = task->copy_data;
 
-	copy_data->copied_size += g_file_info_get_size (source->info);
-	copy_data->current = copy_data->current->next;
-	copy_data__copy_current_file (copy_data);
+	copy_data->running_size += current_num_bytes - task->copied_size;
+	task->copied_size = current_num_bytes;
+	copy_data__update_progress (copy_data);
 }
 
 
+static void copy_data__start_copies (CopyData *copy_data);
+
+
 static void
-copy_data__copy_current_file_ready_cb (GthOverwriteResponse  response,
-				       GError               *error,
-			 	       gpointer              user_data)
+copy_task_ready_cb (GthOverwriteResponse  response,
+		    GError               *error,
+		    gpointer              user_data)
 {
-	CopyData *copy_data = user_data;
+	CopyTask *task = user_data;
+	CopyData *copy_data = task->copy_data;
+	gboolean  retry = FALSE;
+
+	copy_data->n_running--;
+	copy_data->running_size -= task->copied_size;
+	task->copied_size = 0;
+	copy_data->default_response = response;
 
 	if (error == NULL) {
 		/* save the correctly copied directories in order to delete
 		 * them after moving their content. */
-		if (copy_data->move) {
-			GthFileData *source;
-
-			source = (GthFileData *) copy_data->current->data;
-			if (g_file_info_get_file_type (source->info) == G_FILE_TYPE_DIRECTORY)
-				copy_data->copied_directories = g_list_prepend (copy_data->copied_directories, g_file_dup (source->file));
-		}
+		if (copy_data->move && (g_file_info_get_file_type (task->source->info) == G_FILE_TYPE_DIRECTORY))
+			copy_data->copied_directories = g_list_prepend (copy_data->copied_directories, g_file_dup (task->source->file));
+		copy_data->copied_size += g_file_info_get_size (task->source->info);
+	}
+	else if (task->defer_overwrite
+		 && (response != GTH_OVERWRITE_RESPONSE_ALWAYS_NO)
+		 && g_error_matches (error, G_IO_ERROR, G_IO_ERROR_EXISTS))
+	{
+		/* ask the user what to do when the other copies are done */
+		retry = TRUE;
+		g_clear_error (&error);
+	}
+	else if (! task->explicitly_requested && g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND)) {
+		/* already moved as the metadata of another file, see
+		 * copy_data__start_task */
+		copy_data->copied_size += g_file_info_get_size (task->source->info);
+		g_clear_error (&error);
 	}
 	else if ((response == GTH_OVERWRITE_RESPONSE_ALWAYS_NO) || ! g_error_matches (error, G_IO_ERROR, G_IO_ERROR_EXISTS)) {
-		copy_data__done (copy_data, error);
-		return;
+		if (copy_data->error == NULL)
+			copy_data->error = error;
+		else
+			g_clear_error (&error);
 	}
+	else
+		copy_data->copied_size += g_file_info_get_size (task->source->info);
 
-	copy_data->default_response = response;
-	copy_data__copy_next_file (copy_data);
+	if (retry) {
+		task->defer_overwrite = FALSE;
+		copy_data->conflicts = g_list_append (copy_data->conflicts, task);
+	}
+	else
+		copy_task_free (task);
+
+	copy_data__update_progress (copy_data);
+
+	if (! copy_data->starting)
+		copy_data__start_copies (copy_data);
+}
+
+
+/* returns FALSE if the file doesn't need to be copied */
+static gboolean
+copy_data__start_task (CopyData *copy_data,
+		       CopyTask *task)
+{
+	/* Ignore non-existent files that weren't explicitly requested,
+	 * they are children of some requested directory and if they don't
+	 * exist anymore they have been already moved to the destination
+	 * because they are metadata of other files. */
+	if (! task->explicitly_requested) {
+		if (! g_file_query_exists (task->source->file, copy_data->cancellable))
+			return FALSE;
+	}
+
+	if (g_file_equal (task->source->file, task->destination))
+		return FALSE;
+
+	if (copy_data->progress_callback != NULL) {
+		GFile *destination_parent;
+		char  *destination_name;
+
+		g_free (copy_data->message);
+
+		destination_parent = g_file_get_parent (task->destination);
+		destination_name = g_file_get_parse_name (destination_parent);
+		if (copy_data->move)
+			copy_data->message = g_strdup_printf (_("Moving \"%s\" to \"%s\""), g_file_info_get_display_name (task->source->info), destination_name);
+		else
+			copy_data->message = g_strdup_printf (_("Copying \"%s\" to \"%s\""), g_file_info_get_display_name (task->source->info), destination_name);
+		copy_data__update_progress (copy_data);
+
+		g_free (destination_name);
+		g_object_unref (destination_parent);
+	}
+
+	copy_data->n_running++;
+	_g_copy_file_async_private (task->source,
+				    task->destination,
+				    copy_data->move,
+				    copy_data->flags,
+				    copy_data->default_response,
+				    copy_data->io_priority,
+				    copy_data->tot_size,
+				    copy_data->copied_size,
+				    copy_data->tot_files,
+				    copy_data->cancellable,
+				    NULL,
+				    NULL,
+				    copy_data->dialog_callback,
+				    copy_data->dialog_callback_data,
+				    copy_task_progress_cb,
+				    task,
+				    task->defer_overwrite,
+				    copy_task_ready_cb,
+				    task);
+
+	return TRUE;
+}
+
+
+static CopyTask *
+copy_data__get_next_task (CopyData *copy_data)
+{
+	GthFileData *source;
+	CopyTask    *task;
+
+	source = (GthFileData *) copy_data->current->data;
+	copy_data->current = copy_data->current->next;
+
+	task = g_new0 (CopyTask, 1);
+	task->copy_data = copy_data;
+	task->source = g_object_ref (source);
+	task->explicitly_requested = (g_hash_table_lookup (copy_data->source_hash, source->file) != NULL);
+	task->defer_overwrite = TRUE;
+
+	/* compute the destination */
+	if (task->explicitly_requested) {
+		_g_object_unref (copy_data->source_base);
+		copy_data->source_base = g_file_get_parent (source->file);
+	}
+	task->destination = _g_file_get_destination (source->file, copy_data->source_base, copy_data->destination);
+
+	return task;
 }
 
 
@@ -1619,63 +2099,58 @@ copy_data__delete_source_directories (CopyData *copy_data)
 }
 
 
+/* Keeps up to max_running files copying at the same time, in list order.
+ * The files that already exist in the destination are copied again at the
+ * end, one at a time, asking the user what to do. */
 static void
-copy_data__copy_current_file (CopyData *copy_data)
+copy_data__start_copies (CopyData *copy_data)
 {
-	GthFileData *source;
-	gboolean     explicitly_requested;
-	GFile       *destination;
+	copy_data->starting = TRUE;
 
-	if (copy_data->current == NULL) {
-		copy_data__delete_source_directories (copy_data);
-		return;
-	}
+	while ((copy_data->error == NULL) && (copy_data->n_running < copy_data->max_running)) {
+		CopyTask *task;
+		gboolean  defer_overwrite;
 
-	source = (GthFileData *) copy_data->current->data;
-	explicitly_requested = (g_hash_table_lookup (copy_data->source_hash, source->file) != NULL);
+		if (copy_data->current != NULL) {
+			task = copy_data__get_next_task (copy_data);
+		}
+		else if ((copy_data->conflicts != NULL) && (copy_data->n_running == 0)) {
+			task = (CopyTask *) copy_data->conflicts->data;
+			copy_data->conflicts = g_list_delete_link (copy_data->conflicts, copy_data->conflicts);
+		}
+		else
+			break;
 
-	/* Ignore non-existent files that weren't explicitly requested,
-	 * they are children of some requested directory and if they don't
-	 * exist anymore they have been already moved to the destination
-	 * because they are metadata of other files. */
-	if (! explicitly_requested) {
-		if (! g_file_query_exists (source->file, copy_data->cancellable)) {
-			call_when_idle ((DataFunc) copy_data__copy_next_file, copy_data);
-			return;
+		/* the task can be completed and freed before
+		 * copy_data__start_task returns, for example when the source
+		 * is a directory. */
+		defer_overwrite = task->defer_overwrite;
+
+		if (! copy_data__start_task (copy_data, task)) {
+			copy_data->copied_size += g_file_info_get_size (task->source->info);
+			copy_task_free (task);
+			continue;
 		}
-	}
 
-	/* compute the destination */
-	if (explicitly_requested) {
-		_g_object_unref (copy_data->source_base);
-		copy_data->source_base = g_file_get_parent (source->file);
+		if (! defer_overwrite)
+			break;
 	}
-	destination = _g_file_get_destination (source->file, copy_data->source_base, copy_data->destination);
 
-	if (g_file_equal (source->file, destination)) {
-		g_object_unref (destination);
-		call_when_idle ((DataFunc) copy_data__copy_next_file, copy_data);
+	copy_data->starting = FALSE;
+
+	if (copy_data->n_running > 0)
 		return;
-	}
 
-	_g_copy_file_async_private (source,
-				    destination,
-				    copy_data->move,
-				    copy_data->flags,
-				    copy_data->default_response,
-				    copy_data->io_priority,
-				    copy_data->tot_size,
-				    copy_data->copied_size,
-				    copy_data->tot_files,
-				    copy_data->cancellable,
-				    copy_data->progress_callback,
-				    copy_data->progress_callback_data,
-				    copy_data->dialog_callback,
-				    copy_data->dialog_callback_data,
-				    copy_data__copy_current_file_ready_cb,
-				    copy_data);
+	if (copy_data->error != NULL) {
+		copy_data__done (copy_data, copy_data->error);
+		return;
+	}
 
-	g_object_unref (destination);
+	if ((copy_data->current == NULL) && (copy_data->conflicts == NULL))
+		copy_data__delete_source_directories (copy_data);
+	else
+		/* a task has been completed while starting the others */
+		call_when_idle ((DataFunc) copy_data__start_copies, copy_data);
 }
 
 
@@ -1703,8 +2178,10 @@ copy_files__sources_info_ready_cb (GList    *files,
 	}
 
 	copy_data->copied_size = 0;
+	copy_data->running_size = 0;
+	copy_data->start_time = g_get_monotonic_time ();
 	copy_data->current = copy_data->files;
-	copy_data__copy_current_file (copy_data);
+	copy_data__start_copies (copy_data);
 }
 
 
@@ -1739,6 +2216,7 @@ _g_copy_files_async (GList                *sources, /* GFile list */
 	copy_data->done_callback = done_callback;
 	copy_data->user_data = user_data;
 	copy_data->default_response = default_response;
+	copy_data->max_running = g_file_is_native (destination) ? COPY_FILES_MAX_LOCAL_COPIES : COPY_FILES_MAX_REMOTE_COPIES;
 
 	/* save the explicitly requested files */
 	copy_data->source_hash = g_hash_table_new_full ((GHashFunc) g_file_hash, (GEqualFunc) g_file_equal, (GDestroyNotify) g_object_unref, NULL);
@@ -2111,12 +2589,15 @@ typedef struct {
 	gsize                count;
 	gsize                written;
 	GError              *error;
+	goffset              file_size;
+	GFileIOStream       *io_stream;
 } WriteData;
 
 
 static void
 write_data_free (WriteData *write_data)
 {
+	_g_object_unref (write_data->io_stream);
 	g_free (write_data->buffer);
 	g_free (write_data);
 }
@@ -2274,6 +2755,133 @@ _g_file_write_async (GFile               *file,
 }
 
 
+/* -- _g_file_append_async -- */
+
+
+/* Moves to the end of the file after checking that the file has the
+ * expected size, otherwise the file was changed by someone else and the
+ * data must not be appended. */
+static gboolean
+_g_file_io_stream_seek_end (GFileIOStream  *io_stream,
+			    GFileInfo      *info,
+			    goffset         file_size,
+			    GCancellable   *cancellable,
+			    GError        **error)
+{
+	if (g_file_info_get_size (info) != file_size) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_WRONG_ETAG, _("The file has been modified"));
+		return FALSE;
+	}
+
+	return g_seekable_seek (G_SEEKABLE (io_stream), 0, G_SEEK_END, cancellable, error);
+}
+
+
+static void
+write_file__append_error (WriteData *write_data,
+			  GError    *error)
+{
+	write_data->callback (&write_data->buffer, write_data->count, error, write_data->user_data);
+	write_data_free (write_data);
+}
+
+
+static void
+write_file__append_info_ready_cb (GObject      *source_object,
+				  GAsyncResult *result,
+				  gpointer      user_data)
+{
+	WriteData     *write_data = user_data;
+	GFileInfo     *info;
+	GError        *error = NULL;
+	GOutputStream *stream;
+
+	info = g_file_io_stream_query_info_finish (write_data->io_stream, result, &error);
+	if ((info == NULL)
+	    || ! _g_file_io_stream_seek_end (write_data->io_stream,
+					     info,
+					     write_data->file_size,
+					     write_data->cancellable,
+					     &error))
+	{
+		_g_object_unref (info);
+		write_file__append_error (write_data, error);
+		return;
+	}
+
+	g_object_unref (info);
+
+	/* the output stream is owned by the io stream, the reference is
+	 * released by write_file__stream_flush_cb */
+
+	stream = g_object_ref (g_io_stream_get_output_stream (G_IO_STREAM (write_data->io_stream)));
+	write_data->written = 0;
+	g_output_stream_write_async (stream,
+				     write_data->buffer,
+				     write_data->count,
+				     write_data->io_priority,
+				     write_data->cancellable,
+				     write_file__stream_write_ready_cb,
+				     write_data);
+}
+
+
+static void
+write_file__append_ready_cb (GObject      *source_object,
+			     GAsyncResult *result,
+			     gpointer      user_data)
+{
+	WriteData *write_data = user_data;
+	GError    *error = NULL;
+
+	write_data->io_stream = g_file_open_readwrite_finish ((GFile*) source_object, result, &error);
+	if (write_data->io_stream == NULL) {
+		write_file__append_error (write_data, error);
+		return;
+	}
+
+	g_file_io_stream_query_info_async (write_data->io_stream,
+					   G_FILE_ATTRIBUTE_STANDARD_SIZE,
+					   write_data->io_priority,
+					   write_data->cancellable,
+					   write_file__append_info_ready_cb,
+					   write_data);
+}
+
+
+/* Writes @buffer at the end of @file if the file exists and its size is
+ * @file_size, otherwise the file is not changed and the callback receives
+ * a G_IO_ERROR_NOT_FOUND or a G_IO_ERROR_WRONG_ETAG error.  Like
+ * _g_file_write_async() @buffer is freed when done. */
+void
+_g_file_append_async (GFile               *file,
+		      goffset              file_size,
+		      void                *buffer,
+		      gsize                count,
+		      int                  io_priority,
+		      GCancellable        *cancellable,
+		      BufferReadyCallback  callback,
+		      gpointer             user_data)
+{
+	WriteData *write_data;
+
+	write_data = g_new0 (WriteData, 1);
+	write_data->buffer = buffer;
+	write_data->count = count;
+	write_data->io_priority = io_priority;
+	write_data->cancellable = cancellable;
+	write_data->callback = callback;
+	write_data->user_data = user_data;
+	write_data->file_size = file_size;
+
+	g_file_open_readwrite_async (file,
+				     io_priority,
+				     cancellable,
+				     write_file__append_ready_cb,
+				     write_data);
+}
+
+
 GFile *
 _g_file_create_unique (GFile       *parent,
 		       const char  *display_name,
@@ -2435,6 +3043,35 @@ _g_file_write (GFile             *file,
 }
 
 
+/* Synchronous version of _g_file_append_async(). */
+gboolean
+_g_file_append (GFile         *file,
+		goffset        file_size,
+		void          *buffer,
+		gsize          count,
+		GCancellable  *cancellable,
+		GError       **error)
+{
+	gboolean       success;
+	GFileIOStream *io_stream;
+	GFileInfo     *info;
+
+	io_stream = g_file_open_readwrite (file, cancellable, error);
+	if (io_stream == NULL)
+		return FALSE;
+
+	info = g_file_io_stream_query_info (io_stream, G_FILE_ATTRIBUTE_STANDARD_SIZE, cancellable, error);
+	success = (info != NULL)
+		  && _g_file_io_stream_seek_end (io_stream, info, file_size, cancellable, error)
+		  && g_output_stream_write_all (g_io_stream_get_output_stream (G_IO_STREAM (io_stream)), buffer, count, NULL, cancellable, error);
+
+	_g_object_unref (info);
+	g_object_unref (io_stream);
+
+	return success;
+}
+
+
 gboolean
 _g_directory_make (GFile    *file,
 		   guint32   unix_mode,
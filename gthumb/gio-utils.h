@@ -43,7 +43,8 @@ typedef enum {
 	GTH_LIST_RECURSIVE = 1 << 0,
 	GTH_LIST_NO_FOLLOW_LINKS = 1 << 1,
 	GTH_LIST_NO_BACKUP_FILES = 1 << 2,
-	GTH_LIST_NO_HIDDEN_FILES = 1 << 3
+	GTH_LIST_NO_HIDDEN_FILES = 1 << 3,
+	GTH_LIST_PARALLEL = 1 << 4
 } GthListFlags;
 
 typedef DirOp (*StartDirCallback)    (GFile                *directory,
@@ -79,6 +80,15 @@ void   g_directory_foreach_child     (GFile                 *directory,
 				      ForEachChildCallback   for_each_file_func,
 				      ReadyFunc              done_func,
 				      gpointer               user_data);
+void   g_directory_foreach_child_full
+				     (GFile                 *directory,
+				      GthListFlags           flags,
+				      const char            *attributes,
+				      GCancellable          *cancellable,
+				      StartDirCallback       start_dir_func,
+				      ForEachChildCallback   for_each_file_func,
+				      ReadyFunc              done_func,
+				      gpointer               user_data);
 void   g_directory_list_async        (GFile                 *directory,
 				      const char            *base_dir,
 				      gboolean               recursive,
@@ -178,6 +188,20 @@ void     _g_file_write_async         (GFile                 *file,
 				      GCancellable          *cancellable,
 				      BufferReadyCallback    callback,
 				      gpointer               user_data);
+gboolean _g_file_append              (GFile                 *file,
+				      goffset                file_size,
+				      void                  *buffer,
+				      gsize                  count,
+				      GCancellable          *cancellable,
+				      GError               **error);
+void     _g_file_append_async        (GFile                 *file,
+				      goffset                file_size,
+				      void                  *buffer,
+		    		      gsize                  count,
+				      int                    io_priority,
+				      GCancellable          *cancellable,
+				      BufferReadyCallback    callback,
+				      gpointer               user_data);
 GFile * _g_file_create_unique        (GFile                 *parent,
 				      const char            *display_name,
 				      const char            *suffix,
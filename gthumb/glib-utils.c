@@ -1404,6 +1404,25 @@ _g_string_array_join (GPtrArray  *array,
 }
 
 
+void
+_g_ptr_array_insert (GPtrArray *array,
+		     int        pos,
+		     gpointer   data)
+{
+	g_return_if_fail (array != NULL);
+
+	if ((pos < 0) || (pos > array->len))
+		pos = array->len;
+
+	g_ptr_array_set_size (array, array->len + 1);
+	if (pos < array->len - 1)
+		memmove (array->pdata + pos + 1,
+			 array->pdata + pos,
+			 (array->len - pos - 1) * sizeof (gpointer));
+	array->pdata[pos] = data;
+}
+
+
 /* Regexp utils */
 
 static char **
@@ -218,6 +218,9 @@ char *          _g_escape_for_html               (const char  *text,
 
 char *          _g_string_array_join             (GPtrArray    *array,
 						  const char   *separator);
+void            _g_ptr_array_insert              (GPtrArray    *array,
+						  int           pos,
+						  gpointer      data);
 
 /* Regexp utils */
 
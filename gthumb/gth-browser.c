@@ -36,10 +36,12 @@
 #include "gth-enum-types.h"
 #include "gth-error.h"
 #include "gth-file-list.h"
+#include "gth-file-source-vfs.h"
 #include "gth-file-view.h"
 #include "gth-file-selection.h"
 #include "gth-filter.h"
 #include "gth-filterbar.h"
+#include "gth-folder-cache.h"
 #include "gth-folder-tree.h"
 #include "gth-grid-view.h"
 #include "gth-icon-cache.h"
@@ -1208,6 +1210,17 @@ typedef struct {
 	GFile         *entry_point;
 	GthFileSource *file_source;
 	GCancellable  *cancellable;
+	gboolean       in_batches;
+	gboolean       files_added;
+	gboolean       batch_error;
+	int            pending_batches;
+	gboolean       list_ready;
+	GList         *loaded_files;
+	GError        *error;
+	const char    *folder_attributes;
+	GList         *cached_files;
+	GList         *new_files;
+	GList         *changed_files;
 } LoadData;
 
 
@@ -1277,6 +1290,12 @@ load_data_free (LoadData *data)
 	_g_object_list_unref (data->list);
 	_g_object_unref (data->entry_point);
 	g_object_unref (data->cancellable);
+	_g_object_list_unref (data->loaded_files);
+	if (data->error != NULL)
+		g_error_free (data->error);
+	_g_object_list_unref (data->cached_files);
+	_g_object_list_unref (data->new_files);
+	_g_object_list_unref (data->changed_files);
 	g_free (data);
 }
 
@@ -1501,6 +1520,7 @@ _gth_browser_get_list_attributes (GthBrowser *browser,
 
 
 static void _gth_browser_load_ready_cb (GthFileSource *file_source, GList *files, GError *error, gpointer user_data);
+static void _gth_browser_load_batch_cb (GthFileSource *file_source, GList *files, GError *error, gpointer user_data);
 
 
 /* -- _gth_browser_set_sort_order -- */
@@ -1597,11 +1617,36 @@ requested_folder_attributes_ready_cb (GObject  *file_source,
 	}
 	_gth_browser_set_sort_order (browser, browser->priv->current_sort_type, browser->priv->current_sort_inverse, FALSE);
 
-	gth_file_source_list (load_data->file_source,
-			      load_data->requested_folder->file,
-			      _gth_browser_get_fast_file_type (browser, load_data->requested_folder->file) ? GFILE_STANDARD_ATTRIBUTES_WITH_FAST_CONTENT_TYPE : GFILE_STANDARD_ATTRIBUTES_WITH_CONTENT_TYPE,
-			      _gth_browser_load_ready_cb,
-			      load_data);
+	load_data->folder_attributes = _gth_browser_get_fast_file_type (browser, load_data->requested_folder->file) ? GFILE_STANDARD_ATTRIBUTES_WITH_FAST_CONTENT_TYPE : GFILE_STANDARD_ATTRIBUTES_WITH_CONTENT_TYPE;
+
+	if (GTH_IS_FILE_SOURCE_VFS (load_data->file_source))
+		load_data->cached_files = gth_folder_cache_load (load_data->requested_folder->file,
+								 load_data->requested_folder->info,
+								 load_data->folder_attributes);
+
+	if (load_data->cached_files != NULL) {
+		/* show the cached listing, then read the folder again, without
+		 * sniffing the content type, to find the differences, see
+		 * load_data_apply_cache_changes */
+
+		_gth_browser_load_batch_cb (load_data->file_source, load_data->cached_files, NULL, load_data);
+		gth_file_source_list (load_data->file_source,
+				      load_data->requested_folder->file,
+				      GFILE_STANDARD_ATTRIBUTES_WITH_FAST_CONTENT_TYPE,
+				      _gth_browser_load_ready_cb,
+				      load_data);
+		return;
+	}
+
+	/* show the files while the folder is being read */
+
+	load_data->in_batches = TRUE;
+	gth_file_source_list_in_batches (load_data->file_source,
+					 load_data->requested_folder->file,
+					 load_data->folder_attributes,
+					 _gth_browser_load_batch_cb,
+					 _gth_browser_load_ready_cb,
+					 load_data);
 }
 
 
@@ -1794,14 +1839,16 @@ load_data_continue (LoadData *load_data,
 	}
 
 	if (changed_current_location) {
-		GthTest *filter;
-
-		filter = _gth_browser_get_file_filter (browser);
-		gth_file_list_set_filter (GTH_FILE_LIST (browser->priv->file_list), filter);
-		gth_file_list_set_files (GTH_FILE_LIST (browser->priv->file_list), files);
-		gth_file_list_set_filter (GTH_FILE_LIST (browser->priv->thumbnail_list), filter);
-		gth_file_list_set_files (GTH_FILE_LIST (browser->priv->thumbnail_list), files);
-		g_object_unref (filter);
+		if (! load_data->files_added || load_data->batch_error) {
+			GthTest *filter;
+
+			filter = _gth_browser_get_file_filter (browser);
+			gth_file_list_set_filter (GTH_FILE_LIST (browser->priv->file_list), filter);
+			gth_file_list_set_files (GTH_FILE_LIST (browser->priv->file_list), files);
+			gth_file_list_set_filter (GTH_FILE_LIST (browser->priv->thumbnail_list), filter);
+			gth_file_list_set_files (GTH_FILE_LIST (browser->priv->thumbnail_list), files);
+			g_object_unref (filter);
+		}
 
 		if (gth_window_get_current_page (GTH_WINDOW (browser)) == GTH_BROWSER_PAGE_BROWSER)
 			gtk_widget_grab_focus (browser->priv->file_list);
@@ -1874,15 +1921,276 @@ metadata_ready_cb (GObject      *source_object,
 }
 
 
+static void
+load_data_save_cache (LoadData *load_data,
+		      GList    *files)
+{
+	if (g_list_length (files) >= GTH_FOLDER_CACHE_MIN_FILES)
+		gth_folder_cache_save (load_data->requested_folder->file,
+				       load_data->requested_folder->info,
+				       load_data->folder_attributes,
+				       files);
+	else
+		gth_folder_cache_remove (load_data->requested_folder->file);
+}
+
+
+/* Returns the files of the current listing, taking the info from
+ * @updated_files for the new and modified files, and from the cache for the
+ * others. */
+static GList *
+load_data_get_updated_listing (LoadData *load_data,
+			       GList    *updated_files)
+{
+	GHashTable *files_info;
+	GList      *scan;
+	GList      *files;
+
+	files_info = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
+	for (scan = load_data->cached_files; scan; scan = scan->next) {
+		GthFileData *file_data = scan->data;
+		g_hash_table_insert (files_info, file_data->file, file_data);
+	}
+	for (scan = updated_files; scan; scan = scan->next) {
+		GthFileData *file_data = scan->data;
+		g_hash_table_insert (files_info, file_data->file, file_data);
+	}
+
+	files = NULL;
+	for (scan = load_data->loaded_files; scan; scan = scan->next) {
+		GthFileData *file_data = scan->data;
+		GthFileData *updated_data;
+
+		updated_data = g_hash_table_lookup (files_info, file_data->file);
+		if (updated_data != NULL)
+			files = g_list_prepend (files, g_object_ref (updated_data));
+	}
+
+	g_hash_table_destroy (files_info);
+
+	return g_list_reverse (files);
+}
+
+
+static void
+cache_changes_metadata_ready_cb (GObject      *source_object,
+				 GAsyncResult *result,
+				 gpointer      user_data)
+{
+	LoadData   *load_data = user_data;
+	GthBrowser *browser = load_data->browser;
+	GList      *files;
+	GError     *error = NULL;
+	GList      *updated_files;
+	GList      *loaded_files;
+
+	files = _g_query_metadata_finish (result, &error);
+	if (error != NULL) {
+		load_data_error (load_data, error);
+		load_data_free (load_data);
+		return;
+	}
+
+	if (g_file_equal (load_data->requested_folder->file, browser->priv->location->file)) {
+		GList *visible_files;
+
+		visible_files = _gth_browser_get_visible_files (browser, load_data->new_files);
+		gth_file_list_add_files (GTH_FILE_LIST (browser->priv->file_list), visible_files, -1);
+		gth_file_list_add_files (GTH_FILE_LIST (browser->priv->thumbnail_list), visible_files, -1);
+		_g_object_list_unref (visible_files);
+
+		gth_file_list_update_files (GTH_FILE_LIST (browser->priv->file_list), load_data->changed_files);
+		gth_file_list_update_files (GTH_FILE_LIST (browser->priv->thumbnail_list), load_data->changed_files);
+	}
+
+	updated_files = g_list_concat (g_list_copy (load_data->new_files), g_list_copy (load_data->changed_files));
+	loaded_files = load_data_get_updated_listing (load_data, updated_files);
+	load_data_save_cache (load_data, loaded_files);
+	load_data_continue (load_data, loaded_files);
+
+	_g_object_list_unref (loaded_files);
+	g_list_free (updated_files);
+}
+
+
+static void
+load_data_query_changes_metadata (LoadData *load_data)
+{
+	GList *files_to_update;
+
+	files_to_update = g_list_concat (g_list_copy (load_data->new_files), g_list_copy (load_data->changed_files));
+	_g_query_metadata_async (files_to_update,
+				 _gth_browser_get_list_attributes (load_data->browser, TRUE),
+				 load_data->cancellable,
+				 cache_changes_metadata_ready_cb,
+				 load_data);
+
+	g_list_free (files_to_update);
+}
+
+
+static void
+cache_changes_info_ready_cb (GList    *files,
+			     GError   *error,
+			     gpointer  user_data)
+{
+	LoadData   *load_data = user_data;
+	GHashTable *new_files;
+	GList      *scan;
+
+	if (error != NULL) {
+		load_data_error (load_data, error);
+		load_data_free (load_data);
+		return;
+	}
+
+	/* replace the stat-only info with the complete one */
+
+	new_files = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
+	for (scan = load_data->new_files; scan; scan = scan->next) {
+		GthFileData *file_data = scan->data;
+		g_hash_table_insert (new_files, file_data->file, file_data);
+	}
+
+	_g_object_list_unref (load_data->new_files);
+	_g_object_list_unref (load_data->changed_files);
+	load_data->new_files = NULL;
+	load_data->changed_files = NULL;
+	for (scan = files; scan; scan = scan->next) {
+		GthFileData *file_data = scan->data;
+
+		if (g_hash_table_lookup (new_files, file_data->file) != NULL)
+			load_data->new_files = g_list_prepend (load_data->new_files, g_object_ref (file_data));
+		else
+			load_data->changed_files = g_list_prepend (load_data->changed_files, g_object_ref (file_data));
+	}
+	load_data->new_files = g_list_reverse (load_data->new_files);
+	load_data->changed_files = g_list_reverse (load_data->changed_files);
+
+	load_data_query_changes_metadata (load_data);
+
+	g_hash_table_destroy (new_files);
+}
+
+
+/* compare the cached listing with the current stat-only listing, and read
+ * the complete info and the metadata only for the files that have been
+ * added or modified.  The cache is saved again only if the listing
+ * changed. */
+static void
+load_data_apply_cache_changes (LoadData *load_data,
+			       GList    *files)
+{
+	GthBrowser *browser = load_data->browser;
+	GHashTable *cached_files;
+	GList      *scan;
+	GList      *deleted_files;
+
+	load_data->loaded_files = _g_object_list_ref (files);
+
+	cached_files = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
+	for (scan = load_data->cached_files; scan; scan = scan->next) {
+		GthFileData *file_data = scan->data;
+		g_hash_table_insert (cached_files, file_data->file, file_data);
+	}
+
+	for (scan = files; scan; scan = scan->next) {
+		GthFileData *file_data = scan->data;
+		GthFileData *cached_data;
+
+		cached_data = g_hash_table_lookup (cached_files, file_data->file);
+		if (cached_data == NULL)
+			load_data->new_files = g_list_prepend (load_data->new_files, g_object_ref (file_data));
+		else if (gth_folder_cache_file_changed (cached_data->info, file_data->info))
+			load_data->changed_files = g_list_prepend (load_data->changed_files, g_object_ref (file_data));
+		g_hash_table_remove (cached_files, file_data->file);
+	}
+	load_data->new_files = g_list_reverse (load_data->new_files);
+	load_data->changed_files = g_list_reverse (load_data->changed_files);
+
+	deleted_files = NULL;
+	for (scan = load_data->cached_files; scan; scan = scan->next) {
+		GthFileData *file_data = scan->data;
+
+		if (g_hash_table_lookup (cached_files, file_data->file) != NULL)
+			deleted_files = g_list_prepend (deleted_files, g_object_ref (file_data->file));
+	}
+
+	if ((deleted_files != NULL) && g_file_equal (load_data->requested_folder->file, browser->priv->location->file)) {
+		gth_file_list_delete_files (GTH_FILE_LIST (browser->priv->file_list), deleted_files);
+		gth_file_list_delete_files (GTH_FILE_LIST (browser->priv->thumbnail_list), deleted_files);
+	}
+
+	if ((load_data->new_files == NULL) && (load_data->changed_files == NULL)) {
+		GList *loaded_files;
+
+		loaded_files = load_data_get_updated_listing (load_data, NULL);
+		if (deleted_files != NULL)
+			load_data_save_cache (load_data, loaded_files);
+		load_data_continue (load_data, loaded_files);
+
+		_g_object_list_unref (loaded_files);
+	}
+	else if (g_strcmp0 (load_data->folder_attributes, GFILE_STANDARD_ATTRIBUTES_WITH_FAST_CONTENT_TYPE) != 0) {
+		GList *files_to_update;
+
+		files_to_update = NULL;
+		for (scan = load_data->new_files; scan; scan = scan->next)
+			files_to_update = g_list_prepend (files_to_update, ((GthFileData *) scan->data)->file);
+		for (scan = load_data->changed_files; scan; scan = scan->next)
+			files_to_update = g_list_prepend (files_to_update, ((GthFileData *) scan->data)->file);
+		files_to_update = g_list_reverse (files_to_update);
+
+		_g_query_info_async (files_to_update,
+				     GTH_LIST_DEFAULT,
+				     load_data->folder_attributes,
+				     load_data->cancellable,
+				     cache_changes_info_ready_cb,
+				     load_data);
+
+		g_list_free (files_to_update);
+	}
+	else
+		load_data_query_changes_metadata (load_data);
+
+	_g_object_list_unref (deleted_files);
+	g_hash_table_destroy (cached_files);
+}
+
+
 static void
 load_data_ready (LoadData *load_data,
 		 GList    *files,
 		 GError   *error)
 {
+	if (load_data->pending_batches > 0) {
+		/* wait for the metadata of the last batches, see
+		 * batch_metadata_ready_cb */
+		load_data->list_ready = TRUE;
+		load_data->loaded_files = _g_object_list_ref (files);
+		load_data->error = (error != NULL) ? g_error_copy (error) : NULL;
+		return;
+	}
+
+	if ((load_data->folder_attributes != NULL) && GTH_IS_FILE_SOURCE_VFS (load_data->file_source)) {
+		/* when the cache is used the listing is saved only if it
+		 * changed, see load_data_apply_cache_changes */
+		if ((error != NULL) || ((load_data->cached_files != NULL) && load_data->batch_error))
+			gth_folder_cache_remove (load_data->requested_folder->file);
+		else if (load_data->cached_files == NULL)
+			load_data_save_cache (load_data, files);
+	}
+
 	if (error != NULL) {
 		load_data_error (load_data, error);
 		load_data_free (load_data);
 	}
+	else if ((load_data->cached_files != NULL) && ! load_data->batch_error)
+		load_data_apply_cache_changes (load_data, files);
+	else if (load_data->in_batches && ! load_data->batch_error) {
+		/* the metadata has already been read for each batch */
+		load_data_continue (load_data, files);
+	}
 	else if ((load_data->action != GTH_ACTION_LIST_CHILDREN)
 		 && g_file_equal ((GFile *) load_data->current->data, load_data->requested_folder->file))
 	{
@@ -1907,6 +2215,83 @@ _gth_browser_load_ready_cb (GthFileSource *file_source,
 }
 
 
+static void
+batch_metadata_ready_cb (GObject      *source_object,
+			 GAsyncResult *result,
+			 gpointer      user_data)
+{
+	LoadData   *load_data = user_data;
+	GthBrowser *browser = load_data->browser;
+	GList      *files;
+	GError     *error = NULL;
+
+	load_data->pending_batches--;
+
+	files = _g_query_metadata_finish (result, &error);
+	if (error != NULL) {
+		load_data->batch_error = TRUE;
+		g_clear_error (&error);
+	}
+	else if (g_file_equal (load_data->requested_folder->file, browser->priv->location->file)) {
+		GList *visible_files;
+
+		visible_files = _gth_browser_get_visible_files (browser, files);
+		if (! load_data->files_added) {
+			GthTest *filter;
+
+			filter = _gth_browser_get_file_filter (browser);
+			gth_file_list_set_filter (GTH_FILE_LIST (browser->priv->file_list), filter);
+			gth_file_list_set_files (GTH_FILE_LIST (browser->priv->file_list), visible_files);
+			gth_file_list_set_filter (GTH_FILE_LIST (browser->priv->thumbnail_list), filter);
+			gth_file_list_set_files (GTH_FILE_LIST (browser->priv->thumbnail_list), visible_files);
+			g_object_unref (filter);
+
+			load_data->files_added = TRUE;
+		}
+		else {
+			gth_file_list_add_files (GTH_FILE_LIST (browser->priv->file_list), visible_files, -1);
+			gth_file_list_add_files (GTH_FILE_LIST (browser->priv->thumbnail_list), visible_files, -1);
+		}
+
+		_g_object_list_unref (visible_files);
+	}
+
+	if ((load_data->pending_batches == 0) && load_data->list_ready) {
+		GList  *loaded_files = load_data->loaded_files;
+		GError *list_error = load_data->error;
+
+		load_data->list_ready = FALSE;
+		load_data->loaded_files = NULL;
+		load_data->error = NULL;
+		load_data_ready (load_data, loaded_files, list_error);
+
+		_g_object_list_unref (loaded_files);
+		if (list_error != NULL)
+			g_error_free (list_error);
+	}
+}
+
+
+static void
+_gth_browser_load_batch_cb (GthFileSource *file_source,
+			    GList         *files,
+			    GError        *error,
+			    gpointer       user_data)
+{
+	LoadData *load_data = user_data;
+
+	/* read the metadata required to sort and filter the files before
+	 * adding them to the file list */
+
+	load_data->pending_batches++;
+	_g_query_metadata_async (files,
+				 _gth_browser_get_list_attributes (load_data->browser, TRUE),
+				 load_data->cancellable,
+				 batch_metadata_ready_cb,
+				 load_data);
+}
+
+
 static GFile *
 get_nearest_entry_point (GFile *file)
 {
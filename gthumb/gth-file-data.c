@@ -46,6 +46,7 @@ struct _GthFileDataPrivate {
 	GTimeVal  mtime;   /* modification time */
 	GTimeVal  dtime;   /* digitalization time */
 	char     *sort_key;
+	char     *uri_sort_key;
 };
 
 
@@ -67,6 +68,7 @@ gth_file_data_finalize (GObject *obj)
 	_g_object_unref (self->file);
 	_g_object_unref (self->info);
 	g_free (self->priv->sort_key);
+	g_free (self->priv->uri_sort_key);
 
 	G_OBJECT_CLASS (gth_file_data_parent_class)->finalize (obj);
 }
@@ -101,6 +103,7 @@ gth_file_data_init (GthFileData *self)
 	self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self, GTH_TYPE_FILE_DATA, GthFileDataPrivate);
 	self->priv->dtime.tv_sec = 0;
 	self->priv->sort_key = NULL;
+	self->priv->uri_sort_key = NULL;
 	self->file = NULL;
 	self->info = NULL;
 }
@@ -165,6 +168,9 @@ gth_file_data_set_file (GthFileData *self,
 		self->file = NULL;
 	}
 
+	g_free (self->priv->uri_sort_key);
+	self->priv->uri_sort_key = NULL;
+
 	if (file != NULL)
 		self->file = file;
 }
@@ -280,6 +286,19 @@ gth_file_data_get_filename_sort_key (GthFileData *self)
 }
 
 
+const char *
+gth_file_data_get_uri_sort_key (GthFileData *self)
+{
+	if (self->file == NULL)
+		return NULL;
+
+	if (self->priv->uri_sort_key == NULL)
+		self->priv->uri_sort_key = g_file_get_uri (self->file);
+
+	return self->priv->uri_sort_key;
+}
+
+
 time_t
 gth_file_data_get_mtime (GthFileData *self)
 {
@@ -674,3 +693,33 @@ gth_file_data_attribute_equal_string_list (GthFileData    *file_data,
 
 	return gth_string_list_equal (list, value);
 }
+
+
+int
+gth_file_data_sort_key_cmp (GthFileDataSortKey *a,
+			    GthFileDataSortKey *b)
+{
+	int result;
+
+	if (a->value < b->value)
+		return -1;
+	if (a->value > b->value)
+		return 1;
+
+	if ((a->text != NULL) && (b->text != NULL)) {
+		/* the files in the same folder are compared by name */
+		if ((a->folder_len == 0)
+		    || (a->folder_len != b->folder_len)
+		    || (strncmp (a->text, b->text, a->folder_len) != 0))
+		{
+			result = strcmp (a->text, b->text);
+			if (result != 0)
+				return result;
+		}
+	}
+
+	if ((a->name != NULL) && (b->name != NULL))
+		return strcmp (a->name, b->name);
+
+	return 0;
+}
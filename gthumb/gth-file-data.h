@@ -56,11 +56,26 @@ struct _GthFileDataClass {
 typedef int  (*GthFileDataCompFunc) (GthFileData *a, GthFileData *b);
 typedef void (*GthFileDataFunc)     (GthFileData *a, GError *error, gpointer data);
 
+/* A sort key extracted once per file, keys are compared field by field:
+ * value, then text (if not NULL), then name (if not NULL).  The text is
+ * owned by the key, the name is the file sort key, owned by the file
+ * data.  If folder_len is not 0 the text is an uri and the first folder_len
+ * bytes are its folder: the text is skipped if the folders are the same. */
 typedef struct {
-	const char          *name;
-	const char          *display_name;
-	const char          *required_attributes;
-	GthFileDataCompFunc  cmp_func;
+	gint64      value;
+	char       *text;
+	gsize       folder_len;
+	const char *name;
+} GthFileDataSortKey;
+
+typedef void (*GthFileDataSortKeyFunc) (GthFileData *file_data, GthFileDataSortKey *key);
+
+typedef struct {
+	const char             *name;
+	const char             *display_name;
+	const char             *required_attributes;
+	GthFileDataCompFunc     cmp_func;
+	GthFileDataSortKeyFunc  key_func; /* optional, must give the same order of cmp_func */
 } GthFileDataSort;
 
 GType         gth_file_data_get_type                (void);
@@ -80,6 +95,7 @@ const char *  gth_file_data_get_mime_type_from_content
 						    (GthFileData    *self,
 						     GCancellable   *cancellable);
 const char *  gth_file_data_get_filename_sort_key   (GthFileData    *self);
+const char *  gth_file_data_get_uri_sort_key        (GthFileData    *self);
 time_t        gth_file_data_get_mtime               (GthFileData    *self);
 GTimeVal *    gth_file_data_get_modification_time   (GthFileData    *self);
 GTimeVal *    gth_file_data_get_creation_time       (GthFileData    *self);
@@ -120,6 +136,8 @@ gboolean      gth_file_data_attribute_equal_string_list
 						    (GthFileData    *file_data,
 						     const char     *attribute,
 						     GthStringList  *value);
+int           gth_file_data_sort_key_cmp            (GthFileDataSortKey *a,
+						     GthFileDataSortKey *b);
 
 G_END_DECLS
 
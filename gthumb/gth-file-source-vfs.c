@@ -33,6 +33,7 @@
 
 #define GTH_MONITOR_N_EVENTS 3
 #define MONITOR_UPDATE_DELAY 500
+#define MONITOR_MAX_UPDATE_DELAY 2000
 #undef  DEBUG_MONITOR
 
 struct _GthFileSourceVfsPrivate
@@ -45,7 +46,8 @@ struct _GthFileSourceVfsPrivate
 	gpointer              user_data;
 	GHashTable           *hidden_files;
 	GHashTable           *monitors;
-	GList                *monitor_queue[GTH_MONITOR_N_EVENTS];
+	GHashTable           *monitor_events;
+	gint64                monitor_events_time;
 	guint                 monitor_update_id;
 	GVolumeMonitor       *mount_monitor;
 	gboolean              check_hidden_files;
@@ -308,16 +310,18 @@ gth_file_source_vfs_for_each_child (GthFileSource        *file_source,
 	file_source_vfs->priv->user_data = user_data;
 	file_source_vfs->priv->check_hidden_files = _g_file_attributes_matches_any (attributes, G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN);
 
+	/* the .hidden file is read in start_dir_func, which is still called
+	 * just before the files of its directory with GTH_LIST_PARALLEL */
+
 	gio_folder = gth_file_source_to_gio_file (file_source, parent);
-	g_directory_foreach_child (gio_folder,
-				   recursive,
-				   TRUE,
-				   attributes,
-				   gth_file_source_get_cancellable (file_source),
-				   fec__start_dir_func,
-				   fec__for_each_file_func,
-				   fec__done_func,
-				   file_source);
+	g_directory_foreach_child_full (gio_folder,
+					(recursive ? GTH_LIST_RECURSIVE : GTH_LIST_DEFAULT) | GTH_LIST_PARALLEL,
+					attributes,
+					gth_file_source_get_cancellable (file_source),
+					fec__start_dir_func,
+					fec__for_each_file_func,
+					fec__done_func,
+					file_source);
 
 	g_object_unref (gio_folder);
 }
@@ -427,76 +431,105 @@ static gboolean
 process_event_queue (gpointer data)
 {
 	GthFileSourceVfs *file_source_vfs = data;
+	GHashTable       *monitor_events;
+	GHashTable       *folders[GTH_MONITOR_N_EVENTS];
+	GHashTableIter    iter;
+	gpointer          key;
+	gpointer          value;
 	GthMonitor       *monitor;
-	GList            *monitor_queue[GTH_MONITOR_N_EVENTS];
 	int               event_type;
 
 	if (file_source_vfs->priv->monitor_update_id != 0)
 		g_source_remove (file_source_vfs->priv->monitor_update_id);
 	file_source_vfs->priv->monitor_update_id = 0;
 
-	for (event_type = 0; event_type < GTH_MONITOR_N_EVENTS; event_type++) {
-		monitor_queue[event_type] = file_source_vfs->priv->monitor_queue[event_type];
-		file_source_vfs->priv->monitor_queue[event_type] = NULL;
-	}
+	monitor_events = file_source_vfs->priv->monitor_events;
+	file_source_vfs->priv->monitor_events = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, g_object_unref, NULL);
 
-	monitor = gth_main_get_default_monitor ();
-	for (event_type = 0; event_type < GTH_MONITOR_N_EVENTS; event_type++) {
-		GList *scan;
+	/* group the files by event type and parent folder to notify all the
+	 * changes of a folder at once */
+
+	for (event_type = 0; event_type < GTH_MONITOR_N_EVENTS; event_type++)
+		folders[event_type] = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, g_object_unref, NULL);
 
-		for (scan = monitor_queue[event_type]; scan; scan = scan->next) {
-			GFile *file = scan->data;
-			GFile *parent;
-			GList *list;
+	g_hash_table_iter_init (&iter, monitor_events);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		GFile *file = key;
+		GFile *parent;
+		GList *list;
+
+		event_type = GPOINTER_TO_INT (value);
 
 #ifdef DEBUG_MONITOR
-			switch (event_type) {
-			case GTH_MONITOR_EVENT_CREATED:
-				g_print ("GTH_MONITOR_EVENT_CREATED");
-				break;
-			case GTH_MONITOR_EVENT_DELETED:
-				g_print ("GTH_MONITOR_EVENT_DELETED");
-				break;
-			case GTH_MONITOR_EVENT_CHANGED:
-				g_print ("GTH_MONITOR_EVENT_CHANGED");
-				break;
-			}
-			g_print (" ==> %s\n", g_file_get_uri (file));
+		switch (event_type) {
+		case GTH_MONITOR_EVENT_CREATED:
+			g_print ("GTH_MONITOR_EVENT_CREATED");
+			break;
+		case GTH_MONITOR_EVENT_DELETED:
+			g_print ("GTH_MONITOR_EVENT_DELETED");
+			break;
+		case GTH_MONITOR_EVENT_CHANGED:
+			g_print ("GTH_MONITOR_EVENT_CHANGED");
+			break;
+		}
+		g_print (" ==> %s\n", g_file_get_uri (file));
 #endif
 
-			parent = g_file_get_parent (file);
-			list = g_list_prepend (NULL, g_object_ref (file));
+		parent = g_file_get_parent (file);
+		if (parent == NULL)
+			continue;
+
+		list = g_hash_table_lookup (folders[event_type], parent);
+		list = g_list_prepend (list, g_object_ref (file));
+		g_hash_table_replace (folders[event_type], parent, list);
+	}
+
+	monitor = gth_main_get_default_monitor ();
+	for (event_type = 0; event_type < GTH_MONITOR_N_EVENTS; event_type++) {
+		g_hash_table_iter_init (&iter, folders[event_type]);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			GFile *parent = key;
+			GList *list = value;
+
 			gth_monitor_folder_changed (monitor,
 						    parent,
 						    list,
 						    event_type);
 
 			_g_object_list_unref (list);
-			g_object_unref (parent);
 		}
-		_g_object_list_unref (monitor_queue[event_type]);
-		monitor_queue[event_type] = NULL;
+		g_hash_table_destroy (folders[event_type]);
 	}
 
+	g_hash_table_destroy (monitor_events);
+
 	return FALSE;
 }
 
 
-static gboolean
-remove_if_present (GthFileSourceVfs *file_source_vfs,
-		   GthMonitorEvent   event_type,
-		   GFile            *file)
+/* coalesce the new event with the one already queued for the same file */
+static GthMonitorEvent
+get_coalesced_event (GthMonitorEvent old_event,
+		     GthMonitorEvent new_event)
 {
-	GList *link;
+	switch (new_event) {
+	case GTH_MONITOR_EVENT_CREATED:
+		/* a file deleted and created again is a changed file */
+		if (old_event == GTH_MONITOR_EVENT_DELETED)
+			return GTH_MONITOR_EVENT_CHANGED;
+		break;
 
-	link = _g_file_list_find_file (file_source_vfs->priv->monitor_queue[event_type], file);
-	if (link != NULL) {
-		file_source_vfs->priv->monitor_queue[event_type] = g_list_remove_link (file_source_vfs->priv->monitor_queue[event_type], link);
-		_g_object_list_unref (link);
-		return TRUE;
+	case GTH_MONITOR_EVENT_CHANGED:
+		/* the attributes of a created file are read anyway */
+		if (old_event == GTH_MONITOR_EVENT_CREATED)
+			return GTH_MONITOR_EVENT_CREATED;
+		break;
+
+	default:
+		break;
 	}
 
-	return FALSE;
+	return new_event;
 }
 
 
@@ -509,6 +542,7 @@ monitor_changed_cb (GFileMonitor      *file_monitor,
 {
 	GthFileSourceVfs *file_source_vfs = user_data;
 	GthMonitorEvent   event_type;
+	gpointer          old_event;
 
 	switch (file_event_type) {
 	case G_FILE_MONITOR_EVENT_CREATED:
@@ -542,24 +576,20 @@ monitor_changed_cb (GFileMonitor      *file_monitor,
 	g_print (" ==> %s\n", g_file_get_uri (file));
 #endif
 
-	if (event_type == GTH_MONITOR_EVENT_CREATED) {
-		if (remove_if_present (file_source_vfs, GTH_MONITOR_EVENT_DELETED, file))
-			event_type = GTH_MONITOR_EVENT_CHANGED;
-	}
-	else if (event_type == GTH_MONITOR_EVENT_DELETED) {
-		remove_if_present (file_source_vfs, GTH_MONITOR_EVENT_CREATED, file);
-		remove_if_present (file_source_vfs, GTH_MONITOR_EVENT_CHANGED, file);
-	}
-	else if (event_type == GTH_MONITOR_EVENT_CHANGED) {
-		if (_g_file_list_find_file (file_source_vfs->priv->monitor_queue[GTH_MONITOR_EVENT_CREATED], file))
-			return;
-		remove_if_present (file_source_vfs, GTH_MONITOR_EVENT_CHANGED, file);
-	}
+	if (g_hash_table_lookup_extended (file_source_vfs->priv->monitor_events, file, NULL, &old_event))
+		event_type = get_coalesced_event (GPOINTER_TO_INT (old_event), event_type);
+	else if (g_hash_table_size (file_source_vfs->priv->monitor_events) == 0)
+		file_source_vfs->priv->monitor_events_time = g_get_monotonic_time ();
+	g_hash_table_replace (file_source_vfs->priv->monitor_events, g_file_dup (file), GINT_TO_POINTER (event_type));
 
-	file_source_vfs->priv->monitor_queue[event_type] = g_list_prepend (file_source_vfs->priv->monitor_queue[event_type], g_file_dup (file));
+	/* wait for the events to stop before updating, but not more than
+	 * MONITOR_MAX_UPDATE_DELAY milliseconds */
 
-	if (file_source_vfs->priv->monitor_update_id != 0)
+	if (file_source_vfs->priv->monitor_update_id != 0) {
+		if (g_get_monotonic_time () - file_source_vfs->priv->monitor_events_time >= MONITOR_MAX_UPDATE_DELAY * 1000)
+			return;
 		g_source_remove (file_source_vfs->priv->monitor_update_id);
+	}
 	file_source_vfs->priv->monitor_update_id = g_timeout_add (MONITOR_UPDATE_DELAY,
 								  process_event_queue,
 								  file_source_vfs);
@@ -882,8 +912,6 @@ gth_file_source_vfs_finalize (GObject *object)
 	GthFileSourceVfs *file_source_vfs = GTH_FILE_SOURCE_VFS (object);
 
 	if (file_source_vfs->priv != NULL) {
-		int i;
-
 		if (file_source_vfs->priv->monitor_update_id != 0) {
 			g_source_remove (file_source_vfs->priv->monitor_update_id);
 			file_source_vfs->priv->monitor_update_id = 0;
@@ -892,10 +920,7 @@ gth_file_source_vfs_finalize (GObject *object)
 		g_hash_table_destroy (file_source_vfs->priv->hidden_files);
 		g_hash_table_destroy (file_source_vfs->priv->monitors);
 
-		for (i = 0; i < GTH_MONITOR_N_EVENTS; i++) {
-			_g_object_list_unref (file_source_vfs->priv->monitor_queue[i]);
-			file_source_vfs->priv->monitor_queue[i] = NULL;
-		}
+		g_hash_table_destroy (file_source_vfs->priv->monitor_events);
 		_g_object_list_unref (file_source_vfs->priv->files);
 
 		g_free (file_source_vfs->priv);
@@ -931,12 +956,9 @@ gth_file_source_vfs_class_init (GthFileSourceVfsClass *class)
 static void
 gth_file_source_vfs_init (GthFileSourceVfs *file_source)
 {
-	int i;
-
 	file_source->priv = g_new0 (GthFileSourceVfsPrivate, 1);
 	gth_file_source_add_scheme (GTH_FILE_SOURCE (file_source), "vfs+");
 	file_source->priv->hidden_files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 	file_source->priv->monitors = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, g_object_unref, g_object_unref);
-	for (i = 0; i < GTH_MONITOR_N_EVENTS; i++)
-		file_source->priv->monitor_queue[i] = NULL;
+	file_source->priv->monitor_events = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, g_object_unref, NULL);
 }
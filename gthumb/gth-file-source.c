@@ -62,6 +62,7 @@ typedef enum {
 typedef struct {
 	GFile      *folder;
 	const char *attributes;
+	ListReady   batch_func;
 	ListReady   func;
 	gpointer    data;
 } ListData;
@@ -257,6 +258,7 @@ static void
 gth_file_source_queue_list (GthFileSource *file_source,
 			    GFile         *folder,
 			    const char    *attributes,
+			    ListReady      batch_func,
 			    ListReady      func,
 			    gpointer       data)
 {
@@ -267,6 +269,7 @@ gth_file_source_queue_list (GthFileSource *file_source,
 	async_op->op = FILE_SOURCE_OP_LIST;
 	async_op->data.list.folder = g_file_dup (folder);
 	async_op->data.list.attributes = attributes;
+	async_op->data.list.batch_func = batch_func;
 	async_op->data.list.func = func;
 	async_op->data.list.data = data;
 
@@ -468,11 +471,12 @@ gth_file_source_exec_next_in_queue (GthFileSource *file_source)
 					       async_op->data.read_metadata.data);
 		break;
 	case FILE_SOURCE_OP_LIST:
-		gth_file_source_list (file_source,
-				      async_op->data.list.folder,
-				      async_op->data.list.attributes,
-				      async_op->data.list.func,
-				      async_op->data.list.data);
+		gth_file_source_list_in_batches (file_source,
+						 async_op->data.list.folder,
+						 async_op->data.list.attributes,
+						 async_op->data.list.batch_func,
+						 async_op->data.list.func,
+						 async_op->data.list.data);
 		break;
 	case FILE_SOURCE_OP_FOR_EACH_CHILD:
 		gth_file_source_for_each_child (file_source,
@@ -1063,12 +1067,48 @@ gth_file_source_read_metadata (GthFileSource *file_source,
 
 typedef struct {
 	GthFileSource *file_source;
+	ListReady      batch_func;
 	ListReady      ready_func;
 	gpointer       user_data;
 	GList         *files;
+	GList         *batch;
+	guint          batch_id;
 } ListOpData;
 
 
+static void
+list__flush_batch (ListOpData *data)
+{
+	GList *batch;
+
+	if (data->batch_id != 0) {
+		g_source_remove (data->batch_id);
+		data->batch_id = 0;
+	}
+
+	if (data->batch == NULL)
+		return;
+
+	batch = g_list_reverse (data->batch);
+	data->batch = NULL;
+	data->batch_func (data->file_source, batch, NULL, data->user_data);
+
+	_g_object_list_unref (batch);
+}
+
+
+static gboolean
+list__batch_ready_cb (gpointer user_data)
+{
+	ListOpData *data = user_data;
+
+	data->batch_id = 0;
+	list__flush_batch (data);
+
+	return FALSE;
+}
+
+
 static void
 list__done_func (GObject  *source,
 		 GError   *error,
@@ -1076,6 +1116,14 @@ list__done_func (GObject  *source,
 {
 	ListOpData *data = user_data;
 
+	if (data->batch_func != NULL) {
+		if (error == NULL)
+			list__flush_batch (data);
+		else if (data->batch_id != 0)
+			g_source_remove (data->batch_id);
+		_g_object_list_unref (data->batch);
+	}
+
 	data->ready_func (data->file_source, data->files, error, data->user_data);
 
 	_g_object_list_unref (data->files);
@@ -1089,12 +1137,23 @@ list__for_each_file_func (GFile     *file,
 			  GFileInfo *info,
 			  gpointer   user_data)
 {
-	ListOpData *data = user_data;
+	ListOpData  *data = user_data;
+	GthFileData *file_data;
 
 	switch (g_file_info_get_file_type (info)) {
 	case G_FILE_TYPE_REGULAR:
 	case G_FILE_TYPE_DIRECTORY:
-		data->files = g_list_prepend (data->files, gth_file_data_new (file, info));
+		file_data = gth_file_data_new (file, info);
+		data->files = g_list_prepend (data->files, file_data);
+
+		/* the files received in the same main loop iteration, that
+		 * is from the same g_file_enumerator_next_files_async call,
+		 * are delivered as a single batch. */
+		if (data->batch_func != NULL) {
+			data->batch = g_list_prepend (data->batch, g_object_ref (file_data));
+			if (data->batch_id == 0)
+				data->batch_id = g_idle_add (list__batch_ready_cb, data);
+		}
 		break;
 	default:
 		break;
@@ -1118,11 +1177,26 @@ gth_file_source_list (GthFileSource *file_source,
 		      const char    *attributes,
 		      ListReady      func,
 		      gpointer       user_data)
+{
+	gth_file_source_list_in_batches (file_source, folder, attributes, NULL, func, user_data);
+}
+
+
+/* Like gth_file_source_list but batch_func is also called with the files
+ * read so far, as soon as they are available.  ready_func receives the
+ * complete list at the end, the file data objects are the same. */
+void
+gth_file_source_list_in_batches (GthFileSource *file_source,
+				 GFile         *folder,
+				 const char    *attributes,
+				 ListReady      batch_func,
+				 ListReady      ready_func,
+				 gpointer       user_data)
 {
 	ListOpData *data;
 
 	if (gth_file_source_is_active (file_source)) {
-		gth_file_source_queue_list (file_source, folder, attributes, func, user_data);
+		gth_file_source_queue_list (file_source, folder, attributes, batch_func, ready_func, user_data);
 		return;
 	}
 
@@ -1130,7 +1204,8 @@ gth_file_source_list (GthFileSource *file_source,
 
 	data = g_new0 (ListOpData, 1);
 	data->file_source = g_object_ref (file_source);
-	data->ready_func = func;
+	data->batch_func = batch_func;
+	data->ready_func = ready_func;
 	data->user_data = user_data;
 
 	gth_file_source_for_each_child (file_source,
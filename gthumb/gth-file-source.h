@@ -174,6 +174,12 @@ void           gth_file_source_list                  (GthFileSource        *file
 						      const char           *attributes,
 						      ListReady             func,
 						      gpointer              data);
+void           gth_file_source_list_in_batches       (GthFileSource        *file_source,
+						      GFile                *folder,
+						      const char           *attributes,
+						      ListReady             batch_func,
+						      ListReady             ready_func,
+						      gpointer              data);
 void           gth_file_source_for_each_child        (GthFileSource        *file_source,
 						      GFile                *parent,
 						      gboolean              recursive,
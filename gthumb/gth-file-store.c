@@ -20,10 +20,13 @@
  */
 
 #include <config.h>
+#include <string.h>
 #include <glib/gi18n.h>
 #include "cairo-utils.h"
 #include "glib-utils.h"
 #include "gth-file-store.h"
+#include "gth-filter.h"
+#include "gth-main.h"
 #include "gth-marshal.h"
 #include "gth-string-list.h"
 
@@ -31,6 +34,9 @@
 #undef  DEBUG_FILE_STORE
 #define VALID_ITER(iter, store) (((iter) != NULL) && ((iter)->stamp == (store)->priv->stamp) && ((iter)->user_data != NULL))
 #define REALLOC_STEP 32
+#define SORT_KEYS_MIN_ROWS 64
+#define PARALLEL_SORT_MIN_ROWS 20000
+#define PARALLEL_SORT_MAX_THREADS 8
 
 
 enum {
@@ -71,8 +77,10 @@ struct _GthFileStorePrivate
 	GthTest             *filter;
 	GList               *queue;
 	GthFileDataCompFunc  cmp_func;
+	GthFileDataSortKeyFunc key_func;
 	gboolean             inverse_sort : 1;
 	gboolean             update_filter : 1;
+	GHashTable          *file_index;  /* GFile -> GthFileRow array, for all the rows */
 };
 
 
@@ -167,6 +175,89 @@ _gth_file_row_unref (GthFileRow *row)
 }
 
 
+/* -- file index -- */
+
+
+/* a file can be present more than once, so every row is indexed. */
+static void
+_gth_file_store_index_add (GthFileStore *file_store,
+			   GthFileRow   *row)
+{
+	GFile     *file = row->file_data->file;
+	GPtrArray *rows;
+
+	rows = g_hash_table_lookup (file_store->priv->file_index, file);
+	if (rows == NULL) {
+		rows = g_ptr_array_new ();
+		g_hash_table_insert (file_store->priv->file_index, g_object_ref (file), rows);
+	}
+	g_ptr_array_add (rows, row);
+}
+
+
+static void
+_gth_file_store_index_remove (GthFileStore *file_store,
+			      GthFileRow   *row)
+{
+	GFile     *file = row->file_data->file;
+	GPtrArray *rows;
+
+	rows = g_hash_table_lookup (file_store->priv->file_index, file);
+	if (rows == NULL)
+		return;
+
+	g_ptr_array_remove_fast (rows, row);
+	if (rows->len == 0)
+		g_hash_table_remove (file_store->priv->file_index, file);
+}
+
+
+static void
+_gth_file_store_index_rebuild (GthFileStore *file_store)
+{
+	int i;
+
+	g_hash_table_remove_all (file_store->priv->file_index);
+	for (i = 0; i < file_store->priv->tot_rows; i++)
+		if (file_store->priv->all_rows[i] != NULL)
+			_gth_file_store_index_add (file_store, file_store->priv->all_rows[i]);
+}
+
+
+/* Returns the first row of @file, the first visible row if @visible is
+ * TRUE, as a linear search would do. */
+static GthFileRow *
+_gth_file_store_index_lookup (GthFileStore *file_store,
+			      GFile        *file,
+			      gboolean      visible)
+{
+	GPtrArray  *rows;
+	GthFileRow *first_row;
+	int         i;
+
+	rows = g_hash_table_lookup (file_store->priv->file_index, file);
+	if (rows == NULL)
+		return NULL;
+
+	first_row = NULL;
+	for (i = 0; i < rows->len; i++) {
+		GthFileRow *row = g_ptr_array_index (rows, i);
+
+		if (visible) {
+			if (row->visible && ((first_row == NULL) || (row->pos < first_row->pos)))
+				first_row = row;
+		}
+		else if ((first_row == NULL) || (row->abs_pos < first_row->abs_pos))
+			first_row = row;
+	}
+
+	return first_row;
+}
+
+
+/**/
+
+
 static void
 _gth_file_store_clear_queue (GthFileStore *file_store)
 {
@@ -193,6 +284,7 @@ _gth_file_store_free_rows (GthFileStore *file_store)
 
 	file_store->priv->size = 0;
 
+	g_hash_table_remove_all (file_store->priv->file_index);
 	_gth_file_store_clear_queue (file_store);
 }
 
@@ -205,6 +297,7 @@ gth_file_store_finalize (GObject *object)
 	file_store = GTH_FILE_STORE (object);
 
 	_gth_file_store_free_rows (file_store);
+	g_hash_table_unref (file_store->priv->file_index);
 	_g_object_unref (file_store->priv->filter);
 
 	G_OBJECT_CLASS (gth_file_store_parent_class)->finalize (object);
@@ -258,8 +351,13 @@ gth_file_store_init (GthFileStore *file_store)
 	file_store->priv->filter = gth_test_new ();
 	file_store->priv->queue = NULL;
 	file_store->priv->cmp_func = NULL;
+	file_store->priv->key_func = NULL;
 	file_store->priv->inverse_sort = FALSE;
 	file_store->priv->update_filter = FALSE;
+	file_store->priv->file_index = g_hash_table_new_full (g_file_hash,
+							      (GEqualFunc) g_file_equal,
+							      g_object_unref,
+							      (GDestroyNotify) g_ptr_array_unref);
 
 	if (column_type[0] == G_TYPE_INVALID) {
 		column_type[GTH_FILE_STORE_FILE_DATA_COLUMN] = GTH_TYPE_FILE_DATA;
@@ -693,19 +791,177 @@ campare_row_func (gconstpointer a,
 }
 
 
+/* -- sort by key -- */
+
+
+typedef struct {
+	GthFileDataSortKey  key;
+	GthFileRow         *row;
+} RowKey;
+
+
+typedef struct {
+	RowKey   *keys;
+	int       n_keys;
+	gboolean  inverse_sort;
+} SortChunk;
+
+
+static int
+campare_row_key_func (gconstpointer a,
+		      gconstpointer b,
+		      gpointer      user_data)
+{
+	gboolean *inverse_sort = user_data;
+	RowKey   *key_a = (RowKey *) a;
+	RowKey   *key_b = (RowKey *) b;
+	int       result;
+
+	result = gth_file_data_sort_key_cmp (&key_a->key, &key_b->key);
+	if (*inverse_sort)
+		result = result * -1;
+
+	return result;
+}
+
+
+static gpointer
+sort_chunk_thread_func (gpointer user_data)
+{
+	SortChunk *chunk = user_data;
+
+	g_qsort_with_data (chunk->keys,
+			   chunk->n_keys,
+			   (gsize) sizeof (RowKey),
+			   campare_row_key_func,
+			   &chunk->inverse_sort);
+
+	return NULL;
+}
+
+
+static void
+_gth_file_store_sort_keys (RowKey   *keys,
+			   int       n_keys,
+			   gboolean  inverse_sort)
+{
+	int        n_chunks;
+	SortChunk *chunks;
+	GThread  **threads;
+	RowKey    *buffer;
+	int        chunk_size;
+	int        i;
+
+	n_chunks = MIN (g_get_num_processors (), PARALLEL_SORT_MAX_THREADS);
+	if ((n_keys < PARALLEL_SORT_MIN_ROWS) || (n_chunks < 2)) {
+		g_qsort_with_data (keys,
+				   n_keys,
+				   (gsize) sizeof (RowKey),
+				   campare_row_key_func,
+				   &inverse_sort);
+		return;
+	}
+
+	/* sort the chunks in parallel, the keys are only read here so they
+	 * can be compared from any thread. */
+
+	chunks = g_new (SortChunk, n_chunks);
+	threads = g_new (GThread *, n_chunks);
+	chunk_size = (n_keys + n_chunks - 1) / n_chunks;
+	for (i = 0; i < n_chunks; i++) {
+		chunks[i].keys = keys + MIN (i * chunk_size, n_keys);
+		chunks[i].n_keys = MIN (chunk_size, n_keys - (chunks[i].keys - keys));
+		chunks[i].inverse_sort = inverse_sort;
+		threads[i] = g_thread_new ("sort", sort_chunk_thread_func, &chunks[i]);
+	}
+	for (i = 0; i < n_chunks; i++)
+		g_thread_join (threads[i]);
+
+	/* merge the sorted chunks two by two, the merge is stable so the
+	 * result doesn't depend on the number of chunks for distinct
+	 * keys. */
+
+	buffer = g_new (RowKey, n_keys);
+	while (n_chunks > 1) {
+		int n_merged = 0;
+
+		for (i = 0; i < n_chunks; i += 2) {
+			SortChunk *a = &chunks[i];
+			SortChunk *b;
+			RowKey    *out;
+			int        ia, ib;
+
+			if (i + 1 == n_chunks) {
+				chunks[n_merged++] = *a;
+				continue;
+			}
+
+			b = &chunks[i + 1];
+			out = buffer + (a->keys - keys);
+			ia = ib = 0;
+			while ((ia < a->n_keys) && (ib < b->n_keys)) {
+				if (campare_row_key_func (&b->keys[ib], &a->keys[ia], &inverse_sort) < 0)
+					*out++ = b->keys[ib++];
+				else
+					*out++ = a->keys[ia++];
+			}
+			while (ia < a->n_keys)
+				*out++ = a->keys[ia++];
+			while (ib < b->n_keys)
+				*out++ = b->keys[ib++];
+
+			memcpy (a->keys, buffer + (a->keys - keys), sizeof (RowKey) * (a->n_keys + b->n_keys));
+			a->n_keys += b->n_keys;
+			chunks[n_merged++] = *a;
+		}
+		n_chunks = n_merged;
+	}
+
+	g_free (buffer);
+	g_free (threads);
+	g_free (chunks);
+}
+
+
+/**/
+
+
 static void
 _gth_file_store_sort (GthFileStore *file_store,
 		      gconstpointer pbase,
 		      gint          total_elems)
 {
+	GthFileRow **rows = (GthFileRow **) pbase;
+	RowKey      *keys;
+	int          i;
+
 	if (file_store->priv->cmp_func == NULL)
 		return;
 
-	g_qsort_with_data (pbase,
-			   total_elems,
-			   (gsize) sizeof (GthFileRow *),
-			   campare_row_func,
-			   file_store);
+	if ((file_store->priv->key_func == NULL) || (total_elems < SORT_KEYS_MIN_ROWS)) {
+		g_qsort_with_data (pbase,
+				   total_elems,
+				   (gsize) sizeof (GthFileRow *),
+				   campare_row_func,
+				   file_store);
+		return;
+	}
+
+	/* extract the keys once per file instead of once per comparison */
+
+	keys = g_new (RowKey, total_elems);
+	for (i = 0; i < total_elems; i++) {
+		keys[i].row = rows[i];
+		file_store->priv->key_func (rows[i]->file_data, &keys[i].key);
+	}
+
+	_gth_file_store_sort_keys (keys, total_elems, file_store->priv->inverse_sort);
+
+	for (i = 0; i < total_elems; i++) {
+		rows[i] = keys[i].row;
+		g_free (keys[i].key.text);
+	}
+	g_free (keys);
 }
 
 
@@ -997,6 +1253,7 @@ g_print ("\n");
 	g_free (file_store->priv->all_rows);
 	file_store->priv->all_rows = all_rows;
 	file_store->priv->tot_rows = all_rows_n;
+	_gth_file_store_index_rebuild (file_store);
 
 	g_qsort_with_data (old_rows,
 			   old_rows_n,
@@ -1048,6 +1305,161 @@ g_print ("  INSERT: %d\n", i);
 }
 
 
+static gboolean
+_gth_file_store_filter_has_limit (GthFileStore *file_store)
+{
+	GthLimitType limit_type;
+
+	if (! GTH_IS_FILTER (file_store->priv->filter))
+		return FALSE;
+
+	gth_filter_get_limit (GTH_FILTER (file_store->priv->filter), &limit_type, NULL, NULL, NULL);
+
+	return limit_type != GTH_LIMIT_TYPE_NONE;
+}
+
+
+/* Add the rows in add_queue without filtering and sorting again the rows
+ * already present: only the new rows are tested, they are merged into the
+ * sorted arrays and a row-inserted signal is emitted for each new visible
+ * row.  Cannot be used when the filter has a limit, because in that case
+ * the visibility of a file depends on the whole file list. */
+static void
+_gth_file_store_add_rows (GthFileStore *file_store,
+			  GList        *add_queue,
+			  int           position)
+{
+	GthFileRow **new_rows;
+	guint        new_rows_n;
+	GthFileRow **all_rows;
+	guint        all_rows_n;
+	guint        visible_n;
+	GHashTable  *new_rows_index;
+	GList       *files;
+	GList       *scan;
+	GthFileData *file;
+	int          i, j, k;
+
+#ifdef DEBUG_FILE_STORE
+g_print ("ADD ROWS\n");
+#endif
+
+	new_rows_n = g_list_length (add_queue);
+	new_rows = g_new (GthFileRow *, new_rows_n);
+	new_rows_index = g_hash_table_new (g_direct_hash, g_direct_equal);
+	files = NULL;
+	for (scan = add_queue, i = 0; scan; scan = scan->next, i++) {
+		GthFileRow *row = _gth_file_row_ref ((GthFileRow *) scan->data);
+
+		row->visible = FALSE;
+		new_rows[i] = row;
+		g_hash_table_insert (new_rows_index, row->file_data, row);
+		files = g_list_prepend (files, g_object_ref (row->file_data));
+	}
+	files = g_list_reverse (files);
+
+	/* filter the new rows */
+
+	gth_test_set_file_list (file_store->priv->filter, files);
+	while ((file = gth_test_get_next (file_store->priv->filter)) != NULL) {
+		GthFileRow *row;
+
+		row = g_hash_table_lookup (new_rows_index, file);
+		g_assert (row != NULL);
+		row->visible = TRUE;
+	}
+
+	_g_object_list_unref (files);
+	g_hash_table_unref (new_rows_index);
+
+	/* merge the new rows with the current ones, the new visible rows get
+	 * their final position, the old visible rows are moved below while
+	 * emitting the signals. */
+
+	_gth_file_store_sort (file_store, new_rows, new_rows_n);
+
+	if ((position < 0) || (position > file_store->priv->tot_rows))
+		position = file_store->priv->tot_rows;
+
+	all_rows_n = file_store->priv->tot_rows + new_rows_n;
+	all_rows = g_new (GthFileRow *, all_rows_n);
+	visible_n = 0;
+	for (i = 0, j = 0, k = 0; k < all_rows_n; k++) {
+		GthFileRow *row;
+		gboolean    add_new;
+
+		if (j >= new_rows_n)
+			add_new = FALSE;
+		else if (i >= file_store->priv->tot_rows)
+			add_new = TRUE;
+		else if (file_store->priv->cmp_func != NULL)
+			add_new = campare_row_func (&new_rows[j], &file_store->priv->all_rows[i], file_store) < 0;
+		else
+			add_new = (i == position);
+
+		if (add_new) {
+			row = new_rows[j++];
+			if (row->visible)
+				row->pos = visible_n;
+		}
+		else
+			row = file_store->priv->all_rows[i++];
+
+		row->abs_pos = k;
+		all_rows[k] = row;
+		if (row->visible)
+			visible_n++;
+	}
+
+	/* set the new state */
+
+	_gth_file_store_increment_stamp (file_store);
+
+	g_free (file_store->priv->all_rows);
+	file_store->priv->all_rows = all_rows;
+	file_store->priv->tot_rows = all_rows_n;
+
+	for (j = 0; j < new_rows_n; j++)
+		_gth_file_store_index_add (file_store, new_rows[j]);
+
+	/* add the new visible files */
+
+	file_store->priv->rows = g_renew (GthFileRow *, file_store->priv->rows, visible_n);
+	for (j = 0; j < new_rows_n; j++) {
+		GthFileRow  *row = new_rows[j];
+		GtkTreePath *path;
+		GtkTreeIter  iter;
+
+		if (! row->visible)
+			continue;
+
+		i = row->pos;
+
+#ifdef DEBUG_FILE_STORE
+g_print ("  INSERT: %d\n", i);
+#endif
+
+		for (k = file_store->priv->num_rows; k > i; k--) {
+			file_store->priv->rows[k] = file_store->priv->rows[k - 1];
+			file_store->priv->rows[k]->pos++;
+		}
+		file_store->priv->rows[i] = row;
+		file_store->priv->num_rows++;
+
+		path = gtk_tree_path_new_from_indices (i, -1);
+		gth_file_store_get_iter (GTK_TREE_MODEL (file_store), &iter, path);
+		gtk_tree_model_row_inserted (GTK_TREE_MODEL (file_store), path, &iter);
+		gtk_tree_path_free (path);
+	}
+
+	g_assert (file_store->priv->num_rows == visible_n);
+
+	g_signal_emit (file_store, gth_file_store_signals[VISIBILITY_CHANGED], 0);
+
+	g_free (new_rows);
+}
+
+
 void
 gth_file_store_set_filter (GthFileStore *file_store,
 			   GthTest      *filter)
@@ -1106,6 +1518,14 @@ gth_file_store_set_sort_func (GthFileStore        *file_store,
 		return;
 
 	file_store->priv->cmp_func = cmp_func;
+	file_store->priv->key_func = NULL;
+	if (cmp_func != NULL) {
+		GthFileDataSort *sort_type;
+
+		sort_type = gth_main_get_sort_type_for_func (cmp_func);
+		if (sort_type != NULL)
+			file_store->priv->key_func = sort_type->key_func;
+	}
 	file_store->priv->inverse_sort = inverse_sort;
 	_gth_file_store_reorder (file_store);
 }
@@ -1166,26 +1586,18 @@ gth_file_store_find (GthFileStore *file_store,
 		     GFile        *file,
 		     GtkTreeIter  *iter)
 {
-	gboolean found = FALSE;
-	int      i;
-
-	for (i = 0; i < file_store->priv->tot_rows; i++) {
-		GthFileRow *row = file_store->priv->all_rows[i];
+	GthFileRow *row;
 
-		if (row == NULL)
-			continue;
+	row = _gth_file_store_index_lookup (file_store, file, FALSE);
+	if (row == NULL)
+		return FALSE;
 
-		if (g_file_equal (row->file_data->file, file)) {
-			if (iter != NULL) {
-				iter->stamp = file_store->priv->stamp;
-				iter->user_data = row;
-			}
-			found = TRUE;
-			break;
-		}
+	if (iter != NULL) {
+		iter->stamp = file_store->priv->stamp;
+		iter->user_data = row;
 	}
 
-	return found;
+	return TRUE;
 }
 
 
@@ -1194,26 +1606,18 @@ gth_file_store_find_visible (GthFileStore *file_store,
 			     GFile        *file,
 			     GtkTreeIter  *iter)
 {
-	gboolean found = FALSE;
-	int      i;
-
-	for (i = 0; i < file_store->priv->num_rows; i++) {
-		GthFileRow *row = file_store->priv->rows[i];
+	GthFileRow *row;
 
-		if (row == NULL)
-			continue;
+	row = _gth_file_store_index_lookup (file_store, file, TRUE);
+	if (row == NULL)
+		return FALSE;
 
-		if (g_file_equal (row->file_data->file, file)) {
-			if (iter != NULL) {
-				iter->stamp = file_store->priv->stamp;
-				iter->user_data = row;
-			}
-			found = TRUE;
-			break;
-		}
+	if (iter != NULL) {
+		iter->stamp = file_store->priv->stamp;
+		iter->user_data = row;
 	}
 
-	return found;
+	return TRUE;
 }
 
 
@@ -1384,7 +1788,10 @@ void
 gth_file_store_exec_add (GthFileStore *file_store,
 			 int           position)
 {
-	_gth_file_store_update_visibility (file_store, file_store->priv->queue, position);
+	if ((file_store->priv->queue != NULL) && ! _gth_file_store_filter_has_limit (file_store))
+		_gth_file_store_add_rows (file_store, file_store->priv->queue, position);
+	else
+		_gth_file_store_update_visibility (file_store, file_store->priv->queue, position);
 	_gth_file_store_clear_queue (file_store);
 }
 
@@ -1411,7 +1818,9 @@ gth_file_store_queue_set_valist (GthFileStore *file_store,
   		case GTH_FILE_STORE_FILE_DATA_COLUMN:
   			file_data = va_arg (var_args, GthFileData *);
   			g_return_if_fail (GTH_IS_FILE_DATA (file_data));
+  			_gth_file_store_index_remove (file_store, row);
   			_gth_file_row_set_file (row, file_data);
+  			_gth_file_store_index_add (file_store, row);
   			row->changed = TRUE;
   			file_store->priv->update_filter = TRUE;
   			break;
@@ -1596,6 +2005,7 @@ gth_file_store_exec_remove (GthFileStore *file_store)
 		if (row->visible)
 			_gth_file_store_hide_row (file_store, row);
 
+		_gth_file_store_index_remove (file_store, row);
 		file_store->priv->all_rows[row->abs_pos] = NULL;
 		_gth_file_row_unref (row);
 	}
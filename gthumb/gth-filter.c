@@ -224,7 +224,7 @@ gth_filter_match (GthTest     *test,
 	else
 		match = GTH_MATCH_YES;
 
-	if (match == GTH_MATCH_YES) {
+	if ((match == GTH_MATCH_YES) && (filter->priv->limit_type != GTH_LIMIT_TYPE_NONE)) {
 		filter->priv->current_images++;
 		filter->priv->current_size += g_file_info_get_size (file->info);
 	}
@@ -246,6 +246,22 @@ gth_filter_match (GthTest     *test,
 }
 
 
+static gboolean
+gth_filter_compile (GthTest *test)
+{
+	GthFilter *filter = GTH_FILTER (test);
+
+	/* with a limit the result depends on the files tested before */
+	if (filter->priv->limit_type != GTH_LIMIT_TYPE_NONE)
+		return FALSE;
+
+	if (filter->priv->test != NULL)
+		return gth_test_compile (GTH_TEST (filter->priv->test));
+
+	return TRUE;
+}
+
+
 static void
 file_limit_spinbutton_changed_cb (GtkSpinButton *spinbutton,
 				  GthFilter      *filter)
@@ -453,6 +469,7 @@ gth_filter_class_init (GthFilterClass *klass)
 	test_class = GTH_TEST_CLASS (klass);
 	test_class->get_attributes = gth_filter_get_attributes;
 	test_class->set_file_list = gth_filter_set_file_list;
+	test_class->compile = gth_filter_compile;
 	test_class->match = gth_filter_match;
 	test_class->create_control = gth_filter_real_create_control;
 }
@@ -0,0 +1,252 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+/*
+ *  GThumb
+ *
+ *  Copyright (C) 2013 Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include "gio-utils.h"
+#include "gth-file-data.h"
+#include "gth-folder-cache.h"
+#include "gth-metadata.h"
+#include "gth-user-cache.h"
+
+
+/* The listing of a folder is saved as a GVariant with the following format:
+ *
+ *   version, folder uri, attributes, folder mtime, folder ctime,
+ *   array of (name, dictionary of file attributes)
+ *
+ * the times are in microseconds.  The cache is valid as long as the
+ * folder modification and change times are the same.  The cache files are
+ * managed by gth-user-cache.c. */
+
+
+#define CACHE_NAME "folders"
+#define CACHE_VERSION 1
+#define CACHE_FORMAT "(ussxxa(sa{sv}))"
+#define ENTRY_FORMAT "(sa{sv})"
+
+
+static gboolean
+_gth_folder_cache_get_folder_times (GFileInfo *folder_info,
+				    gint64    *mtime,
+				    gint64    *ctime)
+{
+	if (! g_file_info_has_attribute (folder_info, G_FILE_ATTRIBUTE_TIME_MODIFIED))
+		return FALSE;
+
+	*mtime = (gint64) g_file_info_get_attribute_uint64 (folder_info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC
+		 + g_file_info_get_attribute_uint32 (folder_info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+	*ctime = (gint64) g_file_info_get_attribute_uint64 (folder_info, G_FILE_ATTRIBUTE_TIME_CHANGED) * G_USEC_PER_SEC
+		 + g_file_info_get_attribute_uint32 (folder_info, G_FILE_ATTRIBUTE_TIME_CHANGED_USEC);
+
+	return TRUE;
+}
+
+
+/* Returns the cached listing of @folder as a list of GthFileData, or NULL if
+ * the cache doesn't exist or is not valid anymore.  @folder_info must contain
+ * the modification and change times of @folder, @attributes must be the
+ * attributes used to create the cache. */
+GList *
+gth_folder_cache_load (GFile      *folder,
+		       GFileInfo  *folder_info,
+		       const char *attributes)
+{
+	gint64        folder_mtime;
+	gint64        folder_ctime;
+	char         *uri;
+	GMappedFile  *mapped_file;
+	GVariant     *cache;
+	guint32       version;
+	const char   *cache_uri;
+	const char   *cache_attributes;
+	gint64        cache_mtime;
+	gint64        cache_ctime;
+	GVariantIter *entries;
+	const char   *name;
+	GVariantIter *attribute_iter;
+	GList        *list;
+
+	if (! _gth_folder_cache_get_folder_times (folder_info, &folder_mtime, &folder_ctime))
+		return NULL;
+
+	uri = g_file_get_uri (folder);
+	mapped_file = gth_user_cache_map_file (CACHE_NAME, uri);
+	if (mapped_file == NULL) {
+		g_free (uri);
+		return NULL;
+	}
+
+	cache = g_variant_new_from_data (G_VARIANT_TYPE (CACHE_FORMAT),
+					 g_mapped_file_get_contents (mapped_file),
+					 g_mapped_file_get_length (mapped_file),
+					 FALSE,
+					 (GDestroyNotify) g_mapped_file_unref,
+					 mapped_file);
+	g_variant_ref_sink (cache);
+
+	g_variant_get (cache,
+		       "(u&s&sxxa" ENTRY_FORMAT ")",
+		       &version,
+		       &cache_uri,
+		       &cache_attributes,
+		       &cache_mtime,
+		       &cache_ctime,
+		       &entries);
+
+	list = NULL;
+	if ((version == CACHE_VERSION)
+	    && (g_strcmp0 (cache_uri, uri) == 0)
+	    && (g_strcmp0 (cache_attributes, attributes) == 0)
+	    && (cache_mtime == folder_mtime)
+	    && (cache_ctime == folder_ctime))
+	{
+		while (g_variant_iter_loop (entries, "(&sa{sv})", &name, &attribute_iter)) {
+			GFileInfo  *info;
+			const char *attribute;
+			GVariant   *value;
+			GFile      *file;
+
+			info = g_file_info_new ();
+			while (g_variant_iter_loop (attribute_iter, "{&sv}", &attribute, &value))
+				_g_file_info_set_attribute_variant (info, attribute, value);
+
+			file = g_file_get_child (folder, name);
+			list = g_list_prepend (list, gth_file_data_new (file, info));
+
+			g_object_unref (file);
+			g_object_unref (info);
+		}
+		list = g_list_reverse (list);
+	}
+
+	g_variant_iter_free (entries);
+	g_free (uri);
+	g_variant_unref (cache);
+
+	return list;
+}
+
+
+/* Saves the attributes of @files matching @attributes, the file names are
+ * taken from the GFile, so the list must only contain children of @folder. */
+void
+gth_folder_cache_save (GFile      *folder,
+		       GFileInfo  *folder_info,
+		       const char *attributes,
+		       GList      *files)
+{
+	gint64                 folder_mtime;
+	gint64                 folder_ctime;
+	GFileAttributeMatcher *matcher;
+	GVariantBuilder        entries;
+	GList                 *scan;
+	char                  *uri;
+	GVariant              *cache;
+	gsize                  size;
+	void                  *buffer;
+
+	if (! _gth_folder_cache_get_folder_times (folder_info, &folder_mtime, &folder_ctime))
+		return;
+
+	matcher = g_file_attribute_matcher_new (attributes);
+	g_variant_builder_init (&entries, G_VARIANT_TYPE ("a" ENTRY_FORMAT));
+	for (scan = files; scan; scan = scan->next) {
+		GthFileData      *file_data = scan->data;
+		char             *name;
+		GVariantBuilder   attribute_builder;
+		char            **attribute_v;
+		int               i;
+
+		name = g_file_get_basename (file_data->file);
+		if (name == NULL)
+			continue;
+
+		g_variant_builder_init (&attribute_builder, G_VARIANT_TYPE ("a{sv}"));
+		attribute_v = g_file_info_list_attributes (file_data->info, NULL);
+		for (i = 0; attribute_v[i] != NULL; i++) {
+			GVariant *value;
+
+			if (! g_file_attribute_matcher_matches (matcher, attribute_v[i]))
+				continue;
+
+			value = _g_file_info_get_attribute_variant (file_data->info, attribute_v[i]);
+			if (value != NULL)
+				g_variant_builder_add (&attribute_builder, "{sv}", attribute_v[i], value);
+		}
+		g_variant_builder_add (&entries, ENTRY_FORMAT, name, &attribute_builder);
+
+		g_strfreev (attribute_v);
+		g_free (name);
+	}
+
+	uri = g_file_get_uri (folder);
+	cache = g_variant_new (CACHE_FORMAT,
+			       CACHE_VERSION,
+			       uri,
+			       attributes,
+			       folder_mtime,
+			       folder_ctime,
+			       &entries);
+	g_variant_ref_sink (cache);
+
+	size = g_variant_get_size (cache);
+	buffer = g_malloc (size);
+	g_variant_store (cache, buffer);
+	gth_user_cache_write_async (CACHE_NAME, uri, buffer, size);
+
+	g_variant_unref (cache);
+	g_free (uri);
+	g_file_attribute_matcher_unref (matcher);
+}
+
+
+void
+gth_folder_cache_remove (GFile *folder)
+{
+	char *uri;
+
+	uri = g_file_get_uri (folder);
+	gth_user_cache_delete_file (CACHE_NAME, uri);
+
+	g_free (uri);
+}
+
+
+/* Returns whether the cached info of a file is out of date, only the
+ * attributes that can change without changing the folder times are
+ * compared.  @info can be a stat-only info: the content type is not
+ * compared because it can only change if the modification time changes
+ * as well. */
+gboolean
+gth_folder_cache_file_changed (GFileInfo *cached_info,
+			       GFileInfo *info)
+{
+	GTimeVal cached_mtime;
+	GTimeVal mtime;
+
+	g_file_info_get_modification_time (cached_info, &cached_mtime);
+	g_file_info_get_modification_time (info, &mtime);
+
+	return (cached_mtime.tv_sec != mtime.tv_sec)
+		|| (cached_mtime.tv_usec != mtime.tv_usec)
+		|| (g_file_info_get_size (cached_info) != g_file_info_get_size (info))
+		|| (g_file_info_get_is_hidden (cached_info) != g_file_info_get_is_hidden (info));
+}
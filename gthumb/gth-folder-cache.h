@@ -0,0 +1,46 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+/*
+ *  GThumb
+ *
+ *  Copyright (C) 2013 Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GTH_FOLDER_CACHE_H
+#define GTH_FOLDER_CACHE_H
+
+#include <glib.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* folders with less files are not saved in the cache */
+#define GTH_FOLDER_CACHE_MIN_FILES 200
+
+GList *		gth_folder_cache_load		(GFile      *folder,
+						 GFileInfo  *folder_info,
+						 const char *attributes);
+void		gth_folder_cache_save		(GFile      *folder,
+						 GFileInfo  *folder_info,
+						 const char *attributes,
+						 GList      *files);
+void		gth_folder_cache_remove		(GFile      *folder);
+gboolean	gth_folder_cache_file_changed	(GFileInfo  *cached_info,
+						 GFileInfo  *info);
+
+G_END_DECLS
+
+#endif /* GTH_FOLDER_CACHE_H */
@@ -41,7 +41,8 @@
 
 
 #define GTH_GRID_VIEW_ITEM(x)      ((GthGridViewItem *)(x))
-#define GTH_GRID_VIEW_LINE(x)      ((GthGridViewLine *)(x))
+#define ITEM_AT(self, pos)         GTH_GRID_VIEW_ITEM (g_ptr_array_index ((self)->priv->items, (pos)))
+#define LINE_AT(self, n)           (&g_array_index ((self)->priv->lines, GthGridViewLine, (n)))
 #define CAPTION_LINE_SPACING       4
 #define DEFAULT_CAPTION_SPACING    4
 #define DEFAULT_CAPTION_PADDING    2
@@ -54,10 +55,15 @@
 #define RUBBERBAND_BORDER          2
 #define STEP_INCREMENT             0.10
 #define PAGE_INCREMENT             0.33
+#define MIN_CACHED_SURFACES        128
+#define CACHED_SURFACES_PAGES      3     /* cache the surfaces of the items in this number of pages */
+#define VIRTUAL_LAYOUT_MIN_ITEMS   5000  /* with more items the captions are measured only when shown */
 
 
 static void gth_grid_view_gth_file_selection_interface_init (GthFileSelectionInterface *iface);
 static void gth_grid_view_gth_file_view_interface_init (GthFileViewInterface *iface);
+static void _gth_grid_view_measure_lines (GthGridView *self, int first_line, int bottom);
+static void _gth_grid_view_measure_visible_lines (GthGridView *self);
 
 
 G_DEFINE_TYPE_WITH_CODE (GthGridView,
@@ -119,6 +125,15 @@ typedef struct {
 	GtkStateFlags          state;
 	GtkStateFlags          tmp_state;
 	gboolean               update_caption_height : 1;
+	guint                  layout_stamp;  /* the geometry is valid if equal to the view layout_stamp, 0 if never placed */
+
+	/* pre-rendered item, valid for surface_state and the area size */
+
+	cairo_surface_t       *surface;
+	GtkStateFlags          surface_state;
+	int                    surface_width;
+	int                    surface_height;
+	GList                 *surface_link;
 
 	/* geometry info */
 
@@ -130,17 +145,17 @@ typedef struct {
 
 
 typedef struct {
-	int    y;
-	int    height;
-	GList *items;
+	int      y;
+	int      height;
+	gboolean measured;  /* FALSE if height is an estimate, see _gth_grid_view_measure_lines */
 } GthGridViewLine;
 
 
 struct _GthGridViewPrivate {
 	GtkTreeModel          *model;
-	GList                 *items;
-	int                    n_items;
-	GList                 *lines;
+	GPtrArray             *items;
+	int                    n_items;             /* same as items->len */
+	GArray                *lines;               /* line n contains the items from n * items_per_line */
 	GList                 *selection;
 	int                    focused_item;
 	int                    first_focused_item;  /* Used to do multiple selection with the keyboard. */
@@ -152,6 +167,9 @@ struct _GthGridViewPrivate {
 	guint                  layout_timeout;
 	int                    relayout_from_line;
 	guint                  update_caption_height : 1;
+	guint                  layout_stamp;
+	guint                  virtual_layout : 1;  /* the lines are measured only when shown, see _gth_grid_view_use_virtual_layout */
+	int                    estimated_caption_height;
 
 	int                    width;               /* size of the view */
 	int                    height;
@@ -210,16 +228,31 @@ struct _GthGridViewPrivate {
 	PangoLayout           *caption_layout;
 
 	GthIconCache          *icon_cache;
+	GQueue                *cached_items;        /* items with a pre-rendered surface, least recently used first */
+	int                    max_cached_items;
 };
 
 
 /* -- gth_grid_view_item -- */
 
 
+static void
+gth_grid_view_item_invalidate_surface (GthGridViewItem *item)
+{
+	if (item->surface == NULL)
+		return;
+
+	cairo_surface_destroy (item->surface);
+	item->surface = NULL;
+}
+
+
 static void
 gth_grid_view_item_set_file_data (GthGridViewItem *item,
 	          	  	  GthFileData     *file_data)
 {
+	gth_grid_view_item_invalidate_surface (item);
+
 	_g_object_unref (item->file_data);
 	item->file_data = _g_object_ref (file_data);
 
@@ -232,6 +265,8 @@ static void
 gth_grid_view_item_set_thumbnail (GthGridViewItem *item,
 				  cairo_surface_t *thumbnail)
 {
+	gth_grid_view_item_invalidate_surface (item);
+
 	cairo_surface_destroy (item->thumbnail);
 	item->thumbnail = cairo_surface_reference (thumbnail);
 
@@ -263,6 +298,7 @@ gth_grid_view_item_update_caption (GthGridViewItem  *item,
 	int       i;
 
 	item->update_caption_height = TRUE;
+	gth_grid_view_item_invalidate_surface (item);
 
 	g_free (item->caption);
 	item->caption = NULL;
@@ -347,43 +383,58 @@ gth_grid_view_item_unref (GthGridViewItem *item)
 		return;
 
 	g_free (item->caption);
+	cairo_surface_destroy (item->surface);
 	cairo_surface_destroy (item->thumbnail);
 	_g_object_unref (item->file_data);
 	g_free (item);
 }
 
 
-/* -- gth_grid_view_line -- */
+/**/
 
 
 static void
-gth_grid_view_line_free (GthGridViewLine *line)
+_gth_grid_view_free_lines (GthGridView *self)
 {
-	g_list_foreach (line->items, (GFunc) gth_grid_view_item_unref, NULL);
-	g_list_free (line->items);
-	g_free (line);
+	g_array_set_size (self->priv->lines, 0);
+	self->priv->height = 0;
 }
 
 
-/**/
+static void
+_gth_grid_view_free_item_surfaces (GthGridView *self)
+{
+	GthGridViewItem *item;
+
+	while ((item = g_queue_pop_head (self->priv->cached_items)) != NULL) {
+		item->surface_link = NULL;
+		gth_grid_view_item_invalidate_surface (item);
+		gth_grid_view_item_unref (item);
+	}
+}
 
 
+/* Releases the pre-rendered surface of @item and removes it from the cached
+ * items. */
 static void
-_gth_grid_view_free_lines (GthGridView *self)
+_gth_grid_view_uncache_item_surface (GthGridView     *self,
+				     GthGridViewItem *item)
 {
-	g_list_foreach (self->priv->lines, (GFunc) gth_grid_view_line_free, NULL);
-	g_list_free (self->priv->lines);
-	self->priv->lines = NULL;
-	self->priv->height = 0;
+	if (item->surface_link == NULL)
+		return;
+
+	g_queue_delete_link (self->priv->cached_items, item->surface_link);
+	item->surface_link = NULL;
+	gth_grid_view_item_invalidate_surface (item);
+	gth_grid_view_item_unref (item);
 }
 
 
 static void
 _gth_grid_view_free_items (GthGridView *self)
 {
-	g_list_foreach (self->priv->items, (GFunc) gth_grid_view_item_unref, NULL);
-	g_list_free (self->priv->items);
-	self->priv->items = NULL;
+	g_ptr_array_set_size (self->priv->items, 0);
+	self->priv->n_items = 0;
 
 	g_list_free (self->priv->selection);
 	self->priv->selection = NULL;
@@ -409,6 +460,10 @@ gth_grid_view_finalize (GObject *object)
 
 	_gth_grid_view_free_items (self);
 	_gth_grid_view_free_lines (self);
+	g_array_free (self->priv->lines, TRUE);
+	_gth_grid_view_free_item_surfaces (self);
+	g_queue_free (self->priv->cached_items);
+	g_ptr_array_free (self->priv->items, TRUE);
 	g_list_free (self->priv->selection);
 
 	if (self->priv->hadjustment != NULL) {
@@ -439,10 +494,12 @@ static gboolean
 adjustment_value_changed (GtkAdjustment *adj,
 			  GthGridView   *self)
 {
-	if (gtk_widget_get_realized (GTK_WIDGET (self)))
+	if (gtk_widget_get_realized (GTK_WIDGET (self))) {
+		_gth_grid_view_measure_visible_lines (self);
 		gdk_window_move (self->priv->bin_window,
 				 (int) - gtk_adjustment_get_value (self->priv->hadjustment),
 				 (int) - gtk_adjustment_get_value (self->priv->vadjustment));
+	}
 
 	return FALSE;
 }
@@ -459,6 +516,23 @@ gth_grid_view_map (GtkWidget *widget)
 }
 
 
+/* The surface cache holds the items of a few pages, so that scrolling back
+ * and forth doesn't render the items again, and it's never smaller than
+ * the items shown at once. */
+static void
+_gth_grid_view_update_max_cached_items (GthGridView *self)
+{
+	int lines_per_page;
+	int items_per_page;
+
+	/* the lines are at least cell_size high, count the partially
+	 * visible lines at the top and at the bottom as well */
+	lines_per_page = gtk_widget_get_allocated_height (GTK_WIDGET (self)) / (self->priv->cell_size + self->priv->cell_spacing) + 2;
+	items_per_page = lines_per_page * gth_grid_view_get_items_per_line (self);
+	self->priv->max_cached_items = MAX (MIN_CACHED_SURFACES, CACHED_SURFACES_PAGES * items_per_page);
+}
+
+
 static void
 _gth_grid_view_stop_dragging (GthGridView *self)
 {
@@ -490,30 +564,22 @@ gth_grid_view_scroll_to (GthFileView *file_view,
 {
 	GthGridView *self = GTH_GRID_VIEW (file_view);
 	int          n_line;
-	int          y;
-	int          i;
-	GList       *line;
 
 	g_return_if_fail ((pos >= 0) && (pos < self->priv->n_items));
 	g_return_if_fail ((yalign >= 0.0) && (yalign <= 1.0));
 
-	if (self->priv->lines == NULL)
-		return;
-
 	n_line = pos / gth_grid_view_get_items_per_line (self);
-	y = self->priv->cell_spacing;
-	for (i = 0, line = self->priv->lines;
-	     (i < n_line) && (line != NULL);
-	     i++, line = line->next)
-	{
-		y += GTH_GRID_VIEW_LINE (line->data)->height + self->priv->cell_spacing;
-	}
+	if (n_line < self->priv->lines->len) {
+		GthGridViewLine *line;
+		int              y;
+		int              h;
+		double           value;
 
-	if (line != NULL) {
-		int    h;
-		double value;
+		_gth_grid_view_measure_lines (self, n_line, LINE_AT (self, n_line)->y + 1);
 
-		h = gtk_widget_get_allocated_height (GTK_WIDGET (self)) - GTH_GRID_VIEW_LINE (line->data)->height - self->priv->cell_spacing;
+		line = LINE_AT (self, n_line);
+		y = line->y;
+		h = gtk_widget_get_allocated_height (GTK_WIDGET (self)) - line->height - self->priv->cell_spacing;
 		value = CLAMP ((y - (h * yalign) - ((1.0 - yalign) * self->priv->cell_spacing)),
 			       0.0,
 			       self->priv->height - gtk_widget_get_allocated_height (GTK_WIDGET (self)));
@@ -538,33 +604,23 @@ static GthVisibility
 gth_grid_view_get_visibility (GthFileView *file_view,
 			      int          pos)
 {
-	GthGridView *self = GTH_GRID_VIEW (file_view);
-	int          cell_top;
-	int          line_n;
-	int          i;
-	GList       *line;
-	int          cell_bottom;
-	int          window_top;
-	int          window_bottom;
+	GthGridView     *self = GTH_GRID_VIEW (file_view);
+	int              line_n;
+	GthGridViewLine *line;
+	int              cell_top;
+	int              cell_bottom;
+	int              window_top;
+	int              window_bottom;
 
 	g_return_val_if_fail ((pos >= 0) && (pos < self->priv->n_items), GTH_VISIBILITY_NONE);
 
-	if (self->priv->lines == NULL)
-		return GTH_VISIBILITY_NONE;
-
-	cell_top = self->priv->cell_spacing;
 	line_n = pos / gth_grid_view_get_items_per_line (self);
-	for (i = 0, line = self->priv->lines;
-	     (i < line_n) && (line != NULL);
-	     i++, line = line->next)
-	{
-		cell_top += GTH_GRID_VIEW_LINE (line->data)->height + self->priv->cell_spacing;
-	}
-
-	if (line == NULL)
+	if (line_n >= self->priv->lines->len)
 		return GTH_VISIBILITY_NONE;
 
-	cell_bottom = cell_top + GTH_GRID_VIEW_LINE (line->data)->height + self->priv->cell_spacing;
+	line = LINE_AT (self, line_n);
+	cell_top = line->y;
+	cell_bottom = cell_top + line->height + self->priv->cell_spacing;
 	window_top = gtk_adjustment_get_value (self->priv->vadjustment);
 	window_bottom = window_top + gtk_widget_get_allocated_height (GTK_WIDGET (self));
 
@@ -697,48 +753,63 @@ _gth_grid_view_place_item_at (GthGridView     *self,
 }
 
 
-static void
-_gth_grid_view_layout_line (GthGridView     *self,
-			    GthGridViewLine *line)
+/* Returns the item at the given position, updating its geometry if the
+ * layout changed after the last time it was placed.  The items are placed
+ * lazily, so every access to the item geometry must use this function. */
+static GthGridViewItem *
+_gth_grid_view_layout_item (GthGridView *self,
+			    int          pos)
 {
-	int    x;
-	int    direction;
-	GList *scan;
+	GthGridViewItem *item;
+	int              items_per_line;
+	int              n_line;
+	int              column;
+	int              x;
 
-	if (gtk_widget_get_direction (GTK_WIDGET (self)) == GTK_TEXT_DIR_RTL) {
-		x = self->priv->width - self->priv->cell_size;
-		direction = -1;
-	}
-	else {
-		x = 0;
-		direction = 1;
-	}
+	item = ITEM_AT (self, pos);
+	if (item->layout_stamp == self->priv->layout_stamp)
+		return item;
 
-	for (scan = line->items; scan; scan = scan->next) {
-		GthGridViewItem *item = scan->data;
+	items_per_line = gth_grid_view_get_items_per_line (self);
+	n_line = pos / items_per_line;
+	if (n_line >= self->priv->lines->len)
+		return item;
 
-		x += direction * self->priv->cell_spacing;
-		_gth_grid_view_place_item_at (self, item, x, line->y);
-		x += direction * self->priv->cell_size;
-	}
+	column = pos % items_per_line;
+	if (gtk_widget_get_direction (GTK_WIDGET (self)) == GTK_TEXT_DIR_RTL)
+		x = self->priv->width - self->priv->cell_size - self->priv->cell_spacing - column * (self->priv->cell_size + self->priv->cell_spacing);
+	else
+		x = self->priv->cell_spacing + column * (self->priv->cell_size + self->priv->cell_spacing);
+
+	_gth_grid_view_update_item_size (self, item);
+	_gth_grid_view_place_item_at (self, item, x, LINE_AT (self, n_line)->y);
+	item->layout_stamp = self->priv->layout_stamp;
+
+	return item;
 }
 
 
-static GthGridViewLine *
-_gth_grid_view_line_new (GthGridView *self,
-		     	 GList       *items,
-		     	 int          y,
-		     	 int          height)
+/* Returns the number of lines with line->y + offset < y. */
+static int
+_gth_grid_view_count_lines_above (GthGridView *self,
+				  double       y,
+				  int          offset)
 {
-	GthGridViewLine *line;
+	int low;
+	int high;
 
-	line = g_new0 (GthGridViewLine, 1);
-	line->items = g_list_reverse (items);
-	line->y = y;
-	line->height = height;
-	_gth_grid_view_layout_line (self, line);
+	low = 0;
+	high = self->priv->lines->len;
+	while (low < high) {
+		int mid = (low + high) / 2;
+
+		if (LINE_AT (self, mid)->y + offset < y)
+			low = mid + 1;
+		else
+			high = mid;
+	}
 
-	return line;
+	return low;
 }
 
 
@@ -790,61 +861,179 @@ _gth_grid_view_configure_vadjustment (GthGridView *self)
 }
 
 
+/* invalidate the geometry of all the items, 0 is reserved for the items
+ * never placed */
+static void
+_gth_grid_view_new_layout_stamp (GthGridView *self)
+{
+	self->priv->layout_stamp++;
+	if (self->priv->layout_stamp == 0)
+		self->priv->layout_stamp = 1;
+}
+
+
+static void
+_gth_grid_view_set_height (GthGridView *self,
+			   int          height)
+{
+	GtkAllocation allocation;
+
+	if (height == self->priv->height)
+		return;
+
+	self->priv->height = height;
+
+	gtk_widget_get_allocation (GTK_WIDGET (self), &allocation);
+	gdk_window_resize (self->priv->bin_window,
+			   MAX (self->priv->width, allocation.width),
+			   MAX (self->priv->height, allocation.height));
+}
+
+
+/* In the virtual layout the lines not shown yet have an estimated height.
+ * Measure the captions of the lines from first_line to the one at the y
+ * offset 'bottom', and move the following lines accordingly.  The view is
+ * scrolled by the height change of the lines that start above it, so that
+ * the visible content doesn't move. */
+static void
+_gth_grid_view_measure_lines (GthGridView *self,
+			      int          first_line,
+			      int          bottom)
+{
+	int items_per_line;
+	int scroll_value;
+	int scroll_delta;
+	int delta;
+	int n;
+
+	if (! self->priv->virtual_layout || ! gtk_widget_get_realized (GTK_WIDGET (self)))
+		return;
+
+	items_per_line = gth_grid_view_get_items_per_line (self);
+	scroll_value = (self->priv->vadjustment != NULL) ? gtk_adjustment_get_value (self->priv->vadjustment) : 0;
+	scroll_delta = 0;
+	delta = 0;
+	for (n = MAX (first_line, 0); n < self->priv->lines->len; n++) {
+		GthGridViewLine *line = LINE_AT (self, n);
+		int              height;
+		int              pos;
+
+		line->y += delta;
+		if (line->y >= bottom + scroll_delta) {
+			n++;
+			break;
+		}
+
+		if (line->measured)
+			continue;
+
+		height = 0;
+		for (pos = n * items_per_line; (pos < (n + 1) * items_per_line) && (pos < self->priv->n_items); pos++) {
+			GthGridViewItem *item = ITEM_AT (self, pos);
+
+			_gth_grid_view_update_item_size (self, item);
+			height = MAX (item->area.height, height);
+		}
+		line->measured = TRUE;
+
+		if (height != line->height) {
+			if (line->y < scroll_value + scroll_delta)
+				scroll_delta += height - line->height;
+			delta += height - line->height;
+			line->height = height;
+		}
+	}
+
+	if (delta == 0)
+		return;
+
+	for (/* void */; n < self->priv->lines->len; n++)
+		LINE_AT (self, n)->y += delta;
+
+	_gth_grid_view_new_layout_stamp (self);
+	_gth_grid_view_set_height (self, self->priv->height + delta);
+	_gth_grid_view_configure_hadjustment (self);
+	_gth_grid_view_configure_vadjustment (self);
+	if ((scroll_delta != 0) && (self->priv->vadjustment != NULL))
+		gtk_adjustment_set_value (self->priv->vadjustment, scroll_value + scroll_delta);
+
+	gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+
+static void
+_gth_grid_view_measure_visible_lines (GthGridView *self)
+{
+	double value;
+	int    first_line;
+
+	if (! self->priv->virtual_layout || (self->priv->vadjustment == NULL))
+		return;
+
+	value = gtk_adjustment_get_value (self->priv->vadjustment);
+	first_line = _gth_grid_view_count_lines_above (self, value, - self->priv->cell_spacing) - 1;
+	_gth_grid_view_measure_lines (self,
+				      first_line,
+				      value + gtk_widget_get_allocated_height (GTK_WIDGET (self)));
+}
+
+
 static void
 _gth_grid_view_relayout_at (GthGridView *self,
 		    	    int          pos,
 		    	    int          y)
 {
-	GList *new_lines;
-	int    items_per_line;
-	GList *items;
-	int    max_height;
-	GList *scan;
-	int    n;
+	int             items_per_line;
+	GthGridViewLine line;
+	int             n;
 
-	new_lines = NULL;
 	items_per_line = gth_grid_view_get_items_per_line (self);
-	items = NULL;
-	max_height = 0;
-	for (scan = g_list_nth (self->priv->items, pos), n = pos;
-	     scan;
-	     scan = scan->next, n++)
-	{
-		GthGridViewItem *item = scan->data;
 
-		if ((n % items_per_line) == 0) {
-			if (items != NULL) {
-				new_lines = g_list_prepend (new_lines, _gth_grid_view_line_new (self, items, y, max_height));
-				items = NULL;
-				y += max_height + self->priv->cell_spacing;
-			}
-			max_height = 0;
-		}
+	if (self->priv->virtual_layout && (pos < self->priv->n_items)) {
+		int n_lines;
 
-		_gth_grid_view_update_item_size (self, item);
-		max_height = MAX (item->area.height, max_height);
+		/* use the same estimated height for all the lines, the
+		 * captions are measured when shown, see
+		 * _gth_grid_view_measure_lines.  Without captions the
+		 * estimate is exact. */
 
-		items = g_list_prepend (items, gth_grid_view_item_ref (item));
-	}
+		line.height = self->priv->cell_size;
+		if (self->priv->estimated_caption_height > 0)
+			line.height += self->priv->caption_spacing + self->priv->estimated_caption_height;
+		line.measured = (self->priv->estimated_caption_height == 0);
 
-	if (items != NULL) {
-		new_lines = g_list_prepend (new_lines, _gth_grid_view_line_new (self, items, y, max_height));
-		y += max_height + self->priv->cell_spacing;
+		n_lines = (self->priv->n_items - pos + items_per_line - 1) / items_per_line;
+		for (n = 0; n < n_lines; n++) {
+			line.y = y;
+			g_array_append_val (self->priv->lines, line);
+			y += line.height + self->priv->cell_spacing;
+		}
 	}
+	else {
+		line.y = y;
+		line.height = 0;
+		line.measured = TRUE;
+		for (n = pos; n < self->priv->n_items; n++) {
+			GthGridViewItem *item = ITEM_AT (self, n);
+
+			if (((n % items_per_line) == 0) && (n > pos)) {
+				g_array_append_val (self->priv->lines, line);
+				y += line.height + self->priv->cell_spacing;
+				line.y = y;
+				line.height = 0;
+			}
 
-	self->priv->lines = g_list_concat (self->priv->lines, g_list_reverse (new_lines));
-
-	if (y != self->priv->height) {
-		GtkAllocation allocation;
-
-		self->priv->height = y;
+			_gth_grid_view_update_item_size (self, item);
+			line.height = MAX (item->area.height, line.height);
+		}
 
-		gtk_widget_get_allocation (GTK_WIDGET (self), &allocation);
-		gdk_window_resize (self->priv->bin_window,
-				   MAX (self->priv->width, allocation.width),
-				   MAX (self->priv->height, allocation.height));
+		if (pos < self->priv->n_items) {
+			g_array_append_val (self->priv->lines, line);
+			y += line.height + self->priv->cell_spacing;
+		}
 	}
 
+	_gth_grid_view_set_height (self, y);
 	_gth_grid_view_configure_hadjustment (self);
 	_gth_grid_view_configure_vadjustment (self);
 }
@@ -854,22 +1043,58 @@ static void
 _gth_grid_view_free_lines_from (GthGridView *self,
 				int          first_line)
 {
-	GList *lines;
-	GList *scan;
+	if (first_line < self->priv->lines->len)
+		g_array_set_size (self->priv->lines, first_line);
+}
+
+
+/* Huge folders use a layout where the line geometry is computed from an
+ * estimated item height, the captions are measured only when the lines are
+ * shown, and the items are placed only when they are shown.  The captions
+ * are rendered as in the other layout.  Without captions every item has the
+ * same size and the estimate is exact. */
+static gboolean
+_gth_grid_view_use_virtual_layout (GthGridView *self)
+{
+	if ((self->priv->caption_attributes_v == NULL)
+	    || g_str_equal (self->priv->caption_attributes_v[0], "none"))
+	{
+		return TRUE;
+	}
+
+	return self->priv->n_items >= VIRTUAL_LAYOUT_MIN_ITEMS;
+}
+
+
+/* the height of a caption with a line for each attribute */
+static void
+_gth_grid_view_update_estimated_caption_height (GthGridView *self)
+{
+	GString  *markup;
+	gboolean  odd;
+	int       i;
+
+	self->priv->estimated_caption_height = 0;
 
-	lines = g_list_nth (self->priv->lines, first_line);
-	if (lines == NULL)
+	if ((self->priv->caption_attributes_v == NULL)
+	    || g_str_equal (self->priv->caption_attributes_v[0], "none"))
+	{
 		return;
+	}
 
-	/* truncate self->priv->lines before the first line to free */
-	if (lines->prev != NULL)
-		lines->prev->next = NULL;
-	else
-		self->priv->lines = NULL;
+	markup = g_string_new (NULL);
+	odd = TRUE;
+	for (i = 0; self->priv->caption_attributes_v[i] != NULL; i++) {
+		if (i > 0)
+			g_string_append (markup, "\n");
+		g_string_append_printf (markup, "<span%s>X</span>", (odd ? ODD_ROW_ATTR_STYLE : EVEN_ROW_ATTR_STYLE));
+		odd = ! odd;
+	}
+	pango_layout_set_markup (self->priv->caption_layout, markup->str, -1);
+	pango_layout_get_pixel_size (self->priv->caption_layout, NULL, &self->priv->estimated_caption_height);
+	self->priv->estimated_caption_height += self->priv->caption_padding * 2;
 
-	for (scan = lines; scan; scan = scan->next)
-		gth_grid_view_line_free (GTH_GRID_VIEW_LINE (scan->data));
-	g_list_free (lines);
+	g_string_free (markup, TRUE);
 }
 
 
@@ -877,26 +1102,49 @@ static void
 _gth_grid_view_relayout_from_line (GthGridView *self,
 				   int          line)
 {
-	int    y;
-	GList *scan;
+	gboolean virtual_layout;
+	int      y;
 
 	if (! gtk_widget_get_realized (GTK_WIDGET (self))) {
 		self->priv->needs_relayout = TRUE;
 		return;
 	}
 
-	if (self->priv->update_caption_height)
+	virtual_layout = _gth_grid_view_use_virtual_layout (self);
+	if (virtual_layout != self->priv->virtual_layout) {
+		self->priv->virtual_layout = virtual_layout;
+		self->priv->update_caption_height = TRUE;
+		line = 0;
+	}
+
+	if (self->priv->update_caption_height) {
 		pango_layout_set_width (self->priv->caption_layout,
 				        (self->priv->cell_size - (self->priv->cell_padding * 2)) * PANGO_SCALE);
+		if (self->priv->virtual_layout) {
+			int i;
+
+			_gth_grid_view_update_estimated_caption_height (self);
+
+			/* the items are measured later, when shown */
+			for (i = 0; i < self->priv->n_items; i++)
+				ITEM_AT (self, i)->update_caption_height = TRUE;
+		}
+	}
 
 	_gth_grid_view_free_lines_from (self, line);
-	y = self->priv->cell_spacing;
-	for (scan = self->priv->lines; scan; scan = scan->next)
-		y += GTH_GRID_VIEW_LINE (scan->data)->height + self->priv->cell_spacing;
+	line = MIN (line, self->priv->lines->len);
+	if (self->priv->lines->len > 0) {
+		GthGridViewLine *last_line = LINE_AT (self, self->priv->lines->len - 1);
+		y = last_line->y + last_line->height + self->priv->cell_spacing;
+	}
+	else
+		y = self->priv->cell_spacing;
 
+	_gth_grid_view_new_layout_stamp (self);
 	_gth_grid_view_relayout_at (self,
 				    line * gth_grid_view_get_items_per_line (self),
 				    y);
+	_gth_grid_view_measure_visible_lines (self);
 
 	self->priv->update_caption_height = FALSE;
 	self->priv->relayout_from_line = -1;
@@ -1063,6 +1311,8 @@ gth_grid_view_unrealize (GtkWidget *widget)
 	gth_icon_cache_free (self->priv->icon_cache);
 	self->priv->icon_cache = NULL;
 
+	_gth_grid_view_free_item_surfaces (self);
+
 	GTK_WIDGET_CLASS (gth_grid_view_parent_class)->unrealize (widget);
 }
 
@@ -1089,6 +1339,7 @@ static void
 gth_grid_view_state_flags_changed (GtkWidget     *widget,
                                    GtkStateFlags  previous_state)
 {
+	_gth_grid_view_free_item_surfaces (GTH_GRID_VIEW (widget));
 	_gth_grid_view_update_background (GTH_GRID_VIEW (widget));
 	gtk_widget_queue_draw (widget);
 }
@@ -1099,6 +1350,7 @@ gth_grid_view_style_updated (GtkWidget *widget)
 {
 	GTK_WIDGET_CLASS (gth_grid_view_parent_class)->style_updated (widget);
 
+	_gth_grid_view_free_item_surfaces (GTH_GRID_VIEW (widget));
 	_gth_grid_view_update_background (GTH_GRID_VIEW (widget));
 	gtk_widget_queue_resize (widget);
 }
@@ -1145,6 +1397,7 @@ gth_grid_view_size_allocate (GtkWidget     *widget,
 	self->priv->width = allocation->width;
 
 	gtk_widget_set_allocation (widget, allocation);
+	_gth_grid_view_update_max_cached_items (self);
 
 	if (gtk_widget_get_realized (widget)) {
 		gdk_window_move_resize (gtk_widget_get_window (widget),
@@ -1171,18 +1424,13 @@ static int
 get_first_visible_at_offset (GthGridView *self,
 			     double       ofs)
 {
-	int    n_line;
-	GList *scan;
-	int    pos;
+	int n_line;
+	int pos;
 
-	if ((self->priv->n_items == 0) || (self->priv->lines == NULL))
+	if ((self->priv->n_items == 0) || (self->priv->lines->len == 0))
 		return -1;
 
-	n_line = 0;
-	for (scan = self->priv->lines; scan && (ofs > 0.0); scan = scan->next) {
-		ofs -= GTH_GRID_VIEW_LINE (scan->data)->height + self->priv->cell_spacing;
-		n_line++;
-	}
+	n_line = _gth_grid_view_count_lines_above (self, ofs, - self->priv->cell_spacing);
 	pos = gth_grid_view_get_items_per_line (self) * (n_line - 1);
 
 	return CLAMP (pos, 0, self->priv->n_items - 1);
@@ -1202,18 +1450,13 @@ static int
 get_last_visible_at_offset (GthGridView *self,
 			    double       ofs)
 {
-	int    n_line;
-	GList *scan;
-	int    pos;
+	int n_line;
+	int pos;
 
-	if ((self->priv->n_items == 0) || (self->priv->lines == NULL))
+	if ((self->priv->n_items == 0) || (self->priv->lines->len == 0))
 		return -1;
 
-	n_line = 0;
-	for (scan = self->priv->lines; scan && (ofs > 0.0); scan = scan->next) {
-		ofs -= GTH_GRID_VIEW_LINE (scan->data)->height + self->priv->cell_spacing;
-		n_line++;
-	}
+	n_line = _gth_grid_view_count_lines_above (self, ofs, - self->priv->cell_spacing);
 	pos = gth_grid_view_get_items_per_line (self) * n_line - 1;
 
 	return CLAMP (pos, 0, self->priv->n_items - 1);
@@ -1569,18 +1812,11 @@ _gth_grid_view_item_draw_emblems (GthGridViewItem *item,
 
 
 static void
-_gth_grid_view_draw_item (GthGridView     *self,
-			  GthGridViewItem *item,
-			  cairo_t         *cr)
+_gth_grid_view_render_item (GthGridView     *self,
+			    GthGridViewItem *item,
+			    GtkStateFlags    item_state,
+			    cairo_t         *cr)
 {
-	GtkStateType item_state;
-
-	item_state = item->state;
-	if (! gtk_widget_has_focus (GTK_WIDGET (self)) && (item_state & GTK_STATE_FLAG_FOCUSED))
-		item_state ^= GTK_STATE_FLAG_FOCUSED;
-	if (! gtk_widget_has_focus (GTK_WIDGET (self)) && (item_state & GTK_STATE_FLAG_ACTIVE))
-		item_state ^= GTK_STATE_FLAG_ACTIVE;
-
 	if (item_state ^ GTK_STATE_FLAG_NORMAL) {
 		GtkStyleContext *style_context;
 		GdkRGBA          color;
@@ -1607,6 +1843,105 @@ _gth_grid_view_draw_item (GthGridView     *self,
 }
 
 
+static void
+_gth_grid_view_cache_item_surface (GthGridView     *self,
+				   GthGridViewItem *item,
+				   GtkStateFlags    item_state)
+{
+	cairo_t *cr;
+
+	gth_grid_view_item_invalidate_surface (item);
+
+	item->surface = gdk_window_create_similar_surface (self->priv->bin_window,
+							   CAIRO_CONTENT_COLOR_ALPHA,
+							   item->area.width,
+							   item->area.height);
+	item->surface_state = item_state;
+	item->surface_width = item->area.width;
+	item->surface_height = item->area.height;
+
+	cr = cairo_create (item->surface);
+	cairo_translate (cr, - item->area.x, - item->area.y);
+	cairo_set_line_width (cr, 1.0);
+	_gth_grid_view_render_item (self, item, item_state, cr);
+	cairo_destroy (cr);
+
+	/* the queue holds a reference to the items with a surface */
+
+	if (item->surface_link == NULL) {
+		item->surface_link = g_list_alloc ();
+		item->surface_link->data = gth_grid_view_item_ref (item);
+		g_queue_push_tail_link (self->priv->cached_items, item->surface_link);
+	}
+}
+
+
+/* Keeps the most recently drawn items at the tail of the queue. */
+static void
+_gth_grid_view_touch_item_surface (GthGridView     *self,
+				   GthGridViewItem *item)
+{
+	if (item->surface_link == NULL)
+		return;
+
+	if (item->surface_link->next != NULL) {
+		g_queue_unlink (self->priv->cached_items, item->surface_link);
+		g_queue_push_tail_link (self->priv->cached_items, item->surface_link);
+	}
+}
+
+
+/* Releases the surfaces of the items that were not drawn recently, the
+ * last n_drawn items of the queue were drawn in the current frame and are
+ * always kept. */
+static void
+_gth_grid_view_trim_item_surfaces (GthGridView *self,
+				   int          n_drawn)
+{
+	while (g_queue_get_length (self->priv->cached_items) > MAX (self->priv->max_cached_items, n_drawn)) {
+		GthGridViewItem *old_item;
+
+		old_item = g_queue_pop_head (self->priv->cached_items);
+		old_item->surface_link = NULL;
+		gth_grid_view_item_invalidate_surface (old_item);
+		gth_grid_view_item_unref (old_item);
+	}
+}
+
+
+static void
+_gth_grid_view_draw_item (GthGridView     *self,
+			  GthGridViewItem *item,
+			  cairo_t         *cr)
+{
+	GtkStateFlags item_state;
+
+	item_state = item->state;
+	if (! gtk_widget_has_focus (GTK_WIDGET (self)) && (item_state & GTK_STATE_FLAG_FOCUSED))
+		item_state ^= GTK_STATE_FLAG_FOCUSED;
+	if (! gtk_widget_has_focus (GTK_WIDGET (self)) && (item_state & GTK_STATE_FLAG_ACTIVE))
+		item_state ^= GTK_STATE_FLAG_ACTIVE;
+
+	if ((item->area.width <= 0) || (item->area.height <= 0))
+		return;
+
+	if ((item->surface == NULL)
+	    || (item->surface_state != item_state)
+	    || (item->surface_width != item->area.width)
+	    || (item->surface_height != item->area.height))
+	{
+		_gth_grid_view_cache_item_surface (self, item, item_state);
+	}
+	_gth_grid_view_touch_item_surface (self, item);
+
+	cairo_save (cr);
+	cairo_set_source_surface (cr, item->surface, item->area.x, item->area.y);
+	cairo_rectangle (cr, item->area.x, item->area.y, item->area.width, item->area.height);
+	cairo_fill (cr);
+	cairo_restore (cr);
+}
+
+
 static void
 _gth_grid_view_draw_rubberband (GthGridView *self,
 		  	  	cairo_t     *cr)
@@ -1655,7 +1990,7 @@ _gth_grid_view_draw_drop_target (GthGridView *self,
 
 	style_context = gtk_widget_get_style_context (GTK_WIDGET (self));
 
-	item = g_list_nth (self->priv->items, self->priv->drop_item)->data;
+	item = _gth_grid_view_layout_item (self, self->priv->drop_item);
 
 	x = 0;
 	if (self->priv->drop_pos == GTH_DROP_POSITION_LEFT)
@@ -1680,11 +2015,12 @@ gth_grid_view_draw (GtkWidget *widget,
 	int          first_visible;
 	int          last_visible;
 	int          i;
-	GList       *scan;
 
 	if (! gtk_cairo_should_draw_window (cr, self->priv->bin_window))
 		return FALSE;
 
+	_gth_grid_view_measure_visible_lines (self);
+
 	first_visible = gth_grid_view_get_first_visible (GTH_FILE_VIEW (self));
 	if (first_visible == -1)
 		return TRUE;
@@ -1695,12 +2031,9 @@ gth_grid_view_draw (GtkWidget *widget,
 	gtk_cairo_transform_to_window (cr, widget, self->priv->bin_window);
 	cairo_set_line_width (cr, 1.0);
 
-	for (i = first_visible, scan = g_list_nth (self->priv->items, first_visible);
-	     (i <= last_visible) && scan;
-	     i++, scan = scan->next)
-	{
-		_gth_grid_view_draw_item (self, GTH_GRID_VIEW_ITEM (scan->data), cr);
-	}
+	for (i = first_visible; (i <= last_visible) && (i < self->priv->n_items); i++)
+		_gth_grid_view_draw_item (self, _gth_grid_view_layout_item (self, i), cr);
+	_gth_grid_view_trim_item_surfaces (self, i - first_visible);
 
 	if (self->priv->selecting || self->priv->multi_selecting_with_keyboard)
 		_gth_grid_view_draw_rubberband (self, cr);
@@ -1880,11 +2213,22 @@ gth_grid_view_get_selected (GthFileSelection *selection)
 }
 
 
+/* The items are placed lazily, so the item area is computed from the item
+ * position instead of using the last one. */
 static void
-_gth_grid_view_queue_draw_item (GthGridView     *self,
-				GthGridViewItem *item)
+_gth_grid_view_queue_draw_item (GthGridView *self,
+				int          pos)
 {
-	if (gtk_widget_get_realized (GTK_WIDGET (self)))
+	GthGridViewItem *item;
+
+	if (! gtk_widget_get_realized (GTK_WIDGET (self)))
+		return;
+
+	/* if the item is not in the layout yet, the whole view is redrawn
+	 * after the relayout */
+
+	item = _gth_grid_view_layout_item (self, pos);
+	if (item->layout_stamp == self->priv->layout_stamp)
 		gdk_window_invalidate_rect (self->priv->bin_window, &item->area, FALSE);
 }
 
@@ -1893,7 +2237,6 @@ static void
 _gth_grid_view_select_item (GthGridView *self,
 			    int          pos)
 {
-	GList           *link;
 	GthGridViewItem *item;
 
 	g_return_if_fail ((pos >= 0) && (pos < self->priv->n_items));
@@ -1901,10 +2244,7 @@ _gth_grid_view_select_item (GthGridView *self,
 	if (self->priv->selection_mode == GTK_SELECTION_NONE)
 		return;
 
-	link = g_list_nth (self->priv->items, pos);
-	g_return_if_fail (link != NULL);
-
-	item = link->data;
+	item = ITEM_AT (self, pos);
 	if (item->state & GTK_STATE_FLAG_SELECTED)
 		return;
 
@@ -1912,7 +2252,7 @@ _gth_grid_view_select_item (GthGridView *self,
 	self->priv->selection = g_list_prepend (self->priv->selection, GINT_TO_POINTER (pos));
 	self->priv->selection_changed = TRUE;
 
-	_gth_grid_view_queue_draw_item (self, item);
+	_gth_grid_view_queue_draw_item (self, pos);
 }
 
 
@@ -1920,7 +2260,6 @@ static void
 _gth_grid_view_unselect_item (GthGridView *self,
 		     	      int          pos)
 {
-	GList           *link;
 	GthGridViewItem *item;
 
 	g_return_if_fail ((pos >= 0) && (pos < self->priv->n_items));
@@ -1928,10 +2267,7 @@ _gth_grid_view_unselect_item (GthGridView *self,
 	if (self->priv->selection_mode == GTK_SELECTION_NONE)
 		return;
 
-	link = g_list_nth (self->priv->items, pos);
-	g_return_if_fail (link != NULL);
-
-	item = link->data;
+	item = ITEM_AT (self, pos);
 
 	if (! (item->state & GTK_STATE_FLAG_SELECTED))
 		return;
@@ -1940,7 +2276,7 @@ _gth_grid_view_unselect_item (GthGridView *self,
 	self->priv->selection = g_list_remove (self->priv->selection, GINT_TO_POINTER (pos));
 	self->priv->selection_changed = TRUE;
 
-	_gth_grid_view_queue_draw_item (self, item);
+	_gth_grid_view_queue_draw_item (self, pos);
 }
 
 
@@ -1980,17 +2316,12 @@ static int
 _gth_grid_view_unselect_all (GthGridView *self,
 			     gpointer     keep_selected)
 {
-	GthGridViewPrivate *priv = self->priv;
-	int                 idx;
-	GList              *scan;
-	int                 i;
+	int idx;
+	int i;
 
 	idx = 0;
-	for (scan = priv->items, i = 0;
-	     scan != NULL;
-	     scan = scan->next, i++)
-	{
-		GthGridViewItem *item = scan->data;
+	for (i = 0; i < self->priv->n_items; i++) {
+		GthGridViewItem *item = ITEM_AT (self, i);
 
 		if (item == keep_selected)
 			idx = i;
@@ -2007,16 +2338,12 @@ gth_grid_view_select (GthFileSelection *selection,
 		      int               pos)
 {
 	GthGridView *self = GTH_GRID_VIEW (selection);
-	GList       *list;
 	int          i;
 
 	switch (self->priv->selection_mode) {
 	case GTK_SELECTION_SINGLE:
-		for (list = self->priv->items, i = 0;
-		     list != NULL;
-		     list = list->next, i++)
-		{
-			GthGridViewItem *item = list->data;
+		for (i = 0; i < self->priv->n_items; i++) {
+			GthGridViewItem *item = ITEM_AT (self, i);
 
 			if ((i != pos) && (item->state & GTK_STATE_FLAG_SELECTED))
 				_gth_grid_view_set_item_selected (self, FALSE, i);
@@ -2030,7 +2357,7 @@ gth_grid_view_select (GthFileSelection *selection,
 
 		_gth_grid_view_set_item_selected_and_emit_signal (self, TRUE, pos);
 		self->priv->last_selected_pos = pos;
-		self->priv->last_selected_item = g_list_nth (self->priv->items, pos)->data;
+		self->priv->last_selected_item = ITEM_AT (self, pos);
 		break;
 
 	default:
@@ -2050,14 +2377,10 @@ gth_grid_view_unselect (GthFileSelection *selection,
 static void
 _gth_grid_view_select_all (GthGridView *self)
 {
-	GList *scan;
-	int    i;
+	int i;
 
-	for (scan = self->priv->items, i = 0;
-	     scan != NULL;
-	     scan = scan->next, i++)
-	{
-		GthGridViewItem *item = scan->data;
+	for (i = 0; i < self->priv->n_items; i++) {
+		GthGridViewItem *item = ITEM_AT (self, i);
 
 		if (! (item->state & GTK_STATE_FLAG_SELECTED))
 			_gth_grid_view_set_item_selected (self, TRUE, i);
@@ -2156,7 +2479,6 @@ model_row_changed_cb (GtkTreeModel *tree_model,
 {
 	GthGridView     *self = user_data;
 	int              pos;
-	GList           *link;
 	GthFileData     *file_data;
 	cairo_surface_t *thumbnail;
 	gboolean         is_icon;
@@ -2170,10 +2492,13 @@ model_row_changed_cb (GtkTreeModel *tree_model,
 			    -1);
 
 	pos = gtk_tree_path_get_indices (path)[0];
-	link = g_list_nth (self->priv->items, pos);
-	g_return_if_fail (link != NULL);
+	if ((pos < 0) || (pos >= self->priv->n_items)) {
+		_g_object_unref (file_data);
+		cairo_surface_destroy (thumbnail);
+		g_return_if_reached ();
+	}
 
-	item = GTH_GRID_VIEW_ITEM (link->data);
+	item = ITEM_AT (self, pos);
 	gth_grid_view_item_set_file_data (item, file_data);
 	gth_grid_view_item_set_thumbnail (item, thumbnail);
 	item->is_icon = is_icon;
@@ -2193,13 +2518,16 @@ model_row_deleted_cb (GtkTreeModel *tree_model,
 {
 	GthGridView *self = user_data;
 	int          pos;
-	GList       *link;
 	GList       *scan;
 	GList       *selected_link;
 
 	pos = gtk_tree_path_get_indices (path)[0];
-	link = g_list_nth (self->priv->items, pos);
-	self->priv->items = g_list_remove_link (self->priv->items, link);
+	g_return_if_fail ((pos >= 0) && (pos < self->priv->n_items));
+
+	/* the cached items are not kept alive after being deleted */
+
+	_gth_grid_view_uncache_item_surface (self, ITEM_AT (self, pos));
+	g_ptr_array_remove_index (self->priv->items, pos);
 	self->priv->n_items--;
 
 	/* update the selection */
@@ -2221,9 +2549,6 @@ model_row_deleted_cb (GtkTreeModel *tree_model,
 
 	_gth_grid_view_keep_focus_consistent (self);
 	_gth_grid_view_queue_relayout_from_position (self, pos);
-
-	gth_grid_view_item_unref (GTH_GRID_VIEW_ITEM (link->data));
-	g_list_free (link);
 }
 
 
@@ -2253,7 +2578,7 @@ model_row_inserted_cb (GtkTreeModel *tree_model,
 				       is_icon,
 				       self->priv->caption_attributes_v);
 	pos = gtk_tree_path_get_indices (path)[0];
-	self->priv->items = g_list_insert (self->priv->items, item, pos);
+	_g_ptr_array_insert (self->priv->items, pos, item);
 	self->priv->n_items++;
 
 	/* update the selection */
@@ -2281,46 +2606,35 @@ model_rows_reordered_cb (GtkTreeModel *tree_model,
 			 gpointer      user_data)
 {
 	GthGridView *self = user_data;
-	GList       *items;
+	gpointer    *old_items;
+	int         *new_pos;
 	int          i;
 	int          min_changed_pos;
 	GList       *scan;
 
-	/* change the order of the items list */
+	/* change the order of the items array */
 
+	old_items = g_memdup (self->priv->items->pdata, sizeof (gpointer) * self->priv->n_items);
+	new_pos = g_new (int, self->priv->n_items);
 	min_changed_pos = -1;
-	items = NULL;
 	for (i = 0; i < self->priv->n_items; i++) {
-		GList *link;
-		int    old_pos;
+		int old_pos;
 
 		old_pos = ((int *) new_order)[i];
 		if ((min_changed_pos == -1) && (old_pos != i))
 			min_changed_pos = i;
 
-		link = g_list_nth (self->priv->items, old_pos);
-		g_return_if_fail (link != NULL);
-		items = g_list_prepend (items, link->data);
+		self->priv->items->pdata[i] = old_items[old_pos];
+		new_pos[old_pos] = i;
 	}
-	items = g_list_reverse (items);
-
-	g_list_free (self->priv->items);
-	self->priv->items = items;
 
 	/* update the selection */
 
-	for (scan = self->priv->selection; scan; scan = scan->next) {
-		int selected_pos = GPOINTER_TO_INT (scan->data);
-
-		for (i = 0; i < self->priv->n_items; i++) {
-			int old_pos = ((int *) new_order)[i];
+	for (scan = self->priv->selection; scan; scan = scan->next)
+		scan->data = GINT_TO_POINTER (new_pos[GPOINTER_TO_INT (scan->data)]);
 
-			if (selected_pos == old_pos) {
-				scan->data = GINT_TO_POINTER (i);
-				break;
-			}
-		}
-	}
+	g_free (new_pos);
+	g_free (old_items);
 
 	/* relayout from the minimum changed position */
 
@@ -2337,28 +2651,27 @@ model_thumbnail_changed_cb (GtkTreeModel *tree_model,
 {
 	GthGridView     *self = user_data;
 	int              pos;
-	GList           *link;
 	cairo_surface_t *thumbnail;
 	gboolean         is_icon;
 	GthGridViewItem *item;
 
+	pos = gtk_tree_path_get_indices (path)[0];
+	g_return_if_fail ((pos >= 0) && (pos < self->priv->n_items));
+
 	gtk_tree_model_get (tree_model,
 			    iter,
 			    GTH_FILE_STORE_THUMBNAIL_COLUMN, &thumbnail,
 			    GTH_FILE_STORE_IS_ICON_COLUMN, &is_icon,
 			    -1);
 
-	pos = gtk_tree_path_get_indices (path)[0];
-	link = g_list_nth (self->priv->items, pos);
-	g_return_if_fail (link != NULL);
-
-	item = GTH_GRID_VIEW_ITEM (link->data);
+	item = ITEM_AT (self, pos);
 	gth_grid_view_item_set_thumbnail (item, thumbnail);
 	item->is_icon = is_icon;
 
-	_gth_grid_view_update_item_size (self, item);
-	_gth_grid_view_place_item_at (self, item, item->area.x, item->area.y);
-	_gth_grid_view_queue_draw_item (self, item);
+	/* the thumbnail area depends on the thumbnail, place the item
+	 * again */
+	item->layout_stamp = 0;
+	_gth_grid_view_queue_draw_item (self, pos);
 
 	cairo_surface_destroy (thumbnail);
 }
@@ -2411,14 +2724,20 @@ gth_grid_view_get_at_position (GthFileView *file_view,
 			       int          y)
 {
 	GthGridView *self = GTH_GRID_VIEW (file_view);
-	GList       *scan;
+	int          items_per_line;
+	int          n_line;
 	int          n;
 
-	for (scan = self->priv->items, n = 0;
-	     scan != NULL;
-	     scan = scan->next, n++)
+	n_line = _gth_grid_view_count_lines_above (self, y + 1, 0) - 1;
+	if (n_line < 0)
+		return -1;
+
+	items_per_line = gth_grid_view_get_items_per_line (self);
+	for (n = n_line * items_per_line;
+	     (n < (n_line + 1) * items_per_line) && (n < self->priv->n_items);
+	     n++)
 	{
-		GthGridViewItem *item = scan->data;
+		GthGridViewItem *item = _gth_grid_view_layout_item (self, n);
 
 		if (_cairo_rectangle_contains_point (&item->thumbnail_area, x, y)
 		    || _cairo_rectangle_contains_point (&item->caption_area, x, y))
@@ -2436,29 +2755,23 @@ gth_grid_view_cursor_changed (GthFileView *file_view,
 			      int          pos)
 {
 	GthGridView     *self = GTH_GRID_VIEW (file_view);
-	GthGridViewItem *old_item;
-	GList           *link;
+	int              old_pos;
 	GthGridViewItem *new_item;
 
-	old_item = NULL;
-	if (self->priv->focused_item >= 0) {
-		link = g_list_nth (self->priv->items, self->priv->focused_item);
-		if (link != NULL)
-			old_item = link->data;
-	}
-
-	link = g_list_nth (self->priv->items, pos);
-	g_return_if_fail (link != NULL);
+	g_return_if_fail ((pos >= 0) && (pos < self->priv->n_items));
 
+	old_pos = self->priv->focused_item;
 	self->priv->focused_item = pos;
-	if (old_item != NULL) {
+	if ((old_pos >= 0) && (old_pos < self->priv->n_items)) {
+		GthGridViewItem *old_item = ITEM_AT (self, old_pos);
+
 		old_item->state ^= GTK_STATE_FLAG_FOCUSED | GTK_STATE_FLAG_ACTIVE;
-		_gth_grid_view_queue_draw_item (self, old_item);
+		_gth_grid_view_queue_draw_item (self, old_pos);
 	}
 
-	new_item = link->data;
+	new_item = ITEM_AT (self, pos);
 	new_item->state |= GTK_STATE_FLAG_FOCUSED | GTK_STATE_FLAG_ACTIVE;
-	_gth_grid_view_queue_draw_item (self, new_item);
+	_gth_grid_view_queue_draw_item (self, pos);
 
 	self->priv->make_focused_visible = TRUE;
 	_gth_grid_view_make_item_fully_visible (self, self->priv->focused_item);
@@ -2533,22 +2846,17 @@ _gth_grid_view_get_drop_target_at (GthGridView *self,
 				   int          x,
 				   int          y)
 {
-	int    row;
-	int    height;
-	GList *scan;
-	int    items_per_line;
-	int    col;
+	int n_lines;
+	int row;
+	int items_per_line;
+	int col;
 
 	x += gtk_adjustment_get_value (self->priv->hadjustment);
 	y += gtk_adjustment_get_value (self->priv->vadjustment);
 
-	row = -1;
-	height = self->priv->cell_spacing;
-	for (scan = self->priv->lines; scan && (height < y); scan = scan->next) {
-		height += GTH_GRID_VIEW_LINE (scan->data)->height + self->priv->cell_spacing;
-		row++;
-	}
-	if (height < y)
+	n_lines = _gth_grid_view_count_lines_above (self, y, 0);
+	row = n_lines - 1;
+	if ((n_lines == self->priv->lines->len) && (MAX (self->priv->height, self->priv->cell_spacing) < y))
 		row++;
 	row = MAX (row, 0);
 
@@ -2594,7 +2902,7 @@ gth_grid_view_set_drag_dest_pos (GthFileView    *file_view,
 			drop_pos = GTH_DROP_POSITION_RIGHT;
 		}
 		else {
-			GthGridViewItem *item = g_list_nth (self->priv->items, drop_image)->data;
+			GthGridViewItem *item = _gth_grid_view_layout_item (self, drop_image);
 			if (x - item->area.x > self->priv->cell_size / 2)
 				drop_pos = GTH_DROP_POSITION_RIGHT;
 			else
@@ -2641,8 +2949,7 @@ _gth_grid_view_select_range (GthGridView     *self,
 			     GthGridViewItem *item,
 			     int              pos)
 {
-	int    a, b;
-	GList *scan;
+	int a, b;
 
 	if (self->priv->last_selected_pos == -1) {
 		self->priv->last_selected_pos = pos;
@@ -2658,11 +2965,8 @@ _gth_grid_view_select_range (GthGridView     *self,
 		b = pos;
 	}
 
-	for (scan = g_list_nth (self->priv->items, a);
-	     a <= b;
-	     a++, scan = scan->next)
-	{
-		GthGridViewItem *item = scan->data;
+	for (; a <= b; a++) {
+		GthGridViewItem *item = ITEM_AT (self, a);
 
 		if (! (item->state & GTK_STATE_FLAG_SELECTED))
 			_gth_grid_view_set_item_selected (self, TRUE, a);
@@ -2732,10 +3036,10 @@ _gth_grid_view_select_multiple (GthGridView     *self,
 static void
 gth_grid_view_store_items_state (GthGridView *self)
 {
-	GList *scan;
+	int i;
 
-	for (scan = self->priv->items; scan; scan = scan->next) {
-		GthGridViewItem *item = scan->data;
+	for (i = 0; i < self->priv->n_items; i++) {
+		GthGridViewItem *item = ITEM_AT (self, i);
 		item->tmp_state = item->state;
 	}
 }
@@ -2797,7 +3101,7 @@ gth_grid_view_button_press (GtkWidget      *widget,
 		if (self->priv->selection_mode != GTK_SELECTION_NONE) {
 			GthGridViewItem *item;
 
-			item = g_list_nth (self->priv->items, pos)->data;
+			item = ITEM_AT (self, pos);
 			if (self->priv->selection_mode == GTK_SELECTION_MULTIPLE)
 				_gth_grid_view_select_multiple (self, item, pos, event);
 			else
@@ -2878,7 +3182,6 @@ _gth_grid_view_update_mouse_selection (GthGridView *self,
 	gboolean               additive;
 	gboolean               invert;
 	int                    min_y, max_y;
-	GList                 *l, *begin, *end;
 	int                    i, begin_idx, end_idx;
 
 	old_selection_area = self->priv->selection_area;
@@ -2953,13 +3256,7 @@ _gth_grid_view_update_mouse_selection (GthGridView *self,
 	max_y = self->priv->selection_area.y + self->priv->selection_area.height;
 
 	begin_idx = get_first_visible_at_offset (self, min_y);
-	begin = g_list_nth (self->priv->items, begin_idx);
-
 	end_idx = get_last_visible_at_offset (self, max_y);
-	end = g_list_nth (self->priv->items, end_idx);
-
-	if (end != NULL)
-		end = end->next;
 
 	gdk_window_freeze_updates (self->priv->bin_window);
 
@@ -2968,8 +3265,8 @@ _gth_grid_view_update_mouse_selection (GthGridView *self,
 	x2 = x1 + self->priv->selection_area.width;
 	y2 = y1 + self->priv->selection_area.height;
 
-	for (l = begin, i = begin_idx; l != end; l = l->next, i++) {
-		GthGridViewItem *item = l->data;
+	for (i = MAX (begin_idx, 0); (i <= end_idx) && (i < self->priv->n_items); i++) {
+		GthGridViewItem *item = _gth_grid_view_layout_item (self, i);
 		gboolean         selection_changed;
 
 		selection_changed = (item->state & GTK_STATE_FLAG_SELECTED) != (item->tmp_state & GTK_STATE_FLAG_SELECTED);
@@ -3160,23 +3457,16 @@ static void
 select_range_with_keyboard (GthGridView *self,
 			    int          next_focused_item)
 {
-	int    begin_idx;
-	int    end_idx;
-	GList *begin;
-	GList *end;
-	int    i;
-	GList *link;
+	int begin_idx;
+	int end_idx;
+	int i;
 
 	begin_idx = MIN (MIN (self->priv->first_focused_item, self->priv->focused_item), next_focused_item);
 	end_idx = MAX (MAX (self->priv->first_focused_item, self->priv->focused_item), next_focused_item);
-	begin = g_list_nth (self->priv->items, begin_idx);
-	end = g_list_nth (self->priv->items, end_idx);
-	if (end != NULL)
-		end = end->next;
 
 	gdk_window_freeze_updates (self->priv->bin_window);
 
-	for (link = begin, i = begin_idx; link != end; link = link->next, i++) {
+	for (i = MAX (begin_idx, 0); (i <= end_idx) && (i < self->priv->n_items); i++) {
 		if (next_focused_item > self->priv->first_focused_item) {
 			if ((i >= self->priv->first_focused_item) && (i <= next_focused_item))
 				_gth_grid_view_select_item (self, i);
@@ -3197,58 +3487,32 @@ select_range_with_keyboard (GthGridView *self,
 }
 
 
-static GList *
-_gth_grid_view_get_line_at_position (GthGridView *self,
-				     int          pos)
-{
-	GList           *link;
-	GthGridViewItem *item;
-	GList           *scan;
-
-	link = g_list_nth (self->priv->items, pos);
-	g_return_val_if_fail (link != NULL, NULL);
-
-	item = link->data;
-	for (scan = self->priv->lines; scan; scan = scan->next) {
-		GthGridViewLine *line = scan->data;
-
-		if (g_list_find (line->items, item) != NULL)
-			return scan;
-	}
-
-	return NULL;
-}
-
-
 static int
 _gth_grid_view_get_item_at_page_distance (GthGridView *self,
 					  int          focused_item,
 					  gboolean     downward)
 {
-	int    old_focused_item;
-	int    direction;
-	int    h;
-	GList *line;
-	int    items_per_line;
+	int old_focused_item;
+	int direction;
+	int h;
+	int items_per_line;
+	int n_line;
 
 	old_focused_item = focused_item;
 	direction = downward ? 1 : -1;
 	h = gtk_widget_get_allocated_height (GTK_WIDGET (self));
-	line = _gth_grid_view_get_line_at_position (self, focused_item);
 	items_per_line = gth_grid_view_get_items_per_line (self);
+	n_line = focused_item / items_per_line;
 
-	while ((h > 0) && (line != NULL)) {
-		h -= GTH_GRID_VIEW_LINE (line->data)->height + self->priv->cell_spacing;
+	while ((h > 0) && (n_line >= 0) && (n_line < self->priv->lines->len)) {
+		h -= LINE_AT (self, n_line)->height + self->priv->cell_spacing;
 		if (h > 0) {
 			focused_item = focused_item + direction * items_per_line;
 			if ((focused_item >= self->priv->n_items - 1) || (focused_item <= 0))
 				return focused_item;
 		}
 
-		if (downward)
-			line = line->next;
-		else
-			line = line->prev;
+		n_line += direction;
 	}
 
 	if (old_focused_item == focused_item)
@@ -3351,8 +3615,9 @@ gth_grid_view_select_cursor_item (GthGridView *self)
 	if (self->priv->focused_item == -1)
 		return FALSE;
 
-	item = g_list_nth (self->priv->items, self->priv->focused_item)->data;
-	g_return_val_if_fail (item != NULL, FALSE);
+	g_return_val_if_fail (self->priv->focused_item < self->priv->n_items, FALSE);
+
+	item = ITEM_AT (self, self->priv->focused_item);
 
 	_gth_grid_view_unselect_all (self, item);
 	_gth_grid_view_select_item (self, self->priv->focused_item);
@@ -3367,16 +3632,14 @@ gth_grid_view_select_cursor_item (GthGridView *self)
 static gboolean
 gth_grid_view_toggle_cursor_item (GthGridView *self)
 {
-	GList           *link;
 	GthGridViewItem *item;
 
 	if (self->priv->focused_item == -1)
 		return FALSE;
 
-	link = g_list_nth (self->priv->items, self->priv->focused_item);
-	g_return_val_if_fail (link != NULL, FALSE);
+	g_return_val_if_fail (self->priv->focused_item < self->priv->n_items, FALSE);
 
-	item = link->data;
+	item = ITEM_AT (self, self->priv->focused_item);
 	if (item->state & GTK_STATE_FLAG_SELECTED)
 		_gth_grid_view_unselect_item (self, self->priv->focused_item);
 	else
@@ -3488,6 +3751,7 @@ _gth_grid_view_set_thumbnail_size (GthGridView *self,
 	self->priv->thumbnail_size = size;
 	self->priv->cell_size = self->priv->thumbnail_size + (self->priv->thumbnail_border * 2) + (self->priv->cell_padding * 2);
 	self->priv->update_caption_height = TRUE;
+	_gth_grid_view_update_max_cached_items (self);
 	g_object_notify (G_OBJECT (self), "thumbnail-size");
 
 	_gth_grid_view_queue_relayout (self);
@@ -3498,7 +3762,7 @@ static void
 _gth_grid_view_set_caption (GthGridView *self,
 			    const char  *attributes)
 {
-	GList *scan;
+	int i;
 
 	g_free (self->priv->caption_attributes);
 	self->priv->caption_attributes = g_strdup (attributes);
@@ -3510,8 +3774,8 @@ _gth_grid_view_set_caption (GthGridView *self,
 	if (self->priv->caption_attributes != NULL)
 		self->priv->caption_attributes_v = g_strsplit (self->priv->caption_attributes, ",", -1);
 
-	for (scan = self->priv->items; scan; scan = scan->next)
-		gth_grid_view_item_update_caption (GTH_GRID_VIEW_ITEM (scan->data), self->priv->caption_attributes_v);
+	for (i = 0; i < self->priv->n_items; i++)
+		gth_grid_view_item_update_caption (ITEM_AT (self, i), self->priv->caption_attributes_v);
 	self->priv->update_caption_height = TRUE;
 
 	g_object_notify (G_OBJECT (self), "caption");
@@ -3807,9 +4071,9 @@ gth_grid_view_init (GthGridView *self)
 	self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self, GTH_TYPE_GRID_VIEW, GthGridViewPrivate);
 
 	/* self->priv->model = NULL; */
-	self->priv->items = NULL;
+	self->priv->items = g_ptr_array_new_with_free_func ((GDestroyNotify) gth_grid_view_item_unref);
 	self->priv->n_items = 0;
-	self->priv->lines = NULL;
+	self->priv->lines = g_array_new (FALSE, FALSE, sizeof (GthGridViewLine));
 	self->priv->selection = NULL;
 	self->priv->focused_item = -1;
 	self->priv->first_focused_item = -1;
@@ -3820,6 +4084,9 @@ gth_grid_view_init (GthGridView *self)
 	self->priv->layout_timeout = 0;
 	self->priv->relayout_from_line = -1;
 	self->priv->update_caption_height = TRUE;
+	self->priv->layout_stamp = 1;
+	self->priv->virtual_layout = FALSE;
+	self->priv->estimated_caption_height = 0;
 	self->priv->width = 0;
 	self->priv->height = 0;
 	/* self->priv->thumbnail_size = 0; */
@@ -3868,6 +4135,8 @@ gth_grid_view_init (GthGridView *self)
 	self->priv->caption_attributes_v = NULL;
 	self->priv->caption_layout = NULL;
 	self->priv->icon_cache = NULL;
+	self->priv->cached_items = g_queue_new ();
+	self->priv->max_cached_items = MIN_CACHED_SURFACES;
 
 	_gth_grid_view_set_hadjustment (self, gtk_adjustment_new (0.0, 1.0, 0.0, 0.1, 1.0, 1.0));
 	_gth_grid_view_set_vadjustment (self, gtk_adjustment_new (0.0, 1.0, 0.0, 0.1, 1.0, 1.0));
@@ -209,6 +209,8 @@ gth_main_register_default_hooks (void)
 	/**
 	 * Called after a file metadata has been read.  Used to syncronize
 	 * embedded metadata with the .comment file.
+	 * The metadata of a long list is read in batches, on more threads,
+	 * the hook is called after each batch, one batch at a time.
 	 *
 	 * @file_list (GList *): list of GthFileData
 	 * @attributes (const char *): the attributes read for the file
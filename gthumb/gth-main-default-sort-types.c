@@ -40,31 +40,59 @@ gth_file_data_cmp_filename (GthFileData *a,
 }
 
 
+static void
+gth_file_data_filename_key (GthFileData        *file_data,
+			    GthFileDataSortKey *key)
+{
+	key->value = 0;
+	key->text = NULL;
+	key->folder_len = 0;
+	key->name = gth_file_data_get_filename_sort_key (file_data);
+}
+
+
+/* the length of the folder part of the uri */
+static gsize
+_gth_uri_get_folder_len (const char *uri)
+{
+	const char *sep;
+
+	sep = strrchr (uri, '/');
+
+	return (sep != NULL) ? sep - uri : 0;
+}
+
+
 static int
 gth_file_data_cmp_uri (GthFileData *a,
 		       GthFileData *b)
 {
-	GFile *parent_a;
-	GFile *parent_b;
-	int    result;
-
-	parent_a = g_file_get_parent (a->file);
-	parent_b = g_file_get_parent (b->file);
-	if (! g_file_equal (parent_a, parent_b)) {
-		char *uri_a;
-		char *uri_b;
-
-		uri_a = g_file_get_uri (a->file);
-		uri_b = g_file_get_uri (b->file);
-		result = strcmp (uri_a, uri_b);
-
-		g_free (uri_b);
-		g_free (uri_a);
+	const char *uri_a;
+	const char *uri_b;
+	gsize       folder_len;
+
+	uri_a = gth_file_data_get_uri_sort_key (a);
+	uri_b = gth_file_data_get_uri_sort_key (b);
+	folder_len = _gth_uri_get_folder_len (uri_a);
+	if ((folder_len > 0)
+	    && (folder_len == _gth_uri_get_folder_len (uri_b))
+	    && (strncmp (uri_a, uri_b, folder_len) == 0))
+	{
+		return gth_file_data_cmp_filename (a, b);
 	}
-	else
-		result = gth_file_data_cmp_filename (a, b);
 
-	return result;
+	return strcmp (uri_a, uri_b);
+}
+
+
+static void
+gth_file_data_uri_key (GthFileData        *file_data,
+		       GthFileDataSortKey *key)
+{
+	key->value = 0;
+	key->text = g_strdup (gth_file_data_get_uri_sort_key (file_data));
+	key->folder_len = _gth_uri_get_folder_len (key->text);
+	key->name = gth_file_data_get_filename_sort_key (file_data);
 }
 
 
@@ -86,6 +114,17 @@ gth_file_data_cmp_filesize (GthFileData *a,
 }
 
 
+static void
+gth_file_data_filesize_key (GthFileData        *file_data,
+			    GthFileDataSortKey *key)
+{
+	key->value = g_file_info_get_size (file_data->info);
+	key->text = NULL;
+	key->folder_len = 0;
+	key->name = NULL;
+}
+
+
 static int
 gth_file_data_cmp_modified_time (GthFileData *a,
 			         GthFileData *b)
@@ -104,6 +143,20 @@ gth_file_data_cmp_modified_time (GthFileData *a,
 }
 
 
+static void
+gth_file_data_modified_time_key (GthFileData        *file_data,
+				 GthFileDataSortKey *key)
+{
+	GTimeVal *t;
+
+	t = gth_file_data_get_modification_time (file_data);
+	key->value = (gint64) t->tv_sec * G_USEC_PER_SEC + t->tv_usec;
+	key->text = NULL;
+	key->folder_len = 0;
+	key->name = gth_file_data_get_filename_sort_key (file_data);
+}
+
+
 static int
 gth_general_data_cmp_dimensions (GthFileData *a,
 				 GthFileData *b)
@@ -127,13 +180,24 @@ gth_general_data_cmp_dimensions (GthFileData *a,
 }
 
 
+static void
+gth_general_data_dimensions_key (GthFileData        *file_data,
+				 GthFileDataSortKey *key)
+{
+	key->value = (gint64) g_file_info_get_attribute_int32 (file_data->info, "frame::width") * g_file_info_get_attribute_int32 (file_data->info, "frame::height");
+	key->text = NULL;
+	key->folder_len = 0;
+	key->name = gth_file_data_get_filename_sort_key (file_data);
+}
+
+
 GthFileDataSort default_sort_types[] = {
-	{ "file::name", N_("file name"), "standard::display-name", gth_file_data_cmp_filename },
-	{ "file::path", N_("file path"), "standard::display-name", gth_file_data_cmp_uri },
-	{ "file::size", N_("file size"), "standard::size", gth_file_data_cmp_filesize },
-	{ "file::mtime", N_("file modified date"), "time::modified,time::modified-usec", gth_file_data_cmp_modified_time },
-	{ "general::unsorted", N_("no sorting"), "", NULL },
-	{ "general::dimensions", N_("dimensions"), "frame::width,frame::height", gth_general_data_cmp_dimensions },
+	{ "file::name", N_("file name"), "standard::display-name", gth_file_data_cmp_filename, gth_file_data_filename_key },
+	{ "file::path", N_("file path"), "standard::display-name", gth_file_data_cmp_uri, gth_file_data_uri_key },
+	{ "file::size", N_("file size"), "standard::size", gth_file_data_cmp_filesize, gth_file_data_filesize_key },
+	{ "file::mtime", N_("file modified date"), "time::modified,time::modified-usec", gth_file_data_cmp_modified_time, gth_file_data_modified_time_key },
+	{ "general::unsorted", N_("no sorting"), "", NULL, NULL },
+	{ "general::dimensions", N_("dimensions"), "frame::width,frame::height", gth_general_data_cmp_dimensions, gth_general_data_dimensions_key },
 };
 
 
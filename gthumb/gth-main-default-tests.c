@@ -254,6 +254,7 @@ gth_main_register_default_tests (void)
 				  "display-name", _("All Files"),
 				  "data-type", GTH_TEST_DATA_TYPE_NONE,
 				  "get-data-func", is_file_test,
+				  "thread-safe", TRUE,
 				  NULL);
 	gth_main_register_object (GTH_TYPE_TEST,
 				  "file::type::is_image",
@@ -261,6 +262,7 @@ gth_main_register_default_tests (void)
 				  "display-name", _("Images"),
 				  "data-type", GTH_TEST_DATA_TYPE_NONE,
 				  "get-data-func", is_image_test,
+				  "thread-safe", TRUE,
 				  NULL);
 	gth_main_register_object (GTH_TYPE_TEST,
 				  "file::type::is_video",
@@ -268,6 +270,7 @@ gth_main_register_default_tests (void)
 				  "display-name", _("Video"),
 				  "data-type", GTH_TEST_DATA_TYPE_NONE,
 				  "get-data-func", is_video_test,
+				  "thread-safe", TRUE,
 				  NULL);
 	gth_main_register_object (GTH_TYPE_TEST,
 				  "file::type::is_audio",
@@ -275,6 +278,7 @@ gth_main_register_default_tests (void)
 				  "display-name", _("Audio"),
 				  "data-type", GTH_TEST_DATA_TYPE_NONE,
 				  "get-data-func", is_audio_test,
+				  "thread-safe", TRUE,
 				  NULL);
 	gth_main_register_object (GTH_TYPE_TEST,
 				  "file::type::is_media",
@@ -282,6 +286,7 @@ gth_main_register_default_tests (void)
 				  "display-name", _("Media"),
 				  "data-type", GTH_TEST_DATA_TYPE_NONE,
 				  "get-data-func", is_media_test,
+				  "thread-safe", TRUE,
 				  NULL);
 	gth_main_register_object (GTH_TYPE_TEST,
 				  "file::type::is_text",
@@ -289,6 +294,7 @@ gth_main_register_default_tests (void)
 				  "display-name", _("Text Files"),
 				  "data-type", GTH_TEST_DATA_TYPE_NONE,
 				  "get-data-func", is_text_test,
+				  "thread-safe", TRUE,
 				  NULL);
 	gth_main_register_object (GTH_TYPE_TEST,
 				  "file::name",
@@ -297,6 +303,7 @@ gth_main_register_default_tests (void)
 				  "display-name", _("Filename"),
 				  "data-type", GTH_TEST_DATA_TYPE_STRING,
 				  "get-data-func", get_filename_for_test,
+				  "thread-safe", TRUE,
 				  NULL);
 	gth_main_register_object (GTH_TYPE_TEST,
 				  "file::size",
@@ -305,6 +312,7 @@ gth_main_register_default_tests (void)
 				  "display-name", _("Size"),
 				  "data-type", GTH_TEST_DATA_TYPE_SIZE,
 				  "get-data-func", get_filesize_for_test,
+				  "thread-safe", TRUE,
 				  NULL);
 	gth_main_register_object (GTH_TYPE_TEST,
 				  "file::mtime",
@@ -313,6 +321,7 @@ gth_main_register_default_tests (void)
 				  "display-name", _("File modified date"),
 				  "data-type", GTH_TEST_DATA_TYPE_DATE,
 				  "get-data-func", get_modified_date_for_test,
+				  "thread-safe", TRUE,
 				  NULL);
 	gth_main_register_object (GTH_TYPE_TEST,
 				  "Embedded::Photo::DateTimeOriginal",
@@ -321,6 +330,7 @@ gth_main_register_default_tests (void)
 				  "display-name", _("Date photo was taken"),
 				  "data-type", GTH_TEST_DATA_TYPE_DATE,
 				  "get-data-func", get_original_date_for_test,
+				  "thread-safe", TRUE,
 				  NULL);
 	gth_main_register_object (GTH_TYPE_TEST,
 				  "general::title",
@@ -329,6 +339,7 @@ gth_main_register_default_tests (void)
 				  "display-name", _("Title (embedded)"),
 				  "data-type", GTH_TEST_DATA_TYPE_STRING,
 				  "get-data-func", get_embedded_title_for_test,
+				  "thread-safe", TRUE,
 				  NULL);
 	gth_main_register_object (GTH_TYPE_TEST,
 				  "general::description",
@@ -337,6 +348,7 @@ gth_main_register_default_tests (void)
 				  "display-name", _("Description (embedded)"),
 				  "data-type", GTH_TEST_DATA_TYPE_STRING,
 				  "get-data-func", get_embedded_description_for_test,
+				  "thread-safe", TRUE,
 				  NULL);
 	gth_main_register_object (GTH_TYPE_TEST,
 				  "general::rating",
@@ -345,6 +357,7 @@ gth_main_register_default_tests (void)
 				  "display-name", _("Rating"),
 				  "data-type", GTH_TEST_DATA_TYPE_INT,
 				  "get-data-func", get_embedded_rating_for_test,
+				  "thread-safe", TRUE,
 				  "max-int", 5,
 				  NULL);
 	gth_main_register_object (GTH_TYPE_TEST,
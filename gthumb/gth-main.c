@@ -29,6 +29,7 @@
 #include "gth-duplicable.h"
 #include "gth-filter.h"
 #include "gth-main.h"
+#include "gth-metadata-cache.h"
 #include "gth-metadata-provider.h"
 #include "gth-user-dir.h"
 #include "gth-preferences.h"
@@ -190,12 +191,14 @@ gth_main_initialize (void)
 		return;
 
 	Main = (GthMain*) g_object_new (GTH_TYPE_MAIN, NULL);
+	gth_metadata_cache_initialize ();
 }
 
 
 void
 gth_main_release (void)
 {
+	gth_metadata_cache_release ();
 	if (Main != NULL)
 		g_object_unref (Main);
 }
@@ -580,6 +583,32 @@ gth_main_get_sort_type (const char *name)
 }
 
 
+GthFileDataSort *
+gth_main_get_sort_type_for_func (GthFileDataCompFunc cmp_func)
+{
+	GthFileDataSort *retval = NULL;
+	GHashTableIter   iter;
+	gpointer         value;
+
+	if (cmp_func == NULL)
+		return NULL;
+
+	g_mutex_lock (&register_mutex);
+	g_hash_table_iter_init (&iter, Main->priv->sort_types);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		GthFileDataSort *sort_type = value;
+
+		if (sort_type->cmp_func == cmp_func) {
+			retval = sort_type;
+			break;
+		}
+	}
+	g_mutex_unlock (&register_mutex);
+
+	return retval;
+}
+
+
 static void
 collect_sort_types (gpointer key,
 		    gpointer value,
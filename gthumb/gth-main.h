@@ -85,6 +85,7 @@ GthMetadataInfo *      gth_main_get_metadata_info             (const char
 GList *                gth_main_get_all_metadata_info         (void);
 void                   gth_main_register_sort_type            (GthFileDataSort      *sort_type);
 GthFileDataSort *      gth_main_get_sort_type                 (const char           *name);
+GthFileDataSort *      gth_main_get_sort_type_for_func        (GthFileDataCompFunc   cmp_func);
 GList *                gth_main_get_all_sort_types            (void);
 void                   gth_main_register_image_loader_func    (GthImageLoaderFunc    loader,
 							       GthImageFormat        native_format,
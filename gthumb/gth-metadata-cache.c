@@ -0,0 +1,555 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+/*
+ *  GThumb
+ *
+ *  Copyright (C) 2013 Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <config.h>
+#include "gio-utils.h"
+#include "glib-utils.h"
+#include "gth-file-data.h"
+#include "gth-main.h"
+#include "gth-metadata.h"
+#include "gth-metadata-cache.h"
+#include "gth-monitor.h"
+#include "gth-user-cache.h"
+
+
+/* The attributes read by the metadata providers are saved for each folder
+ * as a GVariant with the following format:
+ *
+ *   version, folder uri,
+ *   dictionary of file name → (size, modification time,
+ *                              dictionary of provider → (read attributes,
+ *                                                        dictionary of attributes))
+ *
+ * the modification time is in microseconds.  The attributes of a file are
+ * valid as long as its size and modification time are the same, and only
+ * for the queries of attributes included in the read attributes.  The
+ * cache files are managed by gth-user-cache.c. */
+
+
+#define CACHE_NAME "metadata"
+#define CACHE_VERSION 2
+#define CACHE_FORMAT "(usa{s(txa{s(sa{sv})})})"
+#define ENTRY_FORMAT "(txa{s(sa{sv})})"
+#define PROVIDER_FORMAT "(sa{sv})"
+#define MAX_FOLDERS_IN_MEMORY 8
+
+
+typedef struct {
+	guint64     size;
+	gint64      mtime;
+	GHashTable *providers; /* provider id → GVariant of type PROVIDER_FORMAT */
+} CacheEntry;
+
+
+typedef struct {
+	GFile      *folder;
+	char       *uri;
+	GHashTable *entries; /* file name → CacheEntry */
+} FolderData;
+
+
+static GMutex        cache_mutex;
+static GthUserCache *cache_folders = NULL; /* folder uri → FolderData */
+static GHashTable   *removed_files = NULL; /* folder uri → set of file names */
+
+
+static CacheEntry *
+cache_entry_new (guint64 size,
+		 gint64  mtime)
+{
+	CacheEntry *entry;
+
+	entry = g_new0 (CacheEntry, 1);
+	entry->size = size;
+	entry->mtime = mtime;
+	entry->providers = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_variant_unref);
+
+	return entry;
+}
+
+
+static void
+cache_entry_free (CacheEntry *entry)
+{
+	g_hash_table_unref (entry->providers);
+	g_free (entry);
+}
+
+
+static FolderData *
+folder_data_new (GFile *folder)
+{
+	FolderData *folder_data;
+
+	folder_data = g_new0 (FolderData, 1);
+	folder_data->folder = g_object_ref (folder);
+	folder_data->uri = g_file_get_uri (folder);
+	folder_data->entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) cache_entry_free);
+
+	return folder_data;
+}
+
+
+static void
+folder_data_free (FolderData *folder_data)
+{
+	g_hash_table_unref (folder_data->entries);
+	g_free (folder_data->uri);
+	g_object_unref (folder_data->folder);
+	g_free (folder_data);
+}
+
+
+static gboolean
+_gth_metadata_cache_get_file_times (GFileInfo *info,
+				    guint64   *size,
+				    gint64    *mtime)
+{
+	if (! g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_STANDARD_SIZE)
+	    || ! g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_TIME_MODIFIED))
+	{
+		return FALSE;
+	}
+
+	*size = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
+	*mtime = (gint64) g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC
+		 + g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+
+	return TRUE;
+}
+
+
+static void
+_gth_metadata_cache_read_folder (FolderData *folder_data)
+{
+	GMappedFile  *mapped_file;
+	GVariant     *cache;
+	guint32       version;
+	const char   *cache_uri;
+	GVariantIter *entries;
+
+	mapped_file = gth_user_cache_map_file (CACHE_NAME, folder_data->uri);
+	if (mapped_file == NULL)
+		return;
+
+	cache = g_variant_new_from_data (G_VARIANT_TYPE (CACHE_FORMAT),
+					 g_mapped_file_get_contents (mapped_file),
+					 g_mapped_file_get_length (mapped_file),
+					 FALSE,
+					 (GDestroyNotify) g_mapped_file_unref,
+					 mapped_file);
+	g_variant_ref_sink (cache);
+
+	g_variant_get (cache, "(u&sa{s" ENTRY_FORMAT "})", &version, &cache_uri, &entries);
+	if ((version == CACHE_VERSION) && (g_strcmp0 (cache_uri, folder_data->uri) == 0)) {
+		const char   *name;
+		guint64       file_size;
+		gint64        file_mtime;
+		GVariantIter *providers;
+
+		while (g_variant_iter_loop (entries, "{&s(txa{s(sa{sv})})}", &name, &file_size, &file_mtime, &providers)) {
+			CacheEntry *entry;
+			const char *provider_id;
+			GVariant   *provider_data;
+
+			entry = cache_entry_new (file_size, file_mtime);
+			while (g_variant_iter_loop (providers, "{&s@" PROVIDER_FORMAT "}", &provider_id, &provider_data))
+				g_hash_table_insert (entry->providers, g_strdup (provider_id), g_variant_ref (provider_data));
+			g_hash_table_insert (folder_data->entries, g_strdup (name), entry);
+		}
+	}
+
+	g_variant_iter_free (entries);
+	g_variant_unref (cache);
+}
+
+
+static void
+_gth_metadata_cache_serialize_folder (FolderData  *folder_data,
+				      void       **buffer,
+				      gsize       *size)
+{
+	GVariantBuilder  entries;
+	GHashTableIter   iter;
+	const char      *name;
+	CacheEntry      *entry;
+	GVariant        *cache;
+
+	g_variant_builder_init (&entries, G_VARIANT_TYPE ("a{s" ENTRY_FORMAT "}"));
+	g_hash_table_iter_init (&iter, folder_data->entries);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &name, (gpointer *) &entry)) {
+		GVariantBuilder  providers;
+		GHashTableIter   provider_iter;
+		const char      *provider_id;
+		GVariant        *provider_data;
+
+		g_variant_builder_init (&providers, G_VARIANT_TYPE ("a{s" PROVIDER_FORMAT "}"));
+		g_hash_table_iter_init (&provider_iter, entry->providers);
+		while (g_hash_table_iter_next (&provider_iter, (gpointer *) &provider_id, (gpointer *) &provider_data))
+			g_variant_builder_add (&providers, "{s@" PROVIDER_FORMAT "}", provider_id, provider_data);
+		g_variant_builder_add (&entries, "{s" ENTRY_FORMAT "}", name, entry->size, entry->mtime, &providers);
+	}
+
+	cache = g_variant_new (CACHE_FORMAT, CACHE_VERSION, folder_data->uri, &entries);
+	g_variant_ref_sink (cache);
+
+	*size = g_variant_get_size (cache);
+	*buffer = g_malloc (*size);
+	g_variant_store (cache, *buffer);
+
+	g_variant_unref (cache);
+}
+
+
+/* called with the mutex locked.  Returns TRUE if the entries changed. */
+static gboolean
+_gth_metadata_cache_apply_removed_files (FolderData *folder_data)
+{
+	GHashTable     *names;
+	GHashTableIter  iter;
+	const char     *name;
+	gboolean        changed;
+
+	names = g_hash_table_lookup (removed_files, folder_data->uri);
+	if (names == NULL)
+		return FALSE;
+
+	changed = FALSE;
+	g_hash_table_iter_init (&iter, names);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &name, NULL))
+		if (g_hash_table_remove (folder_data->entries, name))
+			changed = TRUE;
+
+	g_hash_table_remove (removed_files, folder_data->uri);
+
+	return changed;
+}
+
+
+/* Locks the mutex and returns the data of @folder.  If not in memory the
+ * cache file is read with the mutex unlocked, so that the other threads are
+ * not blocked by the disk.  Returns NULL if the cache has been released.
+ * The mutex must be unlocked by the caller in any case. */
+static FolderData *
+_gth_metadata_cache_lock_folder (GFile *folder)
+{
+	char       *uri;
+	FolderData *folder_data;
+
+	uri = g_file_get_uri (folder);
+
+	g_mutex_lock (&cache_mutex);
+
+	folder_data = (cache_folders != NULL) ? gth_user_cache_lookup (cache_folders, uri) : NULL;
+	if ((folder_data == NULL) && (cache_folders != NULL)) {
+		FolderData *new_folder_data;
+
+		g_mutex_unlock (&cache_mutex);
+		new_folder_data = folder_data_new (folder);
+		_gth_metadata_cache_read_folder (new_folder_data);
+		g_mutex_lock (&cache_mutex);
+
+		/* the cache can be released, or the folder loaded by another
+		 * thread, in the meanwhile */
+
+		folder_data = (cache_folders != NULL) ? gth_user_cache_lookup (cache_folders, uri) : NULL;
+		if ((folder_data == NULL) && (cache_folders != NULL)) {
+			folder_data = new_folder_data;
+			gth_user_cache_add (cache_folders, uri, folder_data);
+			if (_gth_metadata_cache_apply_removed_files (folder_data))
+				gth_user_cache_queue_save (cache_folders, uri);
+		}
+		else
+			folder_data_free (new_folder_data);
+	}
+
+	g_free (uri);
+
+	return folder_data;
+}
+
+
+/* -- monitor -- */
+
+
+static void
+monitor_folder_changed_cb (GthMonitor      *monitor,
+			   GFile           *parent,
+			   GList           *list,
+			   int              position,
+			   GthMonitorEvent  event,
+			   gpointer         user_data)
+{
+	GList *scan;
+
+	for (scan = list; scan; scan = scan->next)
+		gth_metadata_cache_remove (G_FILE (scan->data));
+}
+
+
+static void
+monitor_file_renamed_cb (GthMonitor *monitor,
+			 GFile      *file,
+			 GFile      *new_file,
+			 gpointer    user_data)
+{
+	gth_metadata_cache_remove (file);
+	gth_metadata_cache_remove (new_file);
+}
+
+
+static void
+monitor_metadata_changed_cb (GthMonitor  *monitor,
+			     GthFileData *file_data,
+			     gpointer     user_data)
+{
+	gth_metadata_cache_remove (file_data->file);
+}
+
+
+/**/
+
+
+void
+gth_metadata_cache_initialize (void)
+{
+	GthMonitor *monitor;
+
+	if (cache_folders != NULL)
+		return;
+
+	cache_folders = gth_user_cache_new (CACHE_NAME,
+					    MAX_FOLDERS_IN_MEMORY,
+					    (GthUserCacheSerializeFunc) _gth_metadata_cache_serialize_folder,
+					    (GDestroyNotify) folder_data_free,
+					    &cache_mutex);
+	removed_files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_hash_table_unref);
+
+	monitor = gth_main_get_default_monitor ();
+	g_signal_connect (monitor, "folder-changed", G_CALLBACK (monitor_folder_changed_cb), NULL);
+	g_signal_connect (monitor, "file-renamed", G_CALLBACK (monitor_file_renamed_cb), NULL);
+	g_signal_connect (monitor, "metadata-changed", G_CALLBACK (monitor_metadata_changed_cb), NULL);
+}
+
+
+void
+gth_metadata_cache_release (void)
+{
+	GHashTableIter  iter;
+	const char     *uri;
+	GthMonitor     *monitor;
+
+	if (cache_folders == NULL)
+		return;
+
+	monitor = gth_main_get_default_monitor ();
+	g_signal_handlers_disconnect_by_func (monitor, monitor_folder_changed_cb, NULL);
+	g_signal_handlers_disconnect_by_func (monitor, monitor_file_renamed_cb, NULL);
+	g_signal_handlers_disconnect_by_func (monitor, monitor_metadata_changed_cb, NULL);
+
+	g_mutex_lock (&cache_mutex);
+
+	gth_user_cache_free (cache_folders);
+	cache_folders = NULL;
+
+	/* the cache of the folders with removed files is not valid anymore */
+
+	g_hash_table_iter_init (&iter, removed_files);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &uri, NULL))
+		gth_user_cache_delete_file (CACHE_NAME, uri);
+
+	g_hash_table_unref (removed_files);
+	removed_files = NULL;
+
+	g_mutex_unlock (&cache_mutex);
+}
+
+
+/* Sets in @file_data the attributes read by the provider @provider_id the
+ * last time, returns FALSE if they are not in the cache, if the file has
+ * changed since then, or if @attributes were not all read.  In the last
+ * case @read_attributes, if not NULL, is set to the attributes read the
+ * last time. */
+gboolean
+gth_metadata_cache_load (GthFileData  *file_data,
+			 const char   *provider_id,
+			 const char   *attributes,
+			 char        **read_attributes)
+{
+	guint64     size;
+	gint64      mtime;
+	GFile      *folder;
+	char       *name;
+	FolderData *folder_data;
+	CacheEntry *entry;
+	GVariant   *provider_data;
+	gboolean    found;
+
+	if (read_attributes != NULL)
+		*read_attributes = NULL;
+
+	if (! _gth_metadata_cache_get_file_times (file_data->info, &size, &mtime))
+		return FALSE;
+
+	folder = g_file_get_parent (file_data->file);
+	if (folder == NULL)
+		return FALSE;
+	name = g_file_get_basename (file_data->file);
+
+	found = FALSE;
+	folder_data = _gth_metadata_cache_lock_folder (folder);
+	if (folder_data != NULL) {
+		entry = g_hash_table_lookup (folder_data->entries, name);
+		if ((entry != NULL) && (entry->size == size) && (entry->mtime == mtime)) {
+			provider_data = g_hash_table_lookup (entry->providers, provider_id);
+			if (provider_data != NULL) {
+				const char *cached_attributes;
+				GVariant   *values;
+
+				g_variant_get (provider_data, "(&s@a{sv})", &cached_attributes, &values);
+				if (_g_file_attributes_matches_all (attributes, cached_attributes)) {
+					GVariantIter  iter;
+					const char   *attribute;
+					GVariant     *value;
+
+					g_variant_iter_init (&iter, values);
+					while (g_variant_iter_loop (&iter, "{&sv}", &attribute, &value))
+						_g_file_info_set_attribute_variant (file_data->info, attribute, value);
+					found = TRUE;
+				}
+				else if (read_attributes != NULL)
+					*read_attributes = g_strdup (cached_attributes);
+
+				g_variant_unref (values);
+			}
+		}
+	}
+
+	g_mutex_unlock (&cache_mutex);
+
+	g_free (name);
+	g_object_unref (folder);
+
+	return found;
+}
+
+
+/* Saves the @attribute_v attributes of @file_data as the result of the
+ * provider @provider_id when asked to read @read_attributes. */
+void
+gth_metadata_cache_save (GthFileData  *file_data,
+			 const char   *provider_id,
+			 const char   *read_attributes,
+			 char        **attribute_v)
+{
+	guint64          size;
+	gint64           mtime;
+	GVariantBuilder  builder;
+	int              i;
+	GVariant        *provider_data;
+	GFile           *folder;
+	char            *name;
+	FolderData      *folder_data;
+	CacheEntry      *entry;
+
+	if (! _gth_metadata_cache_get_file_times (file_data->info, &size, &mtime))
+		return;
+
+	folder = g_file_get_parent (file_data->file);
+	if (folder == NULL)
+		return;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+	for (i = 0; attribute_v[i] != NULL; i++) {
+		GVariant *value;
+
+		value = _g_file_info_get_attribute_variant (file_data->info, attribute_v[i]);
+		if (value != NULL)
+			g_variant_builder_add (&builder, "{sv}", attribute_v[i], value);
+	}
+	provider_data = g_variant_ref_sink (g_variant_new (PROVIDER_FORMAT, read_attributes, &builder));
+
+	name = g_file_get_basename (file_data->file);
+	folder_data = _gth_metadata_cache_lock_folder (folder);
+	if (folder_data != NULL) {
+		entry = g_hash_table_lookup (folder_data->entries, name);
+		if ((entry == NULL) || (entry->size != size) || (entry->mtime != mtime)) {
+			entry = cache_entry_new (size, mtime);
+			g_hash_table_insert (folder_data->entries, g_strdup (name), entry);
+		}
+		g_hash_table_insert (entry->providers, g_strdup (provider_id), g_variant_ref (provider_data));
+		gth_user_cache_queue_save (cache_folders, folder_data->uri);
+	}
+
+	g_mutex_unlock (&cache_mutex);
+
+	g_variant_unref (provider_data);
+	g_free (name);
+	g_object_unref (folder);
+}
+
+
+/* Removes the attributes saved for @file.  This is called by the monitor
+ * callbacks in the main thread, so the cache of the folder is not loaded
+ * here if not already in memory: the file is removed when the cache is
+ * loaded, or the cache file is deleted at exit. */
+void
+gth_metadata_cache_remove (GFile *file)
+{
+	GFile      *folder;
+	char       *uri;
+	char       *name;
+	FolderData *folder_data;
+
+	folder = g_file_get_parent (file);
+	if (folder == NULL)
+		return;
+
+	uri = g_file_get_uri (folder);
+	name = g_file_get_basename (file);
+
+	g_mutex_lock (&cache_mutex);
+
+	if (cache_folders != NULL) {
+		folder_data = gth_user_cache_lookup (cache_folders, uri);
+		if (folder_data != NULL) {
+			if (g_hash_table_remove (folder_data->entries, name))
+				gth_user_cache_queue_save (cache_folders, uri);
+		}
+		else {
+			GHashTable *names;
+
+			names = g_hash_table_lookup (removed_files, uri);
+			if (names == NULL) {
+				names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+				g_hash_table_insert (removed_files, g_strdup (uri), names);
+			}
+			g_hash_table_add (names, g_strdup (name));
+		}
+	}
+
+	g_mutex_unlock (&cache_mutex);
+
+	g_free (name);
+	g_free (uri);
+	g_object_unref (folder);
+}
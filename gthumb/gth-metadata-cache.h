@@ -0,0 +1,46 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+/*
+ *  GThumb
+ *
+ *  Copyright (C) 2013 Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef GTH_METADATA_CACHE_H
+#define GTH_METADATA_CACHE_H
+
+#include <glib.h>
+#include <gio/gio.h>
+#include "gth-file-data.h"
+
+G_BEGIN_DECLS
+
+void		gth_metadata_cache_initialize	(void);
+void		gth_metadata_cache_release	(void);
+gboolean	gth_metadata_cache_load		(GthFileData  *file_data,
+						 const char   *provider_id,
+						 const char   *attributes,
+						 char        **read_attributes);
+void		gth_metadata_cache_save		(GthFileData  *file_data,
+						 const char   *provider_id,
+						 const char   *read_attributes,
+						 char        **attribute_v);
+void		gth_metadata_cache_remove	(GFile        *file);
+
+G_END_DECLS
+
+#endif /* GTH_METADATA_CACHE_H */
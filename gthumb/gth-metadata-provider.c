@@ -20,13 +20,20 @@
  */
 
 #include <config.h>
+#include <string.h>
 #include "glib-utils.h"
 #include "gth-file-data.h"
 #include "gth-main.h"
+#include "gth-metadata-cache.h"
 #include "gth-metadata-provider.h"
 
 
 #define CHECK_THREAD_RATE 5
+#define READ_CONTEXT_KEY "gth-metadata-read-context"
+#define QUERY_METADATA_BATCH_SIZE 50
+#define QUERY_METADATA_MAX_THREADS 4
+#define PROVIDER_POOL_MAX_SIZE 8
+#define CAN_READ_CACHE_MAX_SIZE 500
 
 
 G_DEFINE_TYPE (GthMetadataProvider, gth_metadata_provider, G_TYPE_OBJECT)
@@ -50,6 +57,22 @@ gth_metadata_provider_real_can_write (GthMetadataProvider  *self,
 }
 
 
+static gboolean
+gth_metadata_provider_real_can_cache (GthMetadataProvider *self,
+				      GthFileData         *file_data)
+{
+	return FALSE;
+}
+
+
+static gsize
+gth_metadata_provider_real_get_read_size (GthMetadataProvider *self,
+					  GthFileData         *file_data)
+{
+	return 0;
+}
+
+
 static void
 gth_metadata_provider_real_read (GthMetadataProvider *self,
 				 GthFileData         *file_data,
@@ -76,6 +99,8 @@ gth_metadata_provider_class_init (GthMetadataProviderClass * klass)
 {
 	GTH_METADATA_PROVIDER_CLASS (klass)->can_read = gth_metadata_provider_real_can_read;
 	GTH_METADATA_PROVIDER_CLASS (klass)->can_write = gth_metadata_provider_real_can_write;
+	GTH_METADATA_PROVIDER_CLASS (klass)->can_cache = gth_metadata_provider_real_can_cache;
+	GTH_METADATA_PROVIDER_CLASS (klass)->get_read_size = gth_metadata_provider_real_get_read_size;
 	GTH_METADATA_PROVIDER_CLASS (klass)->read = gth_metadata_provider_real_read;
 	GTH_METADATA_PROVIDER_CLASS (klass)->write = gth_metadata_provider_real_write;
 }
@@ -106,6 +131,27 @@ gth_metadata_provider_can_write (GthMetadataProvider  *self,
 }
 
 
+/* Returns whether the attributes read for @file_data can be saved in the
+ * metadata cache, that is if they only depend on the file content. */
+gboolean
+gth_metadata_provider_can_cache (GthMetadataProvider *self,
+				 GthFileData         *file_data)
+{
+	return GTH_METADATA_PROVIDER_GET_CLASS (self)->can_cache (self, file_data);
+}
+
+
+/* Returns how many bytes of @file_data the provider is going to ask to
+ * gth_metadata_provider_get_file_buffer, or 0 if it doesn't use the shared
+ * buffer. */
+gsize
+gth_metadata_provider_get_read_size (GthMetadataProvider *self,
+				     GthFileData         *file_data)
+{
+	return GTH_METADATA_PROVIDER_GET_CLASS (self)->get_read_size (self, file_data);
+}
+
+
 void
 gth_metadata_provider_read (GthMetadataProvider *self,
 			    GthFileData         *file_data,
@@ -127,6 +173,226 @@ gth_metadata_provider_write (GthMetadataProvider   *self,
 }
 
 
+/* -- provider pool -- */
+
+
+/* The providers are not thread safe, so every thread needs its own
+ * instances.  To avoid creating them, and their settings, for every query
+ * the lists of instances are kept in a pool when a thread is done with
+ * them.
+ * The providers registered later, when an extension is activated, are
+ * appended to the list of the registered providers, so a list with fewer
+ * providers is out of date. */
+
+
+static GMutex      provider_pool_mutex;
+static GQueue      provider_pool = G_QUEUE_INIT; /* GthMetadataProvider list queue */
+static GHashTable *can_read_cache = NULL;
+
+
+static GList *
+_gth_metadata_provider_pool_get (void)
+{
+	GList *registered_providers;
+	GList *providers;
+	GList *scan;
+
+	registered_providers = gth_main_get_all_metadata_providers ();
+
+	g_mutex_lock (&provider_pool_mutex);
+	providers = g_queue_pop_head (&provider_pool);
+	g_mutex_unlock (&provider_pool_mutex);
+
+	if (providers != NULL) {
+		if (g_list_length (providers) == g_list_length (registered_providers))
+			return providers;
+		_g_object_list_unref (providers);
+		providers = NULL;
+	}
+
+	for (scan = registered_providers; scan; scan = scan->next)
+		providers = g_list_prepend (providers, g_object_new (G_OBJECT_TYPE (scan->data), NULL));
+
+	return g_list_reverse (providers);
+}
+
+
+static void
+_gth_metadata_provider_pool_release (GList *providers)
+{
+	g_mutex_lock (&provider_pool_mutex);
+	if (g_queue_get_length (&provider_pool) < PROVIDER_POOL_MAX_SIZE) {
+		g_queue_push_head (&provider_pool, providers);
+		providers = NULL;
+	}
+	g_mutex_unlock (&provider_pool_mutex);
+
+	_g_object_list_unref (providers);
+}
+
+
+/* Sets in @can_read_v the result of gth_metadata_provider_can_read for each
+ * provider, the results are computed once for each list of providers, mime
+ * type and attributes.  The number of providers identifies the list, see
+ * above. */
+static void
+_gth_metadata_provider_pool_can_read (GList       *providers,
+				      const char  *mime_type,
+				      const char  *attributes,
+				      char       **attributes_v,
+				      gboolean    *can_read_v)
+{
+	int       n_providers;
+	char     *key;
+	gboolean *cached_v;
+	GList    *scan;
+	int       i;
+
+	n_providers = g_list_length (providers);
+	key = g_strdup_printf ("%d\n%s\n%s", n_providers, (mime_type != NULL) ? mime_type : "", attributes);
+
+	g_mutex_lock (&provider_pool_mutex);
+	if (can_read_cache == NULL)
+		can_read_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	cached_v = g_hash_table_lookup (can_read_cache, key);
+	if (cached_v != NULL)
+		memcpy (can_read_v, cached_v, sizeof (gboolean) * n_providers);
+	g_mutex_unlock (&provider_pool_mutex);
+
+	if (cached_v != NULL) {
+		g_free (key);
+		return;
+	}
+
+	for (scan = providers, i = 0; scan; scan = scan->next, i++)
+		can_read_v[i] = gth_metadata_provider_can_read (GTH_METADATA_PROVIDER (scan->data), mime_type, attributes_v);
+
+	g_mutex_lock (&provider_pool_mutex);
+	if (g_hash_table_size (can_read_cache) >= CAN_READ_CACHE_MAX_SIZE)
+		g_hash_table_remove_all (can_read_cache);
+	g_hash_table_insert (can_read_cache, key, g_memdup (can_read_v, sizeof (gboolean) * n_providers));
+	g_mutex_unlock (&provider_pool_mutex);
+}
+
+
+/* -- gth_metadata_provider_get_file_buffer -- */
+
+
+/* The content read from a file while querying its metadata, shared by all
+ * the providers so that the file is opened and read only once. */
+typedef struct {
+	GFile        *file;
+	GInputStream *stream;
+	GByteArray   *buffer;
+	gsize         read_size;
+	gboolean      eof;
+	gboolean      error;
+} ReadContext;
+
+
+static ReadContext *
+read_context_new (GFile *file,
+		  gsize  read_size)
+{
+	ReadContext *read_context;
+
+	read_context = g_new0 (ReadContext, 1);
+	read_context->file = g_object_ref (file);
+	read_context->read_size = read_size;
+	read_context->stream = NULL;
+	read_context->buffer = g_byte_array_new ();
+	read_context->eof = FALSE;
+	read_context->error = FALSE;
+
+	return read_context;
+}
+
+
+static void
+read_context_free (gpointer user_data)
+{
+	ReadContext *read_context = user_data;
+
+	g_byte_array_free (read_context->buffer, TRUE);
+	_g_object_unref (read_context->stream);
+	g_object_unref (read_context->file);
+	g_free (read_context);
+}
+
+
+static void
+read_context_fill (ReadContext  *read_context,
+		   gsize         size,
+		   GCancellable *cancellable)
+{
+	guint old_len;
+	gsize bytes_read;
+
+	if ((read_context->buffer->len >= size) || read_context->eof || read_context->error)
+		return;
+
+	if (read_context->stream == NULL) {
+		read_context->stream = (GInputStream *) g_file_read (read_context->file, cancellable, NULL);
+		if (read_context->stream == NULL) {
+			read_context->error = TRUE;
+			return;
+		}
+	}
+
+	/* read at once what all the providers are going to need, to avoid
+	 * expanding the buffer for each of them */
+
+	size = MAX (size, read_context->read_size);
+
+	old_len = read_context->buffer->len;
+	g_byte_array_set_size (read_context->buffer, size);
+	if (! g_input_stream_read_all (read_context->stream,
+				       read_context->buffer->data + old_len,
+				       size - old_len,
+				       &bytes_read,
+				       cancellable,
+				       NULL))
+	{
+		g_byte_array_set_size (read_context->buffer, old_len);
+		read_context->error = TRUE;
+		return;
+	}
+
+	g_byte_array_set_size (read_context->buffer, old_len + bytes_read);
+	if (bytes_read < size - old_len)
+		read_context->eof = TRUE;
+}
+
+
+/* Returns the first bytes of the file, reading at least @min_size bytes
+ * unless the file is shorter.  The content is read only once and shared by
+ * all the providers called by _g_query_metadata_async, later calls can only
+ * expand it.  Returns NULL if the buffer is not available, in that case the
+ * provider has to read the file by itself.  The returned data is valid until
+ * the next call. */
+const guchar *
+gth_metadata_provider_get_file_buffer (GthFileData  *file_data,
+				       gsize         min_size,
+				       gsize        *buffer_size,
+				       GCancellable *cancellable)
+{
+	ReadContext *read_context;
+
+	read_context = g_object_get_data (G_OBJECT (file_data), READ_CONTEXT_KEY);
+	if (read_context == NULL)
+		return NULL;
+
+	read_context_fill (read_context, min_size, cancellable);
+	if (read_context->error && (read_context->buffer->len == 0))
+		return NULL;
+
+	if (buffer_size != NULL)
+		*buffer_size = read_context->buffer->len;
+
+	return read_context->buffer->data;
+}
+
+
 /* -- _g_query_metadata_async -- */
 
 
@@ -149,72 +415,337 @@ query_metadata_data_free (gpointer user_data)
 }
 
 
-static void
-_g_query_metadata_async_thread (GSimpleAsyncResult *result,
-				GObject            *object,
-				GCancellable       *cancellable)
-{
+/* read the metadata of a batch of files in every thread, the
+ * read-metadata-ready hook is invoked after each batch. */
+typedef struct {
 	QueryMetadataData  *qmd;
-	GList              *providers;
-	GList              *scan;
-	GError             *error = NULL;
+	GthFileData       **files;
+	int                 n_files;
+	int                 next_batch;
+	int                 cancelled;
+	GCancellable       *cancellable;
+} QueryMetadataWork;
 
-	performance (DEBUG_INFO, "_g_query_metadata_async_thread start");
 
-	qmd = g_simple_async_result_get_op_res_gpointer (result);
+static GMutex read_metadata_ready_mutex;
 
-	providers = NULL;
-	for (scan = gth_main_get_all_metadata_providers (); scan; scan = scan->next)
-		providers = g_list_prepend (providers, g_object_new (G_OBJECT_TYPE (scan->data), NULL));
-	providers = g_list_reverse (providers);
 
-	for (scan = qmd->files; scan; scan = scan->next) {
-		GthFileData *file_data = scan->data;
-		GList       *scan_providers;
+static gboolean
+_g_file_info_attribute_equal (GFileInfo  *info1,
+			      GFileInfo  *info2,
+			      const char *attribute)
+{
+	GFileAttributeType  type;
+	char               *value1;
+	char               *value2;
+	gboolean            equal;
 
-		if ((cancellable != NULL) && g_cancellable_is_cancelled (cancellable)) {
-			error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_CANCELLED, "");
-			break;
+	type = g_file_info_get_attribute_type (info1, attribute);
+	if (type != g_file_info_get_attribute_type (info2, attribute))
+		return FALSE;
+
+	if (type == G_FILE_ATTRIBUTE_TYPE_OBJECT)
+		return g_file_info_get_attribute_object (info1, attribute) == g_file_info_get_attribute_object (info2, attribute);
+
+	value1 = g_file_info_get_attribute_as_string (info1, attribute);
+	value2 = g_file_info_get_attribute_as_string (info2, attribute);
+	equal = g_strcmp0 (value1, value2) == 0;
+
+	g_free (value2);
+	g_free (value1);
+
+	return equal;
+}
+
+
+/* the namespaces of the attributes set when querying the file info, not
+ * by the metadata providers */
+static const char *file_info_namespaces[] = { "standard::", "time::", "unix::", "access::", "owner::", "id::", "etag::", "filesystem::", "mountable::", "thumbnail::", "preview::", "dos::", "selinux::", "trash::", "recent::", "xattr::", "xattr-sys::", "gvfs::", NULL };
+
+
+static gboolean
+_g_file_attribute_is_file_info (const char *attribute)
+{
+	int i;
+
+	for (i = 0; file_info_namespaces[i] != NULL; i++)
+		if (g_str_has_prefix (attribute, file_info_namespaces[i]))
+			return TRUE;
+
+	return FALSE;
+}
+
+
+/* Returns the attributes to save in the cache after reading
+ * @read_attributes: the attributes added or changed by the provider, and
+ * the attributes that match @read_attributes, even if they had the same
+ * value before, so that they are available when loading the cache for
+ * another file info. */
+static char **
+_g_file_info_get_cache_attributes (GFileInfo  *old_info,
+				   GFileInfo  *new_info,
+				   const char *read_attributes)
+{
+	GFileAttributeMatcher  *matcher;
+	char                  **attribute_v;
+	GPtrArray              *cache_attributes;
+	int                     i;
+
+	matcher = g_file_attribute_matcher_new (read_attributes);
+	cache_attributes = g_ptr_array_new ();
+	attribute_v = g_file_info_list_attributes (new_info, NULL);
+	for (i = 0; attribute_v[i] != NULL; i++) {
+		if (! _g_file_info_attribute_equal (old_info, new_info, attribute_v[i])
+		    || (g_file_attribute_matcher_matches (matcher, attribute_v[i]) && ! _g_file_attribute_is_file_info (attribute_v[i])))
+		{
+			g_ptr_array_add (cache_attributes, g_strdup (attribute_v[i]));
 		}
+	}
+	g_ptr_array_add (cache_attributes, NULL);
+
+	g_strfreev (attribute_v);
+	g_file_attribute_matcher_unref (matcher);
+
+	return (char **) g_ptr_array_free (cache_attributes, FALSE);
+}
+
+
+/* Returns the attributes in @attributes1 or in @attributes2. */
+static char *
+_g_file_attributes_union (const char *attributes1,
+			  const char *attributes2)
+{
+	char    **attributes_v;
+	GString  *attributes;
+	char    **attribute_v2;
+	int       i;
+
+	attributes_v = g_strsplit (attributes1, ",", -1);
+	attributes = g_string_new (attributes1);
+	attribute_v2 = g_strsplit (attributes2, ",", -1);
+	for (i = 0; attribute_v2[i] != NULL; i++) {
+		if ((attribute_v2[i][0] == '\0') || (_g_strv_find (attributes_v, attribute_v2[i]) >= 0))
+			continue;
+		g_string_append_c (attributes, ',');
+		g_string_append (attributes, attribute_v2[i]);
+	}
+
+	g_strfreev (attribute_v2);
+	g_strfreev (attributes_v);
+
+	return g_string_free (attributes, FALSE);
+}
+
+
+static void
+_g_query_metadata_read_provider (QueryMetadataData   *qmd,
+				 GthMetadataProvider *metadata_provider,
+				 GthFileData         *file_data,
+				 GCancellable        *cancellable)
+{
+	const char  *provider_id;
+	char        *cached_attributes;
+	char        *read_attributes;
+	GFileInfo   *old_info;
+	char       **cache_v;
+
+	if (! gth_metadata_provider_can_cache (metadata_provider, file_data)) {
+		gth_metadata_provider_read (metadata_provider, file_data, qmd->attributes, cancellable);
+		return;
+	}
+
+	/* the provider reads the file only if the cached attributes are
+	 * missing or out of date. */
+
+	provider_id = G_OBJECT_TYPE_NAME (metadata_provider);
+	if (gth_metadata_cache_load (file_data, provider_id, qmd->attributes, &cached_attributes))
+		return;
+
+	/* read the attributes cached before as well, so that the cache is
+	 * valid for the previous queries too */
+
+	if (cached_attributes != NULL)
+		read_attributes = _g_file_attributes_union (qmd->attributes, cached_attributes);
+	else
+		read_attributes = g_strdup (qmd->attributes);
+
+	old_info = g_file_info_dup (file_data->info);
+	gth_metadata_provider_read (metadata_provider, file_data, read_attributes, cancellable);
+	if ((cancellable == NULL) || ! g_cancellable_is_cancelled (cancellable)) {
+		cache_v = _g_file_info_get_cache_attributes (old_info, file_data->info, read_attributes);
+		gth_metadata_cache_save (file_data, provider_id, read_attributes, cache_v);
+		g_strfreev (cache_v);
+	}
+
+	g_object_unref (old_info);
+	g_free (read_attributes);
+	g_free (cached_attributes);
+}
+
+
+static void
+_g_query_metadata_read_file (QueryMetadataData *qmd,
+			     GList             *providers,
+			     gboolean          *can_read_v,
+			     GthFileData       *file_data,
+			     GCancellable      *cancellable)
+{
+	GList *scan_providers;
+	int    i;
+	gsize  read_size;
 
 #if WEBP_IS_UNKNOWN_TO_GLIB
-		if (_g_file_attributes_matches_any_v (G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE ","
-						      G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE,
-						      qmd->attributes_v))
-		{
-			char       *uri;
-			const char *ext;
+	if (_g_file_attributes_matches_any_v (G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE ","
+					      G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE,
+					      qmd->attributes_v))
+	{
+		char       *uri;
+		const char *ext;
+
+		uri = g_file_get_uri (file_data->file);
+		ext = _g_uri_get_file_extension (uri);
+		if (g_strcmp0 (ext, ".webp") == 0)
+			gth_file_data_set_mime_type (file_data, "image/webp");
+
+		g_free (uri);
+	}
+#endif
+
+	_gth_metadata_provider_pool_can_read (providers,
+					      gth_file_data_get_mime_type (file_data),
+					      qmd->attributes,
+					      qmd->attributes_v,
+					      can_read_v);
+
+	/* the file content is read lazily, only if a provider asks
+	 * for it, as much as the largest amount needed by the providers
+	 * that are going to read the file */
+
+	read_size = 0;
+	for (scan_providers = providers, i = 0; scan_providers; scan_providers = scan_providers->next, i++) {
+		if (can_read_v[i])
+			read_size = MAX (read_size, gth_metadata_provider_get_read_size (scan_providers->data, file_data));
+	}
 
-			uri = g_file_get_uri (file_data->file);
-			ext = _g_uri_get_file_extension (uri);
-			if (g_strcmp0 (ext, ".webp") == 0)
-				gth_file_data_set_mime_type (file_data, "image/webp");
+	g_object_set_data_full (G_OBJECT (file_data),
+				READ_CONTEXT_KEY,
+				read_context_new (file_data->file, read_size),
+				read_context_free);
+	for (scan_providers = providers, i = 0; scan_providers; scan_providers = scan_providers->next, i++) {
+		GthMetadataProvider *metadata_provider = scan_providers->data;
 
-			g_free (uri);
+		if (can_read_v[i])
+			_g_query_metadata_read_provider (qmd, metadata_provider, file_data, cancellable);
+	}
+
+	g_object_set_data (G_OBJECT (file_data), READ_CONTEXT_KEY, NULL);
+}
+
+
+static gpointer
+query_metadata_thread_func (gpointer user_data)
+{
+	QueryMetadataWork *work = user_data;
+	GList             *providers;
+	gboolean          *can_read_v;
+
+	providers = _gth_metadata_provider_pool_get ();
+	can_read_v = g_new (gboolean, g_list_length (providers));
+
+	while (! g_atomic_int_get (&work->cancelled)) {
+		int    first;
+		int    last;
+		GList *batch;
+		int    i;
+
+		first = g_atomic_int_add (&work->next_batch, 1) * QUERY_METADATA_BATCH_SIZE;
+		if (first >= work->n_files)
+			break;
+		last = MIN (first + QUERY_METADATA_BATCH_SIZE, work->n_files);
+
+		batch = NULL;
+		for (i = first; i < last; i++) {
+			if ((work->cancellable != NULL) && g_cancellable_is_cancelled (work->cancellable)) {
+				g_atomic_int_set (&work->cancelled, TRUE);
+				break;
+			}
+
+			_g_query_metadata_read_file (work->qmd, providers, can_read_v, work->files[i], work->cancellable);
+			batch = g_list_prepend (batch, work->files[i]);
 		}
-#endif
+		batch = g_list_reverse (batch);
 
-		for (scan_providers = providers; scan_providers; scan_providers = scan_providers->next) {
-			GthMetadataProvider *metadata_provider = scan_providers->data;
+		if (! g_atomic_int_get (&work->cancelled)) {
+			/* the hook callbacks are not required to be thread
+			 * safe. */
 
-			if (gth_metadata_provider_can_read (metadata_provider, gth_file_data_get_mime_type (file_data), qmd->attributes_v))
-				gth_metadata_provider_read (metadata_provider, file_data, qmd->attributes, cancellable);
+			g_mutex_lock (&read_metadata_ready_mutex);
+			gth_hook_invoke ("read-metadata-ready", batch, work->qmd->attributes);
+			g_mutex_unlock (&read_metadata_ready_mutex);
 		}
+
+		g_list_free (batch);
 	}
 
-	_g_object_list_unref (providers);
+	g_free (can_read_v);
+	_gth_metadata_provider_pool_release (providers);
 
-	performance (DEBUG_INFO, "_g_query_metadata_async_thread before read-metadata-ready");
+	return NULL;
+}
 
-	if (error == NULL)
-		gth_hook_invoke ("read-metadata-ready", qmd->files, qmd->attributes);
 
-	if (error != NULL) {
+static void
+_g_query_metadata_async_thread (GSimpleAsyncResult *result,
+				GObject            *object,
+				GCancellable       *cancellable)
+{
+	QueryMetadataData  *qmd;
+	QueryMetadataWork   work;
+	GList              *scan;
+	int                 n_batches;
+	int                 n_threads;
+	GThread           **threads;
+	int                 i;
+
+	performance (DEBUG_INFO, "_g_query_metadata_async_thread start");
+
+	qmd = g_simple_async_result_get_op_res_gpointer (result);
+
+	work.qmd = qmd;
+	work.n_files = g_list_length (qmd->files);
+	work.files = g_new (GthFileData *, work.n_files);
+	for (scan = qmd->files, i = 0; scan; scan = scan->next)
+		work.files[i++] = scan->data;
+	work.next_batch = 0;
+	work.cancelled = FALSE;
+	work.cancellable = cancellable;
+
+	/* this thread reads a batch as well, the other threads are started
+	 * only if there is more than one batch to read. */
+
+	n_batches = (work.n_files + QUERY_METADATA_BATCH_SIZE - 1) / QUERY_METADATA_BATCH_SIZE;
+	n_threads = MIN (g_get_num_processors (), QUERY_METADATA_MAX_THREADS);
+	n_threads = MAX (MIN (n_threads, n_batches), 1);
+
+	threads = g_new (GThread *, n_threads);
+	for (i = 1; i < n_threads; i++)
+		threads[i] = g_thread_new ("query_metadata", query_metadata_thread_func, &work);
+	query_metadata_thread_func (&work);
+	for (i = 1; i < n_threads; i++)
+		g_thread_join (threads[i]);
+
+	performance (DEBUG_INFO, "_g_query_metadata_async_thread end");
+
+	if (work.cancelled) {
+		GError *error;
+
+		error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_CANCELLED, "");
 		g_simple_async_result_set_from_error (result, error);
 		g_error_free (error);
 	}
 
-	performance (DEBUG_INFO, "_g_query_metadata_async_thread end");
+	g_free (threads);
+	g_free (work.files);
 }
 
 
@@ -305,10 +836,7 @@ _g_write_metadata_async_thread (GSimpleAsyncResult *result,
 
 	wmd = g_simple_async_result_get_op_res_gpointer (result);
 
-	providers = NULL;
-	for (scan = gth_main_get_all_metadata_providers (); scan; scan = scan->next)
-		providers = g_list_prepend (providers, g_object_new (G_OBJECT_TYPE (scan->data), NULL));
-	providers = g_list_reverse (providers);
+	providers = _gth_metadata_provider_pool_get ();
 
 	for (scan = wmd->files; scan; scan = scan->next) {
 		GthFileData *file_data = scan->data;
@@ -327,7 +855,7 @@ _g_write_metadata_async_thread (GSimpleAsyncResult *result,
 		}
 	}
 
-	_g_object_list_unref (providers);
+	_gth_metadata_provider_pool_release (providers);
 
 	if (error != NULL) {
 		g_simple_async_result_set_from_error (result, error);
@@ -56,6 +56,10 @@ struct _GthMetadataProviderClass {
 	gboolean  (*can_write) (GthMetadataProvider    *self,
 			        const char             *mime_type,
 			        char                  **attribute_v);
+	gboolean  (*can_cache) (GthMetadataProvider    *self,
+				GthFileData            *file_data);
+	gsize     (*get_read_size) (GthMetadataProvider *self,
+				    GthFileData         *file_data);
 	void      (*read)      (GthMetadataProvider    *self,
 		                GthFileData            *file_data,
 		                const char             *attributes,
@@ -74,6 +78,10 @@ gboolean   gth_metadata_provider_can_read   (GthMetadataProvider    *self,
 gboolean   gth_metadata_provider_can_write  (GthMetadataProvider    *self,
 					     const char             *mime_type,
 					     char                  **attribute_v);
+gboolean   gth_metadata_provider_can_cache  (GthMetadataProvider    *self,
+					     GthFileData            *file_data);
+gsize      gth_metadata_provider_get_read_size (GthMetadataProvider *self,
+						GthFileData         *file_data);
 void       gth_metadata_provider_read       (GthMetadataProvider    *self,
 					     GthFileData            *file_data,
 					     const char             *attributes,
@@ -83,6 +91,10 @@ void       gth_metadata_provider_write      (GthMetadataProvider    *self,
 					     GthFileData            *file_data,
 					     const char             *attributes,
 					     GCancellable           *cancellable);
+const guchar * gth_metadata_provider_get_file_buffer (GthFileData            *file_data,
+						      gsize                   min_size,
+						      gsize                  *buffer_size,
+						      GCancellable           *cancellable);
 void       _g_query_metadata_async          (GList                  *files,       /* GthFileData * list */
 					     const char             *attributes,
 					     GCancellable           *cancellable,
@@ -325,3 +325,208 @@ set_attribute_from_string (GFileInfo  *info,
 
 	g_object_unref (metadata);
 }
+
+
+/* -- GFileInfo attributes as GVariant -- */
+
+
+#define ICON_FORMAT "(s)"
+#define STRING_LIST_FORMAT "(as)"
+#define METADATA_FORMAT "(msmsmsmsmsmas)"
+
+
+static GVariant *
+_gth_string_list_to_variant (GthStringList *string_list)
+{
+	GVariantBuilder  builder;
+	GList           *scan;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_STRING_ARRAY);
+	for (scan = gth_string_list_get_list (string_list); scan; scan = scan->next)
+		g_variant_builder_add (&builder, "s", scan->data);
+
+	return g_variant_builder_end (&builder);
+}
+
+
+static GthStringList *
+_gth_string_list_from_variant (GVariant *value)
+{
+	const char    **strv;
+	GthStringList  *string_list;
+
+	strv = g_variant_get_strv (value, NULL);
+	string_list = gth_string_list_new_from_strv ((char **) strv);
+
+	g_free (strv);
+
+	return string_list;
+}
+
+
+/* Returns the value of @attribute as a floating GVariant, or NULL if the
+ * value cannot be serialized.  Objects are supported if they are icons,
+ * GthMetadata or GthStringList objects. */
+GVariant *
+_g_file_info_get_attribute_variant (GFileInfo  *info,
+				    const char *attribute)
+{
+	GVariant *value = NULL;
+
+	switch (g_file_info_get_attribute_type (info, attribute)) {
+	case G_FILE_ATTRIBUTE_TYPE_STRING:
+		if (g_file_info_get_attribute_string (info, attribute) != NULL)
+			value = g_variant_new_string (g_file_info_get_attribute_string (info, attribute));
+		break;
+
+	case G_FILE_ATTRIBUTE_TYPE_BYTE_STRING:
+		if (g_file_info_get_attribute_byte_string (info, attribute) != NULL)
+			value = g_variant_new_bytestring (g_file_info_get_attribute_byte_string (info, attribute));
+		break;
+
+	case G_FILE_ATTRIBUTE_TYPE_BOOLEAN:
+		value = g_variant_new_boolean (g_file_info_get_attribute_boolean (info, attribute));
+		break;
+
+	case G_FILE_ATTRIBUTE_TYPE_UINT32:
+		value = g_variant_new_uint32 (g_file_info_get_attribute_uint32 (info, attribute));
+		break;
+
+	case G_FILE_ATTRIBUTE_TYPE_INT32:
+		value = g_variant_new_int32 (g_file_info_get_attribute_int32 (info, attribute));
+		break;
+
+	case G_FILE_ATTRIBUTE_TYPE_UINT64:
+		value = g_variant_new_uint64 (g_file_info_get_attribute_uint64 (info, attribute));
+		break;
+
+	case G_FILE_ATTRIBUTE_TYPE_INT64:
+		value = g_variant_new_int64 (g_file_info_get_attribute_int64 (info, attribute));
+		break;
+
+	case G_FILE_ATTRIBUTE_TYPE_STRINGV:
+		value = g_variant_new_strv ((const char * const *) g_file_info_get_attribute_stringv (info, attribute), -1);
+		break;
+
+	case G_FILE_ATTRIBUTE_TYPE_OBJECT:
+		{
+			GObject *object;
+
+			object = g_file_info_get_attribute_object (info, attribute);
+			if (G_IS_ICON (object)) {
+				char *icon_name;
+
+				icon_name = g_icon_to_string (G_ICON (object));
+				if (icon_name != NULL)
+					value = g_variant_new (ICON_FORMAT, icon_name);
+
+				g_free (icon_name);
+			}
+			else if (GTH_IS_METADATA (object)) {
+				GthMetadata *metadata = GTH_METADATA (object);
+
+				value = g_variant_new ("(msmsmsmsmsm@as)",
+						       metadata->priv->id,
+						       metadata->priv->description,
+						       metadata->priv->raw,
+						       metadata->priv->formatted,
+						       metadata->priv->value_type,
+						       ((metadata->priv->data_type == GTH_METADATA_TYPE_STRING_LIST) && (metadata->priv->list != NULL)) ? _gth_string_list_to_variant (metadata->priv->list) : NULL);
+			}
+			else if (GTH_IS_STRING_LIST (object))
+				value = g_variant_new ("(@as)", _gth_string_list_to_variant (GTH_STRING_LIST (object)));
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	return value;
+}
+
+
+void
+_g_file_info_set_attribute_variant (GFileInfo  *info,
+				    const char *attribute,
+				    GVariant   *value)
+{
+	if (g_variant_is_of_type (value, G_VARIANT_TYPE_STRING))
+		g_file_info_set_attribute_string (info, attribute, g_variant_get_string (value, NULL));
+	else if (g_variant_is_of_type (value, G_VARIANT_TYPE_BYTESTRING))
+		g_file_info_set_attribute_byte_string (info, attribute, g_variant_get_bytestring (value));
+	else if (g_variant_is_of_type (value, G_VARIANT_TYPE_BOOLEAN))
+		g_file_info_set_attribute_boolean (info, attribute, g_variant_get_boolean (value));
+	else if (g_variant_is_of_type (value, G_VARIANT_TYPE_UINT32))
+		g_file_info_set_attribute_uint32 (info, attribute, g_variant_get_uint32 (value));
+	else if (g_variant_is_of_type (value, G_VARIANT_TYPE_INT32))
+		g_file_info_set_attribute_int32 (info, attribute, g_variant_get_int32 (value));
+	else if (g_variant_is_of_type (value, G_VARIANT_TYPE_UINT64))
+		g_file_info_set_attribute_uint64 (info, attribute, g_variant_get_uint64 (value));
+	else if (g_variant_is_of_type (value, G_VARIANT_TYPE_INT64))
+		g_file_info_set_attribute_int64 (info, attribute, g_variant_get_int64 (value));
+	else if (g_variant_is_of_type (value, G_VARIANT_TYPE_STRING_ARRAY)) {
+		const char **v;
+
+		v = g_variant_get_strv (value, NULL);
+		g_file_info_set_attribute_stringv (info, attribute, (char **) v);
+
+		g_free (v);
+	}
+	else if (g_variant_is_of_type (value, G_VARIANT_TYPE (ICON_FORMAT))) {
+		const char *icon_name;
+		GIcon      *icon;
+
+		g_variant_get (value, "(&s)", &icon_name);
+		icon = g_icon_new_for_string (icon_name, NULL);
+		if (icon != NULL) {
+			g_file_info_set_attribute_object (info, attribute, G_OBJECT (icon));
+			g_object_unref (icon);
+		}
+	}
+	else if (g_variant_is_of_type (value, G_VARIANT_TYPE (METADATA_FORMAT))) {
+		const char    *id;
+		const char    *description;
+		const char    *raw;
+		const char    *formatted;
+		const char    *value_type;
+		GVariant      *list_value;
+		GthStringList *string_list;
+		GthMetadata   *metadata;
+
+		g_variant_get (value,
+			       "(m&sm&sm&sm&sm&sm@as)",
+			       &id,
+			       &description,
+			       &raw,
+			       &formatted,
+			       &value_type,
+			       &list_value);
+		string_list = (list_value != NULL) ? _gth_string_list_from_variant (list_value) : NULL;
+		metadata = g_object_new (GTH_TYPE_METADATA,
+					 "id", id,
+					 "description", description,
+					 "raw", raw,
+					 "formatted", formatted,
+					 "value-type", value_type,
+					 "string-list", string_list,
+					 NULL);
+		g_file_info_set_attribute_object (info, attribute, G_OBJECT (metadata));
+
+		g_object_unref (metadata);
+		_g_object_unref (string_list);
+		if (list_value != NULL)
+			g_variant_unref (list_value);
+	}
+	else if (g_variant_is_of_type (value, G_VARIANT_TYPE (STRING_LIST_FORMAT))) {
+		GVariant      *list_value;
+		GthStringList *string_list;
+
+		list_value = g_variant_get_child_value (value, 0);
+		string_list = _gth_string_list_from_variant (list_value);
+		g_file_info_set_attribute_object (info, attribute, G_OBJECT (string_list));
+
+		g_object_unref (string_list);
+		g_variant_unref (list_value);
+	}
+}
@@ -93,6 +93,11 @@ void              set_attribute_from_string         (GFileInfo       *info,
 						     const char      *key,
 						     const char      *raw,
 						     const char      *formatted);
+GVariant *        _g_file_info_get_attribute_variant (GFileInfo       *info,
+						      const char      *attribute);
+void              _g_file_info_set_attribute_variant (GFileInfo       *info,
+						      const char      *attribute,
+						      GVariant        *value);
 
 G_END_DECLS
 
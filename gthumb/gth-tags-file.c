@@ -62,44 +62,59 @@ gth_tags_file_free (GthTagsFile *tags)
 }
 
 
+typedef struct {
+	gboolean  tags_node;
+	GList    *items;
+} ReadData;
+
+
+static void
+read_start_element (int          depth,
+		    const char  *element_name,
+		    const char **attribute_names,
+		    const char **attribute_values,
+		    gpointer     user_data)
+{
+	ReadData   *read_data = user_data;
+	const char *tag_value;
+
+	if (depth == 0)
+		read_data->tags_node = (strcmp (element_name, "tags") == 0);
+
+	if ((depth != 1) || ! read_data->tags_node || (strcmp (element_name, "tag") != 0))
+		return;
+
+	tag_value = dom_reader_get_attribute (attribute_names, attribute_values, "value");
+	if (tag_value != NULL)
+		read_data->items = g_list_prepend (read_data->items, g_strdup (tag_value));
+}
+
+
+static const DomReader tags_reader = {
+	read_start_element,
+	NULL
+};
+
+
 gboolean
 gth_tags_file_load_from_data (GthTagsFile  *tags,
                               const char   *data,
                               gsize         length,
                               GError      **error)
 {
-	DomDocument *doc;
-	gboolean     success;
+	ReadData read_data;
+	gboolean success;
 
 	_g_string_list_free (tags->items);
 	tags->items = NULL;
 
-	doc = dom_document_new ();
-	success = dom_document_load (doc, data, length, error);
-	if (success) {
-		DomElement *tags_node;
-		DomElement *child;
-
-		tags_node = DOM_ELEMENT (doc)->first_child;
-		if ((tags_node != NULL) && (g_strcmp0 (tags_node->tag_name, "tags") == 0)) {
-			for (child = tags_node->first_child;
-			     child != NULL;
-			     child = child->next_sibling)
-			{
-				if (strcmp (child->tag_name, "tag") == 0) {
-					const char *tag_value;
-
-					tag_value = dom_element_get_attribute (child, "value");
-					if (tag_value != NULL)
-						tags->items = g_list_prepend (tags->items, g_strdup (tag_value));
-				}
-			}
-
-			tags->items = g_list_reverse (tags->items);
-		}
-	}
-
-	g_object_unref (doc);
+	read_data.tags_node = FALSE;
+	read_data.items = NULL;
+	success = dom_reader_parse (&tags_reader, data, length, &read_data, error);
+	if (success)
+		tags->items = g_list_reverse (read_data.items);
+	else
+		_g_string_list_free (read_data.items);
 
 	return success;
 }
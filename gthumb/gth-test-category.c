@@ -52,6 +52,7 @@ GthOpData category_op_data[] = {
 struct _GthTestCategoryPrivate
 {
 	char         *category;
+	char         *category_casefolded;
 	GthTestOp     op;
 	gboolean      negative;
 	gboolean      has_focus;
@@ -93,6 +94,7 @@ gth_test_category_finalize (GObject *object)
 			test->priv->monitor_events = 0;
 		}
 		g_free (test->priv->category);
+		g_free (test->priv->category_casefolded);
 		g_free (test->priv);
 		test->priv = NULL;
 	}
@@ -269,6 +271,14 @@ gth_test_category_real_create_control (GthTest *base)
 }
 
 
+static gboolean
+gth_test_category_real_compile (GthTest *test)
+{
+	/* the casefolded category is computed when the category is set */
+	return TRUE;
+}
+
+
 static GthMatch
 gth_test_category_real_match (GthTest     *test,
 			      GthFileData *file)
@@ -281,7 +291,6 @@ gth_test_category_real_match (GthTest     *test,
 	if (test_category->priv->category != NULL) {
 		GthMetadata   *metadata;
 		GList         *list, *scan;
-		char          *test_category_casefolded;
 
 		list = NULL;
 		metadata = (GthMetadata *) g_file_info_get_attribute_object (file->info, gth_test_get_attributes (GTH_TEST (test_category)));
@@ -297,18 +306,15 @@ gth_test_category_real_match (GthTest     *test,
 				return test_category->priv->negative ? GTH_MATCH_YES : GTH_MATCH_NO;
 		}
 
-		test_category_casefolded = g_utf8_casefold (test_category->priv->category, -1);
 		for (scan = list; ! result && scan; scan = scan->next) {
 			char *category;
 
 			category = g_utf8_casefold (scan->data, -1);
-			if (g_utf8_collate (category, test_category_casefolded) == 0)
+			if (g_utf8_collate (category, test_category->priv->category_casefolded) == 0)
 				result = TRUE;
 
 			g_free (category);
 		}
-
-		g_free (test_category_casefolded);
 	}
 
         if (test_category->priv->negative)
@@ -352,8 +358,12 @@ gth_test_category_set_category (GthTestCategory *self,
 {
 	g_free (self->priv->category);
 	self->priv->category = NULL;
-	if (category != NULL)
+	g_free (self->priv->category_casefolded);
+	self->priv->category_casefolded = NULL;
+	if (category != NULL) {
 		self->priv->category = g_strdup (category);
+		self->priv->category_casefolded = g_utf8_casefold (category, -1);
+	}
 }
 
 
@@ -444,6 +454,7 @@ gth_test_category_class_init (GthTestCategoryClass *class)
 	test_class = (GthTestClass *) class;
 	test_class->create_control = gth_test_category_real_create_control;
 	test_class->update_from_control = gth_test_category_real_update_from_control;
+	test_class->compile = gth_test_category_real_compile;
 	test_class->match = gth_test_category_real_match;
 }
 
@@ -105,6 +105,20 @@ gth_test_chain_match (GthTest     *test,
 }
 
 
+static gboolean
+gth_test_chain_compile (GthTest *test)
+{
+	GthTestChain *chain = GTH_TEST_CHAIN (test);
+	gboolean      thread_safe = TRUE;
+	GList        *scan;
+
+	for (scan = chain->priv->tests; scan; scan = scan->next)
+		if (! gth_test_compile (GTH_TEST (scan->data)))
+			thread_safe = FALSE;
+
+	return thread_safe;
+}
+
 
 static const char *
 gth_test_chain_get_attributes (GthTest *test)
@@ -142,6 +156,7 @@ gth_test_chain_class_init (GthTestChainClass *class)
 	object_class->finalize = gth_test_chain_finalize;
 
 	test_class = (GthTestClass *) class;
+	test_class->compile = gth_test_chain_compile;
 	test_class->match = gth_test_chain_match;
 	test_class->get_attributes = gth_test_chain_get_attributes;
 }
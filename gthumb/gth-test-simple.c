@@ -89,7 +89,8 @@ enum {
         PROP_GET_DATA,
         PROP_OP,
         PROP_NEGATIVE,
-        PROP_MAX_INT
+        PROP_MAX_INT,
+        PROP_THREAD_SAFE
 };
 
 
@@ -105,7 +106,10 @@ struct _GthTestSimplePrivate
 	GthTestOp        op;
 	gboolean         negative;
 	gint64           max_int;
+	gboolean         thread_safe;
+	char            *casefolded_data;
 	GPatternSpec    *pattern;
+	guint32          julian_date;
 	gboolean         has_focus;
 	GtkWidget       *text_entry;
 	GtkWidget       *text_op_combo_box;
@@ -157,6 +161,10 @@ _gth_test_simple_free_data (GthTestSimple *test)
 		g_pattern_spec_free (test->priv->pattern);
 		test->priv->pattern = NULL;
 	}
+
+	g_free (test->priv->casefolded_data);
+	test->priv->casefolded_data = NULL;
+	test->priv->julian_date = 0;
 }
 
 
@@ -569,6 +577,35 @@ gth_test_simple_real_create_control (GthTest *test)
 }
 
 
+/* prepare the test data once instead of doing it for each file */
+static void
+_gth_test_simple_compile (GthTestSimple *test)
+{
+	switch (test->priv->data_type) {
+	case GTH_TEST_DATA_TYPE_STRING:
+		if ((test->priv->data.s != NULL) && (test->priv->casefolded_data == NULL)) {
+			test->priv->casefolded_data = g_utf8_casefold (test->priv->data.s, -1);
+			if (test->priv->pattern != NULL)
+				g_pattern_spec_free (test->priv->pattern);
+			test->priv->pattern = g_pattern_spec_new (test->priv->casefolded_data);
+		}
+		break;
+
+	case GTH_TEST_DATA_TYPE_DATE:
+		if ((test->priv->data.date != NULL)
+		    && (test->priv->julian_date == 0)
+		    && g_date_valid (test->priv->data.date))
+		{
+			test->priv->julian_date = g_date_get_julian (test->priv->data.date);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+
 static gboolean
 test_string (GthTestSimple *test,
 	     char          *value)
@@ -577,10 +614,10 @@ test_string (GthTestSimple *test,
 	char     *value1;
 	char     *value2;
 
-	if ((test->priv->data.s == NULL) || (value == NULL))
+	if ((test->priv->casefolded_data == NULL) || (value == NULL))
 		return FALSE;
 
-	value1 = g_utf8_casefold (test->priv->data.s, -1);
+	value1 = test->priv->casefolded_data;
 	value2 = g_utf8_casefold (value, -1);
 
 	switch (test->priv->op) {
@@ -609,8 +646,6 @@ test_string (GthTestSimple *test,
 		break;
 
 	case GTH_TEST_OP_MATCHES:
-		if (test->priv->pattern == NULL)
-			test->priv->pattern = g_pattern_spec_new (test->priv->data.s);
 		result = g_pattern_match_string (test->priv->pattern, value2);
 		break;
 
@@ -619,7 +654,6 @@ test_string (GthTestSimple *test,
 	}
 
 	g_free (value2);
-	g_free (value1);
 
 	return result;
 }
@@ -657,12 +691,19 @@ test_date (GthTestSimple *test,
            GDate         *date)
 {
 	gboolean result = FALSE;
-	int       compare;
+	guint32  julian_date;
+	int      compare;
 
-	if (! g_date_valid (date) || ! g_date_valid (test->priv->data.date))
+	if ((test->priv->julian_date == 0) || ! g_date_valid (date))
 		return FALSE;
 
-	compare = g_date_compare (date, test->priv->data.date);
+	julian_date = g_date_get_julian (date);
+	if (julian_date < test->priv->julian_date)
+		compare = -1;
+	else if (julian_date > test->priv->julian_date)
+		compare = 1;
+	else
+		compare = 0;
 
 	switch (test->priv->op) {
 	case GTH_TEST_OP_EQUAL:
@@ -716,6 +757,8 @@ gth_test_simple_real_match (GthTest   *test,
 
         test_simple = GTH_TEST_SIMPLE (test);
 
+	_gth_test_simple_compile (test_simple);
+
 	switch (test_simple->priv->data_type) {
 	case GTH_TEST_DATA_TYPE_NONE:
 		result = _gth_test_simple_get_int (test_simple, file) == TRUE;
@@ -748,6 +791,19 @@ gth_test_simple_real_match (GthTest   *test,
 }
 
 
+/* the test can be evaluated from more threads only if its get-data-func is
+ * declared thread safe with the thread-safe property. */
+static gboolean
+gth_test_simple_real_compile (GthTest *test)
+{
+	GthTestSimple *test_simple = GTH_TEST_SIMPLE (test);
+
+	_gth_test_simple_compile (test_simple);
+
+	return test_simple->priv->thread_safe;
+}
+
+
 static DomElement*
 gth_test_simple_real_create_element (DomDomizable *base,
 				     DomDocument  *doc)
@@ -1034,6 +1090,7 @@ gth_test_simple_real_duplicate (GthDuplicable *duplicable)
 	new_test->priv->op = test->priv->op;
 	new_test->priv->negative = test->priv->negative;
 	new_test->priv->max_int = test->priv->max_int;
+	new_test->priv->thread_safe = test->priv->thread_safe;
 
 	return (GObject *) new_test;
 }
@@ -1085,6 +1142,10 @@ gth_test_simple_set_property (GObject      *object,
 		test->priv->max_int = g_value_get_int (value);
 		break;
 
+	case PROP_THREAD_SAFE:
+		test->priv->thread_safe = g_value_get_boolean (value);
+		break;
+
 	default:
 		break;
 	}
@@ -1134,6 +1195,10 @@ gth_test_simple_get_property (GObject    *object,
 		g_value_set_int (value, test->priv->max_int);
 		break;
 
+	case PROP_THREAD_SAFE:
+		g_value_set_boolean (value, test->priv->thread_safe);
+		break;
+
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
 		break;
@@ -1155,6 +1220,7 @@ gth_test_simple_class_init (GthTestSimpleClass *class)
 	test_class = (GthTestClass *) class;
 	test_class->create_control = gth_test_simple_real_create_control;
 	test_class->update_from_control = gth_test_simple_real_update_from_control;
+	test_class->compile = gth_test_simple_real_compile;
 	test_class->match = gth_test_simple_real_match;
 
 	/* properties */
@@ -1221,6 +1287,13 @@ gth_test_simple_class_init (GthTestSimpleClass *class)
                                                            G_MAXINT,
                                                            0,
                                                            G_PARAM_READWRITE));
+	g_object_class_install_property (object_class,
+					 PROP_THREAD_SAFE,
+					 g_param_spec_boolean ("thread-safe",
+                                                               "Thread safe",
+                                                               "Whether the get-data-func can be called from more threads at the same time, on different files",
+                                                               FALSE,
+                                                               G_PARAM_READWRITE));
 }
 
 
@@ -29,6 +29,10 @@
 #include "glib-utils.h"
 
 
+#define PARALLEL_MATCH_MIN_FILES 5000
+#define PARALLEL_MATCH_MAX_THREADS 8
+
+
 /* Properties */
 enum {
         PROP_0,
@@ -49,6 +53,7 @@ struct _GthTestPrivate {
 	char      *attributes;
 	char      *display_name;
 	gboolean   visible;
+	GthMatch  *matches;
 };
 
 
@@ -83,6 +88,7 @@ gth_test_finalize (GObject *object)
 	g_free (self->priv->id);
 	g_free (self->priv->attributes);
 	g_free (self->priv->display_name);
+	g_free (self->priv->matches);
 	g_free (self->files);
 
 	G_OBJECT_CLASS (gth_test_parent_class)->finalize (object);
@@ -118,6 +124,15 @@ base_reset (GthTest *self)
 }
 
 
+static gboolean
+base_compile (GthTest *self)
+{
+	/* the match function of a generic test is not known to be thread
+	 * safe. */
+	return FALSE;
+}
+
+
 static GthMatch
 base_match (GthTest     *self,
 	    GthFileData *fdata)
@@ -126,6 +141,64 @@ base_match (GthTest     *self,
 }
 
 
+/* -- parallel match -- */
+
+
+typedef struct {
+	GthTest *test;
+	int      first;
+	int      last;
+} MatchChunk;
+
+
+static gpointer
+match_chunk_thread_func (gpointer user_data)
+{
+	MatchChunk *chunk = user_data;
+	int         i;
+
+	for (i = chunk->first; i < chunk->last; i++)
+		chunk->test->priv->matches[i] = gth_test_match (chunk->test, chunk->test->files[i]);
+
+	return NULL;
+}
+
+
+static void
+_gth_test_match_files_in_parallel (GthTest *self)
+{
+	int          n_chunks;
+	MatchChunk  *chunks;
+	GThread    **threads;
+	int          chunk_size;
+	int          i;
+
+	n_chunks = MIN (g_get_num_processors (), PARALLEL_MATCH_MAX_THREADS);
+	if (n_chunks < 2)
+		return;
+
+	self->priv->matches = g_new (GthMatch, self->n_files);
+
+	chunks = g_new (MatchChunk, n_chunks);
+	threads = g_new (GThread *, n_chunks);
+	chunk_size = (self->n_files + n_chunks - 1) / n_chunks;
+	for (i = 0; i < n_chunks; i++) {
+		chunks[i].test = self;
+		chunks[i].first = MIN (i * chunk_size, self->n_files);
+		chunks[i].last = MIN (chunks[i].first + chunk_size, self->n_files);
+		threads[i] = g_thread_new ("match", match_chunk_thread_func, &chunks[i]);
+	}
+	for (i = 0; i < n_chunks; i++)
+		g_thread_join (threads[i]);
+
+	g_free (threads);
+	g_free (chunks);
+}
+
+
+/**/
+
+
 void
 base_set_file_list (GthTest *self,
 	 	    GList   *files)
@@ -143,6 +216,14 @@ base_set_file_list (GthTest *self,
 	self->files[i++] = NULL;
 
 	self->iterator = 0;
+
+	/* test the files in advance on more threads if the list is long
+	 * enough and the test allows it. */
+
+	g_free (self->priv->matches);
+	self->priv->matches = NULL;
+	if ((self->n_files >= PARALLEL_MATCH_MIN_FILES) && gth_test_compile (self))
+		_gth_test_match_files_in_parallel (self);
 }
 
 
@@ -158,7 +239,10 @@ base_get_next (GthTest *self)
 	while (match == GTH_MATCH_NO) {
 		file = self->files[self->iterator];
 		if (file != NULL) {
-			match = gth_test_match (self, file);
+			if (self->priv->matches != NULL)
+				match = self->priv->matches[self->iterator];
+			else
+				match = gth_test_match (self, file);
 			self->iterator++;
 		}
 		else
@@ -171,6 +255,8 @@ base_get_next (GthTest *self)
 	if (file == NULL) {
 		g_free (self->files);
 		self->files = NULL;
+		g_free (self->priv->matches);
+		self->priv->matches = NULL;
 	}
 
 	return file;
@@ -278,6 +364,7 @@ gth_test_class_init (GthTestClass *klass)
 	klass->create_control = base_create_control;
 	klass->update_from_control = base_update_from_control;
 	klass->reset = base_reset;
+	klass->compile = base_compile;
 	klass->match = base_match;
 	klass->set_file_list = base_set_file_list;
 	klass->get_next = base_get_next;
@@ -410,6 +497,16 @@ gth_test_reset (GthTest *self)
 }
 
 
+/* Prepares the test to be evaluated on many files.  Returns TRUE if after
+ * this call gth_test_match() can be called from more threads at the same
+ * time, as long as each file is tested by a single thread. */
+gboolean
+gth_test_compile (GthTest *self)
+{
+	return GTH_TEST_GET_CLASS (self)->compile (self);
+}
+
+
 GthMatch
 gth_test_match (GthTest     *self,
 		GthFileData *fdata)
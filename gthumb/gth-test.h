@@ -87,6 +87,7 @@ struct _GthTestClass {
 	gboolean      (*update_from_control)  (GthTest     *test,
 					       GError     **error);
 	void          (*reset)                (GthTest     *test);
+	gboolean      (*compile)              (GthTest     *test);
 	GthMatch      (*match)                (GthTest     *test,
 			                       GthFileData *fdata);
 	void          (*set_file_list)        (GthTest     *test,
@@ -106,6 +107,7 @@ GtkWidget *   gth_test_create_control      (GthTest      *test);
 gboolean      gth_test_update_from_control (GthTest      *test,
 					    GError      **error);
 void          gth_test_changed             (GthTest      *test);
+gboolean      gth_test_compile             (GthTest      *test);
 GthMatch      gth_test_match               (GthTest      *test,
 					    GthFileData  *fdata);
 void          gth_test_set_file_list       (GthTest      *test,
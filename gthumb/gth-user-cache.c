@@ -0,0 +1,483 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+/*
+ *  GThumb
+ *
+ *  Copyright (C) 2013 Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include "gio-utils.h"
+#include "gth-user-cache.h"
+#include "gth-user-dir.h"
+
+
+/* The caches are saved in a subfolder of the user cache folder, with a file for
+ * each folder uri named after the MD5 checksum of the uri.  The first time a
+ * cache is used in a session the files not used for GTH_USER_CACHE_MAX_AGE
+ * days are deleted, the files older than REFRESH_AGE days are touched when
+ * read, so that the files in use are never deleted.
+ *
+ * A GthUserCache keeps in memory the data of the folders used recently, the
+ * changed data is saved SAVE_DELAY seconds after the first change.  Only
+ * the data already saved is removed from memory, so that the disk is never
+ * accessed with the mutex locked, except when the cache is freed. */
+
+
+#define SAVE_DELAY 5
+#define REFRESH_AGE (GTH_USER_CACHE_MAX_AGE / 2)
+
+
+typedef struct {
+	gpointer        data;
+	GDestroyNotify  free_func;
+	gboolean        dirty;
+	guint           last_used;
+} CacheItem;
+
+
+struct _GthUserCache {
+	char                      *name;
+	guint                      max_in_memory;
+	GthUserCacheSerializeFunc  serialize_func;
+	GDestroyNotify             free_func;
+	GMutex                    *mutex;
+	GHashTable                *items; /* uri → CacheItem */
+	guint                      use_counter;
+	guint                      save_id;
+};
+
+
+static GMutex      pruned_mutex;
+static GHashTable *pruned_caches = NULL; /* names of the caches pruned in this session */
+
+
+/* -- cache files -- */
+
+
+GFile *
+gth_user_cache_get_file (const char *cache_name,
+			 const char *uri,
+			 gboolean    for_write)
+{
+	char  *name;
+	GFile *file;
+
+	name = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+	if (for_write) {
+		gth_user_dir_mkdir_with_parents (GTH_DIR_CACHE, GTHUMB_DIR, cache_name, NULL);
+		file = gth_user_dir_get_file_for_write (GTH_DIR_CACHE, GTHUMB_DIR, cache_name, name, NULL);
+	}
+	else
+		file = gth_user_dir_get_file_for_read (GTH_DIR_CACHE, GTHUMB_DIR, cache_name, name, NULL);
+
+	g_free (name);
+
+	return file;
+}
+
+
+static gboolean
+_gth_user_cache_file_is_old (GFileInfo *info,
+			     gint64     max_age)
+{
+	gint64 mtime;
+
+	mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	return g_get_real_time () / G_USEC_PER_SEC - mtime > max_age * 24 * 60 * 60;
+}
+
+
+static gpointer
+delete_old_files_thread_func (gpointer user_data)
+{
+	GFile           *cache_dir = user_data;
+	GFileEnumerator *enumerator;
+	GFileInfo       *info;
+
+	enumerator = g_file_enumerate_children (cache_dir,
+						G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_TIME_MODIFIED,
+						G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+						NULL,
+						NULL);
+	if (enumerator != NULL) {
+		while ((info = g_file_enumerator_next_file (enumerator, NULL, NULL)) != NULL) {
+			if (_gth_user_cache_file_is_old (info, GTH_USER_CACHE_MAX_AGE)) {
+				GFile *file;
+
+				file = g_file_get_child (cache_dir, g_file_info_get_name (info));
+				g_file_delete (file, NULL, NULL);
+
+				g_object_unref (file);
+			}
+			g_object_unref (info);
+		}
+		g_object_unref (enumerator);
+	}
+
+	g_object_unref (cache_dir);
+
+	return NULL;
+}
+
+
+/* Deletes the cache files not used for a long time, the folders not viewed
+ * anymore or removed.  Done once per session for each cache. */
+static void
+_gth_user_cache_delete_old_files (const char *cache_name)
+{
+	gboolean  pruned;
+	GFile    *cache_dir;
+
+	g_mutex_lock (&pruned_mutex);
+	if (pruned_caches == NULL)
+		pruned_caches = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	pruned = g_hash_table_contains (pruned_caches, cache_name);
+	if (! pruned)
+		g_hash_table_add (pruned_caches, g_strdup (cache_name));
+	g_mutex_unlock (&pruned_mutex);
+
+	if (pruned)
+		return;
+
+	cache_dir = gth_user_dir_get_file_for_read (GTH_DIR_CACHE, GTHUMB_DIR, cache_name, NULL);
+	g_thread_unref (g_thread_new ("gth-user-cache", delete_old_files_thread_func, cache_dir));
+}
+
+
+/* Returns the content of the cache file saved for @uri, or NULL if it
+ * doesn't exist. */
+GMappedFile *
+gth_user_cache_map_file (const char *cache_name,
+			 const char *uri)
+{
+	GFile       *cache_file;
+	char        *path;
+	GMappedFile *mapped_file;
+
+	cache_file = gth_user_cache_get_file (cache_name, uri, FALSE);
+	path = g_file_get_path (cache_file);
+	mapped_file = g_mapped_file_new (path, FALSE, NULL);
+
+	if (mapped_file != NULL) {
+		GFileInfo *info;
+
+		info = g_file_query_info (cache_file, G_FILE_ATTRIBUTE_TIME_MODIFIED, G_FILE_QUERY_INFO_NONE, NULL, NULL);
+		if ((info != NULL) && _gth_user_cache_file_is_old (info, REFRESH_AGE))
+			g_file_set_attribute_uint64 (cache_file,
+						     G_FILE_ATTRIBUTE_TIME_MODIFIED,
+						     g_get_real_time () / G_USEC_PER_SEC,
+						     G_FILE_QUERY_INFO_NONE,
+						     NULL,
+						     NULL);
+
+		_g_object_unref (info);
+	}
+
+	_gth_user_cache_delete_old_files (cache_name);
+
+	g_free (path);
+	g_object_unref (cache_file);
+
+	return mapped_file;
+}
+
+
+/* Saves @buffer in the cache file for @uri, the buffer is freed. */
+void
+gth_user_cache_write_sync (const char *cache_name,
+			   const char *uri,
+			   void       *buffer,
+			   gsize       size)
+{
+	GFile *cache_file;
+
+	cache_file = gth_user_cache_get_file (cache_name, uri, TRUE);
+	if (! g_file_replace_contents (cache_file, buffer, size, NULL, FALSE, G_FILE_CREATE_NONE, NULL, NULL, NULL))
+		g_file_delete (cache_file, NULL, NULL);
+
+	g_object_unref (cache_file);
+	g_free (buffer);
+}
+
+
+static void
+cache_file_saved_cb (void     **buffer,
+		     gsize      count,
+		     GError    *error,
+		     gpointer   user_data)
+{
+	GFile *cache_file = user_data;
+
+	if (error != NULL) {
+		g_file_delete (cache_file, NULL, NULL);
+		g_clear_error (&error);
+	}
+
+	g_object_unref (cache_file);
+}
+
+
+/* Same as gth_user_cache_write_sync but asynchronous, the file is deleted
+ * if an error occurs. */
+void
+gth_user_cache_write_async (const char *cache_name,
+			    const char *uri,
+			    void       *buffer,
+			    gsize       size)
+{
+	GFile *cache_file;
+
+	cache_file = gth_user_cache_get_file (cache_name, uri, TRUE);
+	_g_file_write_async (cache_file,
+			     buffer,
+			     size,
+			     TRUE,
+			     G_PRIORITY_LOW,
+			     NULL,
+			     cache_file_saved_cb,
+			     cache_file);
+}
+
+
+void
+gth_user_cache_delete_file (const char *cache_name,
+			    const char *uri)
+{
+	GFile *cache_file;
+
+	cache_file = gth_user_cache_get_file (cache_name, uri, FALSE);
+	g_file_delete (cache_file, NULL, NULL);
+
+	g_object_unref (cache_file);
+}
+
+
+/* -- GthUserCache -- */
+
+
+static void
+cache_item_free (CacheItem *item)
+{
+	item->free_func (item->data);
+	g_free (item);
+}
+
+
+/* Creates a cache that keeps in memory the data of @max_in_memory folders
+ * at most, if possible.  @serialize_func returns the content of the cache
+ * file for the data, @free_func frees the data.  If @mutex is not NULL the
+ * cache can be used by more threads, in this case every function must be
+ * called with the mutex locked, and the mutex is locked when saving.  The
+ * cache must be created and freed in the main thread. */
+GthUserCache *
+gth_user_cache_new (const char                *cache_name,
+		    guint                      max_in_memory,
+		    GthUserCacheSerializeFunc  serialize_func,
+		    GDestroyNotify             free_func,
+		    GMutex                    *mutex)
+{
+	GthUserCache *cache;
+
+	cache = g_new0 (GthUserCache, 1);
+	cache->name = g_strdup (cache_name);
+	cache->max_in_memory = max_in_memory;
+	cache->serialize_func = serialize_func;
+	cache->free_func = free_func;
+	cache->mutex = mutex;
+	cache->items = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) cache_item_free);
+	cache->use_counter = 0;
+	cache->save_id = 0;
+
+	return cache;
+}
+
+
+/* Saves the changed data and frees @cache. */
+void
+gth_user_cache_free (GthUserCache *cache)
+{
+	GHashTableIter  iter;
+	const char     *uri;
+	CacheItem      *item;
+
+	if (cache->save_id != 0) {
+		g_source_remove (cache->save_id);
+		cache->save_id = 0;
+	}
+
+	g_hash_table_iter_init (&iter, cache->items);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &uri, (gpointer *) &item)) {
+		void  *buffer;
+		gsize  size;
+
+		if (! item->dirty)
+			continue;
+
+		cache->serialize_func (item->data, &buffer, &size);
+		gth_user_cache_write_sync (cache->name, uri, buffer, size);
+		item->dirty = FALSE;
+	}
+
+	g_hash_table_unref (cache->items);
+	g_free (cache->name);
+	g_free (cache);
+}
+
+
+/* Removes from memory the data used less recently, if already saved, to keep
+ * max_in_memory folders at most.  @keep is never removed. */
+static void
+_gth_user_cache_free_old_items (GthUserCache *cache,
+				CacheItem    *keep)
+{
+	while (g_hash_table_size (cache->items) > cache->max_in_memory) {
+		GHashTableIter  iter;
+		const char     *uri;
+		CacheItem      *item;
+		const char     *oldest_uri = NULL;
+		CacheItem      *oldest = NULL;
+
+		g_hash_table_iter_init (&iter, cache->items);
+		while (g_hash_table_iter_next (&iter, (gpointer *) &uri, (gpointer *) &item)) {
+			if ((item == keep) || item->dirty)
+				continue;
+			if ((oldest == NULL) || (item->last_used < oldest->last_used)) {
+				oldest_uri = uri;
+				oldest = item;
+			}
+		}
+
+		if (oldest == NULL)
+			break;
+
+		g_hash_table_remove (cache->items, oldest_uri);
+	}
+}
+
+
+/* Returns the data of @uri if in memory, NULL otherwise. */
+gpointer
+gth_user_cache_lookup (GthUserCache *cache,
+		       const char   *uri)
+{
+	CacheItem *item;
+
+	item = g_hash_table_lookup (cache->items, uri);
+	if (item == NULL)
+		return NULL;
+
+	item->last_used = ++cache->use_counter;
+
+	return item->data;
+}
+
+
+/* Adds @data as the data of @uri, replacing the current data if any.  The
+ * cache takes ownership of @data. */
+void
+gth_user_cache_add (GthUserCache *cache,
+		    const char   *uri,
+		    gpointer      data)
+{
+	CacheItem *item;
+
+	item = g_new0 (CacheItem, 1);
+	item->data = data;
+	item->free_func = cache->free_func;
+	item->dirty = FALSE;
+	item->last_used = ++cache->use_counter;
+	g_hash_table_insert (cache->items, g_strdup (uri), item);
+
+	_gth_user_cache_free_old_items (cache, item);
+}
+
+
+/* Removes the data of @uri from memory, the changes not saved yet are
+ * lost. */
+void
+gth_user_cache_remove (GthUserCache *cache,
+		       const char   *uri)
+{
+	g_hash_table_remove (cache->items, uri);
+}
+
+
+static gboolean
+save_cache_cb (gpointer user_data)
+{
+	GthUserCache   *cache = user_data;
+	GHashTableIter  iter;
+	const char     *uri;
+	CacheItem      *item;
+
+	if (cache->mutex != NULL)
+		g_mutex_lock (cache->mutex);
+
+	cache->save_id = 0;
+
+	g_hash_table_iter_init (&iter, cache->items);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &uri, (gpointer *) &item)) {
+		void  *buffer;
+		gsize  size;
+
+		if (! item->dirty)
+			continue;
+
+		cache->serialize_func (item->data, &buffer, &size);
+		item->dirty = FALSE;
+		gth_user_cache_write_async (cache->name, uri, buffer, size);
+	}
+
+	_gth_user_cache_free_old_items (cache, NULL);
+
+	if (cache->mutex != NULL)
+		g_mutex_unlock (cache->mutex);
+
+	return FALSE;
+}
+
+
+/* Marks the data of @uri as changed, it will be saved soon. */
+void
+gth_user_cache_queue_save (GthUserCache *cache,
+			   const char   *uri)
+{
+	CacheItem *item;
+
+	item = g_hash_table_lookup (cache->items, uri);
+	if (item == NULL)
+		return;
+
+	item->dirty = TRUE;
+	if (cache->save_id == 0)
+		cache->save_id = g_timeout_add_seconds (SAVE_DELAY, save_cache_cb, cache);
+}
+
+
+void
+gth_user_cache_foreach (GthUserCache     *cache,
+			GthUserCacheFunc  func,
+			gpointer          user_data)
+{
+	GHashTableIter  iter;
+	const char     *uri;
+	CacheItem      *item;
+
+	g_hash_table_iter_init (&iter, cache->items);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &uri, (gpointer *) &item))
+		func (uri, item->data, user_data);
+}
@@ -0,0 +1,83 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+/*
+ *  GThumb
+ *
+ *  Copyright (C) 2013 Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GTH_USER_CACHE_H
+#define GTH_USER_CACHE_H
+
+#include <glib.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* the cache files not used for this number of days are deleted */
+#define GTH_USER_CACHE_MAX_AGE 60
+
+typedef struct _GthUserCache GthUserCache;
+
+typedef void (*GthUserCacheSerializeFunc) (gpointer   data,
+					   void     **buffer,
+					   gsize     *size);
+typedef void (*GthUserCacheFunc)          (const char *uri,
+					   gpointer    data,
+					   gpointer    user_data);
+
+/* cache files */
+
+GFile *		gth_user_cache_get_file		(const char                *cache_name,
+						 const char                *uri,
+						 gboolean                   for_write);
+GMappedFile *	gth_user_cache_map_file		(const char                *cache_name,
+						 const char                *uri);
+void		gth_user_cache_write_sync	(const char                *cache_name,
+						 const char                *uri,
+						 void                      *buffer,
+						 gsize                      size);
+void		gth_user_cache_write_async	(const char                *cache_name,
+						 const char                *uri,
+						 void                      *buffer,
+						 gsize                      size);
+void		gth_user_cache_delete_file	(const char                *cache_name,
+						 const char                *uri);
+
+/* cache data in memory */
+
+GthUserCache *	gth_user_cache_new		(const char                *cache_name,
+						 guint                      max_in_memory,
+						 GthUserCacheSerializeFunc  serialize_func,
+						 GDestroyNotify             free_func,
+						 GMutex                    *mutex);
+void		gth_user_cache_free		(GthUserCache              *cache);
+gpointer	gth_user_cache_lookup		(GthUserCache              *cache,
+						 const char                *uri);
+void		gth_user_cache_add		(GthUserCache              *cache,
+						 const char                *uri,
+						 gpointer                   data);
+void		gth_user_cache_remove		(GthUserCache              *cache,
+						 const char                *uri);
+void		gth_user_cache_queue_save	(GthUserCache              *cache,
+						 const char                *uri);
+void		gth_user_cache_foreach		(GthUserCache              *cache,
+						 GthUserCacheFunc           func,
+						 gpointer                   user_data);
+
+G_END_DECLS
+
+#endif /* GTH_USER_CACHE_H */
@@ -164,6 +164,84 @@ test_dom_3 (void)
 }
 
 
+static void
+reader_start_element (int          depth,
+		      const char  *element_name,
+		      const char **attribute_names,
+		      const char **attribute_values,
+		      gpointer     user_data)
+{
+	GString    *trace = user_data;
+	const char *uri;
+
+	g_string_append_printf (trace, "<%d:%s", depth, element_name);
+	uri = dom_reader_get_attribute (attribute_names, attribute_values, "uri");
+	if (uri != NULL)
+		g_string_append_printf (trace, "[%s]", uri);
+}
+
+
+static void
+reader_end_element (int          depth,
+		    const char  *element_name,
+		    const char  *text,
+		    gpointer     user_data)
+{
+	GString *trace = user_data;
+
+	g_string_append_printf (trace, ">%d:%s", depth, element_name);
+	if (text != NULL)
+		g_string_append_printf (trace, "(%s)", text);
+}
+
+
+static const DomReader test_reader = {
+	reader_start_element,
+	reader_end_element
+};
+
+
+static void
+test_dom_reader (void)
+{
+	const char *xml;
+	GString    *trace;
+	GError     *error = NULL;
+
+	xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	      "<catalog version=\"1.0\">\n"
+	      "  <name>Trip &amp; more</name>\n"
+	      "  <empty></empty>\n"
+	      "  <files>\n"
+	      "    <file uri=\"file:///a.jpg\"/>\n"
+	      "    <file uri=\"file:///b.jpg\"/>\n"
+	      "  </files>\n"
+	      "</catalog>\n";
+
+	trace = g_string_new ("");
+	g_assert (dom_reader_parse (&test_reader, xml, -1, trace, &error));
+	g_assert_no_error (error);
+	g_assert_cmpstr (trace->str, ==, "<0:catalog"
+					 "<1:name>1:name(Trip & more)"
+					 "<1:empty>1:empty"
+					 "<1:files"
+					 "<2:file[file:///a.jpg]>2:file"
+					 "<2:file[file:///b.jpg]>2:file"
+					 ">1:files"
+					 ">0:catalog");
+
+	/* the elements before the error are reported */
+
+	g_string_truncate (trace, 0);
+	g_assert (! dom_reader_parse (&test_reader, xml, 100, trace, &error));
+	g_assert (error != NULL);
+	g_assert (g_str_has_prefix (trace->str, "<0:catalog<1:name>1:name(Trip & more)"));
+
+	g_clear_error (&error);
+	g_string_free (trace, TRUE);
+}
+
+
 int
 main (int   argc,
       char *argv[])
@@ -173,6 +251,7 @@ main (int   argc,
 	g_test_add_func ("/dom/1", test_dom_1);
 	g_test_add_func ("/dom/2", test_dom_2);
 	g_test_add_func ("/dom/3", test_dom_3);
+	g_test_add_func ("/dom/reader", test_dom_reader);
 
 	return g_test_run ();
 }
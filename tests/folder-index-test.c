@@ -0,0 +1,339 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+/*
+ *  GThumb
+ *
+ *  Copyright (C) 2013 Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <config.h>
+#include <string.h>
+#include "glib-utils.h"
+#include "gth-folder-index.h"
+
+
+#define ROOT_URI "file:///tmp/gthumb-test"
+#define ATTRIBUTES "standard::name,standard::size,time::modified,time::modified-usec"
+
+
+static GVariant *
+create_files (const char *name,
+	      guint64     size,
+	      guint64     mtime)
+{
+	GVariantBuilder files;
+	GVariantBuilder attributes;
+
+	g_variant_builder_init (&files, G_VARIANT_TYPE (GTH_FOLDER_INDEX_FILES_FORMAT));
+	if (name != NULL) {
+		g_variant_builder_init (&attributes, G_VARIANT_TYPE ("a{sv}"));
+		g_variant_builder_add (&attributes, "{sv}", G_FILE_ATTRIBUTE_STANDARD_SIZE, g_variant_new_uint64 (size));
+		g_variant_builder_add (&attributes, "{sv}", G_FILE_ATTRIBUTE_TIME_MODIFIED, g_variant_new_uint64 (mtime));
+		g_variant_builder_add (&attributes, "{sv}", G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC, g_variant_new_uint32 (0));
+		g_variant_builder_add (&files, "{sa{sv}}", name, &attributes);
+	}
+
+	return g_variant_builder_end (&files);
+}
+
+
+static GFileInfo *
+create_file_info (const char *name,
+		  guint64     size,
+		  guint64     mtime)
+{
+	GFileInfo *info;
+
+	info = g_file_info_new ();
+	g_file_info_set_name (info, name);
+	g_file_info_set_file_type (info, G_FILE_TYPE_REGULAR);
+	g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN, name[0] == '.');
+	g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE, size);
+	g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED, mtime);
+	g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC, 0);
+
+	return info;
+}
+
+
+/* Creates an index with the folders "", "a", "a/b", "c". */
+static GthFolderIndex *
+create_index (GFile *root)
+{
+	GthFolderIndex  *index;
+	char            *root_subfolders[] = { "a", "c", NULL };
+	char            *root_ids[] = { "id-a", "id-c", NULL };
+	char            *a_subfolders[] = { "b", NULL };
+	char            *a_ids[] = { "id-b", NULL };
+	char            *no_subfolders[] = { NULL };
+	GList           *new_folders;
+
+	index = gth_folder_index_new (root, ATTRIBUTES);
+	gth_folder_index_add_folder (index, "", NULL);
+
+	new_folders = gth_folder_index_set_folder (index, "", 10, "id-root", root_subfolders, root_ids, create_files ("1.jpg", 100, 1));
+	g_assert_cmpint (g_list_length (new_folders), ==, 2);
+	g_assert_cmpstr (new_folders->data, ==, "a");
+	g_assert_cmpstr (new_folders->next->data, ==, "c");
+	_g_string_list_free (new_folders);
+
+	new_folders = gth_folder_index_set_folder (index, "a", 20, "id-a", a_subfolders, a_ids, create_files ("2.jpg", 200, 2));
+	g_assert_cmpint (g_list_length (new_folders), ==, 1);
+	g_assert_cmpstr (new_folders->data, ==, "a/b");
+	_g_string_list_free (new_folders);
+
+	new_folders = gth_folder_index_set_folder (index, "a/b", 30, "id-b", no_subfolders, NULL, create_files (NULL, 0, 0));
+	g_assert (new_folders == NULL);
+
+	new_folders = gth_folder_index_set_folder (index, "c", 40, "id-c", no_subfolders, NULL, create_files ("3.jpg", 300, 3));
+	g_assert (new_folders == NULL);
+
+	return index;
+}
+
+
+static void
+test_folder_index_build (void)
+{
+	GFile          *root;
+	GthFolderIndex *index;
+	GVariant       *data;
+	GthFolderIndex *loaded;
+	GFile          *other_root;
+
+	root = g_file_new_for_uri (ROOT_URI);
+	index = create_index (root);
+	g_assert_cmpint (g_hash_table_size (index->folders), ==, 4);
+	g_assert_cmpint (gth_folder_index_lookup (index, "a/b")->mtime, ==, 30);
+
+	/* the saved index is loaded back */
+
+	data = gth_folder_index_to_variant (index);
+	loaded = gth_folder_index_new_from_variant (root, ATTRIBUTES, data);
+	g_assert (loaded != NULL);
+	g_assert_cmpint (g_hash_table_size (loaded->folders), ==, 4);
+	g_assert_cmpint (gth_folder_index_lookup (loaded, "")->mtime, ==, 10);
+	g_assert_cmpstr (gth_folder_index_lookup (loaded, "a")->id, ==, "id-a");
+	g_assert_cmpstr (gth_folder_index_lookup (loaded, "a")->subfolders[0], ==, "b");
+	g_assert (g_variant_equal (gth_folder_index_lookup (loaded, "c")->files, gth_folder_index_lookup (index, "c")->files));
+	gth_folder_index_unref (loaded);
+
+	/* an index saved with other attributes or for another root is not
+	 * loaded */
+
+	g_assert (gth_folder_index_new_from_variant (root, "standard::name", data) == NULL);
+	other_root = g_file_new_for_uri (ROOT_URI "/a");
+	g_assert (gth_folder_index_new_from_variant (other_root, ATTRIBUTES, data) == NULL);
+
+	g_object_unref (other_root);
+	g_variant_unref (data);
+	gth_folder_index_unref (index);
+	g_object_unref (root);
+}
+
+
+static void
+test_folder_index_invalidate (void)
+{
+	GFile          *root;
+	GthFolderIndex *index;
+	GFile          *folder;
+	char           *root_subfolders[] = { "c", NULL };
+	GList          *new_folders;
+
+	root = g_file_new_for_uri (ROOT_URI);
+	index = create_index (root);
+
+	/* a changed folder is marked as to be read again */
+
+	folder = g_file_new_for_uri (ROOT_URI "/a/b");
+	g_assert (gth_folder_index_invalidate_folder (index, folder));
+	g_assert_cmpint (gth_folder_index_lookup (index, "a/b")->mtime, ==, 0);
+	g_assert_cmpint (gth_folder_index_lookup (index, "a")->mtime, ==, 20);
+	g_assert (! gth_folder_index_invalidate_folder (index, folder));
+	g_object_unref (folder);
+
+	/* a folder outside the index is ignored */
+
+	folder = g_file_new_for_uri ("file:///tmp/other");
+	g_assert (! gth_folder_index_invalidate_folder (index, folder));
+	g_object_unref (folder);
+
+	/* a removed sub-folder is removed with its children */
+
+	new_folders = gth_folder_index_set_folder (index, "", 50, "id-root", root_subfolders, NULL, create_files (NULL, 0, 0));
+	g_assert (new_folders == NULL);
+	g_assert (gth_folder_index_lookup (index, "a") == NULL);
+	g_assert (gth_folder_index_lookup (index, "a/b") == NULL);
+	g_assert (gth_folder_index_lookup (index, "c") != NULL);
+	g_assert_cmpint (g_hash_table_size (index->folders), ==, 2);
+	g_assert (gth_folder_index_can_add_folder (index, "d", "id-a"));
+
+	gth_folder_index_remove_folder (index, "");
+	g_assert_cmpint (g_hash_table_size (index->folders), ==, 0);
+	g_assert_cmpint (g_hash_table_size (index->ids), ==, 0);
+
+	gth_folder_index_unref (index);
+	g_object_unref (root);
+}
+
+
+static void
+test_folder_index_lookup (void)
+{
+	GFile          *root;
+	GthFolderIndex *index;
+	GFile          *file;
+	char           *path;
+	GList          *folders;
+	char           *uri;
+
+	root = g_file_new_for_uri (ROOT_URI);
+	index = create_index (root);
+
+	file = g_file_new_for_uri (ROOT_URI "/a/b");
+	path = gth_folder_index_get_relative_uri (index, file);
+	g_assert_cmpstr (path, ==, "a/b");
+	g_free (path);
+	g_object_unref (file);
+
+	path = gth_folder_index_get_relative_uri (index, root);
+	g_assert_cmpstr (path, ==, "");
+	g_free (path);
+
+	file = g_file_new_for_uri (ROOT_URI "-other/a");
+	g_assert (gth_folder_index_get_relative_uri (index, file) == NULL);
+	g_object_unref (file);
+
+	folders = gth_folder_index_get_folders (index, "", TRUE);
+	g_assert_cmpint (g_list_length (folders), ==, 4);
+	g_assert_cmpstr (g_list_nth_data (folders, 0), ==, "");
+	g_assert_cmpstr (g_list_nth_data (folders, 1), ==, "a");
+	g_assert_cmpstr (g_list_nth_data (folders, 2), ==, "a/b");
+	g_assert_cmpstr (g_list_nth_data (folders, 3), ==, "c");
+	_g_string_list_free (folders);
+
+	folders = gth_folder_index_get_folders (index, "a", TRUE);
+	g_assert_cmpint (g_list_length (folders), ==, 2);
+	_g_string_list_free (folders);
+
+	folders = gth_folder_index_get_folders (index, "a", FALSE);
+	g_assert_cmpint (g_list_length (folders), ==, 1);
+	g_assert_cmpstr (folders->data, ==, "a");
+	_g_string_list_free (folders);
+
+	uri = gth_folder_index_get_folder_uri (index, "");
+	g_assert_cmpstr (uri, ==, ROOT_URI);
+	g_free (uri);
+
+	uri = gth_folder_index_get_folder_uri_prefix (index, "a/b");
+	g_assert_cmpstr (uri, ==, ROOT_URI "/a/b/");
+	g_free (uri);
+
+	gth_folder_index_unref (index);
+	g_object_unref (root);
+}
+
+
+static void
+test_folder_index_links (void)
+{
+	GFile          *root;
+	GthFolderIndex *index;
+
+	root = g_file_new_for_uri (ROOT_URI);
+	index = create_index (root);
+
+	/* a folder is indexed only once */
+
+	g_assert (gth_folder_index_can_add_folder (index, "a", "id-a"));
+	g_assert (! gth_folder_index_can_add_folder (index, "c/link-to-a", "id-a"));
+	g_assert (! gth_folder_index_can_add_folder (index, "a/b/link-to-root", "id-root"));
+	g_assert (gth_folder_index_can_add_folder (index, "c/d", "id-d"));
+	g_assert (gth_folder_index_can_add_folder (index, "c/e", NULL));
+
+	gth_folder_index_unref (index);
+	g_object_unref (root);
+}
+
+
+static void
+test_folder_index_files_changed (void)
+{
+	GFile    *folder;
+	GVariant *files;
+	GList    *list;
+
+	folder = g_file_new_for_uri (ROOT_URI);
+	files = g_variant_ref_sink (create_files ("1.jpg", 100, 1));
+
+	list = g_list_prepend (NULL, create_file_info ("1.jpg", 100, 1));
+	list = g_list_prepend (list, create_file_info (".hidden.jpg", 10, 1));
+	g_assert (! gth_folder_index_files_changed (files, folder, list));
+	_g_object_list_unref (list);
+
+	/* edited in place */
+
+	list = g_list_prepend (NULL, create_file_info ("1.jpg", 101, 1));
+	g_assert (gth_folder_index_files_changed (files, folder, list));
+	_g_object_list_unref (list);
+
+	list = g_list_prepend (NULL, create_file_info ("1.jpg", 100, 2));
+	g_assert (gth_folder_index_files_changed (files, folder, list));
+	_g_object_list_unref (list);
+
+	/* added, removed or renamed */
+
+	list = g_list_prepend (NULL, create_file_info ("1.jpg", 100, 1));
+	list = g_list_prepend (list, create_file_info ("2.jpg", 100, 1));
+	g_assert (gth_folder_index_files_changed (files, folder, list));
+	_g_object_list_unref (list);
+
+	g_assert (gth_folder_index_files_changed (files, folder, NULL));
+
+	list = g_list_prepend (NULL, create_file_info ("3.jpg", 100, 1));
+	g_assert (gth_folder_index_files_changed (files, folder, list));
+	_g_object_list_unref (list);
+
+	g_variant_unref (files);
+
+	/* the names are escaped as in the uris */
+
+	files = g_variant_ref_sink (create_files ("a%20b.jpg", 100, 1));
+	list = g_list_prepend (NULL, create_file_info ("a b.jpg", 100, 1));
+	g_assert (! gth_folder_index_files_changed (files, folder, list));
+	_g_object_list_unref (list);
+	g_variant_unref (files);
+
+	g_object_unref (folder);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/folder-index/build", test_folder_index_build);
+	g_test_add_func ("/folder-index/invalidate", test_folder_index_invalidate);
+	g_test_add_func ("/folder-index/lookup", test_folder_index_lookup);
+	g_test_add_func ("/folder-index/links", test_folder_index_links);
+	g_test_add_func ("/folder-index/files-changed", test_folder_index_files_changed);
+
+	return g_test_run ();
+}
@@ -0,0 +1,415 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+/*
+ *  GThumb
+ *
+ *  Copyright (C) 2013 Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <config.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+#include "glib-utils.h"
+#include "gio-utils.h"
+#include "test-stubs.h"
+
+
+/* -- utilities -- */
+
+
+static char *
+create_test_tree (void)
+{
+	char *base;
+	char *path;
+
+	base = g_dir_make_tmp ("gthumb-test-XXXXXX", NULL);
+	g_assert (base != NULL);
+
+	path = g_build_filename (base, "source", "sub1", "sub2", NULL);
+	g_assert_cmpint (g_mkdir_with_parents (path, 0700), ==, 0);
+	g_free (path);
+
+	path = g_build_filename (base, "source", "empty", NULL);
+	g_assert_cmpint (g_mkdir_with_parents (path, 0700), ==, 0);
+	g_free (path);
+
+	path = g_build_filename (base, "destination", NULL);
+	g_assert_cmpint (g_mkdir_with_parents (path, 0700), ==, 0);
+	g_free (path);
+
+	path = g_build_filename (base, "source", "a.txt", NULL);
+	g_assert (g_file_set_contents (path, "a", -1, NULL));
+	g_free (path);
+
+	path = g_build_filename (base, "source", "sub1", "b.txt", NULL);
+	g_assert (g_file_set_contents (path, "bb", -1, NULL));
+	g_free (path);
+
+	path = g_build_filename (base, "source", "sub1", "sub2", "c.txt", NULL);
+	g_assert (g_file_set_contents (path, "ccc", -1, NULL));
+	g_free (path);
+
+	return base;
+}
+
+
+static void
+remove_tree (GFile *file)
+{
+	GFileEnumerator *enumerator;
+
+	enumerator = g_file_enumerate_children (file, G_FILE_ATTRIBUTE_STANDARD_NAME, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, NULL, NULL);
+	if (enumerator != NULL) {
+		GFileInfo *info;
+
+		while ((info = g_file_enumerator_next_file (enumerator, NULL, NULL)) != NULL) {
+			GFile *child;
+
+			child = g_file_get_child (file, g_file_info_get_name (info));
+			remove_tree (child);
+
+			g_object_unref (child);
+			g_object_unref (info);
+		}
+		g_object_unref (enumerator);
+	}
+	g_file_delete (file, NULL, NULL);
+}
+
+
+static void
+assert_file_content (const char *base,
+		     const char *relative_path,
+		     const char *expected)
+{
+	char *path;
+	char *content;
+
+	path = g_build_filename (base, relative_path, NULL);
+	g_assert (g_file_get_contents (path, &content, NULL, NULL));
+	g_assert_cmpstr (content, ==, expected);
+
+	g_free (content);
+	g_free (path);
+}
+
+
+static void
+assert_is_directory (const char *base,
+		     const char *relative_path,
+		     gboolean    exists)
+{
+	char *path;
+
+	path = g_build_filename (base, relative_path, NULL);
+	g_assert (g_file_test (path, G_FILE_TEST_IS_DIR) == exists);
+
+	g_free (path);
+}
+
+
+static void
+write_file (const char *base,
+	    const char *relative_path,
+	    const char *content)
+{
+	char *path;
+	char *parent;
+
+	path = g_build_filename (base, relative_path, NULL);
+	parent = g_path_get_dirname (path);
+	g_assert_cmpint (g_mkdir_with_parents (parent, 0700), ==, 0);
+	g_assert (g_file_set_contents (path, content, -1, NULL));
+
+	g_free (parent);
+	g_free (path);
+}
+
+
+typedef struct {
+	GMainLoop *loop;
+	GError    *error;
+} CopyTreeData;
+
+
+static void
+copy_done_cb (GError   *error,
+	      gpointer  user_data)
+{
+	CopyTreeData *data = user_data;
+
+	data->error = error;
+	g_main_loop_quit (data->loop);
+}
+
+
+/* returns the error of the copy, NULL if none */
+static GError *
+copy_tree_with_response (const char           *base,
+			 gboolean              move,
+			 GthOverwriteResponse  default_response)
+{
+	char         *path;
+	GFile        *source;
+	GFile        *destination;
+	GList        *sources;
+	CopyTreeData  data;
+
+	path = g_build_filename (base, "source", NULL);
+	source = g_file_new_for_path (path);
+	g_free (path);
+
+	path = g_build_filename (base, "destination", NULL);
+	destination = g_file_new_for_path (path);
+	g_free (path);
+
+	sources = g_list_append (NULL, source);
+	data.loop = g_main_loop_new (NULL, FALSE);
+	data.error = NULL;
+	_g_copy_files_async (sources,
+			     destination,
+			     move,
+			     G_FILE_COPY_NONE,
+			     default_response,
+			     G_PRIORITY_DEFAULT,
+			     NULL,
+			     NULL,
+			     NULL,
+			     NULL,
+			     NULL,
+			     copy_done_cb,
+			     &data);
+	g_main_loop_run (data.loop);
+
+	g_main_loop_unref (data.loop);
+	g_list_free (sources);
+	g_object_unref (destination);
+	g_object_unref (source);
+
+	return data.error;
+}
+
+
+static void
+copy_tree (const char *base,
+	   gboolean    move)
+{
+	GError *error;
+
+	error = copy_tree_with_response (base, move, GTH_OVERWRITE_RESPONSE_UNSPECIFIED);
+	g_assert_no_error (error);
+}
+
+
+/* -- tests -- */
+
+
+static void
+test_copy_files_tree (void)
+{
+	char  *base;
+	GFile *file;
+
+	base = create_test_tree ();
+	copy_tree (base, FALSE);
+
+	assert_file_content (base, "destination/source/a.txt", "a");
+	assert_file_content (base, "destination/source/sub1/b.txt", "bb");
+	assert_file_content (base, "destination/source/sub1/sub2/c.txt", "ccc");
+	assert_is_directory (base, "destination/source/empty", TRUE);
+	assert_file_content (base, "source/sub1/sub2/c.txt", "ccc");
+
+	file = g_file_new_for_path (base);
+	remove_tree (file);
+	g_object_unref (file);
+	g_free (base);
+}
+
+
+static void
+test_move_files_tree (void)
+{
+	char  *base;
+	GFile *file;
+
+	base = create_test_tree ();
+	copy_tree (base, TRUE);
+
+	assert_file_content (base, "destination/source/a.txt", "a");
+	assert_file_content (base, "destination/source/sub1/b.txt", "bb");
+	assert_file_content (base, "destination/source/sub1/sub2/c.txt", "ccc");
+	assert_is_directory (base, "destination/source/empty", TRUE);
+	assert_is_directory (base, "source", FALSE);
+
+	file = g_file_new_for_path (base);
+	remove_tree (file);
+	g_object_unref (file);
+	g_free (base);
+}
+
+
+/* the files already in the destination are copied after the other ones, one
+ * at a time, the user is asked only once when the answer is 'always'. */
+static void
+test_copy_files_overwrite_always_yes (void)
+{
+	char   *base;
+	GError *error;
+	GFile  *file;
+
+	base = create_test_tree ();
+	write_file (base, "destination/source/a.txt", "old a");
+	write_file (base, "destination/source/sub1/b.txt", "old b");
+
+	test_stubs_set_overwrite_response (GTH_OVERWRITE_RESPONSE_ALWAYS_YES);
+	error = copy_tree_with_response (base, FALSE, GTH_OVERWRITE_RESPONSE_UNSPECIFIED);
+	g_assert_no_error (error);
+	g_assert_cmpint (test_stubs_get_n_overwrite_dialogs (), ==, 1);
+
+	assert_file_content (base, "destination/source/a.txt", "a");
+	assert_file_content (base, "destination/source/sub1/b.txt", "bb");
+	assert_file_content (base, "destination/source/sub1/sub2/c.txt", "ccc");
+
+	test_stubs_set_overwrite_response (GTH_OVERWRITE_RESPONSE_UNSPECIFIED);
+
+	file = g_file_new_for_path (base);
+	remove_tree (file);
+	g_object_unref (file);
+	g_free (base);
+}
+
+
+/* not overwriting stops the copy, the files without a conflict are already
+ * copied at that point. */
+static void
+test_copy_files_overwrite_always_no (void)
+{
+	char   *base;
+	GError *error;
+	GFile  *file;
+
+	base = create_test_tree ();
+	write_file (base, "destination/source/a.txt", "old a");
+	write_file (base, "destination/source/sub1/b.txt", "old b");
+
+	test_stubs_set_overwrite_response (GTH_OVERWRITE_RESPONSE_ALWAYS_NO);
+	error = copy_tree_with_response (base, FALSE, GTH_OVERWRITE_RESPONSE_UNSPECIFIED);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_EXISTS);
+	g_clear_error (&error);
+	g_assert_cmpint (test_stubs_get_n_overwrite_dialogs (), ==, 1);
+
+	assert_file_content (base, "destination/source/a.txt", "old a");
+	assert_file_content (base, "destination/source/sub1/b.txt", "old b");
+	assert_file_content (base, "destination/source/sub1/sub2/c.txt", "ccc");
+
+	test_stubs_set_overwrite_response (GTH_OVERWRITE_RESPONSE_UNSPECIFIED);
+
+	file = g_file_new_for_path (base);
+	remove_tree (file);
+	g_object_unref (file);
+	g_free (base);
+}
+
+
+/* with a default response the user is not asked */
+static void
+test_copy_files_default_always_yes (void)
+{
+	char   *base;
+	GError *error;
+	GFile  *file;
+
+	base = create_test_tree ();
+	write_file (base, "destination/source/a.txt", "old a");
+
+	error = copy_tree_with_response (base, FALSE, GTH_OVERWRITE_RESPONSE_ALWAYS_YES);
+	g_assert_no_error (error);
+
+	assert_file_content (base, "destination/source/a.txt", "a");
+	assert_file_content (base, "destination/source/sub1/b.txt", "bb");
+
+	file = g_file_new_for_path (base);
+	remove_tree (file);
+	g_object_unref (file);
+	g_free (base);
+}
+
+
+static void
+test_file_append (void)
+{
+	char   *base;
+	char   *path;
+	GFile  *file;
+	GError *error = NULL;
+	GFile  *base_file;
+
+	base = create_test_tree ();
+	path = g_build_filename (base, "source", "a.txt", NULL);
+	file = g_file_new_for_path (path);
+
+	/* appended only if the file has the expected size */
+
+	g_assert (_g_file_append (file, 1, (void *) "+b\n", 3, NULL, &error));
+	g_assert_no_error (error);
+	assert_file_content (base, "source/a.txt", "a+b\n");
+
+	g_assert (! _g_file_append (file, 1, (void *) "+c\n", 3, NULL, &error));
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_WRONG_ETAG);
+	g_clear_error (&error);
+	assert_file_content (base, "source/a.txt", "a+b\n");
+
+	/* a deleted file is not created again */
+
+	g_assert (g_file_delete (file, NULL, NULL));
+	g_assert (! _g_file_append (file, 4, (void *) "+c\n", 3, NULL, &error));
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_clear_error (&error);
+	g_assert (! g_file_query_exists (file, NULL));
+
+	base_file = g_file_new_for_path (base);
+	remove_tree (base_file);
+	g_object_unref (base_file);
+	g_object_unref (file);
+	g_free (path);
+	g_free (base);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/gio-utils/_g_copy_files_async/tree", test_copy_files_tree);
+	g_test_add_func ("/gio-utils/_g_copy_files_async/move-tree", test_move_files_tree);
+	g_test_add_func ("/gio-utils/_g_copy_files_async/default-always-yes", test_copy_files_default_always_yes);
+
+	/* the overwrite dialog needs a display */
+
+	if (gtk_init_check (&argc, &argv)) {
+		g_test_add_func ("/gio-utils/_g_copy_files_async/overwrite-always-yes", test_copy_files_overwrite_always_yes);
+		g_test_add_func ("/gio-utils/_g_copy_files_async/overwrite-always-no", test_copy_files_overwrite_always_no);
+	}
+
+	g_test_add_func ("/gio-utils/_g_file_append", test_file_append);
+
+	return g_test_run ();
+}
@@ -39,6 +39,27 @@ test_g_rand_string (void)
 }
 
 
+static void
+test_g_ptr_array_insert (void)
+{
+	GPtrArray *array;
+	char      *s;
+
+	array = g_ptr_array_new ();
+	_g_ptr_array_insert (array, 0, "b");
+	_g_ptr_array_insert (array, 0, "a");
+	_g_ptr_array_insert (array, 2, "d");
+	_g_ptr_array_insert (array, 2, "c");
+	_g_ptr_array_insert (array, -1, "e");
+
+	s = _g_string_array_join (array, ",");
+	g_assert_cmpstr (s, ==, "a,b,c,d,e");
+
+	g_free (s);
+	g_ptr_array_free (array, TRUE);
+}
+
+
 static void
 test_regexp (void)
 {
@@ -75,6 +96,7 @@ main (int   argc,
 	g_test_init (&argc, &argv, NULL);
 
 	g_test_add_func ("/glib-utils/_g_rand_string/1", test_g_rand_string);
+	g_test_add_func ("/glib-utils/_g_ptr_array_insert", test_g_ptr_array_insert);
 
 	test_regexp ();
 
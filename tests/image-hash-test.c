@@ -0,0 +1,173 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+/*
+ *  GThumb
+ *
+ *  Copyright (C) 2013 Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <config.h>
+#include "cairo-utils.h"
+#include "gth-image-hash.h"
+
+
+/* Returns an image with a horizontal gradient, from black to white if
+ * @ascending is TRUE, from white to black otherwise. */
+static cairo_surface_t *
+gradient_surface_new (int      width,
+		      int      height,
+		      gboolean ascending)
+{
+	cairo_surface_t *surface;
+	int              stride;
+	guchar          *pixels;
+	int              x, y;
+
+	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+	stride = cairo_image_surface_get_stride (surface);
+	pixels = cairo_image_surface_get_data (surface);
+	for (y = 0; y < height; y++) {
+		guchar *p = pixels + (y * stride);
+
+		for (x = 0; x < width; x++) {
+			guchar value;
+
+			value = x * 255 / (width - 1);
+			if (! ascending)
+				value = 255 - value;
+			p[CAIRO_RED] = value;
+			p[CAIRO_GREEN] = value;
+			p[CAIRO_BLUE] = value;
+			p[CAIRO_ALPHA] = 255;
+			p += 4;
+		}
+	}
+	cairo_surface_mark_dirty (surface);
+
+	return surface;
+}
+
+
+static void
+test_image_hash_from_surface (void)
+{
+	cairo_surface_t *surface;
+	guint64          hash;
+	guint64          scaled_hash;
+
+	g_assert (! gth_image_hash_from_surface (NULL, &hash));
+
+	/* too small */
+
+	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 4, 4);
+	g_assert (! gth_image_hash_from_surface (surface, &hash));
+	cairo_surface_destroy (surface);
+
+	/* unsupported format */
+
+	surface = cairo_image_surface_create (CAIRO_FORMAT_A8, 90, 80);
+	g_assert (! gth_image_hash_from_surface (surface, &hash));
+	cairo_surface_destroy (surface);
+
+	/* every cell is darker than the cell on its right */
+
+	surface = gradient_surface_new (90, 80, TRUE);
+	g_assert (gth_image_hash_from_surface (surface, &hash));
+	g_assert_cmpuint (hash, ==, G_MAXUINT64);
+	cairo_surface_destroy (surface);
+
+	surface = gradient_surface_new (90, 80, FALSE);
+	g_assert (gth_image_hash_from_surface (surface, &hash));
+	g_assert_cmpuint (hash, ==, 0);
+	cairo_surface_destroy (surface);
+
+	/* the hash doesn't depend on the image size */
+
+	surface = gradient_surface_new (90, 80, TRUE);
+	g_assert (gth_image_hash_from_surface (surface, &hash));
+	cairo_surface_destroy (surface);
+
+	surface = gradient_surface_new (270, 160, TRUE);
+	g_assert (gth_image_hash_from_surface (surface, &scaled_hash));
+	cairo_surface_destroy (surface);
+
+	g_assert_cmpint (gth_image_hash_distance (hash, scaled_hash), ==, 0);
+}
+
+
+static void
+test_image_hash_distance (void)
+{
+	g_assert_cmpint (gth_image_hash_distance (0, 0), ==, 0);
+	g_assert_cmpint (gth_image_hash_distance (G_MAXUINT64, G_MAXUINT64), ==, 0);
+	g_assert_cmpint (gth_image_hash_distance (0, G_MAXUINT64), ==, 64);
+	g_assert_cmpint (gth_image_hash_distance (0xf0, 0x0f), ==, 8);
+	g_assert_cmpint (gth_image_hash_distance (0x1, 0x3), ==, 1);
+	g_assert_cmpint (gth_image_hash_distance (G_GUINT64_CONSTANT (0x8000000000000000), 0), ==, 1);
+}
+
+
+static void
+test_image_hash_tree (void)
+{
+	GthImageHashTree *tree;
+
+	tree = gth_image_hash_tree_new (g_free);
+	g_assert (gth_image_hash_tree_find (tree, 0, 64) == NULL);
+
+	gth_image_hash_tree_add (tree, 0, g_strdup ("zero"));
+	gth_image_hash_tree_add (tree, 0xff, g_strdup ("byte"));
+	gth_image_hash_tree_add (tree, G_MAXUINT64, g_strdup ("all"));
+	gth_image_hash_tree_add (tree, 0xff00, g_strdup ("second byte"));
+	gth_image_hash_tree_add (tree, 0xffff, g_strdup ("word"));
+
+	/* exact match */
+
+	g_assert_cmpstr (gth_image_hash_tree_find (tree, 0, 0), ==, "zero");
+	g_assert_cmpstr (gth_image_hash_tree_find (tree, 0xff, 0), ==, "byte");
+	g_assert_cmpstr (gth_image_hash_tree_find (tree, 0xff00, 0), ==, "second byte");
+	g_assert_cmpstr (gth_image_hash_tree_find (tree, G_MAXUINT64, 0), ==, "all");
+
+	/* nearest within the distance */
+
+	g_assert_cmpstr (gth_image_hash_tree_find (tree, 0x3, 2), ==, "zero");
+	g_assert_cmpstr (gth_image_hash_tree_find (tree, 0x7f, 2), ==, "byte");
+	g_assert_cmpstr (gth_image_hash_tree_find (tree, 0xfffe, 2), ==, "word");
+	g_assert_cmpstr (gth_image_hash_tree_find (tree, G_MAXUINT64 ^ 0x11, 6), ==, "all");
+
+	/* nothing within the distance */
+
+	g_assert (gth_image_hash_tree_find (tree, 0xf, 3) == NULL);
+	g_assert (gth_image_hash_tree_find (tree, G_GUINT64_CONSTANT (0xffffffff00000000), 6) == NULL);
+
+	gth_image_hash_tree_free (tree);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/image-hash/gth_image_hash_from_surface", test_image_hash_from_surface);
+	g_test_add_func ("/image-hash/gth_image_hash_distance", test_image_hash_distance);
+	g_test_add_func ("/image-hash/gth_image_hash_tree", test_image_hash_tree);
+
+	return g_test_run ();
+}
@@ -0,0 +1,228 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+/*
+ *  GThumb
+ *
+ *  Copyright (C) 2013 Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <config.h>
+#include <glib/gstdio.h>
+#include "glib-utils.h"
+#include "gio-utils.h"
+#include "gth-file-data.h"
+#include "gth-main.h"
+#include "gth-metadata-cache.h"
+
+
+#define PROVIDER_ID "GthMetadataProviderTest"
+
+
+static GthMonitor *monitor = NULL;
+
+
+/* stubs for the functions of the application used by gth-metadata-cache.c,
+ * the other ones are in test-stubs.c */
+
+
+GthMonitor *
+gth_main_get_default_monitor (void)
+{
+	if (monitor == NULL)
+		monitor = gth_monitor_new ();
+	return monitor;
+}
+
+
+/* the files are not read, only the size and the modification time are used
+ * to validate the cache. */
+static GthFileData *
+file_data_new (const char *uri,
+	       guint64     size,
+	       guint64     mtime)
+{
+	GFile       *file;
+	GFileInfo   *info;
+	GthFileData *file_data;
+
+	file = g_file_new_for_uri (uri);
+	info = g_file_info_new ();
+	g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE, size);
+	g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED, mtime);
+	g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC, 0);
+	file_data = gth_file_data_new (file, info);
+
+	g_object_unref (info);
+	g_object_unref (file);
+
+	return file_data;
+}
+
+
+static void
+save_model (GthFileData *file_data,
+	    const char  *read_attributes,
+	    const char  *model)
+{
+	char *attribute_v[] = { "Exif::Image::Model", NULL };
+
+	g_file_info_set_attribute_string (file_data->info, "Exif::Image::Model", model);
+	gth_metadata_cache_save (file_data, PROVIDER_ID, read_attributes, attribute_v);
+}
+
+
+static void
+assert_cached_model (GthFileData *file_data,
+		     const char  *attributes,
+		     const char  *expected)
+{
+	g_file_info_remove_attribute (file_data->info, "Exif::Image::Model");
+	g_assert (gth_metadata_cache_load (file_data, PROVIDER_ID, attributes, NULL));
+	g_assert_cmpstr (g_file_info_get_attribute_string (file_data->info, "Exif::Image::Model"), ==, expected);
+}
+
+
+static void
+test_metadata_cache_load (void)
+{
+	GthFileData *file_data;
+	GthFileData *changed_file_data;
+	char        *read_attributes;
+
+	gth_metadata_cache_initialize ();
+
+	file_data = file_data_new ("file:///test/load/a.jpg", 100, 1000);
+	g_assert (! gth_metadata_cache_load (file_data, PROVIDER_ID, "Exif::*", NULL));
+
+	save_model (file_data, "Exif::*", "Camera");
+	assert_cached_model (file_data, "Exif::*", "Camera");
+	assert_cached_model (file_data, "Exif::Image::Model", "Camera");
+
+	/* another provider */
+
+	g_assert (! gth_metadata_cache_load (file_data, "GthMetadataProviderOther", "Exif::*", NULL));
+
+	/* more attributes than the ones read before */
+
+	g_assert (! gth_metadata_cache_load (file_data, PROVIDER_ID, "Exif::*,Xmp::*", &read_attributes));
+	g_assert_cmpstr (read_attributes, ==, "Exif::*");
+	g_free (read_attributes);
+
+	/* the file changed */
+
+	changed_file_data = file_data_new ("file:///test/load/a.jpg", 200, 1000);
+	g_assert (! gth_metadata_cache_load (changed_file_data, PROVIDER_ID, "Exif::*", NULL));
+	g_object_unref (changed_file_data);
+
+	changed_file_data = file_data_new ("file:///test/load/a.jpg", 100, 2000);
+	g_assert (! gth_metadata_cache_load (changed_file_data, PROVIDER_ID, "Exif::*", NULL));
+	g_object_unref (changed_file_data);
+
+	/* saved to disk */
+
+	gth_metadata_cache_release ();
+	gth_metadata_cache_initialize ();
+	assert_cached_model (file_data, "Exif::*", "Camera");
+
+	gth_metadata_cache_release ();
+	g_object_unref (file_data);
+}
+
+
+static void
+test_metadata_cache_remove (void)
+{
+	GthFileData *file_data;
+	GthFileData *other_file_data;
+	GFile       *folder;
+	GList       *list;
+
+	gth_metadata_cache_initialize ();
+
+	file_data = file_data_new ("file:///test/remove/a.jpg", 100, 1000);
+	other_file_data = file_data_new ("file:///test/remove/b.jpg", 100, 1000);
+	save_model (file_data, "Exif::*", "Camera");
+	save_model (other_file_data, "Exif::*", "Other camera");
+
+	/* folder in memory */
+
+	gth_metadata_cache_remove (file_data->file);
+	g_assert (! gth_metadata_cache_load (file_data, PROVIDER_ID, "Exif::*", NULL));
+	assert_cached_model (other_file_data, "Exif::*", "Other camera");
+
+	/* folder not in memory, changed while running */
+
+	save_model (file_data, "Exif::*", "Camera");
+	gth_metadata_cache_release ();
+	gth_metadata_cache_initialize ();
+
+	folder = g_file_new_for_uri ("file:///test/remove");
+	list = g_list_append (NULL, g_file_new_for_uri ("file:///test/remove/a.jpg"));
+	gth_monitor_folder_changed (gth_main_get_default_monitor (),
+				    folder,
+				    list,
+				    GTH_MONITOR_EVENT_CHANGED);
+	_g_object_list_unref (list);
+	g_object_unref (folder);
+
+	g_assert (! gth_metadata_cache_load (file_data, PROVIDER_ID, "Exif::*", NULL));
+	assert_cached_model (other_file_data, "Exif::*", "Other camera");
+
+	/* folder not in memory, changed before exiting */
+
+	save_model (file_data, "Exif::*", "Camera");
+	gth_metadata_cache_release ();
+	gth_metadata_cache_initialize ();
+
+	gth_metadata_cache_remove (file_data->file);
+	gth_metadata_cache_release ();
+	gth_metadata_cache_initialize ();
+
+	g_assert (! gth_metadata_cache_load (file_data, PROVIDER_ID, "Exif::*", NULL));
+	g_assert (! gth_metadata_cache_load (other_file_data, PROVIDER_ID, "Exif::*", NULL));
+
+	gth_metadata_cache_release ();
+	g_object_unref (other_file_data);
+	g_object_unref (file_data);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	char *cache_dir;
+	int   result;
+
+	/* use a temporary cache directory */
+
+	cache_dir = g_dir_make_tmp ("gthumb-test-XXXXXX", NULL);
+	g_assert (cache_dir != NULL);
+	g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
+
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/metadata-cache/load", test_metadata_cache_load);
+	g_test_add_func ("/metadata-cache/remove", test_metadata_cache_remove);
+
+	result = g_test_run ();
+
+	g_free (cache_dir);
+
+	return result;
+}
@@ -0,0 +1,129 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+
+/*
+ *  GThumb
+ *
+ *  Copyright (C) 2013 Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <config.h>
+#include <gtk/gtk.h>
+#include "gio-utils.h"
+#include "gth-metadata-provider.h"
+#include "gth-overwrite-dialog.h"
+#include "test-stubs.h"
+
+
+/* stubs for the functions of the application used by gio-utils.c, shared
+ * by the tests.  The overwrite dialog is answered with the response set
+ * with test_stubs_set_overwrite_response, as soon as the main loop runs,
+ * it must not be shown if no response is set. */
+
+
+static GthOverwriteResponse overwrite_response = GTH_OVERWRITE_RESPONSE_UNSPECIFIED;
+static int                  n_overwrite_dialogs = 0;
+
+
+void
+test_stubs_set_overwrite_response (GthOverwriteResponse response)
+{
+	overwrite_response = response;
+	n_overwrite_dialogs = 0;
+}
+
+
+int
+test_stubs_get_n_overwrite_dialogs (void)
+{
+	return n_overwrite_dialogs;
+}
+
+
+void
+gth_hook_invoke (const char *name,
+		 gpointer    first_data,
+		 ...)
+{
+}
+
+
+GType
+gth_overwrite_dialog_get_type (void)
+{
+	return GTK_TYPE_DIALOG;
+}
+
+
+static gboolean
+overwrite_dialog_respond_cb (gpointer user_data)
+{
+	gtk_dialog_response (GTK_DIALOG (user_data), GTK_RESPONSE_OK);
+	return FALSE;
+}
+
+
+GtkWidget *
+gth_overwrite_dialog_new (GFile                *source,
+			  GthImage             *source_image,
+			  GFile                *destination,
+			  GthOverwriteResponse  default_respose,
+			  gboolean              single_file)
+{
+	GtkWidget *dialog;
+
+	g_assert (overwrite_response != GTH_OVERWRITE_RESPONSE_UNSPECIFIED);
+
+	n_overwrite_dialogs++;
+	dialog = gtk_dialog_new ();
+	g_idle_add (overwrite_dialog_respond_cb, dialog);
+
+	return dialog;
+}
+
+
+GthOverwriteResponse
+gth_overwrite_dialog_get_response (GthOverwriteDialog *dialog)
+{
+	return overwrite_response;
+}
+
+
+const char *
+gth_overwrite_dialog_get_filename (GthOverwriteDialog *dialog)
+{
+	return NULL;
+}
+
+
+void
+_g_query_metadata_async (GList               *files,
+			 const char          *attributes,
+			 GCancellable        *cancellable,
+			 GAsyncReadyCallback  callback,
+			 gpointer             user_data)
+{
+	g_assert_not_reached ();
+}
+
+
+GList *
+_g_query_metadata_finish (GAsyncResult  *result,
+			  GError       **error)
+{
+	g_assert_not_reached ();
+	return NULL;
+}